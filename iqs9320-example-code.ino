@@ -20,6 +20,10 @@
  *                  - Channel states (Channel 0 -> 19)                        *
  *                  - Power Mode Feedback                                     *
  *                                                                            *
+ *              With DEMO_IQS9320_BINARY_STREAM the data is sent as compact   *
+ *              binary packets instead, decode them on the PC with            *
+ *              tools/iqs9320-stream.                                         *
+ *                                                                            *
  * @author      Azoteq PTY Ltd                                                *
  * @version     v1.5                                                          *
  * @date        2024-06-10                                                    *
@@ -27,6 +31,9 @@
 
 #include <Arduino.h>
 #include "src\IQS9320\IQS9320.h"
+#include "src\IQS9320\IQS9320_fixed.h"
+#include "src\IQS9320\IQS9320_layout.h"
+#include "src\IQS9320\IQS9320_stream.h"
 
 /*** Defines ***/
 #define DEMO_IQS9320_ADDR                      0x3E
@@ -35,36 +42,55 @@
 #define DEMO_IQS9320_NR_CHANNELS               20
 #define DEMO_IQS9320_SAMPLE_TIME               10
 
+/* Send binary packets (see IQS9320_stream.h) instead of the text table, and
+   optionally include the channel deltas in every packet */
+#define DEMO_IQS9320_BINARY_STREAM             true
+#define DEMO_IQS9320_STREAM_DELTAS             false
+
+/* Binary stream only: also send every I2C transaction of the driver as a
+   TRACE packet. Save them with iqs9320-stream -f trace and replay the file
+   with tools/iqs9320-replay */
+#define DEMO_IQS9320_BUS_CAPTURE               false
+
+/* Text table only: update the changed cells in place with ANSI cursor
+   movement instead of printing a new table for every change */
+#define DEMO_IQS9320_ANSI_UI                   true
+
+/* Text table layout, used to position the cursor for in-place updates */
+#define DEMO_UI_ROWS_BELOW_KEYS                13  // Lines from cursor to key row 0
+#define DEMO_UI_ROWS_BELOW_POWER               3   // Lines from cursor to power mode
+
 /*** Instances ***/
-IQS9320 iqs9320;
+/* Frame reads of this firmware version and channel count, the deltas are
+   only read when they are streamed */
+IQS9320Fixed<IQS9320_VERSION, DEMO_IQS9320_NR_CHANNELS,
+             DEMO_IQS9320_STREAM_DELTAS ? IQS9320_FEATURE_DEBUG : 0> iqs9320;
 
 /*** Global Variables ***/
 iqs9320_ch_states key_states[DEMO_IQS9320_NR_CHANNELS];
 iqs9320_power_mode_e power_mode = IQS9320_NORMAL_POWER;
 uint32_t demo_sample_timer = 0;
+iqs9320_frame_s frame;
+iqs9320_stream_packet_s stream_packet;
+uint32_t ui_dirty_channels = 0;  // Channels of which the table cell changed
+bool ui_dirty_power = false;     // Power mode line changed
+bool ui_drawn = false;           // Full table is on screen below the cursor
+uint32_t capture_timestamp = 0;  // Time of the previous captured transaction
 
-/* Channel layout for the keys on EV-Kit */
-#ifdef IQS9320_V1_0
-uint8_t ch_seq[DEMO_IQS9320_NR_CHANNELS] = {8,  18, 7,  17,
-                                            19, 9,  6,  16,
-                                            2,  11, 14, 5,
-                                            10, 0,  4,  15,
-                                            1,  12, 13, 3};
-#endif
-
-#ifdef IQS9320_V0_7
-uint8_t ch_seq[DEMO_IQS9320_NR_CHANNELS] = {8,  18, 7,  17,
-                                            19, 9,  6,  16,
-                                            2,  11, 14, 5,
-                                            10, 0,  4,  15,
-                                            1,  12, 13, 3};
+/* Channel of every key on the EV-Kit, row by row from the top left */
+#if defined(IQS9320_V1_0) || defined(IQS9320_V0_7)
+typedef IQS9320Layout<5, 4,  8,  18, 7,  17,
+                             19, 9,  6,  16,
+                             2,  11, 14, 5,
+                             10, 0,  4,  15,
+                             1,  12, 13, 3> EvKitLayout;
 #endif
 #ifdef IQS9320_V0_4
-uint8_t ch_seq[DEMO_IQS9320_NR_CHANNELS] = {1,  11, 2,  12,
-                                            10, 0,  3,  13,
-                                            7,  18, 15, 4,
-                                            19, 9,  5,  14,
-                                            8,  17, 16, 6};
+typedef IQS9320Layout<5, 4,  1,  11, 2,  12,
+                             10, 0,  3,  13,
+                             7,  18, 15, 4,
+                             19, 9,  5,  14,
+                             8,  17, 16, 6> EvKitLayout;
 #endif
 
 void setup()
@@ -83,7 +109,11 @@ void setup()
   digitalWrite(DEMO_IQS9320_POWER_PIN, HIGH);
 
   /* Initialize the IQS9320 with input parameters device address and RDY pin */
-  iqs9320.begin(DEMO_IQS9320_ADDR, DEMO_IQS9320_MCLR_PIN, DEMO_IQS9320_NR_CHANNELS);
+  iqs9320.begin(DEMO_IQS9320_ADDR, DEMO_IQS9320_MCLR_PIN);
+  if(DEMO_IQS9320_BINARY_STREAM && DEMO_IQS9320_BUS_CAPTURE)
+  {
+    iqs9320.setCaptureCallback(capture_transfer); // Trace starts at init
+  }
   Serial.println("IQS9320 Ready");
   delay(200);
 
@@ -95,6 +125,13 @@ void loop()
 {
   iqs9320.run(); // Runs the IQS9320 program loop
 
+  /* The driver prints progress during (re-)initialization, draw a new table
+     below it afterwards */
+  if(iqs9320.iqs9320_state.state == IQS9320_STATE_INIT)
+  {
+    ui_drawn = false;
+  }
+
   /* Request data from IQS9320 devices every IQS_SAMPLE_TIME ms.
      IQS9320 should be in idle state */
   if(iqs9320.iqs9320_state.state == IQS9320_STATE_IDLE)
@@ -109,8 +146,16 @@ void loop()
   /* Process data read from IQS9320 when new data is available */
   if(iqs9320.new_data_available)
   {
-    check_power_mode();     // Verify if a power mode change occurred
-    check_channel_states(); // Check if a channel state change has occurred
+    if(DEMO_IQS9320_BINARY_STREAM)
+    {
+      stream_frame();         // Send a packet when anything changed
+    }
+    else
+    {
+      check_power_mode();     // Verify if a power mode change occurred
+      check_channel_states(); // Check if a channel state change has occurred
+      serial_ui_update();     // Redraw the changes of this frame at once
+    }
 
     iqs9320.new_data_available = false;
   }
@@ -123,47 +168,71 @@ void check_power_mode(void)
   if (current_pm != power_mode)
   {
     power_mode = current_pm;
-    serial_ui_print();
+    ui_dirty_power = true;
   }
 }
 
-/* Function to check the proximity and touch states of the three IQS9320 channels*/
+/* Function to check the proximity and touch states of the IQS9320 channels.
+   Changes are only collected here, the table is updated once per frame by
+   serial_ui_update() */
 void check_channel_states(void)
 {
-  for (uint8_t i = 0; i < DEMO_IQS9320_NR_CHANNELS; i++)
+  for (uint8_t i = 0; i < iqs9320.getChannelCount(); i++)
   {
+    iqs9320_ch_states new_state = IQS9320_CH_NONE;
+
     /* Check if the activation state bit is set */
     if(iqs9320.getChannelActivation((iqs9320_channel_e)i))
     {
-      if(key_states[i] != IQS9320_CH_ACTIVATION)
-      {
-        key_states[i] = IQS9320_CH_ACTIVATION;
-        serial_ui_print();
-      }
+      new_state = IQS9320_CH_ACTIVATION;
     }
 
     /* Check if the filter halt state bit is set */
     else if (iqs9320.getChannelFilterHalt((iqs9320_channel_e)i))
     {
-      if(key_states[i] != IQS9320_CH_FILTER_HALT)
-      {
-        key_states[i] = IQS9320_CH_FILTER_HALT;
-        serial_ui_print();
-      }
+      new_state = IQS9320_CH_FILTER_HALT;
     }
 
-    /* None state if neither the activation nor filter halt bit was set to 1 */
-    else
+    /* Only activations are shown in the table */
+    if((new_state == IQS9320_CH_ACTIVATION) != (key_states[i] == IQS9320_CH_ACTIVATION))
     {
-      if(key_states[i] != IQS9320_CH_NONE)
-      {
-        key_states[i] = IQS9320_CH_NONE;
-        serial_ui_print();
-      }
+      ui_dirty_channels |= (1UL << i);
     }
+    key_states[i] = new_state;
   }
 }
 
+/* Function to send the latest data as one binary packet. Without deltas a
+   packet is only sent when the power mode or a channel state changed. */
+void stream_frame(void)
+{
+  uint8_t buffer[IQS9320_STREAM_MAX_PACKET];
+
+  iqs9320.decodeFrame(&frame, 0);
+
+  bool changed = (frame.activation[0] != stream_packet.activation)
+              || (frame.filter_halt[0] != stream_packet.filter_halt)
+              || ((uint8_t)frame.system_status[0] != (uint8_t)stream_packet.system_status);
+
+  if(changed || DEMO_IQS9320_STREAM_DELTAS)
+  {
+    iqs9320_stream_from_frame(&frame, 0, DEMO_IQS9320_STREAM_DELTAS ? iqs9320.getChannelCount() : 0, &stream_packet);
+    stream_packet.seq++;
+    Serial.write(buffer, iqs9320_stream_encode(&stream_packet, buffer));
+  }
+}
+
+/* Send one I2C transaction of the driver as a TRACE packet */
+void capture_transfer(const iqs9320_trace_record_s *record)
+{
+  uint8_t trace[IQS9320_TRACE_MAX_RECORD];
+  uint8_t buffer[IQS9320_STREAM_MAX_PACKET];
+
+  size_t length = iqs9320_trace_encode(record, capture_timestamp, trace);
+  capture_timestamp = record->timestamp;
+  Serial.write(buffer, iqs9320_stream_encode_raw(IQS9320_STREAM_TYPE_TRACE, trace, length, buffer));
+}
+
 /* Force the IQS9320 to open a RDY window and read the current state of the
  * device or request a software reset */
 void force_comms_and_reset(void)
@@ -192,75 +261,128 @@ char read_message(void)
   return '\n';
 }
 
-/* Function that prints out the activation status of each channel over serial
-   in table format. */
-void serial_ui_print(void)
+/* Function that brings the table on the serial terminal up to date with the
+   changes collected during this frame. Prints the full table the first time,
+   afterwards only the changed cells are rewritten when DEMO_IQS9320_ANSI_UI is
+   enabled. */
+void serial_ui_update(void)
 {
-  Serial.println("");
-  Serial.println("    IQS9320 20-KEY EV-KIT    ");
-  Serial.println("=============================");
-  Serial.print("|");
-
-  /* Print channel names in table and split total channels in 2 lines */
-  uint8_t half_ch = DEMO_IQS9320_NR_CHANNELS/2;
-  for(uint8_t i = 0; i < DEMO_IQS9320_NR_CHANNELS; i++)
+  if(!ui_drawn || !DEMO_IQS9320_ANSI_UI)
   {
-    /* Print divider line */
-    if (i % 4 == 0 && i != 0)
+    if(!ui_drawn || ui_dirty_channels || ui_dirty_power)
     {
-      Serial.println(" ");
-      Serial.println("|---------------------------|");
-      Serial.print("|");
+      serial_ui_print();
+      ui_drawn = true;
     }
+  }
+  else if(ui_dirty_channels || ui_dirty_power)
+  {
+    /* Changed cells in key order */
+    uint32_t dirty_keys = EvKitLayout::toKeyOrder(ui_dirty_channels);
 
-    /* Check if activation bit is set and fill block */
-    if(key_states[ch_seq[i]] == 2)
+    Serial.print("\e[s"); // Save the cursor below the table
+
+    for(uint8_t i = 0; i < EvKitLayout::keys; i++)
     {
-      Serial.print("███");
-      if (ch_seq[i] < 10)
-      {
-        Serial.print("█");
-        Serial.print("██|");
-      }
-      else
+      if(dirty_keys & (1UL << i))
       {
-        Serial.print("██");
-        Serial.print("█|");
+        /* Move up to the key row and to the column of the cell */
+        Serial.print("\e[");
+        Serial.print(DEMO_UI_ROWS_BELOW_KEYS - 2*EvKitLayout::row(i));
+        Serial.print("A\e[");
+        Serial.print(2 + 7*EvKitLayout::col(i));
+        Serial.print("G");
+        serial_ui_print_cell(EvKitLayout::channel(i));
+        Serial.print("\e[u");
+        Serial.print("\e[s");
       }
     }
-    else
+
+    if(ui_dirty_power)
     {
-      Serial.print(" CH");
-      Serial.print(ch_seq[i]);
-      if (ch_seq[i] < 10)
-      {
-        Serial.print("  |");
-      }
-      else
-      {
-        Serial.print(" |");
-      }
+      Serial.print("\e[");
+      Serial.print(DEMO_UI_ROWS_BELOW_POWER);
+      Serial.print("A\e[2G");
+      serial_ui_print_power();
     }
+
+    Serial.print("\e[u"); // Back to below the table
   }
 
-  /* Close table with double line */
-  Serial.println(" ");
-  Serial.println("|---------------------------|");
+  ui_dirty_channels = 0;
+  ui_dirty_power = false;
+}
+
+/* Function that prints the 6 character table cell of a channel */
+void serial_ui_print_cell(uint8_t ch)
+{
+  /* Check if activation bit is set and fill block */
+  if(key_states[ch] == IQS9320_CH_ACTIVATION)
+  {
+    Serial.print("██████");
+  }
+  else
+  {
+    Serial.print(" CH");
+    Serial.print(ch);
+    if (ch < 10)
+    {
+      Serial.print("  ");
+    }
+    else
+    {
+      Serial.print(" ");
+    }
+  }
+}
 
+/* Function that prints the 27 character power mode line of the table */
+void serial_ui_print_power(void)
+{
   switch (power_mode)
   {
   case IQS9320_NORMAL_POWER:
-    Serial.println("|        Normal Power       |");
+    Serial.print("        Normal Power       ");
     break;
 
   case IQS9320_LOW_POWER:
-    Serial.println("|         Low Power         |");
+    Serial.print("         Low Power         ");
     break;
 
   case IQS9320_ULTRA_LOW_POWER:
-    Serial.println("|      Ultra Low Power      |");
+    Serial.print("      Ultra Low Power      ");
     break;
   }
+}
 
+/* Function that prints out the activation status of each channel over serial
+   in table format. */
+void serial_ui_print(void)
+{
+  Serial.println("");
+  Serial.println("    IQS9320 20-KEY EV-KIT    ");
+  Serial.println("=============================");
+  Serial.print("|");
+
+  for(uint8_t i = 0; i < EvKitLayout::keys; i++)
+  {
+    /* Print divider line */
+    if (EvKitLayout::col(i) == 0 && i != 0)
+    {
+      Serial.println(" ");
+      Serial.println("|---------------------------|");
+      Serial.print("|");
+    }
+
+    serial_ui_print_cell(EvKitLayout::channel(i));
+    Serial.print("|");
+  }
+
+  /* Close table with double line */
+  Serial.println(" ");
+  Serial.println("|---------------------------|");
+  Serial.print("|");
+  serial_ui_print_power();
+  Serial.println("|");
   Serial.println("=============================\n");
 }
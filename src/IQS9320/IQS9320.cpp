@@ -40,13 +40,76 @@
 #include "IQS9320_v0_4_init.h"
 #endif
 
+/* Channels enabled in the init file: the channels of the two conversion
+   cycles, without the ones set in CHANNEL_DISABLE */
+#if defined(CHANNEL_DISABLE_0)
+#define IQS9320_DISABLED_MASK     ((uint32_t)CHANNEL_DISABLE_0 | ((uint32_t)CHANNEL_DISABLE_1 << 8) \
+                                  | ((uint32_t)CHANNEL_DISABLE_2 << 16))
+#else
+#define IQS9320_DISABLED_MASK     0UL
+#endif
+#define IQS9320_CYCLE_MASK        ((1UL << (CYCLE_0_SELECT + CYCLE_1_SELECT)) - 1)
+#define IQS9320_ENABLED_MASK      (IQS9320_CYCLE_MASK & ~IQS9320_DISABLED_MASK)
+
 /* Private Functions */
 
+/* Channels up to the last enabled one, the reads and decoded frames cover
+   these; disabled channels below it read as 0 */
+static uint8_t iqs9320_enabled_span(void)
+{
+  uint8_t span = 0;
+
+  for(uint8_t ch = 0; ch < IQS9320_MAX_CHANNELS; ch++)
+  {
+    if(IQS9320_ENABLED_MASK & (1UL << ch))
+    {
+      span = ch + 1;
+    }
+  }
+  return span;
+}
+
+
+/* Clocks tried by trainClock(), below the limit set with setClockLimit() */
+static const uint32_t iqs9320_clocks[] = {100000, 400000, 1000000};
+#define IQS9320_CLOCK_STEPS             (sizeof(iqs9320_clocks) / sizeof(iqs9320_clocks[0]))
 
 /*****************************************************************************/
 /*                             CONSTRUCTORS                                  */
 /*****************************************************************************/
 IQS9320::IQS9320(){
+  _frame_job_count = 0;
+  _read_plan = IQS9320_READ_BURST;
+  _frame_probe = false;
+  _frame_failed = false;
+  _plan_burst = true;
+  _plan_rate = 0;
+  _plan_refresh = 0;
+  clearReadStats();
+  _clock_step = 0;
+  _clock_jobs = 0;
+  _clock_errors = 0;
+  _clock_owner = NULL;
+  _reset_time_us = 0;
+  _reset_worst_us = 0;
+  _mclr_retries = 0;
+  _failed_frames = 0;
+  _bus_jobs = 0;
+  _bus_errors = 0;
+  _init_reads = 0;
+  _init_scheduled = false;
+  _init_wait_start = 0;
+  _init_wait_us = 0;
+  _power_mode = IQS9320_NORMAL_POWER;
+  clearPowerStats();
+  _power_session = false;
+  _power_applied = IQS9320_TIMEOUTS_INIT;
+  _activity_ms = 0;
+  _idle_ms = 0;
+  _idle_np_timeout = 0;
+  _idle_lp_timeout = 0;
+  setClockLimit(IQS9320_CLOCK_MAX);
+  _transfer.begin(&_wire_port);
 }
 
 /*****************************************************************************/
@@ -72,12 +135,22 @@ IQS9320::IQS9320(){
   *           take place at all.
   *         - If communication is successfully established then it is unlikely
   *           that initialization will fail.
+  *         - nChannels is limited to the last channel enabled with
+  *           CYCLE_0_SELECT, CYCLE_1_SELECT and CHANNEL_DISABLE in the init
+  *           file, see getChannelCount(). The settings of every enabled
+  *           channel are still written.
 */
 void IQS9320::begin(uint8_t deviceAddressIn, uint8_t mclr_pin, uint8_t nChannels)
 {
   // Initialize I2C communication here, since this library can't function without it.
-  Wire.begin();
-  Wire.setClock(400000);
+  _wire_port.begin(_clock_owner ? _clock_owner->getClock() : 400000);
+
+  /* Step of the 400 kHz clock until trainClock() */
+  _clock_step = 0;
+  while((_clock_step + 1 < _clock_steps) && (clockFrequency(_clock_step + 1) <= 400000))
+  {
+    _clock_step++;
+  }
 
   /* Initialize I2C communication here, since this library can't function
   without it. */
@@ -85,10 +158,21 @@ void IQS9320::begin(uint8_t deviceAddressIn, uint8_t mclr_pin, uint8_t nChannels
   _nChannels      = nChannels;
   _mclr_pin       = mclr_pin;
   _debug_en       = false;
+  _settings_pending = 0;
+  _version_valid  = false;
+
+  _mclr_retries   = 0;
+  _failed_frames  = 0;
+  _init_reads     = 0;
+  _init_scheduled = false;
+  _init_wait_us   = 0;
 
   /* Set MCLR pins and pull HIGH */
-  pinMode(_mclr_pin, OUTPUT);
-  digitalWrite(_mclr_pin, HIGH);
+  if(_mclr_pin != IQS9320_MCLR_NONE)
+  {
+    pinMode(_mclr_pin, OUTPUT);
+    digitalWrite(_mclr_pin, HIGH);
+  }
 
   /* Float the other pins to prevent interference */
   pinMode(19, INPUT);
@@ -97,6 +181,16 @@ void IQS9320::begin(uint8_t deviceAddressIn, uint8_t mclr_pin, uint8_t nChannels
   pinMode(16, INPUT);
   pinMode(3, INPUT);
 
+  /* Size all channel reads and writes to the channels that are in use */
+  if(_nChannels > iqs9320_enabled_span())
+  {
+    _nChannels = iqs9320_enabled_span();
+  }
+  if(_nChannels > IQS9320_MAX_CHANNELS)
+  {
+    _nChannels = IQS9320_MAX_CHANNELS;
+  }
+
   /* Initialize "running" and "init" state machine variables. */
   iqs9320_state.state = IQS9320_STATE_START;
   iqs9320_state.init_state = IQS9320_INIT_VERIFY_PRODUCT;
@@ -116,6 +210,14 @@ bool IQS9320::init(void)
 {
   uint16_t prod_num;
   uint8_t ver_maj, ver_min;
+  bool answered;
+
+  /* The wait of the previous step, only left running when the start-up is
+  scheduled by IQS9320Group */
+  if(initWaitRemaining() > 0)
+  {
+    return false;
+  }
 
   switch (iqs9320_state.init_state)
   {
@@ -123,24 +225,61 @@ bool IQS9320::init(void)
     for this example */
     case IQS9320_INIT_VERIFY_PRODUCT:
       Serial.println("IQS9320_INIT_VERIFY_PRODUCT");
-      prod_num = getProductNum(STOP);
-      ver_maj = getmajorVersion(STOP);
-      ver_min = getminorVersion(STOP);
+      /* One burst of the version details, unless they were found by
+      enumerate() */
+      answered = true;
+      if(!_version_valid)
+      {
+        answered = readVersionDetails(STOP);
+      }
+      _version_valid = false;
+      prod_num = (uint16_t)(IQSMemoryMap.VERSION_DETAILS[0] | (IQSMemoryMap.VERSION_DETAILS[1] << 8));
+      ver_maj = IQSMemoryMap.VERSION_DETAILS[IQS9320_MM_MAJOR_VERSION_NUM];
+      ver_min = IQSMemoryMap.VERSION_DETAILS[IQS9320_MM_MINOR_VERSION_NUM];
       Serial.print("\t\tProduct number is: ");
       Serial.print(prod_num);
       Serial.print(" v");
       Serial.print(ver_maj);
       Serial.print(".");
       Serial.println(ver_min);
-      if(prod_num == IQS9320_PRODUCT_NUM)
+      if(answered && (prod_num == IQS9320_PRODUCT_NUM))
       {
-        iqs9320_state.init_state = IQS9320_INIT_READ_RESET;
+        _mclr_retries = 0;
+        iqs9320_state.init_state = IQS9320_CLOCK_TRAINING ? IQS9320_INIT_TRAIN_CLOCK : IQS9320_INIT_READ_RESET;
       }
-      else
+      /* Another product answered, a reset does not change that */
+      else if(answered)
       {
         Serial.println("\t\tDevice is not a IQS9320!");
         iqs9320_state.init_state = IQS9320_INIT_NONE;
       }
+      /* A device that does not answer may hold the bus, release it and
+      reset the device through MCLR before it is read again */
+      else if(_mclr_retries < IQS9320_MCLR_RETRY)
+      {
+        _mclr_retries++;
+        Serial.println("\t\tNo answer, Bus Recovery.");
+        recoverBus();
+        if(_mclr_pin != IQS9320_MCLR_NONE)
+        {
+          Serial.println("\t\tMCLR Reset.");
+          HW_Reset();
+        }
+      }
+      else
+      {
+        Serial.println("\t\tNo answer from the device!");
+        iqs9320_state.init_state = IQS9320_INIT_NONE;
+      }
+    break;
+
+    /* Find the fastest clock the bus carries without errors */
+    case IQS9320_INIT_TRAIN_CLOCK:
+      Serial.println("IQS9320_INIT_TRAIN_CLOCK");
+      Serial.print("\t\tI2C clock: ");
+      Serial.print(trainClock());
+      Serial.println(" Hz");
+      iqs9320_state.init_state = IQS9320_INIT_READ_RESET;
     break;
 
     /* Verify if a reset has occurred */
@@ -159,14 +298,34 @@ bool IQS9320::init(void)
       }
     break;
 
-    /* Perform SW Reset */
+    /* Perform SW Reset, or pulse MCLR, and wait until the device shows the
+    reset */
     case IQS9320_INIT_CHIP_RESET:
        Serial.println("IQS9320_INIT_CHIP_RESET");
-
-      //Perform SW Reset
-      SW_Reset(STOP);
-      Serial.println("\t\tSoftware Reset Bit Set.");
-      delay(100);
+      {
+        bool ready;
+
+        if(IQS9320_RESET_MCLR && (_mclr_pin != IQS9320_MCLR_NONE))
+        {
+          Serial.println("\t\tMCLR Reset.");
+          ready = HW_Reset();
+        }
+        else
+        {
+          uint32_t start_us = micros();
+
+          //Perform SW Reset
+          SW_Reset(STOP);
+          Serial.println("\t\tSoftware Reset Bit Set.");
+          ready = waitReady(start_us);
+        }
+        if(ready)
+        {
+          Serial.print("\t\tReady after ");
+          Serial.print(_reset_time_us);
+          Serial.println(" us");
+        }
+      }
       iqs9320_state.init_state = IQS9320_INIT_READ_RESET;
     break;
 
@@ -174,7 +333,7 @@ bool IQS9320::init(void)
     case IQS9320_INIT_ACK_RESET:
       Serial.println("IQS9320_INIT_ACK_RESET");
       acknowledgeReset(STOP);
-      delay(10);
+      initWait(10);
       iqs9320_state.init_state = IQS9320_INIT_UPDATE_SETTINGS;
       break;
 
@@ -182,6 +341,31 @@ bool IQS9320::init(void)
     case IQS9320_INIT_UPDATE_SETTINGS:
       Serial.println("IQS9320_INIT_UPDATE_SETTINGS");
       updateSettings(STOP);
+      iqs9320_state.init_state = IQS9320_INIT_VERIFY_SETTINGS;
+    break;
+
+    /* Read the settings back and rewrite the ranges that differ, before ATI
+    changes the mirror selection */
+    case IQS9320_INIT_VERIFY_SETTINGS:
+      Serial.println("IQS9320_INIT_VERIFY_SETTINGS");
+      {
+        iqs9320_verify_s verify;
+        bool verified = verifySettings(true, &verify);
+
+        for(uint8_t i = 0; (i < verify.nRanges) && (i < IQS9320_VERIFY_MAX_RANGES); i++)
+        {
+          Serial.print("\t\tRewrite 0x");
+          Serial.print(verify.ranges[i].address, HEX);
+          Serial.print(" (");
+          Serial.print(verify.ranges[i].length);
+          Serial.println(" bytes)");
+        }
+        Serial.print(verified ? "\t\tSettings verified, " : "\t\tSettings do not match, ");
+        Serial.print(verify.bytes);
+        Serial.print(" bytes in ");
+        Serial.print(verify.reads);
+        Serial.println(" reads");
+      }
       iqs9320_state.init_state = IQS9320_INIT_DEFAULT_READ_SYS_STATUS;
     break;
 
@@ -196,7 +380,7 @@ bool IQS9320::init(void)
     case IQS9320_INIT_RECONFIG_DEV:
       Serial.println("IQS9320_INIT_RECONFIG_DEV");
       reconfigureDevice(STOP);
-      delay(10);
+      initWait(10);
       iqs9320_state.init_state = IQS9320_INIT_ATI;
     break;
 
@@ -204,18 +388,22 @@ bool IQS9320::init(void)
     case IQS9320_INIT_ATI:
       Serial.println("IQS9320_INIT_ATI");
       ReATI(STOP);
+      initWait(10);
       iqs9320_state.init_state = IQS9320_INIT_WAIT_FOR_ATI;
       Serial.println("IQS9320_INIT_WAIT_FOR_ATI");
     break;
 
     /* Read the ATI Active bit to see if the rest of the program can continue */
     case IQS9320_INIT_WAIT_FOR_ATI:
-      delay(10);
       if(!readATIactive())
       {
         Serial.println("\t\tDONE");
         iqs9320_state.init_state = IQS9320_INIT_RESEED;
       }
+      else
+      {
+        initWait(10);
+      }
     break;
 
     /* Ressed the counts to match LTA after device is configured */
@@ -227,12 +415,17 @@ bool IQS9320::init(void)
 
     /* Read the latest data from the iqs9320 */
     case IQS9320_INIT_READ_DATA:
-      Serial.println("IQS9320_INIT_READ_DATA");
-      queueValueUpdates();
-      delay(10);
+      if(_init_reads == 0)
+      {
+        Serial.println("IQS9320_INIT_READ_DATA");
+      }
       queueValueUpdates();
-      delay(10);
-      iqs9320_state.init_state = IQS9320_INIT_DONE;
+      initWait(10);
+      if(++_init_reads >= 2)
+      {
+        _init_reads = 0;
+        iqs9320_state.init_state = IQS9320_INIT_DONE;
+      }
     break;
 
     /* If all operations have been completed correctly, the RDY pin can be set
@@ -240,6 +433,9 @@ bool IQS9320::init(void)
     case IQS9320_INIT_DONE:
       Serial.println("IQS9320_INIT_DONE\n");
       Serial.print("\e[s");
+      _power_timing = false; // The start-up is not counted in a power mode
+      _power_applied = IQS9320_TIMEOUTS_INIT; // Written by the start-up
+      _activity_ms = millis();
       new_data_available = true;
       return true;
     break;
@@ -265,6 +461,9 @@ bool IQS9320::init(void)
   */
 void IQS9320::run(void)
 {
+  /* Advance the queued transfers, a no-op with the blocking Wire port */
+  _transfer.service();
+
   switch (iqs9320_state.state)
   {
     /* After a hardware reset, this is the starting position of the main
@@ -290,6 +489,11 @@ void IQS9320::run(void)
     /* Continuous reset monitoring state, ensure no reset event has occurred
     for data to be valid */
     case IQS9320_STATE_CHECK_RESET:
+      checkClock();
+      if(checkBus())
+      {
+        break;
+      }
       if(checkReset())
       {
         Serial.println("Reset Occurred!\n");
@@ -302,22 +506,45 @@ void IQS9320::run(void)
       window */
       else
       {
-        new_data_available = true; /* No reset, thus data is valid */
+        /* No reset, thus data is valid unless a read of the frame failed */
+        new_data_available = !_frame_failed;
+        if(new_data_available)
+        {
+          countPowerMode();
+        }
         iqs9320_state.state = IQS9320_STATE_IDLE;
       }
     break;
 
     /* If a RDY Window is open, read the latest values from the IQS9320 */
     case IQS9320_STATE_RUN:
-      queueValueUpdates();
+      startValueUpdates();
       new_data_available = false;
-      iqs9320_state.state = IQS9320_STATE_CHECK_RESET;
+      iqs9320_state.state = IQS9320_STATE_WAIT_FOR_DATA;
+      // fall through, a blocking port has completed the reads already
+
+    /* Wait until all reads of the frame have completed, a probe that found
+    a change queues the rest of the frame */
+    case IQS9320_STATE_WAIT_FOR_DATA:
+      while(valueUpdatesDone())
+      {
+        if(!continueValueUpdates())
+        {
+          finishValueUpdates();
+          iqs9320_state.state = IQS9320_STATE_CHECK_RESET;
+          break;
+        }
+      }
     break;
 
     /* Idle State for the IQS9320, the user should request new data to promt
     the IQS9320 to change state */
     case IQS9320_STATE_IDLE:
     break;
+
+    /* Not started with begin(), nothing to do */
+    case IQS9320_STATE_NONE:
+    break;
   }
 }
 
@@ -339,81 +566,291 @@ void IQS9320::requestData(void)
   *         performed each time the IQS9320 opens a RDY window.
   * @param  None.
   * @retval None.
-  * @note   Any Address in the IQS9320 memory map can be read from here.
+  * @note   Blocks until the reads have completed. run() queues the same reads
+  *         with startValueUpdates() and returns while they are on the bus.
+  *         Any Address in the IQS9320 memory map can be read from there.
   */
 void IQS9320::queueValueUpdates(void)
 {
-  uint8_t transferBytes[40];	// The array which will hold the bytes to be transferred.
+  startValueUpdates();
+  do
+  {
+    _transfer.wait(&_frame_jobs[_frame_job_count - 1]);
+  }while(continueValueUpdates());
+  finishValueUpdates();
+}
+
+/**
+  * @name   startValueUpdates
+  * @brief  A method that queues the reads of one frame. A full read covers
+  *         the info flags and with debug enabled the normalized delta,
+  *         movement and delta blocks. With the adaptive read plan and no
+  *         recent activity only the system status and activation flags are
+  *         read first, see continueValueUpdates().
+  * @param  None.
+  * @retval None.
+  * @note   The debug blocks are read straight into IQSMemoryMap, the flags
+  *         are assigned by finishValueUpdates() once all reads completed.
+  */
+void IQS9320::startValueUpdates(void)
+{
+  /* Wait for room in the queue, only happens with many queued user jobs */
+  while(_transfer.pending() > IQS9320_TRANSFER_QUEUE_LENGTH - 4)
+  {
+    _transfer.service();
+  }
+
+  _frame_job_count = 0;
+  _frame_bytes = 0;
+  _read_stats.frames++;
+
+  _frame_probe = (_read_plan == IQS9320_READ_ADAPTIVE) && !_plan_burst && (_plan_refresh < IQS9320_PLAN_REFRESH_FRAMES);
+  if(!_frame_probe)
+  {
+    _plan_refresh = 0;
+    queueFullRead();
+    return;
+  }
 
+  /* Probe into the places of the full read, the other flags keep the values
+  of the last full read */
+  _plan_refresh++;
+  _read_stats.probes++;
   #if defined(IQS9320_V0_7) || defined(IQS9320_V1_0)
-  uint8_t bytes_per_field = 4;  // Calculate how many bytes is required to fit all the channels
-  uint8_t total_bytes = 2+(3*bytes_per_field); // Calculate the total bytes to read
+  queueFrameRead(IQS9320_MM_SYSTEM_STATUS, 2, _flags_buffer);
+  queueFrameRead(IQS9320_MM_ACTIVATION_FLAGS, (_nChannels + 7)/8, &_flags_buffer[2+2*IQS9320_FLAG_FIELD_SIZE]);
   #endif
   #ifdef IQS9320_V0_4
-  uint8_t bytes_per_field = _nChannels/8 + 1;  // Calculate how many bytes is required to fit all the channels
-  uint8_t total_bytes = 2+(2*bytes_per_field); // Calculate the total bytes to read
+  /* The activation flags follow the system status */
+  queueFrameRead(IQS9320_MM_SYSTEM_STATUS, 2+(_nChannels + 7)/8, _flags_buffer);
   #endif
+}
 
-	/* Read the info flags. 2 System flags bytes for activation and filter halt */
-  readRandomBytes16(_deviceAddress, IQS9320_MM_SYSTEM_STATUS, total_bytes, transferBytes, STOP);
-	// readOnly(_deviceAddress, 2+(2*bytes_per_field), transferBytes, STOP);
+/**
+  * @name   valueUpdatesDone
+  * @brief  A method that checks if the reads queued by startValueUpdates()
+  *         have completed.
+  * @param  None.
+  * @retval bool -> true when the last read of the frame has completed.
+  */
+bool IQS9320::valueUpdatesDone(void)
+{
+  uint8_t status = _frame_jobs[_frame_job_count - 1].status;
+
+  return (status == IQS9320_TRANSFER_DONE) || (status == IQS9320_TRANSFER_ERROR);
+}
+
+/**
+  * @name   continueValueUpdates
+  * @brief  A method that checks a completed probe against the last frame and
+  *         queues the full read if the status or activation flags changed.
+  * @param  None.
+  * @retval bool -> true if reads were queued, wait for them before
+  *         finishValueUpdates().
+  */
+bool IQS9320::continueValueUpdates(void)
+{
+  uint8_t bytes_per_field = (_nChannels + 7)/8;  // Calculate how many bytes is required to fit the enabled channels
+  bool changed;
+
+  #if defined(IQS9320_V0_7) || defined(IQS9320_V1_0)
+  uint8_t activation = 2+2*IQS9320_FLAG_FIELD_SIZE;     // Offset of the activation flags
+  #endif
+  #ifdef IQS9320_V0_4
+  uint8_t activation = 2;                               // Offset of the activation flags
+  #endif
+
+  if(!_frame_probe)
+  {
+    return false;
+  }
+  _frame_probe = false;
+
+  /* A failed probe is not compared, finishValueUpdates() drops the frame */
+  if(frameFailed())
+  {
+    return false;
+  }
+
+  changed = memcmp(IQSMemoryMap.SYSTEM_STATUS, _flags_buffer, 2)
+         || memcmp(IQSMemoryMap.ACTIVATION_FLAGS, &_flags_buffer[activation], bytes_per_field);
+  if(!changed)
+  {
+    return false;
+  }
+
+  _read_stats.probe_hits++;
+  _plan_refresh = 0;
+  _frame_job_count = 0;
+  queueFullRead();
+  return true;
+}
+
+/**
+  * @name   finishValueUpdates
+  * @brief  A method that assigns the info flags of a completed frame and
+  *         updates the read plan.
+  * @param  None.
+  * @retval None.
+  * @note   A frame with a failed or short read keeps the flags of the last
+  *         frame, is not counted in the read statistics or the read plan and
+  *         sets _frame_failed, so that run() does not report it as new data.
+  */
+void IQS9320::finishValueUpdates(void)
+{
+  uint8_t bytes_per_field = (_nChannels + 7)/8;  // Calculate how many bytes is required to fit the enabled channels
+  uint16_t full_bytes = fullReadBytes();
+  bool changed;
+  bool active = false;
+
+  _frame_failed = frameFailed();
+  if(_frame_failed)
+  {
+    return;
+  }
+
+  changed = memcmp(IQSMemoryMap.SYSTEM_STATUS, _flags_buffer, 2) != 0;
 
 	/* Assign the System Status */
-  IQSMemoryMap.SYSTEM_STATUS[0] =  transferBytes[0];
-  IQSMemoryMap.SYSTEM_STATUS[1] =  transferBytes[1];
+  IQSMemoryMap.SYSTEM_STATUS[0] =  _flags_buffer[0];
+  IQSMemoryMap.SYSTEM_STATUS[1] =  _flags_buffer[1];
 
   for(uint8_t i = 0; i < bytes_per_field; i++)
   {
     #if defined(IQS9320_V0_7) || defined(IQS9320_V1_0)
+      changed |= (IQSMemoryMap.ACTIVATION_FLAGS[i] != _flags_buffer[2+2*IQS9320_FLAG_FIELD_SIZE+i]);
+      changed |= (IQSMemoryMap.FILTER_HALT_FLAGS[i] != _flags_buffer[2+IQS9320_FLAG_FIELD_SIZE+i]);
       /* Assign the ATI Error Flags */
-      IQSMemoryMap.ATI_ERROR[i] =  transferBytes[2+i];
+      IQSMemoryMap.ATI_ERROR[i] =  _flags_buffer[2+i];
       /* Assign the Filter Halt Flags */
-      IQSMemoryMap.FILTER_HALT_FLAGS[i] =  transferBytes[2+bytes_per_field+i];
+      IQSMemoryMap.FILTER_HALT_FLAGS[i] =  _flags_buffer[2+IQS9320_FLAG_FIELD_SIZE+i];
       /* Assign the Activation Flags */
-      IQSMemoryMap.ACTIVATION_FLAGS[i] =  transferBytes[2+2*bytes_per_field+i];
+      IQSMemoryMap.ACTIVATION_FLAGS[i] =  _flags_buffer[2+2*IQS9320_FLAG_FIELD_SIZE+i];
     #endif
     #ifdef IQS9320_V0_4
+        changed |= (IQSMemoryMap.ACTIVATION_FLAGS[i] != _flags_buffer[2+i]);
+        changed |= (IQSMemoryMap.FILTER_HALT_FLAGS[i] != _flags_buffer[2+IQS9320_FLAG_FIELD_SIZE+i]);
         /* Assign the Activation Flags */
-        IQSMemoryMap.ACTIVATION_FLAGS[i] =  transferBytes[2+i];
+        IQSMemoryMap.ACTIVATION_FLAGS[i] =  _flags_buffer[2+i];
         /* Assign the Filter Halt Flags */
-        IQSMemoryMap.FILTER_HALT_FLAGS[i] =  transferBytes[2+bytes_per_field+i];
+        IQSMemoryMap.FILTER_HALT_FLAGS[i] =  _flags_buffer[2+IQS9320_FLAG_FIELD_SIZE+i];
     #endif
+    active |= (IQSMemoryMap.ACTIVATION_FLAGS[i] != 0);
   }
 
-  /* Stream delta when debug is enabled */
-  if(_debug_en)
+  /* Count the bytes of the frame against a full read */
+  _read_stats.bus_bytes += _frame_bytes;
+  if(_frame_bytes < full_bytes)
   {
-    /* Calculate the start address for Normalized delta base on total active channels */
-    uint16_t address = IQS9320_MM_ACTIVATION_FLAGS + 3*bytes_per_field;
-    if((address & 0x0001) == 1)
-    {
-      address++;
-    }
+    _read_stats.bytes_avoided += full_bytes - _frame_bytes;
+  }
+
+  /* Running rate of frames with a change. Full reads while keys are active
+  or changes are frequent, probes once it has settled */
+  _plan_rate = _plan_rate - (_plan_rate >> 3) + (changed ? 32 : 0);
+  if(active || (_plan_rate >= IQS9320_PLAN_BURST_ENTER))
+  {
+    _plan_burst = true;
+  }
+  else if(_plan_rate < IQS9320_PLAN_BURST_LEAVE)
+  {
+    _plan_burst = false;
+  }
+}
 
-    readRandomBytes16(_deviceAddress, address, _nChannels, transferBytes, STOP);
-    for(uint8_t i = 0; i < _nChannels; i++)
+/**
+  * @name   frameFailed
+  * @brief  A method that checks the reads of the current frame.
+  * @param  None.
+  * @retval bool -> true if a read ended with IQS9320_TRANSFER_ERROR, a bus
+  *         error or fewer bytes than requested.
+  */
+bool IQS9320::frameFailed(void)
+{
+  for(uint8_t i = 0; i < _frame_job_count; i++)
+  {
+    if(_frame_jobs[i].status == IQS9320_TRANSFER_ERROR)
     {
-      IQSMemoryMap.CH_NORM_DELTA[i] = transferBytes[i];
+      return true;
     }
+  }
+  return false;
+}
 
-    /* Calculate the start address for Movement base on total active channels */
-    address = address + (_nChannels);
+/**
+  * @name   queueFrameRead
+  * @brief  A method that queues one read of the current frame.
+  * @param  memoryAddress ->  The first register.
+  * @param  numBytes      ->  The number of bytes to read.
+  * @param  bytesArray    ->  Where the bytes are stored.
+  * @retval None.
+  */
+void IQS9320::queueFrameRead(uint16_t memoryAddress, uint8_t numBytes, uint8_t bytesArray[])
+{
+  iqs9320_transfer_setup(&_frame_jobs[_frame_job_count], _deviceAddress, memoryAddress, bytesArray, numBytes, true, STOP);
+  _transfer.submit(&_frame_jobs[_frame_job_count++]);
+  _frame_bytes += numBytes + IQS9320_READ_OVERHEAD;
+}
 
-    readRandomBytes16(_deviceAddress, address, _nChannels, transferBytes, STOP);
-    for(uint8_t i = 0; i < _nChannels; i++)
-    {
-      IQSMemoryMap.CH_MOVEMENT[i] = transferBytes[i];
-    }
+/**
+  * @name   queueFullRead
+  * @brief  A method that queues the info flags and, with debug enabled, the
+  *         normalized delta, movement and delta blocks.
+  * @param  None.
+  * @retval None.
+  */
+void IQS9320::queueFullRead(void)
+{
+	/* Read the info flags. 2 System flags bytes for activation and filter halt */
+  queueFrameRead(IQS9320_MM_SYSTEM_STATUS, flagsLength(), _flags_buffer);
 
-    /* Calculate the start address for Delta base on total active channels */
-    address = address + (_nChannels);
+  /* Stream delta when debug is enabled */
+  if(_debug_en)
+  {
+    /* The normalized delta, movement and delta blocks hold 20 channels each,
+    only the enabled channels at the start of each block are read */
+    queueFrameRead(IQS9320_MM_CH0_NORM_DELTA, _nChannels, IQSMemoryMap.CH_NORM_DELTA);
+    queueFrameRead(IQS9320_MM_CH0_NORM_DELTA + IQS9320_MAX_CHANNELS, _nChannels, IQSMemoryMap.CH_MOVEMENT);
+    queueFrameRead(IQS9320_MM_CH0_DELTA, _nChannels*2, IQSMemoryMap.CH_DELTA);
+  }
+}
 
-    readRandomBytes16(_deviceAddress, address, _nChannels*2, transferBytes, STOP);
-    for(uint8_t i = 0; i < _nChannels*2; i++)
-    {
-      IQSMemoryMap.CH_DELTA[i] = transferBytes[i];
-    }
+/**
+  * @name   flagsLength
+  * @brief  A method that returns the length of the info flags read.
+  * @param  None.
+  * @retval uint8_t -> Bytes from SYSTEM_STATUS to the last used byte of the
+  *                    last flag field.
+  */
+uint8_t IQS9320::flagsLength(void)
+{
+  uint8_t bytes_per_field = (_nChannels + 7)/8;  // Calculate how many bytes is required to fit the enabled channels
+
+  #if defined(IQS9320_V0_7) || defined(IQS9320_V1_0)
+  /* Only the last field, the activation flags, is shortened */
+  return 2+(2*IQS9320_FLAG_FIELD_SIZE)+bytes_per_field;
+  #endif
+  #ifdef IQS9320_V0_4
+  /* Only the last field, the filter halt flags, is shortened */
+  return 2+IQS9320_FLAG_FIELD_SIZE+bytes_per_field;
+  #endif
+}
+
+/**
+  * @name   fullReadBytes
+  * @brief  A method that returns the bus bytes of a full frame read.
+  * @param  None.
+  * @retval uint16_t -> Data and IQS9320_READ_OVERHEAD of every read.
+  */
+uint16_t IQS9320::fullReadBytes(void)
+{
+  uint16_t bytes = flagsLength() + IQS9320_READ_OVERHEAD;
+
+  if(_debug_en)
+  {
+    bytes += 4*_nChannels + 3*IQS9320_READ_OVERHEAD;
   }
+  return bytes;
 }
 
 /**
@@ -525,6 +962,68 @@ uint8_t IQS9320::getminorVersion(bool stopOrRestart)
   return ver_min;
 }
 
+/**
+  * @name   readVersionDetails
+  * @brief  A method that reads the product number, version numbers and the
+  *         rest of the version details in one burst into VERSION_DETAILS.
+  * @param  stopOrRestart ->  Specifies whether the communications window must
+  *                           be kept open or must be closed after this action.
+  *                           Use the STOP and RESTART definitions.
+  * @retval bool -> true if the read succeeded, VERSION_DETAILS is all 0
+  *         otherwise.
+  */
+bool IQS9320::readVersionDetails(bool stopOrRestart)
+{
+  iqs9320_device_info_s info;
+  bool ok;
+
+  ok = readVersion(_deviceAddress, &info, stopOrRestart);
+  memcpy(IQSMemoryMap.VERSION_DETAILS, info.details, IQS9320_VERSION_DETAILS_LENGTH);
+  return ok;
+}
+
+/**
+  * @name   setVersionDetails
+  * @brief  A method that stores the version details found by enumerate(), so
+  *         that IQS9320_INIT_VERIFY_PRODUCT does not read them again.
+  * @param  info ->  The table entry of this device.
+  * @retval None.
+  * @note   Used once, a later start-up reads the details from the device.
+  */
+void IQS9320::setVersionDetails(const iqs9320_device_info_s *info)
+{
+  memcpy(IQSMemoryMap.VERSION_DETAILS, info->details, IQS9320_VERSION_DETAILS_LENGTH);
+  _version_valid = true;
+}
+
+/**
+  * @name   enumerate
+  * @brief  A method that finds the devices on the bus of this device. Every
+  *         candidate address gets a single read of the version details, an
+  *         address without a device ends after its NACK.
+  * @param  addresses  ->  The addresses to try.
+  * @param  nAddresses ->  Number of addresses.
+  * @param  table      ->  Where the devices found are stored.
+  * @param  maxDevices ->  Entries of the table.
+  * @retval uint8_t -> Number of devices in the table. Devices of other
+  *         products are listed with their product number.
+  * @note   Pass the entries to setVersionDetails() of the devices after
+  *         begin(), then their start-up does not read the details again.
+  */
+uint8_t IQS9320::enumerate(const uint8_t addresses[], uint8_t nAddresses, iqs9320_device_info_s table[], uint8_t maxDevices)
+{
+  uint8_t found = 0;
+
+  for(uint8_t i = 0; (i < nAddresses) && (found < maxDevices); i++)
+  {
+    if(readVersion(addresses[i], &table[found], STOP))
+    {
+      found++;
+    }
+  }
+  return found;
+}
+
 /**
   * @name	acknowledgeReset
   * @brief  A method that clears the Reset Event bit by writing it to a 0.
@@ -619,6 +1118,56 @@ void IQS9320::SW_Reset(bool stopOrRestart)
   writeRandomBytes16(_deviceAddress, IQS9320_MM_SYSTEM_CONTROL, 2, transferByte, stopOrRestart);
 }
 
+/**
+  * @name   HW_Reset
+  * @brief  A method that resets the IQS9320 by pulling MCLR low, and waits
+  *         until the device shows the reset.
+  * @param  None.
+  * @retval bool -> true once SHOW_RESET is read back, false without an MCLR
+  *         pin or after IQS9320_RESET_TIMEOUT_MS.
+  * @note   Unlike SW_Reset() this works when the device no longer answers on
+  *         the bus. The time to ready is kept, see getResetTime().
+  */
+bool IQS9320::HW_Reset(void)
+{
+  uint32_t start_us;
+
+  if(_mclr_pin == IQS9320_MCLR_NONE)
+  {
+    return false;
+  }
+
+  start_us = micros();
+  digitalWrite(_mclr_pin, LOW);
+  delayMicroseconds(IQS9320_MCLR_PULSE_US);
+  digitalWrite(_mclr_pin, HIGH);
+
+  return waitReady(start_us);
+}
+
+/**
+  * @name   getResetTime
+  * @brief  A method that returns the time of the last reset, from the start
+  *         of the MCLR pulse or the SW_RESET write until SHOW_RESET was read.
+  * @param  None.
+  * @retval uint32_t -> Time in us, 0 before the first reset.
+  */
+uint32_t IQS9320::getResetTime(void)
+{
+  return _reset_time_us;
+}
+
+/**
+  * @name   getWorstResetTime
+  * @brief  A method that returns the longest reset time since begin.
+  * @param  None.
+  * @retval uint32_t -> Time in us.
+  */
+uint32_t IQS9320::getWorstResetTime(void)
+{
+  return _reset_worst_us;
+}
+
 /**
   * @name   updateInfoFlags
   * @brief  A method that reads the info flags from the IQS9320 and assigns
@@ -677,339 +1226,580 @@ void IQS9320::DebugOff(void)
   */
 void IQS9320::updateSettings(bool stopOrRestart)
 {
-  uint8_t transferBytes[30];
-
-  /* Change the Device Configuration */
-  /* Memory Map Position 0x2000 - 0x2007 */
-  transferBytes[0]  = SYSTEM_CONTROL_0;
-  transferBytes[1]  = SYSTEM_CONTROL_1;
-  transferBytes[2]  = SYSTEM_CONFIG_0;
-  transferBytes[3]  = SYSTEM_CONFIG_1;
-  transferBytes[4]  = NP_SAMPLING_INTERVAL_0;
-  transferBytes[5]  = NP_SAMPLING_INTERVAL_1;
-  transferBytes[6]  = NP_TIMEOUT_0;
-  transferBytes[7]  = NP_TIMEOUT_1;
-  transferBytes[8]  = LP_SAMPLING_INTERVAL_0;
-  transferBytes[9]  = LP_SAMPLING_INTERVAL_1;
-  transferBytes[10]  = LP_TIMEOUT_0;
-  transferBytes[11] = LP_TIMEOUT_1;
-  transferBytes[12] = ULP_SAMPLING_INTERVAL_0;
-  transferBytes[13] = ULP_SAMPLING_INTERVAL_1;
-  transferBytes[14] = ULP_TIMEOUT_0;
-  transferBytes[15] = ULP_TIMEOUT_1;
-  transferBytes[16] = DEFAULT_READ_LOCATION_0;
-  transferBytes[17] = DEFAULT_READ_LOCATION_1;
-  writeRandomBytes16(_deviceAddress, IQS9320_MM_SYSTEM_CONTROL, 18, transferBytes, STOP);
-  Serial.println("\t\t1. Write Device Configuration");
-
-  /* Change the Mirror Selection CH 0-9 */
-  /* Memory Map Position 0x3000 - 0x3009 */
-  transferBytes[0]  = MIRROR_SEL_CH0_0;
-  transferBytes[1]  = MIRROR_SEL_CH0_1;
-  transferBytes[2]  = MIRROR_SEL_CH1_0;
-  transferBytes[3]  = MIRROR_SEL_CH1_1;
-  transferBytes[4]  = MIRROR_SEL_CH2_0;
-  transferBytes[5]  = MIRROR_SEL_CH2_1;
-  transferBytes[6]  = MIRROR_SEL_CH3_0;
-  transferBytes[7]  = MIRROR_SEL_CH3_1;
-  transferBytes[8]  = MIRROR_SEL_CH4_0;
-  transferBytes[9]  = MIRROR_SEL_CH4_1;
-  transferBytes[10] = MIRROR_SEL_CH5_0;
-  transferBytes[11] = MIRROR_SEL_CH5_1;
-  transferBytes[12] = MIRROR_SEL_CH6_0;
-  transferBytes[13] = MIRROR_SEL_CH6_1;
-  transferBytes[14] = MIRROR_SEL_CH7_0;
-  transferBytes[15] = MIRROR_SEL_CH7_1;
-  transferBytes[16] = MIRROR_SEL_CH8_0;
-  transferBytes[17] = MIRROR_SEL_CH8_1;
-  transferBytes[18] = MIRROR_SEL_CH9_0;
-  transferBytes[19] = MIRROR_SEL_CH9_1;
-  writeRandomBytes16(_deviceAddress, IQS9320_MM_MIRROR_SELECTION_CH0, 20, transferBytes, STOP);
-  Serial.println("\t\t2. Write Mirror Selection CH 0-9");
-
-  /* Change the Mirror Selection CH 10-19 */
-  /* Memory Map Position 0x3014 - 0x301D */
-  transferBytes[0]  = MIRROR_SEL_CH10_0;
-  transferBytes[1]  = MIRROR_SEL_CH10_1;
-  transferBytes[2]  = MIRROR_SEL_CH11_0;
-  transferBytes[3]  = MIRROR_SEL_CH11_1;
-  transferBytes[4]  = MIRROR_SEL_CH12_0;
-  transferBytes[5]  = MIRROR_SEL_CH12_1;
-  transferBytes[6]  = MIRROR_SEL_CH13_0;
-  transferBytes[7]  = MIRROR_SEL_CH13_1;
-  transferBytes[8]  = MIRROR_SEL_CH14_0;
-  transferBytes[9]  = MIRROR_SEL_CH14_1;
-  transferBytes[10] = MIRROR_SEL_CH15_0;
-  transferBytes[11] = MIRROR_SEL_CH15_1;
-  transferBytes[12] = MIRROR_SEL_CH16_0;
-  transferBytes[13] = MIRROR_SEL_CH16_1;
-  transferBytes[14] = MIRROR_SEL_CH17_0;
-  transferBytes[15] = MIRROR_SEL_CH17_1;
-  transferBytes[16] = MIRROR_SEL_CH18_0;
-  transferBytes[17] = MIRROR_SEL_CH18_1;
-  transferBytes[18] = MIRROR_SEL_CH19_0;
-  transferBytes[19] = MIRROR_SEL_CH19_1;
-  writeRandomBytes16(_deviceAddress, IQS9320_MM_MIRROR_SELECTION_CH10, 20, transferBytes, STOP);
-  Serial.println("\t\t3. Write Mirror Selection CH 10-19");
-
-  #if defined(IQS9320_V0_7) || defined(IQS9320_V0_4)
-  /* Change the Calibration Parameters CH 0-9 */
-  /* Memory Map Position 0x3028 - 0x3031 */
-  transferBytes[0]  = CALIB_STEP_CH0;
-  transferBytes[1]  = CALIB_CORRECT_CH0;
-  transferBytes[2]  = CALIB_STEP_CH1;
-  transferBytes[3]  = CALIB_CORRECT_CH1;
-  transferBytes[4]  = CALIB_STEP_CH2;
-  transferBytes[5]  = CALIB_CORRECT_CH2;
-  transferBytes[6]  = CALIB_STEP_CH3;
-  transferBytes[7]  = CALIB_CORRECT_CH3;
-  transferBytes[8]  = CALIB_STEP_CH4;
-  transferBytes[9]  = CALIB_CORRECT_CH4;
-  transferBytes[10] = CALIB_STEP_CH5;
-  transferBytes[11] = CALIB_CORRECT_CH5;
-  transferBytes[12] = CALIB_STEP_CH6;
-  transferBytes[13] = CALIB_CORRECT_CH6;
-  transferBytes[14] = CALIB_STEP_CH7;
-  transferBytes[15] = CALIB_CORRECT_CH7;
-  transferBytes[16] = CALIB_STEP_CH8;
-  transferBytes[17] = CALIB_CORRECT_CH8;
-  transferBytes[18] = CALIB_STEP_CH9;
-  transferBytes[19] = CALIB_CORRECT_CH9;
-  writeRandomBytes16(_deviceAddress, IQS9320_MM_CALIBRATION_PARAMETERS_CH0, 20, transferBytes, STOP);
-  Serial.println("\t\t4. Write Calibration Parameters CH 0-9");
-
-  /* Change the Calibration Parameters CH 10-19 */
-  /* Memory Map Position 0x3042 - 0x304B */
-  transferBytes[0]  = CALIB_STEP_CH10;
-  transferBytes[1]  = CALIB_CORRECT_CH10;
-  transferBytes[2]  = CALIB_STEP_CH11;
-  transferBytes[3]  = CALIB_CORRECT_CH11;
-  transferBytes[4]  = CALIB_STEP_CH12;
-  transferBytes[5]  = CALIB_CORRECT_CH12;
-  transferBytes[6]  = CALIB_STEP_CH13;
-  transferBytes[7]  = CALIB_CORRECT_CH13;
-  transferBytes[8]  = CALIB_STEP_CH14;
-  transferBytes[9]  = CALIB_CORRECT_CH14;
-  transferBytes[10] = CALIB_STEP_CH15;
-  transferBytes[11] = CALIB_CORRECT_CH15;
-  transferBytes[12] = CALIB_STEP_CH16;
-  transferBytes[13] = CALIB_CORRECT_CH16;
-  transferBytes[14] = CALIB_STEP_CH17;
-  transferBytes[15] = CALIB_CORRECT_CH17;
-  transferBytes[16] = CALIB_STEP_CH18;
-  transferBytes[17] = CALIB_CORRECT_CH18;
-  transferBytes[18] = CALIB_STEP_CH19;
-  transferBytes[19] = CALIB_CORRECT_CH19;
-  writeRandomBytes16(_deviceAddress, IQS9320_MM_CALIBRATION_PARAMETERS_CH10, 20, transferBytes, STOP);
-  Serial.println("\t\t5. Write Calibration Parameters CH 10-19");
-  #endif
+  iqs9320_settings_block_s block;
+  uint8_t last = 0;
 
-  /* Change the Effective Max Delta CH 0-9 */
-  /* Memory Map Position 0x3050 - 0x3059 */
-  transferBytes[0]  = MAX_DELTA_E_0_0;
-  transferBytes[1]  = MAX_DELTA_E_0_1;
-  transferBytes[2]  = MAX_DELTA_E_1_0;
-  transferBytes[3]  = MAX_DELTA_E_1_1;
-  transferBytes[4]  = MAX_DELTA_E_2_0;
-  transferBytes[5]  = MAX_DELTA_E_2_1;
-  transferBytes[6]  = MAX_DELTA_E_3_0;
-  transferBytes[7]  = MAX_DELTA_E_3_1;
-  transferBytes[8]  = MAX_DELTA_E_4_0;
-  transferBytes[9]  = MAX_DELTA_E_4_1;
-  transferBytes[10] = MAX_DELTA_E_5_0;
-  transferBytes[11] = MAX_DELTA_E_5_1;
-  transferBytes[12] = MAX_DELTA_E_6_0;
-  transferBytes[13] = MAX_DELTA_E_6_1;
-  transferBytes[14] = MAX_DELTA_E_7_0;
-  transferBytes[15] = MAX_DELTA_E_7_1;
-  transferBytes[16] = MAX_DELTA_E_8_0;
-  transferBytes[17] = MAX_DELTA_E_8_1;
-  transferBytes[18] = MAX_DELTA_E_9_0;
-  transferBytes[19] = MAX_DELTA_E_9_1;
-  writeRandomBytes16(_deviceAddress, IQS9320_MM_EFFECTIVE_MAX_DELTA_CH0, 20, transferBytes, STOP);
-  Serial.println("\t\t6. Write Effective Max Delta CH 0-9");
-
-  /* Change the Effective Max Delta CH 10-19 */
-  /* Memory Map Position 0x3064 - 0x306D */
-  transferBytes[0]  = MAX_DELTA_E_10_0;
-  transferBytes[1]  = MAX_DELTA_E_10_1;
-  transferBytes[2]  = MAX_DELTA_E_11_0;
-  transferBytes[3]  = MAX_DELTA_E_11_1;
-  transferBytes[4]  = MAX_DELTA_E_12_0;
-  transferBytes[5]  = MAX_DELTA_E_12_1;
-  transferBytes[6]  = MAX_DELTA_E_13_0;
-  transferBytes[7]  = MAX_DELTA_E_13_1;
-  transferBytes[8]  = MAX_DELTA_E_14_0;
-  transferBytes[9]  = MAX_DELTA_E_14_1;
-  transferBytes[10] = MAX_DELTA_E_15_0;
-  transferBytes[11] = MAX_DELTA_E_15_1;
-  transferBytes[12] = MAX_DELTA_E_16_0;
-  transferBytes[13] = MAX_DELTA_E_16_1;
-  transferBytes[14] = MAX_DELTA_E_17_0;
-  transferBytes[15] = MAX_DELTA_E_17_1;
-  transferBytes[16] = MAX_DELTA_E_18_0;
-  transferBytes[17] = MAX_DELTA_E_18_1;
-  transferBytes[18] = MAX_DELTA_E_19_0;
-  transferBytes[19] = MAX_DELTA_E_19_1;
-  writeRandomBytes16(_deviceAddress, IQS9320_MM_EFFECTIVE_MAX_DELTA_CH10, 20, transferBytes, STOP);
-  Serial.println("\t\t7. Write Effective Max Delta CH 10-19");
-
-  /* Change the Individual Thresholds */
-  transferBytes[0]  = INDIVIDUAL_THRESHOLDS_0;
-  transferBytes[1]  = INDIVIDUAL_THRESHOLDS_1;
-  transferBytes[2]  = INDIVIDUAL_THRESHOLDS_2;
-  transferBytes[3]  = INDIVIDUAL_THRESHOLDS_3;
-  transferBytes[4]  = INDIVIDUAL_THRESHOLDS_4;
-  transferBytes[5]  = INDIVIDUAL_THRESHOLDS_5;
-  transferBytes[6]  = INDIVIDUAL_THRESHOLDS_6;
-  transferBytes[7]  = INDIVIDUAL_THRESHOLDS_7;
-  transferBytes[8]  = INDIVIDUAL_THRESHOLDS_8;
-  transferBytes[9]  = INDIVIDUAL_THRESHOLDS_9;
-  transferBytes[10] = INDIVIDUAL_THRESHOLDS_10;
-  transferBytes[11] = INDIVIDUAL_THRESHOLDS_11;
-  transferBytes[12] = INDIVIDUAL_THRESHOLDS_12;
-  transferBytes[13] = INDIVIDUAL_THRESHOLDS_13;
-  transferBytes[14] = INDIVIDUAL_THRESHOLDS_14;
-  transferBytes[15] = INDIVIDUAL_THRESHOLDS_15;
-  transferBytes[16] = INDIVIDUAL_THRESHOLDS_16;
-  transferBytes[17] = INDIVIDUAL_THRESHOLDS_17;
-  transferBytes[18] = INDIVIDUAL_THRESHOLDS_18;
-  transferBytes[19] = INDIVIDUAL_THRESHOLDS_19;
-  writeRandomBytes16(_deviceAddress, IQS9320_MM_INDIVIDUAL_THRESHOLDS_CH0, 20, transferBytes, STOP);
-  Serial.println("\t\t8. Write Individual Thresholds");
-
-  /* Change the Channel Select and Disable */
-  transferBytes[0]  = CYCLE_0_SELECT;
-  transferBytes[1]  = CYCLE_1_SELECT;
-  writeRandomBytes16(_deviceAddress, IQS9320_MM_CYCLE_0_CHANNELS, 2, transferBytes, STOP);
-  Serial.println("\t\t9. Write Channel Select and Disable");
-
-  /* Change the Rx Select */
-  transferBytes[0]  = RX_SELECT_0;
-  transferBytes[1]  = RX_SELECT_1;
-  transferBytes[2]  = RX_SELECT_2;
-  transferBytes[3]  = RX_SELECT_3;
-  transferBytes[4]  = RX_SELECT_4;
-  transferBytes[5]  = RX_SELECT_5;
-  transferBytes[6]  = RX_SELECT_6;
-  transferBytes[7]  = RX_SELECT_7;
-  transferBytes[8]  = RX_SELECT_8;
-  transferBytes[9]  = RX_SELECT_9;
-  transferBytes[10] = RX_SELECT_10;
-  transferBytes[11] = RX_SELECT_11;
-  transferBytes[12] = RX_SELECT_12;
-  transferBytes[13] = RX_SELECT_13;
-  transferBytes[14] = RX_SELECT_14;
-  transferBytes[15] = RX_SELECT_15;
-  transferBytes[16] = RX_SELECT_16;
-  transferBytes[17] = RX_SELECT_17;
-  transferBytes[18] = RX_SELECT_18;
-  transferBytes[19] = RX_SELECT_19;
-  writeRandomBytes16(_deviceAddress, IQS9320_MM_RX_SELECT, 20, transferBytes, STOP);
-  Serial.println("\t\t10. Write Rx Select");
-
-  /* Change the Tx Select */
-  transferBytes[0]  = TX_SELECT_0;
-  transferBytes[1]  = TX_SELECT_1;
-  transferBytes[2]  = TX_SELECT_2;
-  transferBytes[3]  = TX_SELECT_3;
-  transferBytes[4]  = TX_SELECT_4;
-  transferBytes[5]  = TX_SELECT_5;
-  transferBytes[6]  = TX_SELECT_6;
-  transferBytes[7]  = TX_SELECT_7;
-  transferBytes[8]  = TX_SELECT_8;
-  transferBytes[9]  = TX_SELECT_9;
-  transferBytes[10] = TX_SELECT_10;
-  transferBytes[11] = TX_SELECT_11;
-  transferBytes[12] = TX_SELECT_12;
-  transferBytes[13] = TX_SELECT_13;
-  transferBytes[14] = TX_SELECT_14;
-  transferBytes[15] = TX_SELECT_15;
-  transferBytes[16] = TX_SELECT_16;
-  transferBytes[17] = TX_SELECT_17;
-  transferBytes[18] = TX_SELECT_18;
-  transferBytes[19] = TX_SELECT_19;
-  writeRandomBytes16(_deviceAddress, IQS9320_MM_TX_SELECT, 20, transferBytes, STOP);
-  Serial.println("\t\t11. Write Tx Select");
-
-  /* Change the ATI Target and Band */
-  transferBytes[0]  = ATI_TARGET_0;
-  transferBytes[1]  = ATI_TARGET_1;
-  transferBytes[2]  = ATI_BAND_0;
-  transferBytes[3]  = ATI_BAND_1;
-  writeRandomBytes16(_deviceAddress, IQS9320_MM_ATI_TARGET, 4, transferBytes, STOP);
-  Serial.println("\t\t12. Write ATI Target and Band");
-
-  /* Change the Thresholds */
-  transferBytes[0]  = ACTIVATION_THRESHOLD;
-  transferBytes[1]  = REFERENCE_HALT_THRESHOLD;
-  transferBytes[2]  = FAST_REF_THRESHOLD;
-  transferBytes[3]  = MOVEMENT_THRESHOLD;
-  writeRandomBytes16(_deviceAddress, IQS9320_MM_ACTIVATION_THRESHOLD, 4, transferBytes, STOP);
-  Serial.println("\t\t13. Write Thresholds");
-
-  /* Change the Filter Values */
-  transferBytes[0]  = BETA_LTA_NP;
-  transferBytes[1]  = BETA_LTA_LP;
-  transferBytes[2]  = BETA_LTA_ULP;
-  transferBytes[3]  = BETA_FAST_LTA_NP;
-  transferBytes[4]  = BETA_FAST_LTA_LP;
-  transferBytes[5]  = BETA_FAST_LTA_ULP;
-  transferBytes[6]  = BETA_COUNTS_NP;
-  transferBytes[7]  = BETA_COUNTS_LP;
-  transferBytes[8]  = BETA_COUNTS_ULP;
-  writeRandomBytes16(_deviceAddress, IQS9320_MM_LTA_BETA_FILTER, 9, transferBytes, STOP);
-  Serial.println("\t\t14. Write Filter Values");
-
-  /* Change the Reference Halt Timeout */
-  transferBytes[0]  = REF_HALT_TIMEOUT_0;
-  writeRandomBytes16(_deviceAddress, IQS9320_MM_REFERENCE_HALT_TIMEOUT, 1, transferBytes, STOP);
-  Serial.println("\t\t15. Write Reference Halt Timeout");
-
-  /* Change the Activation Hysteresis */
-  transferBytes[0]  = ACTIVATION_HYSTERESIS_0;
-  writeRandomBytes16(_deviceAddress, IQS9320_MM_ACTIVATION_HYSTERESIS, 1, transferBytes, STOP);
-  Serial.println("\t\t16. Write Activation Hysteresis");
+  /* The last block written ends with stopOrRestart, the others with STOP */
+  for(uint8_t step = 0; step < IQS9320_SETTINGS_BLOCKS; step++)
+  {
+    getSettingsBlock(step, &block);
+    if(block.length != 0)
+    {
+      last = step;
+    }
+  }
 
-  #if defined(IQS9320_V0_7) || defined(IQS9320_V1_0)
-  /* Change the Timing Generator Settings */
-  /* Memory Map Position 0x3146 - 0x3147 */
-  transferBytes[0]  = TIMING_GENERATOR_0;
-  transferBytes[1]  = TIMING_GENERATOR_0;
-  writeRandomBytes16(_deviceAddress, IQS9320_MM_ACTIVATION_HYSTERESIS, 1, transferBytes, STOP);
-  Serial.println("\t\t17. Write Timing Generator Settings");
-
-  /* Change the Hardware Settings */
-  /* Memory Map Position 0x3148 - 0x3149 */
-  transferBytes[0]  = HARDWARE_SETTINGS_0;
-  transferBytes[1]  = HARDWARE_SETTINGS_1;
-  writeRandomBytes16(_deviceAddress, IQS9320_MM_ACTIVATION_HYSTERESIS, 1, transferBytes, STOP);
-  Serial.println("\t\t18. Write Hardware Settings");
-  #endif
+  for(uint8_t step = 0; step < IQS9320_SETTINGS_BLOCKS; step++)
+  {
+    getSettingsBlock(step, &block);
+    if(block.length == 0)
+    {
+      continue; // Not used with this version or channel count
+    }
+
+    writeRandomBytes16(_deviceAddress, block.address, block.length, block.data, (step == last) ? stopOrRestart : STOP);
+    Serial.print("\t\t");
+    Serial.print(step + 1);
+    Serial.print(". Write ");
+    Serial.println(block.name);
+  }
 }
 
 /**
-  * @name   reconfigureDevice
-  * @brief  A method that calls the reconfigure bit to upload and use all settings
-  * previously defined to the IQS9320.
-  * @param  stopOrRestart ->  Specifies whether the communications window must
-  *                           be kept open or must be closed after this action.
-  *              			        Use the STOP and RESTART definitions.
-  * @retval None.
-  * @note   This bit should always be called after settings has been changed in order
-  *         for it to take effect.
+  * @name   getSettingsBlock
+  * @brief  A method that returns one register block of the settings in the
+  *         init file, in the order updateSettings() writes them.
+  * @param  step  ->  Block number, 0 to IQS9320_SETTINGS_BLOCKS-1.
+  * @param  block ->  Receives the address, length, name and data.
+  * @retval bool -> false if step is out of range.
+  * @note   The length is 0 for blocks that do not exist on the selected
+  *         version. Per-channel blocks cover the channels up to the last one
+  *         the init file enables, also those beyond nChannels, which the
+  *         device converts with the same settings.
   */
-void IQS9320::reconfigureDevice(bool stopOrRestart)
+bool IQS9320::getSettingsBlock(uint8_t step, iqs9320_settings_block_s *block)
 {
-  uint8_t transferByte[2]; // Array to store the bytes transferred.
+  uint8_t *d = block->data;
+  /* Per-channel blocks are written for the channels the init file enables */
+  uint8_t span = iqs9320_enabled_span();
+  uint8_t low_channels = (span < 10) ? span : 10;       // Channels 0-9 enabled
+  uint8_t high_channels = span - low_channels;          // Channels 10-19 enabled
 
-  readRandomBytes16(_deviceAddress, IQS9320_MM_SYSTEM_CONTROL, 2, transferByte, STOP);
-  /* Set the the RECONFIG_DEV_BIT in the SYSTEM_CONTROL register */
-  transferByte[0] = setBit(transferByte[0], IQS9320_RECONFIG_DEV_BIT);
-  /* Write the new byte to the required device. */
-  writeRandomBytes16(_deviceAddress, IQS9320_MM_SYSTEM_CONTROL, 2, transferByte, stopOrRestart);
+  block->address = 0;
+  block->length = 0;
+  block->name = "";
 
-}
+  switch(step)
+  {
+    /* Change the Device Configuration */
+    /* Memory Map Position 0x2000 - 0x2007 */
+    case 0:
+      d[0]  = SYSTEM_CONTROL_0;
+      d[1]  = SYSTEM_CONTROL_1;
+      d[2]  = SYSTEM_CONFIG_0;
+      d[3]  = SYSTEM_CONFIG_1;
+      d[4]  = NP_SAMPLING_INTERVAL_0;
+      d[5]  = NP_SAMPLING_INTERVAL_1;
+      d[6]  = NP_TIMEOUT_0;
+      d[7]  = NP_TIMEOUT_1;
+      d[8]  = LP_SAMPLING_INTERVAL_0;
+      d[9]  = LP_SAMPLING_INTERVAL_1;
+      d[10] = LP_TIMEOUT_0;
+      d[11] = LP_TIMEOUT_1;
+      d[12] = ULP_SAMPLING_INTERVAL_0;
+      d[13] = ULP_SAMPLING_INTERVAL_1;
+      d[14] = ULP_TIMEOUT_0;
+      d[15] = ULP_TIMEOUT_1;
+      d[16] = DEFAULT_READ_LOCATION_0;
+      d[17] = DEFAULT_READ_LOCATION_1;
+      block->address = IQS9320_MM_SYSTEM_CONTROL;
+      block->length  = 18;
+      block->name    = "Device Configuration";
+    break;
+
+    /* Change the Mirror Selection CH 0-9 */
+    /* Memory Map Position 0x3000 - 0x3009 */
+    case 1:
+      d[0]  = MIRROR_SEL_CH0_0;
+      d[1]  = MIRROR_SEL_CH0_1;
+      d[2]  = MIRROR_SEL_CH1_0;
+      d[3]  = MIRROR_SEL_CH1_1;
+      d[4]  = MIRROR_SEL_CH2_0;
+      d[5]  = MIRROR_SEL_CH2_1;
+      d[6]  = MIRROR_SEL_CH3_0;
+      d[7]  = MIRROR_SEL_CH3_1;
+      d[8]  = MIRROR_SEL_CH4_0;
+      d[9]  = MIRROR_SEL_CH4_1;
+      d[10] = MIRROR_SEL_CH5_0;
+      d[11] = MIRROR_SEL_CH5_1;
+      d[12] = MIRROR_SEL_CH6_0;
+      d[13] = MIRROR_SEL_CH6_1;
+      d[14] = MIRROR_SEL_CH7_0;
+      d[15] = MIRROR_SEL_CH7_1;
+      d[16] = MIRROR_SEL_CH8_0;
+      d[17] = MIRROR_SEL_CH8_1;
+      d[18] = MIRROR_SEL_CH9_0;
+      d[19] = MIRROR_SEL_CH9_1;
+      block->address = IQS9320_MM_MIRROR_SELECTION_CH0;
+      block->length  = 2*low_channels;
+      block->name    = "Mirror Selection CH 0-9";
+    break;
+
+    /* Change the Mirror Selection CH 10-19 */
+    /* Memory Map Position 0x3014 - 0x301D */
+    case 2:
+      d[0]  = MIRROR_SEL_CH10_0;
+      d[1]  = MIRROR_SEL_CH10_1;
+      d[2]  = MIRROR_SEL_CH11_0;
+      d[3]  = MIRROR_SEL_CH11_1;
+      d[4]  = MIRROR_SEL_CH12_0;
+      d[5]  = MIRROR_SEL_CH12_1;
+      d[6]  = MIRROR_SEL_CH13_0;
+      d[7]  = MIRROR_SEL_CH13_1;
+      d[8]  = MIRROR_SEL_CH14_0;
+      d[9]  = MIRROR_SEL_CH14_1;
+      d[10] = MIRROR_SEL_CH15_0;
+      d[11] = MIRROR_SEL_CH15_1;
+      d[12] = MIRROR_SEL_CH16_0;
+      d[13] = MIRROR_SEL_CH16_1;
+      d[14] = MIRROR_SEL_CH17_0;
+      d[15] = MIRROR_SEL_CH17_1;
+      d[16] = MIRROR_SEL_CH18_0;
+      d[17] = MIRROR_SEL_CH18_1;
+      d[18] = MIRROR_SEL_CH19_0;
+      d[19] = MIRROR_SEL_CH19_1;
+      block->address = IQS9320_MM_MIRROR_SELECTION_CH10;
+      block->length  = 2*high_channels;
+      block->name    = "Mirror Selection CH 10-19";
+    break;
+
+    #if defined(IQS9320_V0_7) || defined(IQS9320_V0_4)
+    /* Change the Calibration Parameters CH 0-9 */
+    /* Memory Map Position 0x3028 - 0x3031 */
+    case 3:
+      d[0]  = CALIB_STEP_CH0;
+      d[1]  = CALIB_CORRECT_CH0;
+      d[2]  = CALIB_STEP_CH1;
+      d[3]  = CALIB_CORRECT_CH1;
+      d[4]  = CALIB_STEP_CH2;
+      d[5]  = CALIB_CORRECT_CH2;
+      d[6]  = CALIB_STEP_CH3;
+      d[7]  = CALIB_CORRECT_CH3;
+      d[8]  = CALIB_STEP_CH4;
+      d[9]  = CALIB_CORRECT_CH4;
+      d[10] = CALIB_STEP_CH5;
+      d[11] = CALIB_CORRECT_CH5;
+      d[12] = CALIB_STEP_CH6;
+      d[13] = CALIB_CORRECT_CH6;
+      d[14] = CALIB_STEP_CH7;
+      d[15] = CALIB_CORRECT_CH7;
+      d[16] = CALIB_STEP_CH8;
+      d[17] = CALIB_CORRECT_CH8;
+      d[18] = CALIB_STEP_CH9;
+      d[19] = CALIB_CORRECT_CH9;
+      block->address = IQS9320_MM_CALIBRATION_PARAMETERS_CH0;
+      block->length  = 2*low_channels;
+      block->name    = "Calibration Parameters CH 0-9";
+    break;
+    #endif
+
+    #if defined(IQS9320_V0_7) || defined(IQS9320_V0_4)
+    /* Change the Calibration Parameters CH 10-19 */
+    /* Memory Map Position 0x3042 - 0x304B */
+    case 4:
+      d[0]  = CALIB_STEP_CH10;
+      d[1]  = CALIB_CORRECT_CH10;
+      d[2]  = CALIB_STEP_CH11;
+      d[3]  = CALIB_CORRECT_CH11;
+      d[4]  = CALIB_STEP_CH12;
+      d[5]  = CALIB_CORRECT_CH12;
+      d[6]  = CALIB_STEP_CH13;
+      d[7]  = CALIB_CORRECT_CH13;
+      d[8]  = CALIB_STEP_CH14;
+      d[9]  = CALIB_CORRECT_CH14;
+      d[10] = CALIB_STEP_CH15;
+      d[11] = CALIB_CORRECT_CH15;
+      d[12] = CALIB_STEP_CH16;
+      d[13] = CALIB_CORRECT_CH16;
+      d[14] = CALIB_STEP_CH17;
+      d[15] = CALIB_CORRECT_CH17;
+      d[16] = CALIB_STEP_CH18;
+      d[17] = CALIB_CORRECT_CH18;
+      d[18] = CALIB_STEP_CH19;
+      d[19] = CALIB_CORRECT_CH19;
+      block->address = IQS9320_MM_CALIBRATION_PARAMETERS_CH10;
+      block->length  = 2*high_channels;
+      block->name    = "Calibration Parameters CH 10-19";
+    break;
+    #endif
+
+    /* Change the Effective Max Delta CH 0-9 */
+    /* Memory Map Position 0x3050 - 0x3059 */
+    case 5:
+      d[0]  = MAX_DELTA_E_0_0;
+      d[1]  = MAX_DELTA_E_0_1;
+      d[2]  = MAX_DELTA_E_1_0;
+      d[3]  = MAX_DELTA_E_1_1;
+      d[4]  = MAX_DELTA_E_2_0;
+      d[5]  = MAX_DELTA_E_2_1;
+      d[6]  = MAX_DELTA_E_3_0;
+      d[7]  = MAX_DELTA_E_3_1;
+      d[8]  = MAX_DELTA_E_4_0;
+      d[9]  = MAX_DELTA_E_4_1;
+      d[10] = MAX_DELTA_E_5_0;
+      d[11] = MAX_DELTA_E_5_1;
+      d[12] = MAX_DELTA_E_6_0;
+      d[13] = MAX_DELTA_E_6_1;
+      d[14] = MAX_DELTA_E_7_0;
+      d[15] = MAX_DELTA_E_7_1;
+      d[16] = MAX_DELTA_E_8_0;
+      d[17] = MAX_DELTA_E_8_1;
+      d[18] = MAX_DELTA_E_9_0;
+      d[19] = MAX_DELTA_E_9_1;
+      block->address = IQS9320_MM_EFFECTIVE_MAX_DELTA_CH0;
+      block->length  = 2*low_channels;
+      block->name    = "Effective Max Delta CH 0-9";
+    break;
+
+    /* Change the Effective Max Delta CH 10-19 */
+    /* Memory Map Position 0x3064 - 0x306D */
+    case 6:
+      d[0]  = MAX_DELTA_E_10_0;
+      d[1]  = MAX_DELTA_E_10_1;
+      d[2]  = MAX_DELTA_E_11_0;
+      d[3]  = MAX_DELTA_E_11_1;
+      d[4]  = MAX_DELTA_E_12_0;
+      d[5]  = MAX_DELTA_E_12_1;
+      d[6]  = MAX_DELTA_E_13_0;
+      d[7]  = MAX_DELTA_E_13_1;
+      d[8]  = MAX_DELTA_E_14_0;
+      d[9]  = MAX_DELTA_E_14_1;
+      d[10] = MAX_DELTA_E_15_0;
+      d[11] = MAX_DELTA_E_15_1;
+      d[12] = MAX_DELTA_E_16_0;
+      d[13] = MAX_DELTA_E_16_1;
+      d[14] = MAX_DELTA_E_17_0;
+      d[15] = MAX_DELTA_E_17_1;
+      d[16] = MAX_DELTA_E_18_0;
+      d[17] = MAX_DELTA_E_18_1;
+      d[18] = MAX_DELTA_E_19_0;
+      d[19] = MAX_DELTA_E_19_1;
+      block->address = IQS9320_MM_EFFECTIVE_MAX_DELTA_CH10;
+      block->length  = 2*high_channels;
+      block->name    = "Effective Max Delta CH 10-19";
+    break;
+
+    /* Change the Individual Thresholds */
+    case 7:
+      d[0]  = INDIVIDUAL_THRESHOLDS_0;
+      d[1]  = INDIVIDUAL_THRESHOLDS_1;
+      d[2]  = INDIVIDUAL_THRESHOLDS_2;
+      d[3]  = INDIVIDUAL_THRESHOLDS_3;
+      d[4]  = INDIVIDUAL_THRESHOLDS_4;
+      d[5]  = INDIVIDUAL_THRESHOLDS_5;
+      d[6]  = INDIVIDUAL_THRESHOLDS_6;
+      d[7]  = INDIVIDUAL_THRESHOLDS_7;
+      d[8]  = INDIVIDUAL_THRESHOLDS_8;
+      d[9]  = INDIVIDUAL_THRESHOLDS_9;
+      d[10] = INDIVIDUAL_THRESHOLDS_10;
+      d[11] = INDIVIDUAL_THRESHOLDS_11;
+      d[12] = INDIVIDUAL_THRESHOLDS_12;
+      d[13] = INDIVIDUAL_THRESHOLDS_13;
+      d[14] = INDIVIDUAL_THRESHOLDS_14;
+      d[15] = INDIVIDUAL_THRESHOLDS_15;
+      d[16] = INDIVIDUAL_THRESHOLDS_16;
+      d[17] = INDIVIDUAL_THRESHOLDS_17;
+      d[18] = INDIVIDUAL_THRESHOLDS_18;
+      d[19] = INDIVIDUAL_THRESHOLDS_19;
+      block->address = IQS9320_MM_INDIVIDUAL_THRESHOLDS_CH0;
+      block->length  = span;
+      block->name    = "Individual Thresholds";
+    break;
+
+    /* Change the Channel Select and Disable */
+    case 8:
+      d[0] = CYCLE_0_SELECT;
+      d[1] = CYCLE_1_SELECT;
+      block->address = IQS9320_MM_CYCLE_0_CHANNELS;
+      block->length  = 2;
+      block->name    = "Channel Select and Disable";
+    break;
+
+    /* Change the Rx Select */
+    case 9:
+      d[0]  = RX_SELECT_0;
+      d[1]  = RX_SELECT_1;
+      d[2]  = RX_SELECT_2;
+      d[3]  = RX_SELECT_3;
+      d[4]  = RX_SELECT_4;
+      d[5]  = RX_SELECT_5;
+      d[6]  = RX_SELECT_6;
+      d[7]  = RX_SELECT_7;
+      d[8]  = RX_SELECT_8;
+      d[9]  = RX_SELECT_9;
+      d[10] = RX_SELECT_10;
+      d[11] = RX_SELECT_11;
+      d[12] = RX_SELECT_12;
+      d[13] = RX_SELECT_13;
+      d[14] = RX_SELECT_14;
+      d[15] = RX_SELECT_15;
+      d[16] = RX_SELECT_16;
+      d[17] = RX_SELECT_17;
+      d[18] = RX_SELECT_18;
+      d[19] = RX_SELECT_19;
+      block->address = IQS9320_MM_RX_SELECT;
+      block->length  = span;
+      block->name    = "Rx Select";
+    break;
+
+    /* Change the Tx Select */
+    case 10:
+      d[0]  = TX_SELECT_0;
+      d[1]  = TX_SELECT_1;
+      d[2]  = TX_SELECT_2;
+      d[3]  = TX_SELECT_3;
+      d[4]  = TX_SELECT_4;
+      d[5]  = TX_SELECT_5;
+      d[6]  = TX_SELECT_6;
+      d[7]  = TX_SELECT_7;
+      d[8]  = TX_SELECT_8;
+      d[9]  = TX_SELECT_9;
+      d[10] = TX_SELECT_10;
+      d[11] = TX_SELECT_11;
+      d[12] = TX_SELECT_12;
+      d[13] = TX_SELECT_13;
+      d[14] = TX_SELECT_14;
+      d[15] = TX_SELECT_15;
+      d[16] = TX_SELECT_16;
+      d[17] = TX_SELECT_17;
+      d[18] = TX_SELECT_18;
+      d[19] = TX_SELECT_19;
+      block->address = IQS9320_MM_TX_SELECT;
+      block->length  = span;
+      block->name    = "Tx Select";
+    break;
+
+    /* Change the ATI Target and Band */
+    case 11:
+      d[0] = ATI_TARGET_0;
+      d[1] = ATI_TARGET_1;
+      d[2] = ATI_BAND_0;
+      d[3] = ATI_BAND_1;
+      block->address = IQS9320_MM_ATI_TARGET;
+      block->length  = 4;
+      block->name    = "ATI Target and Band";
+    break;
+
+    /* Change the Thresholds */
+    case 12:
+      d[0] = ACTIVATION_THRESHOLD;
+      d[1] = REFERENCE_HALT_THRESHOLD;
+      d[2] = FAST_REF_THRESHOLD;
+      d[3] = MOVEMENT_THRESHOLD;
+      block->address = IQS9320_MM_ACTIVATION_THRESHOLD;
+      block->length  = 4;
+      block->name    = "Thresholds";
+    break;
+
+    /* Change the Filter Values */
+    case 13:
+      d[0] = BETA_LTA_NP;
+      d[1] = BETA_LTA_LP;
+      d[2] = BETA_LTA_ULP;
+      d[3] = BETA_FAST_LTA_NP;
+      d[4] = BETA_FAST_LTA_LP;
+      d[5] = BETA_FAST_LTA_ULP;
+      d[6] = BETA_COUNTS_NP;
+      d[7] = BETA_COUNTS_LP;
+      d[8] = BETA_COUNTS_ULP;
+      block->address = IQS9320_MM_LTA_BETA_FILTER;
+      block->length  = 9;
+      block->name    = "Filter Values";
+    break;
+
+    /* Change the Reference Halt Timeout */
+    case 14:
+      d[0] = REF_HALT_TIMEOUT_0;
+      block->address = IQS9320_MM_REFERENCE_HALT_TIMEOUT;
+      block->length  = 1;
+      block->name    = "Reference Halt Timeout";
+    break;
+
+    /* Change the Activation Hysteresis */
+    case 15:
+      d[0] = ACTIVATION_HYSTERESIS_0;
+      block->address = IQS9320_MM_ACTIVATION_HYSTERESIS;
+      block->length  = 1;
+      block->name    = "Activation Hysteresis";
+    break;
+
+    #if defined(IQS9320_V0_7) || defined(IQS9320_V1_0)
+    /* Change the Timing Generator Settings */
+    /* Memory Map Position 0x3146 - 0x3147 */
+    case 16:
+      d[0] = TIMING_GENERATOR_0;
+      d[1] = TIMING_GENERATOR_1;
+      block->address = IQS9320_MM_TIMING_GENERATOR;
+      block->length  = 2;
+      block->name    = "Timing Generator Settings";
+    break;
+    #endif
+
+    #if defined(IQS9320_V0_7) || defined(IQS9320_V1_0)
+    /* Change the Hardware Settings */
+    /* Memory Map Position 0x3148 - 0x3149 */
+    case 17:
+      d[0] = HARDWARE_SETTINGS_0;
+      d[1] = HARDWARE_SETTINGS_1;
+      block->address = IQS9320_MM_HARDWARE_SETTINGS;
+      block->length  = 2;
+      block->name    = "Hardware Settings";
+    break;
+    #endif
+
+    default:
+      /* Blocks of other versions are left empty */
+      return (step < IQS9320_SETTINGS_BLOCKS);
+  }
+
+  return true;
+}
+
+/**
+  * @name   verifySettings
+  * @brief  A method that reads the settings of the init file back from the
+  *         device and compares them with the values written by
+  *         updateSettings(). Neighbouring blocks are read in one burst, so the
+  *         0x2000 and 0x3000 regions take a few reads.
+  * @param  repair ->  true to rewrite the bytes that differ, from the first to
+  *                    the last differing byte of each block, and read them
+  *                    back once more.
+  * @param  result ->  Receives the counts and the mismatched ranges.
+  * @retval bool -> true if the device holds the settings of the init file.
+  * @note   SYSTEM_CONTROL is not compared, its command bits clear
+  *         themselves. Use before ATI: ATI changes the mirror selection and
+  *         ReATI() the SYSTEM_CONFIG ATI bits, and the set methods change
+  *         the device on purpose. Blocks are expected in rising address
+  *         order.
+  */
+bool IQS9320::verifySettings(bool repair, iqs9320_verify_s *result)
+{
+  iqs9320_settings_block_s block;
+  uint8_t readback[IQS9320_VERIFY_BUFFER];
+  uint8_t first = 0;
+  bool verified = true;
+
+  memset(result, 0, sizeof(*result));
+
+  while(first < IQS9320_SETTINGS_BLOCKS)
+  {
+    uint16_t start;
+    uint16_t end;
+    uint8_t last = first;
+
+    getSettingsBlock(first, &block);
+    if(block.length == 0)
+    {
+      first++;
+      continue; // Not used with this version or channel count
+    }
+
+    /* Join the following blocks while the gap is short and the burst fits */
+    start = block.address;
+    end = block.address + block.length;
+    for(uint8_t step = first + 1; step < IQS9320_SETTINGS_BLOCKS; step++)
+    {
+      getSettingsBlock(step, &block);
+      if(block.length == 0)
+      {
+        continue;
+      }
+      if((block.address < end) || (block.address - end > IQS9320_VERIFY_GAP)
+         || (block.address + block.length - start > IQS9320_VERIFY_BUFFER))
+      {
+        break;
+      }
+      end = block.address + block.length;
+      last = step;
+    }
+
+    readRandomBytes16(_deviceAddress, start, end - start, readback, STOP);
+    result->reads++;
+
+    /* Compare the blocks of the burst */
+    for(uint8_t step = first; step <= last; step++)
+    {
+      uint8_t *device_bytes;
+      int16_t lo = -1;
+      int16_t hi = -1;
+
+      getSettingsBlock(step, &block);
+      if(block.length == 0)
+      {
+        continue;
+      }
+      device_bytes = &readback[block.address - start];
+
+      for(uint8_t i = 0; i < block.length; i++)
+      {
+        if((uint16_t)(block.address + i - IQS9320_MM_SYSTEM_CONTROL) < 2)
+        {
+          continue; // Command bits
+        }
+        result->bytes++;
+        if(device_bytes[i] != block.data[i])
+        {
+          lo = (lo < 0) ? i : lo;
+          hi = i;
+        }
+      }
+      if(lo < 0)
+      {
+        continue;
+      }
+
+      if(result->nRanges < IQS9320_VERIFY_MAX_RANGES)
+      {
+        result->ranges[result->nRanges].address = block.address + lo;
+        result->ranges[result->nRanges].length = hi - lo + 1;
+      }
+      result->nRanges++;
+
+      if(!repair)
+      {
+        verified = false;
+        continue;
+      }
+
+      /* Rewrite only the differing bytes and check them once more */
+      writeRandomBytes16(_deviceAddress, block.address + lo, hi - lo + 1, &block.data[lo], STOP);
+      readRandomBytes16(_deviceAddress, block.address + lo, hi - lo + 1, &device_bytes[lo], STOP);
+      result->writes++;
+      result->reads++;
+      if(memcmp(&device_bytes[lo], &block.data[lo], hi - lo + 1) != 0)
+      {
+        verified = false;
+      }
+    }
+
+    first = last + 1;
+  }
+
+  return verified;
+}
+
+/**
+  * @name   reconfigureDevice
+  * @brief  A method that calls the reconfigure bit to upload and use all settings
+  * previously defined to the IQS9320.
+  * @param  stopOrRestart ->  Specifies whether the communications window must
+  *                           be kept open or must be closed after this action.
+  *              			        Use the STOP and RESTART definitions.
+  * @retval None.
+  * @note   This bit should always be called after settings has been changed in order
+  *         for it to take effect.
+  */
+void IQS9320::reconfigureDevice(bool stopOrRestart)
+{
+  uint8_t transferByte[2]; // Array to store the bytes transferred.
+
+  readRandomBytes16(_deviceAddress, IQS9320_MM_SYSTEM_CONTROL, 2, transferByte, STOP);
+  /* Set the the RECONFIG_DEV_BIT in the SYSTEM_CONTROL register */
+  transferByte[0] = setBit(transferByte[0], IQS9320_RECONFIG_DEV_BIT);
+  /* Write the new byte to the required device. */
+  writeRandomBytes16(_deviceAddress, IQS9320_MM_SYSTEM_CONTROL, 2, transferByte, stopOrRestart);
+
+}
 
 /**
   * @name   enableMovement
@@ -1075,9 +1865,352 @@ void IQS9320::executeCallibration(bool stopOrRestart)
   * @retval None.
   * @note
   */
-void IQS9320::readATIMirrors(bool stopOrRestart)
+void IQS9320::readATIMirrors(bool stopOrRestart)
+{
+  readRandomBytes16(_deviceAddress, IQS9320_MM_MIRROR_SELECTION_CH0, 40, IQSMemoryMap.MIRROR_SELECTION, stopOrRestart);
+}
+
+/**
+  * @name   setActivationThreshold
+  * @brief  A method that writes the activation threshold of all channels
+  *         without an individual threshold.
+  * @param  threshold ->  ACTIVATION_THRESHOLD, in normalised delta counts.
+  * @retval None.
+  * @note   Takes effect with the next commitSettings(), no ATI is needed.
+  */
+void IQS9320::setActivationThreshold(uint8_t threshold)
+{
+  writeSetting(IQS9320_MM_ACTIVATION_THRESHOLD, 1, &threshold, IQS9320_SETTINGS_RECONFIG);
+}
+
+/**
+  * @name   setChannelThreshold
+  * @brief  A method that writes the individual threshold of one channel.
+  * @param  ch        ->  The channel, ignored if it is not in use.
+  * @param  threshold ->  INDIVIDUAL_THRESHOLDS_n, 0 for the activation
+  *                       threshold.
+  * @retval None.
+  * @note   Takes effect with the next commitSettings(), no ATI is needed.
+  */
+void IQS9320::setChannelThreshold(iqs9320_channel_e ch, uint8_t threshold)
+{
+  if(ch >= _nChannels)
+  {
+    return;
+  }
+  writeSetting(IQS9320_MM_INDIVIDUAL_THRESHOLDS_CH0 + ch, 1, &threshold, IQS9320_SETTINGS_RECONFIG);
+}
+
+/**
+  * @name   setHysteresis
+  * @brief  A method that writes the activation hysteresis.
+  * @param  hysteresis ->  ACTIVATION_HYSTERESIS_0, in normalised delta counts.
+  * @retval None.
+  * @note   Takes effect with the next commitSettings(), no ATI is needed.
+  */
+void IQS9320::setHysteresis(uint8_t hysteresis)
+{
+  writeSetting(IQS9320_MM_ACTIVATION_HYSTERESIS, 1, &hysteresis, IQS9320_SETTINGS_RECONFIG);
+}
+
+/**
+  * @name   setSamplingInterval
+  * @brief  A method that writes the sampling interval of a power mode.
+  * @param  mode        ->  The power mode.
+  * @param  interval_ms ->  Sampling interval in ms.
+  * @retval None.
+  * @note   Takes effect with the next commitSettings(), no ATI is needed.
+  */
+void IQS9320::setSamplingInterval(iqs9320_power_mode_e mode, uint16_t interval_ms)
+{
+  uint8_t transferByte[2]; // Array to store the bytes transferred.
+  uint16_t address = IQS9320_MM_NORMAL_POWER_SAMPLING;
+
+  if(mode == IQS9320_LOW_POWER)
+  {
+    address = IQS9320_MM_LOW_POWER_SAMPLING;
+  }
+  else if(mode == IQS9320_ULTRA_LOW_POWER)
+  {
+    address = IQS9320_MM_ULTRA_LOW_POWER_SAMPLING;
+  }
+  transferByte[0] = (uint8_t)(interval_ms >> 0);
+  transferByte[1] = (uint8_t)(interval_ms >> 8);
+  writeSetting(address, 2, transferByte, IQS9320_SETTINGS_RECONFIG);
+}
+
+/**
+  * @name   setModeTimeout
+  * @brief  A method that writes the time without activity after which the
+  *         device moves from a power mode to the next lower one.
+  * @param  mode       ->  The power mode.
+  * @param  timeout_ms ->  Timeout in ms, 0 stays in the mode.
+  * @retval None.
+  * @note   Takes effect with the next commitSettings(), no ATI is needed.
+  */
+void IQS9320::setModeTimeout(iqs9320_power_mode_e mode, uint16_t timeout_ms)
+{
+  uint8_t transferByte[2]; // Array to store the bytes transferred.
+  uint16_t address = IQS9320_MM_NORMAL_POWER_TIMEOUT;
+
+  if(mode == IQS9320_LOW_POWER)
+  {
+    address = IQS9320_MM_LOW_POWER_TIMEOUT;
+  }
+  else if(mode == IQS9320_ULTRA_LOW_POWER)
+  {
+    address = IQS9320_MM_ULTRA_LOW_POWER_TIMEOUT;
+  }
+  transferByte[0] = (uint8_t)(timeout_ms >> 0);
+  transferByte[1] = (uint8_t)(timeout_ms >> 8);
+  writeSetting(address, 2, transferByte, IQS9320_SETTINGS_RECONFIG);
+}
+
+/**
+  * @name   setFilterBeta
+  * @brief  A method that writes one filter beta of a power mode.
+  * @param  filter ->  The LTA, fast LTA or counts filter.
+  * @param  mode   ->  The power mode.
+  * @param  beta   ->  BETA_*_NP/LP/ULP.
+  * @retval None.
+  * @note   Takes effect with the next commitSettings(), no ATI is needed.
+  *         The betas are stored LTA, fast LTA, counts, each for NP, LP, ULP.
+  */
+void IQS9320::setFilterBeta(iqs9320_beta_e filter, iqs9320_power_mode_e mode, uint8_t beta)
+{
+  writeSetting(IQS9320_MM_LTA_BETA_FILTER + 3*filter + mode, 1, &beta, IQS9320_SETTINGS_RECONFIG);
+}
+
+/**
+  * @name   setATITarget
+  * @brief  A method that writes the ATI target and band.
+  * @param  target ->  ATI target in counts.
+  * @param  band   ->  ATI band in counts.
+  * @retval None.
+  * @note   The channels are re-tuned with the next commitSettings().
+  */
+void IQS9320::setATITarget(uint16_t target, uint16_t band)
+{
+  uint8_t transferByte[4]; // Array to store the bytes transferred.
+
+  transferByte[0] = (uint8_t)(target >> 0);
+  transferByte[1] = (uint8_t)(target >> 8);
+  transferByte[2] = (uint8_t)(band >> 0);
+  transferByte[3] = (uint8_t)(band >> 8);
+  writeSetting(IQS9320_MM_ATI_TARGET, 4, transferByte, IQS9320_SETTINGS_RECONFIG | IQS9320_SETTINGS_ATI);
+}
+
+/**
+  * @name   commitSettings
+  * @brief  A method that applies the settings written with the set methods
+  *         since the last commit: the device is reconfigured once, and ATI is
+  *         only run when one of the settings changed the channel tuning.
+  * @param  stopOrRestart ->  Specifies whether the communications window must
+  *                           be kept open or must be closed after this action.
+  *              			        Use the STOP and RESTART definitions.
+  * @retval bool -> true if ATI was started, poll readATIactive() before the
+  *         next requestData().
+  * @note   Call in IQS9320_STATE_IDLE. Without ATI the new settings are used
+  *         from the next sample on.
+  */
+bool IQS9320::commitSettings(bool stopOrRestart)
+{
+  uint8_t pending = _settings_pending;
+
+  _settings_pending = 0;
+  if(pending & IQS9320_SETTINGS_ATI)
+  {
+    /* ReATI() reconfigures the device before ATI is started */
+    ReATI(stopOrRestart);
+    return true;
+  }
+  if(pending & IQS9320_SETTINGS_RECONFIG)
+  {
+    reconfigureDevice(stopOrRestart);
+  }
+  return false;
+}
+
+/**
+  * @name   setReadPlan
+  * @brief  A method that selects how the frames are read.
+  * @param  plan ->  IQS9320_READ_BURST reads all flags (and the debug data)
+  *                  every frame. IQS9320_READ_ADAPTIVE reads the system
+  *                  status and activation flags first and the rest only when
+  *                  they changed, while the keys are idle.
+  * @retval None.
+  * @note   The adaptive plan reads full frames while any key is active or
+  *         the flags changed in more than 1 of 4 recent frames, and returns
+  *         to probes below 1 of 16. A change of only the filter halt flags
+  *         is seen with the full read every IQS9320_PLAN_REFRESH_FRAMES.
+  */
+void IQS9320::setReadPlan(iqs9320_read_plan_e plan)
+{
+  _read_plan = plan;
+  _plan_burst = true;
+  _plan_rate = 0;
+  _plan_refresh = 0;
+}
+
+/**
+  * @name   getReadStats
+  * @brief  A method that returns the counters of the frame reads.
+  * @param  stats ->  Receives the counters.
+  * @retval None.
+  */
+void IQS9320::getReadStats(iqs9320_read_stats_s *stats)
+{
+  *stats = _read_stats;
+}
+
+/**
+  * @name   clearReadStats
+  * @brief  A method that clears the counters of the frame reads.
+  * @param  None.
+  * @retval None.
+  */
+void IQS9320::clearReadStats(void)
+{
+  memset(&_read_stats, 0, sizeof(_read_stats));
+}
+
+/**
+  * @name   beginSession
+  * @brief  A method that keeps the device in Normal Power while a UI session
+  *         is active, for the shortest touch-to-event latency.
+  * @param  stopOrRestart ->  Specifies whether the communications window must
+  *                           be kept open or must be closed after this action.
+  *              			        Use the STOP and RESTART definitions.
+  * @retval None.
+  * @note   Writes NP_TIMEOUT 0 with setModeTimeout() and commitSettings().
+  *         Call in IQS9320_STATE_IDLE.
+  */
+void IQS9320::beginSession(bool stopOrRestart)
+{
+  _power_session = true;
+  applyPowerPolicy(stopOrRestart);
+}
+
+/**
+  * @name   endSession
+  * @brief  A method that ends the session of beginSession(), the NP and LP
+  *         timeouts of the init file are written again.
+  * @param  stopOrRestart ->  Specifies whether the communications window must
+  *                           be kept open or must be closed after this action.
+  *              			        Use the STOP and RESTART definitions.
+  * @retval None.
+  * @note   The host idle time of setIdleTimeouts() starts again.
+  */
+void IQS9320::endSession(bool stopOrRestart)
+{
+  _power_session = false;
+  _activity_ms = millis();
+  applyPowerPolicy(stopOrRestart);
+}
+
+/**
+  * @name   notifyActivity
+  * @brief  A method that records activity of the host, e.g. a touch handled by
+  *         the UI. Restores the timeouts of the init file when the short
+  *         timeouts of setIdleTimeouts() are on the device.
+  * @param  stopOrRestart ->  Specifies whether the communications window must
+  *                           be kept open or must be closed after this action.
+  *              			        Use the STOP and RESTART definitions.
+  * @retval None.
+  */
+void IQS9320::notifyActivity(bool stopOrRestart)
+{
+  _activity_ms = millis();
+  applyPowerPolicy(stopOrRestart);
+}
+
+/**
+  * @name   setIdleTimeouts
+  * @brief  A method that sets the NP and LP timeouts used after the host was
+  *         idle, so that the device moves to LP and ULP sooner.
+  * @param  idle_ms       ->  Time without notifyActivity(), 0 turns it off.
+  * @param  np_timeout_ms ->  NP timeout while the host is idle.
+  * @param  lp_timeout_ms ->  LP timeout while the host is idle.
+  * @retval None.
+  * @note   Only takes effect in applyPowerPolicy(). The idle time starts again.
+  */
+void IQS9320::setIdleTimeouts(uint32_t idle_ms, uint16_t np_timeout_ms, uint16_t lp_timeout_ms)
+{
+  _idle_ms = idle_ms;
+  _idle_np_timeout = np_timeout_ms;
+  _idle_lp_timeout = lp_timeout_ms;
+  _activity_ms = millis();
+}
+
+/**
+  * @name   applyPowerPolicy
+  * @brief  A method that writes the NP and LP timeouts of the session and host
+  *         idle state when they differ from the ones on the device: NP timeout
+  *         0 in a session, the timeouts of setIdleTimeouts() after the host was
+  *         idle, otherwise the timeouts of the init file.
+  * @param  stopOrRestart ->  Specifies whether the communications window must
+  *                           be kept open or must be closed after this action.
+  *              			        Use the STOP and RESTART definitions.
+  * @retval bool -> true if the timeouts were written.
+  * @note   Call in IQS9320_STATE_IDLE after every frame, it also writes the
+  *         timeouts again after a reset. The write goes through
+  *         setModeTimeout() and commitSettings(), which also applies other
+  *         settings written since the last commit.
+  */
+bool IQS9320::applyPowerPolicy(bool stopOrRestart)
+{
+  iqs9320_timeouts_e timeouts = IQS9320_TIMEOUTS_INIT;
+  uint16_t np_timeout = (uint16_t)(NP_TIMEOUT_0 | (NP_TIMEOUT_1 << 8));
+  uint16_t lp_timeout = (uint16_t)(LP_TIMEOUT_0 | (LP_TIMEOUT_1 << 8));
+
+  if(_power_session)
+  {
+    timeouts = IQS9320_TIMEOUTS_SESSION;
+    np_timeout = 0;
+  }
+  else if((_idle_ms != 0) && ((uint32_t)(millis() - _activity_ms) >= _idle_ms))
+  {
+    timeouts = IQS9320_TIMEOUTS_IDLE;
+    np_timeout = _idle_np_timeout;
+    lp_timeout = _idle_lp_timeout;
+  }
+
+  if(timeouts == _power_applied)
+  {
+    return false;
+  }
+  setModeTimeout(IQS9320_NORMAL_POWER, np_timeout);
+  setModeTimeout(IQS9320_LOW_POWER, lp_timeout);
+  commitSettings(stopOrRestart);
+  _power_applied = timeouts;
+  _power_stats.timeout_writes++;
+  return true;
+}
+
+/**
+  * @name   getPowerStats
+  * @brief  A method that returns the time spent in each power mode and the
+  *         number of power mode changes.
+  * @param  stats ->  Receives the counters.
+  * @retval None.
+  * @note   The time between two frames is counted in the power mode of the
+  *         first, so the resolution is the frame interval.
+  */
+void IQS9320::getPowerStats(iqs9320_power_stats_s *stats)
+{
+  *stats = _power_stats;
+}
+
+/**
+  * @name   clearPowerStats
+  * @brief  A method that clears the power mode counters.
+  * @param  None.
+  * @retval None.
+  */
+void IQS9320::clearPowerStats(void)
 {
-  readRandomBytes16(_deviceAddress, IQS9320_MM_MIRROR_SELECTION_CH0, 40, IQSMemoryMap.MIRROR_SELECTION, STOP);
+  memset(&_power_stats, 0, sizeof(_power_stats));
+  _power_timing = false;
 }
 
 /**
@@ -1203,6 +2336,300 @@ iqs9320_power_mode_e IQS9320::getPowerMode(void)
   return (iqs9320_power_mode_e)ss;
 }
 
+/**
+  * @name   getChannelCount
+  * @brief  A method that returns the number of channels the driver reads and
+  *         writes.
+  * @param  None.
+  * @retval uint8_t -> The nChannels given to begin(), limited to the channels
+  *                    enabled in the init file.
+  * @note   Channels 0 to getChannelCount()-1 are valid in the flags, the
+  *         debug data and decoded frames.
+*/
+uint8_t IQS9320::getChannelCount(void)
+{
+  return _nChannels;
+}
+
+/**
+  * @name   decodeFrame
+  * @brief  A method that decodes the latest data of this device into a slot of
+  *         a structure-of-arrays frame.
+  * @param  frame ->  The frame to fill, shared between devices.
+  * @param  slot  ->  The device slot in the frame, channel data is written to
+  *                   index slot*IQS9320_MAX_CHANNELS onwards.
+  * @retval None.
+  * @note   Call once per frame after new_data_available is set. Channel data
+  *         is only valid when Debug is enabled.
+*/
+void IQS9320::decodeFrame(iqs9320_frame_s *frame, uint8_t slot)
+{
+  uint16_t base = slot * IQS9320_MAX_CHANNELS;
+
+  if(slot >= IQS9320_FRAME_MAX_DEVICES)
+  {
+    return;
+  }
+
+  if(slot >= frame->nDevices)
+  {
+    frame->nDevices = slot + 1;
+  }
+
+  frame->system_status[slot] = (uint16_t)IQSMemoryMap.SYSTEM_STATUS[0]
+                             | ((uint16_t)IQSMemoryMap.SYSTEM_STATUS[1] << 8);
+  frame->activation[slot]    = (uint32_t)IQSMemoryMap.ACTIVATION_FLAGS[0]
+                             | ((uint32_t)IQSMemoryMap.ACTIVATION_FLAGS[1] << 8)
+                             | ((uint32_t)IQSMemoryMap.ACTIVATION_FLAGS[2] << 16);
+  frame->filter_halt[slot]   = (uint32_t)IQSMemoryMap.FILTER_HALT_FLAGS[0]
+                             | ((uint32_t)IQSMemoryMap.FILTER_HALT_FLAGS[1] << 8)
+                             | ((uint32_t)IQSMemoryMap.FILTER_HALT_FLAGS[2] << 16);
+
+  memcpy(&frame->norm[base], IQSMemoryMap.CH_NORM_DELTA, _nChannels);
+  memcpy(&frame->move[base], IQSMemoryMap.CH_MOVEMENT, _nChannels);
+
+  /* Deltas are little-endian on the IQS9320, copy directly on little-endian
+  hosts and assemble byte-wise otherwise */
+  #if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+  memcpy(&frame->delta[base], IQSMemoryMap.CH_DELTA, _nChannels * 2);
+  #else
+  for(uint8_t i = 0; i < _nChannels; i++)
+  {
+    frame->delta[base + i] = (int16_t)((uint16_t)IQSMemoryMap.CH_DELTA[2*i]
+                           | ((uint16_t)IQSMemoryMap.CH_DELTA[2*i + 1] << 8));
+  }
+  #endif
+
+  /* Channels that are not enabled read as 0 */
+  for(uint8_t i = _nChannels; i < IQS9320_MAX_CHANNELS; i++)
+  {
+    frame->delta[base + i] = 0;
+    frame->norm[base + i] = 0;
+    frame->move[base + i] = 0;
+  }
+
+  frame->timestamp = millis();
+}
+
+/**
+  * @name   setCaptureCallback
+  * @brief  A method that registers a function which receives a trace record
+  *         of every I2C transaction made by the driver.
+  * @param  callback ->  Function to call after each transaction, NULL to stop
+  *                      capturing.
+  * @retval None.
+  * @note   Encode the records with iqs9320_trace_encode() and store or send
+  *         them for replay with tools/iqs9320-replay. The callback runs inside
+  *         the transaction path and should return quickly.
+*/
+void IQS9320::setCaptureCallback(iqs9320_capture_cb callback)
+{
+  _transfer.setCaptureCallback(callback);
+}
+
+/**
+  * @name   setTransferPort
+  * @brief  A method that selects the bus back-end of the transfer engine.
+  * @param  port ->  Port for an asynchronous I2C peripheral (DMA or
+  *                  interrupt driven), NULL for the blocking Wire library.
+  * @retval None.
+  * @note   With an asynchronous port run() returns while the reads of a
+  *         frame are on the bus and continues once they completed, call run()
+  *         often. Init and the other methods still wait for their transfers.
+*/
+void IQS9320::setTransferPort(IQS9320TransferPort *port)
+{
+  _transfer.setPort(port ? port : &_wire_port);
+}
+
+/**
+  * @name   trainClock
+  * @brief  A method that selects the fastest I2C clock the bus carries
+  *         without errors. The version details are read at 100 kHz as a
+  *         reference, then at every faster clock up to the limit they are
+  *         read IQS9320_CLOCK_PROBES times and a scratch value is written to
+  *         DEFAULT_READ_LOCATION and read back. The first clock with a NACK,
+  *         a short read or a wrong value ends the training.
+  * @param  None.
+  * @retval uint32_t -> The selected clock in Hz.
+  * @note   Takes a few ms. DEFAULT_READ_LOCATION is restored afterwards.
+  *         The clock is set through the transfer port, ports with a fixed
+  *         clock ignore it. A device that shares the clock of another device
+  *         (shareClock()) does not train, it returns the clock of the owner.
+  */
+uint32_t IQS9320::trainClock(void)
+{
+  uint8_t reference[12];
+  uint8_t default_read[2];
+
+  if(_clock_owner)
+  {
+    return getClock();
+  }
+
+  /* Reference values at the lowest clock */
+  _clock_step = 0;
+  _transfer.setClock(clockFrequency(0));
+  readRandomBytes16(_deviceAddress, IQS9320_MM_PROD_NUM, 12, reference, STOP);
+  readRandomBytes16(_deviceAddress, IQS9320_MM_DEFAULT_READ_LOCATION, 2, default_read, STOP);
+
+  for(uint8_t step = 1; step < _clock_steps; step++)
+  {
+    _transfer.setClock(clockFrequency(step));
+    if(probeClock(reference) > 0)
+    {
+      break;
+    }
+    _clock_step = step;
+  }
+
+  _transfer.setClock(clockFrequency(_clock_step));
+  writeRandomBytes16(_deviceAddress, IQS9320_MM_DEFAULT_READ_LOCATION, 2, default_read, STOP);
+
+  /* Start the runtime error window */
+  _clock_jobs = _transfer.getJobCount();
+  _clock_errors = _transfer.getErrorCount();
+
+  return clockFrequency(_clock_step);
+}
+
+/**
+  * @name   setClockLimit
+  * @brief  A method that sets the fastest clock trainClock() may select.
+  * @param  frequency ->  Highest clock in Hz, at least 100 kHz. Used as the
+  *                       last step of the training, after the standard clocks
+  *                       below it.
+  * @retval None.
+  */
+void IQS9320::setClockLimit(uint32_t frequency)
+{
+  _clock_limit = frequency;
+  _clock_steps = 1;
+  while((_clock_steps < IQS9320_CLOCK_STEPS) && (iqs9320_clocks[_clock_steps - 1] < frequency))
+  {
+    _clock_steps++;
+  }
+  if(iqs9320_clocks[_clock_steps - 1] < frequency)
+  {
+    _clock_steps++; // The limit is above the standard clocks
+  }
+
+  if(_clock_step >= _clock_steps)
+  {
+    _clock_step = _clock_steps - 1;
+    if(!_clock_owner)
+    {
+      _transfer.setClock(clockFrequency(_clock_step));
+    }
+  }
+}
+
+/**
+  * @name   getClock
+  * @brief  A method that returns the I2C clock in use.
+  * @param  None.
+  * @retval uint32_t -> Clock in Hz.
+  */
+uint32_t IQS9320::getClock(void)
+{
+  if(_clock_owner)
+  {
+    return _clock_owner->getClock();
+  }
+  return clockFrequency(_clock_step);
+}
+
+/**
+  * @name   shareClock
+  * @brief  A method that makes this device follow the I2C clock of another
+  *         device on the same bus. The clock is a property of the bus, so
+  *         only one device of the bus may train or lower it; the others
+  *         would set the bus back to their own clock on every change.
+  * @param  owner ->  The device that trains the clock, NULL to train again.
+  * @retval None.
+  * @note   The device no longer calls setClock() of its transfer port, and
+  *         its transfer errors do not lower the clock. IQS9320Group shares
+  *         the clock of its first device with the others.
+  */
+void IQS9320::shareClock(IQS9320 *owner)
+{
+  _clock_owner = (owner == this) ? NULL : owner;
+}
+
+/**
+  * @name   recoverBus
+  * @brief  A method that releases an I2C bus held by the IQS9320 after an
+  *         interrupted transfer: up to 9 SCL clocks and a STOP, after which
+  *         Wire is started again.
+  * @param  None.
+  * @retval uint8_t -> iqs9320_recover_e, see IQS9320TransferPort::recover().
+  * @note   Runs automatically from checkBus(), see getBusStats() for the
+  *         counters and the recovery time.
+  */
+uint8_t IQS9320::recoverBus(void)
+{
+  return _transfer.recover();
+}
+
+/**
+  * @name   getBusStats
+  * @brief  A method that copies the bus health counters: timeouts,
+  *         recoveries and the time they took.
+  * @param  stats ->  Where the counters are stored.
+  * @retval None.
+  */
+void IQS9320::getBusStats(iqs9320_bus_stats_s *stats)
+{
+  _transfer.getBusStats(stats);
+}
+
+/**
+  * @name   queueRead
+  * @brief  A method that queues a read from the IQS9320 without waiting.
+  * @param  memoryAddress ->  The register address to read from.
+  * @param  numBytes      ->  Number of bytes to read.
+  * @param  bytesArray    ->  Destination, must stay valid until completion.
+  * @param  transfer      ->  Job for the read, poll transfer->status for
+  *                           IQS9320_TRANSFER_DONE or IQS9320_TRANSFER_ERROR.
+  * @param  callback      ->  Called on completion from run(), or NULL.
+  * @retval bool -> false if the queue is full.
+  * @note   Callbacks must not call methods that wait for the bus.
+*/
+bool IQS9320::queueRead(uint16_t memoryAddress, uint8_t numBytes, uint8_t bytesArray[], iqs9320_transfer_s *transfer, iqs9320_transfer_cb callback)
+{
+  iqs9320_transfer_setup(transfer, _deviceAddress, memoryAddress, bytesArray, numBytes, true, STOP);
+  transfer->callback = callback;
+  return _transfer.submit(transfer);
+}
+
+/**
+  * @name   queueWrite
+  * @brief  A method that queues a write to the IQS9320 without waiting.
+  * @param  memoryAddress ->  The register address to write to.
+  * @param  numBytes      ->  Number of bytes to write.
+  * @param  bytesArray    ->  Source, must stay valid until completion.
+  * @param  transfer      ->  Job for the write, see queueRead().
+  * @param  callback      ->  Called on completion from run(), or NULL.
+  * @retval bool -> false if the queue is full.
+*/
+bool IQS9320::queueWrite(uint16_t memoryAddress, uint8_t numBytes, uint8_t bytesArray[], iqs9320_transfer_s *transfer, iqs9320_transfer_cb callback)
+{
+  iqs9320_transfer_setup(transfer, _deviceAddress, memoryAddress, bytesArray, numBytes, false, STOP);
+  transfer->callback = callback;
+  return _transfer.submit(transfer);
+}
+
+/**
+  * @name   transfersPending
+  * @brief  A method that reports if queued transfers have not completed yet.
+  * @param  None.
+  * @retval bool -> true while transfers are queued or on the bus.
+*/
+bool IQS9320::transfersPending(void)
+{
+  return !_transfer.idle();
+}
+
 /*****************************************************************************/
 /*									     		ADVANCED PUBLIC METHODS							    	 		   */
 /*****************************************************************************/
@@ -1242,6 +2669,7 @@ void IQS9320::readRandomBytes8(uint8_t deviceAddress, uint8_t memoryAddress, uin
 	Wire.write(memoryAddress);
 	/* Complete the selection and communication initialization. */
 	error_s = Wire.endTransmission(RESTART);  // Restart transmission for reading that follows.
+	(void)error_s; // Not checked, a failed selection reads no bytes below
 	/* The required device has now been selected and it has been told which register to send information from. */
 
 	/* Request "numBytes" bytes from the device which has address "deviceAddress"*/
@@ -1280,7 +2708,8 @@ void IQS9320::readRandomBytes8(uint8_t deviceAddress, uint8_t memoryAddress, uin
  *                           False keeps it open, true closes it. Use the STOP
  *                           and RESTART definitions.
  * @retval  No value is returned, however, the user-supplied array is overwritten.
- * @note    Uses standard Arduino "Wire" library which is for I2C communication.
+ * @note    Goes through the transfer engine, which uses the standard Arduino
+ *          "Wire" library unless another port is set with setTransferPort().
  *          Take note that C++ cannot return an array, therefore, the array which
  *          is passed as an argument is overwritten with the required values.
  *          Pass an array to the method by using only its name, e.g. "bytesArray",
@@ -1288,42 +2717,15 @@ void IQS9320::readRandomBytes8(uint8_t deviceAddress, uint8_t memoryAddress, uin
  */
 void IQS9320::readRandomBytes16(uint8_t deviceAddress, uint16_t memoryAddress, uint8_t numBytes, uint8_t bytesArray[], bool stopOrRestart)
 {
-	uint8_t i = 0;  // A simple counter to assist with loading bytes into the user supplied array.
-	uint8_t error_s = 0; // I2C Error variable to track any issues during communication
-
-	// Select the device with the address of "deviceAddress" and start communication.
-	Wire.beginTransmission(deviceAddress);
-	/* Specify the memory address */
-	uint8_t addr_h, addr_l;
-	addr_h = memoryAddress >> 8;
-	addr_l = memoryAddress;
-	Wire.write(addr_l);
-	Wire.write(addr_h);
-
-	/* Complete the selection and communication initialization. */
-	error_s = Wire.endTransmission(RESTART);  // Restart transmission for reading that follows.
-	/* The required device has now been selected and it has been told which register to send information from. */
-
-	/* Request "numBytes" bytes from the device which has address "deviceAddress"*/
-	uint8_t counter = 0;
-	do
-	{
-		Wire.requestFrom((int)deviceAddress, (int)numBytes, (int)stopOrRestart);
-
-		/* break out of request loop if max retry is reached */
-		if(counter++ >= IQS9320_I2C_RETRY)
-		{
-			return;
-		}
-	}while(Wire.available() == 0);  // Wait for response, this sometimes takes a few attempts
+	iqs9320_transfer_s transfer;
 
-	/* Load the received bytes into the array until there are no more */
-	while(Wire.available())
+	/* Queue the read behind any transfers in progress and wait for it */
+	iqs9320_transfer_setup(&transfer, deviceAddress, memoryAddress, bytesArray, numBytes, true, stopOrRestart);
+	while(!_transfer.submit(&transfer))
 	{
-		/* Load the received bytes into the user supplied array */
-		bytesArray[i] = Wire.read();
-		i++;
+		_transfer.service();
 	}
+	_transfer.wait(&transfer);
 }
 
 /**
@@ -1363,6 +2765,7 @@ void IQS9320::writeRandomBytes8(uint8_t deviceAddress, uint8_t memoryAddress, ui
 	}
 	/* End the transmission, user decides to STOP or RESTART. */
 	error_s = Wire.endTransmission(stopOrRestart);
+	(void)error_s; // Not checked by the 8 bit writes
 }
 
 /**
@@ -1380,7 +2783,8 @@ void IQS9320::writeRandomBytes8(uint8_t deviceAddress, uint8_t memoryAddress, ui
   *                          False keeps it open, true closes it. Use the STOP
   *                          and RESTART definitions.
   * @retval No value is returned, only the IQS device registers are altered.
-  * @note   Uses standard Arduino "Wire" library which is for I2C communication.
+  * @note   Goes through the transfer engine, which uses the standard Arduino
+  *         "Wire" library unless another port is set with setTransferPort().
   *         Take note that a full array cannot be passed to a function in C++.
   *         Pass an array to the function by using only its name, e.g. "bytesArray",
   *         without the square brackets, this passes a pointer to the
@@ -1389,25 +2793,284 @@ void IQS9320::writeRandomBytes8(uint8_t deviceAddress, uint8_t memoryAddress, ui
   */
 void IQS9320::writeRandomBytes16(uint8_t deviceAddress, uint16_t memoryAddress, uint8_t numBytes, uint8_t bytesArray[], bool stopOrRestart)
 {
-	uint8_t error_s = 0; // I2C Error variable to track any issues during communication
-
-	// Select the device with the address of "deviceAddress" and start communication.
-	Wire.beginTransmission(deviceAddress);
-
-	/* Specify the memory address */
-	uint8_t addr_h, addr_l;
-	addr_h = memoryAddress >> 8;
-	addr_l = memoryAddress;
-	Wire.write(addr_l);
-	Wire.write(addr_h);
+	iqs9320_transfer_s transfer;
 
-	// Write the bytes as specified in the array which "arrayAddress" pointer points to.
-	for(int i=0; i<numBytes; i++)
+	/* Queue the write behind any transfers in progress and wait for it */
+	iqs9320_transfer_setup(&transfer, deviceAddress, memoryAddress, bytesArray, numBytes, false, stopOrRestart);
+	while(!_transfer.submit(&transfer))
 	{
-	Wire.write(bytesArray[i]);
+		_transfer.service();
 	}
-	// End the transmission, user decides to STOP or RESTART.
-	error_s = Wire.endTransmission(stopOrRestart);
+	_transfer.wait(&transfer);
+}
+
+/**
+  * @name   clockFrequency
+  * @brief  A method that returns the clock of a training step.
+  * @param  step ->  0 to _clock_steps-1.
+  * @retval uint32_t -> Clock in Hz, the last step is the limit.
+  */
+uint32_t IQS9320::clockFrequency(uint8_t step)
+{
+  return (step + 1 >= _clock_steps) ? _clock_limit : iqs9320_clocks[step];
+}
+
+/**
+  * @name   probeClock
+  * @brief  A method that checks the bus at the current clock.
+  * @param  reference ->  The 12 version bytes read at 100 kHz.
+  * @retval uint8_t -> Number of failed transfers and wrong values.
+  */
+uint8_t IQS9320::probeClock(const uint8_t reference[])
+{
+  uint32_t errors = _transfer.getErrorCount();
+  uint8_t scratch[2] = {0x5A, 0xA5};
+  uint8_t readback[12];
+  uint8_t wrong = 0;
+
+  for(uint8_t i = 0; i < IQS9320_CLOCK_PROBES; i++)
+  {
+    memset(readback, 0, sizeof(readback));
+    readRandomBytes16(_deviceAddress, IQS9320_MM_PROD_NUM, 12, readback, STOP);
+    wrong += (memcmp(readback, reference, 12) != 0);
+  }
+
+  /* A write and read-back of a harmless register */
+  writeRandomBytes16(_deviceAddress, IQS9320_MM_DEFAULT_READ_LOCATION, 2, scratch, STOP);
+  memset(readback, 0, sizeof(readback));
+  readRandomBytes16(_deviceAddress, IQS9320_MM_DEFAULT_READ_LOCATION, 2, readback, STOP);
+  wrong += (memcmp(readback, scratch, 2) != 0);
+
+  return wrong + (uint8_t)(_transfer.getErrorCount() - errors);
+}
+
+/**
+  * @name   checkClock
+  * @brief  A method that lowers the clock by one step when too many
+  *         transfers of the last window failed.
+  * @param  None.
+  * @retval None.
+  */
+void IQS9320::checkClock(void)
+{
+  uint32_t jobs = _transfer.getJobCount() - _clock_jobs;
+  uint32_t errors = _transfer.getErrorCount() - _clock_errors;
+
+  if(_clock_owner || (jobs < IQS9320_CLOCK_WINDOW))
+  {
+    return;
+  }
+
+  if((errors > IQS9320_CLOCK_MAX_ERRORS) && (_clock_step > 0))
+  {
+    _clock_step--;
+    _transfer.setClock(clockFrequency(_clock_step));
+    Serial.print("I2C errors, clock lowered to ");
+    Serial.print(clockFrequency(_clock_step));
+    Serial.println(" Hz");
+  }
+  _clock_jobs = _transfer.getJobCount();
+  _clock_errors = _transfer.getErrorCount();
+}
+
+/**
+  * @name   readVersion
+  * @brief  A method that reads the version details of a device in one burst.
+  * @param  deviceAddress ->  The I2C address.
+  * @param  info          ->  Where the details are stored, cleared first.
+  * @param  stopOrRestart ->  STOP or RESTART at the end of the read.
+  * @retval bool -> true if the device answered with all bytes.
+  */
+bool IQS9320::readVersion(uint8_t deviceAddress, iqs9320_device_info_s *info, bool stopOrRestart)
+{
+  uint32_t errors = _transfer.getErrorCount();
+
+  memset(info, 0, sizeof(*info));
+  info->address = deviceAddress;
+  readRandomBytes16(deviceAddress, IQS9320_MM_PROD_NUM, IQS9320_VERSION_DETAILS_LENGTH, info->details, stopOrRestart);
+  if(_transfer.getErrorCount() != errors)
+  {
+    memset(info->details, 0, IQS9320_VERSION_DETAILS_LENGTH);
+    return false;
+  }
+
+  info->product = (uint16_t)(info->details[0] | (info->details[1] << 8));
+  info->major = info->details[IQS9320_MM_MAJOR_VERSION_NUM];
+  info->minor = info->details[IQS9320_MM_MINOR_VERSION_NUM];
+  return true;
+}
+
+/**
+  * @name   initWait
+  * @brief  A method that waits between two steps of init(). Blocks, unless
+  *         the start-up is scheduled by IQS9320Group, in which case init()
+  *         returns at once until the time has passed.
+  * @param  ms ->  Time in ms.
+  * @retval None.
+  */
+void IQS9320::initWait(uint16_t ms)
+{
+  if(!_init_scheduled)
+  {
+    delay(ms);
+    return;
+  }
+  _init_wait_start = micros();
+  _init_wait_us = (uint32_t)ms * 1000UL;
+}
+
+/**
+  * @name   initWaitRemaining
+  * @brief  A method that returns the time left of the wait set by initWait().
+  * @param  None.
+  * @retval uint32_t -> Time in us, 0 when init() can continue.
+  */
+uint32_t IQS9320::initWaitRemaining(void)
+{
+  uint32_t elapsed = micros() - _init_wait_start;
+
+  if(elapsed >= _init_wait_us)
+  {
+    _init_wait_us = 0;
+    return 0;
+  }
+  return _init_wait_us - elapsed;
+}
+
+/**
+  * @name   waitReady
+  * @brief  A method that polls SYSTEM_STATUS until the device answers with
+  *         SHOW_RESET set, instead of waiting a fixed time after a reset.
+  * @param  start_us ->  micros() when the reset was started.
+  * @retval bool -> true when the device is ready, false after
+  *         IQS9320_RESET_TIMEOUT_MS.
+  * @note   The device does not answer while it starts, those polls fail and
+  *         are repeated.
+  */
+bool IQS9320::waitReady(uint32_t start_us)
+{
+  uint8_t status[2];
+  uint32_t elapsed_us;
+  bool ready = false;
+
+  do
+  {
+    uint32_t errors = _transfer.getErrorCount();
+
+    status[0] = 0;
+    readRandomBytes16(_deviceAddress, IQS9320_MM_SYSTEM_STATUS, 2, status, STOP);
+    elapsed_us = micros() - start_us;
+    if((_transfer.getErrorCount() == errors) && getBit(status[0], IQS9320_SHOW_RESET_BIT))
+    {
+      IQSMemoryMap.SYSTEM_STATUS[0] = status[0];
+      IQSMemoryMap.SYSTEM_STATUS[1] = status[1];
+      _reset_time_us = elapsed_us;
+      if(elapsed_us > _reset_worst_us)
+      {
+        _reset_worst_us = elapsed_us;
+      }
+      ready = true;
+      break;
+    }
+    delayMicroseconds(IQS9320_RESET_POLL_US);
+  } while(elapsed_us < (uint32_t)IQS9320_RESET_TIMEOUT_MS * 1000UL);
+
+  /* Polls of a starting device fail, they do not count against the clock
+  or the bus */
+  _clock_jobs = _bus_jobs = _transfer.getJobCount();
+  _clock_errors = _bus_errors = _transfer.getErrorCount();
+
+  return ready;
+}
+
+/**
+  * @name   checkBus
+  * @brief  A method that handles frames in which every transfer failed.
+  *         Every IQS9320_HANG_FRAMES such frames the bus is recovered and
+  *         the state machine returns to IQS9320_STATE_RUN, so that the next
+  *         run() reads the frame again with the reads of the driver in use.
+  *         After IQS9320_STUCK_FRAMES MCLR is pulsed and the initialization
+  *         restarted.
+  * @param  None.
+  * @retval bool -> true if the bus was recovered or the device was reset.
+  */
+bool IQS9320::checkBus(void)
+{
+  uint32_t jobs = _transfer.getJobCount() - _bus_jobs;
+  uint32_t errors = _transfer.getErrorCount() - _bus_errors;
+
+  _bus_jobs = _transfer.getJobCount();
+  _bus_errors = _transfer.getErrorCount();
+
+  if((jobs == 0) || (errors < jobs))
+  {
+    _failed_frames = 0;
+    return false;
+  }
+
+  if((++_failed_frames < IQS9320_STUCK_FRAMES) || (_mclr_pin == IQS9320_MCLR_NONE))
+  {
+    if((_failed_frames % IQS9320_HANG_FRAMES) != 0)
+    {
+      return false;
+    }
+    Serial.println("I2C bus not responding, Bus Recovery!\n");
+    recoverBus();
+    new_data_available = false;
+    iqs9320_state.state = IQS9320_STATE_RUN;
+    return true;
+  }
+
+  Serial.println("Device not answering, MCLR Reset!\n");
+  _failed_frames = 0;
+  HW_Reset();
+  new_data_available = false;
+  iqs9320_state.state = IQS9320_STATE_START;
+  iqs9320_state.init_state = IQS9320_INIT_VERIFY_PRODUCT;
+  return true;
+}
+
+/**
+  * @name   countPowerMode
+  * @brief  A method that counts the time since the last frame in the power
+  *         mode of that frame, as reported in SYSTEM_STATUS.
+  * @param  None.
+  * @retval None.
+  * @note   Called for every valid frame. The modes are switched by the device
+  *         on its NP/LP/ULP timeouts, see applyPowerPolicy().
+  */
+void IQS9320::countPowerMode(void)
+{
+  uint32_t now = millis();
+  iqs9320_power_mode_e mode = getPowerMode();
+
+  if(_power_timing && (_power_mode < IQS9320_POWER_MODES))
+  {
+    _power_stats.time_ms[_power_mode] += now - _power_frame_ms;
+    if(mode != _power_mode)
+    {
+      _power_stats.switches++;
+    }
+  }
+  _power_timing = true;
+  _power_frame_ms = now;
+  _power_mode = mode;
+}
+
+/**
+  * @name   writeSetting
+  * @brief  A method that writes the bytes of one setting and records what
+  *         commitSettings() has to do to apply it.
+  * @param  memoryAddress ->  First register of the setting.
+  * @param  numBytes      ->  Number of bytes of the setting.
+  * @param  bytesArray    ->  The bytes to write.
+  * @param  pending       ->  IQS9320_SETTINGS_* needed to apply the setting.
+  * @retval None.
+  */
+void IQS9320::writeSetting(uint16_t memoryAddress, uint8_t numBytes, uint8_t bytesArray[], uint8_t pending)
+{
+  writeRandomBytes16(_deviceAddress, memoryAddress, numBytes, bytesArray, STOP);
+  _settings_pending |= pending;
 }
 
 /**
@@ -28,17 +28,62 @@
 // Include Files
 #include "Arduino.h"
 #include "Wire.h"
-#include "./inc/iqs9320_addresses.h"
+#include "./inc/IQS9320_addresses.h"
+#include "IQS9320_frame.h"
+#include "IQS9320_trace.h"
+#include "IQS9320_transfer.h"
 
 /* Select the version of IQS9320 used */
 // #define IQS9320_V0_4
 // #define IQS9320_V0_7
 #define IQS9320_V1_0
 
+/* Version numbers for templates, IQS9320_VERSION is the selected version */
+#define IQS9320_VERSION_0_4             4
+#define IQS9320_VERSION_0_7             7
+#define IQS9320_VERSION_1_0             10
+
+#if defined(IQS9320_V1_0)
+#define IQS9320_VERSION                 IQS9320_VERSION_1_0
+#elif defined(IQS9320_V0_7)
+#define IQS9320_VERSION                 IQS9320_VERSION_0_7
+#elif defined(IQS9320_V0_4)
+#define IQS9320_VERSION                 IQS9320_VERSION_0_4
+#endif
+
 /* Choose to ATI on start-up or read the Mirror selection and disable ATI (should be true for IQS9320 v0.3 or less) */
 #define IQS9320_RESET_ON_STARTUP        false
 #define IQS9320_I2C_RETRY               10
 
+/* I2C clock training during init, see trainClock(). The clock is lowered at
+runtime when more than IQS9320_CLOCK_MAX_ERRORS of IQS9320_CLOCK_WINDOW
+transfers fail */
+#define IQS9320_CLOCK_TRAINING          true
+#define IQS9320_CLOCK_MAX               1000000 // Fast-mode Plus
+#define IQS9320_CLOCK_PROBES            16      // Version reads per clock
+#define IQS9320_CLOCK_WINDOW            64
+#define IQS9320_CLOCK_MAX_ERRORS        2
+
+/* Hardware reset through MCLR, see HW_Reset(). With IQS9320_RESET_MCLR the
+init reset pulses MCLR instead of setting SW_RESET. When every transfer of a
+frame fails, the bus is recovered (recoverBus()) every IQS9320_HANG_FRAMES
+frames, and MCLR is pulsed after IQS9320_STUCK_FRAMES frames in a row */
+#define IQS9320_RESET_MCLR              false
+#define IQS9320_MCLR_NONE               0xFF    // mclr_pin of a board without MCLR
+#define IQS9320_MCLR_PULSE_US           1000    // MCLR low time
+#define IQS9320_RESET_TIMEOUT_MS        100     // Longest wait for SHOW_RESET
+#define IQS9320_RESET_POLL_US           500     // SYSTEM_STATUS poll interval
+#define IQS9320_HANG_FRAMES             2
+#define IQS9320_STUCK_FRAMES            8
+#define IQS9320_MCLR_RETRY              3       // Resets while the product read fails
+
+/* Adaptive read plan, see setReadPlan(). The change rate is a running
+average in 1/256 with a weight of 1/8 for the latest frame */
+#define IQS9320_PLAN_BURST_ENTER        64      // Full reads from a change in 1 of 4 frames
+#define IQS9320_PLAN_BURST_LEAVE        16      // Conditional reads below 1 of 16 frames
+#define IQS9320_PLAN_REFRESH_FRAMES     32      // Full read at least every n frames
+#define IQS9320_READ_OVERHEAD           4       // Bus bytes of a read besides its data
+
 // Public Global Definitions
 /* For use with Wire.h library. True argument with some functions closes the
    I2C communication window.*/
@@ -66,6 +111,7 @@
 #define IQS9320_MM_LTA_BETA_FILTER              0x3112
 #define IQS9320_MM_REFERENCE_HALT_TIMEOUT       0x311C
 #define IQS9320_MM_ACTIVATION_HYSTERESIS        0x311D
+#define IQS9320_FLAG_FIELD_SIZE                 3
 #endif
 #if defined(IQS9320_V0_7) || defined(IQS9320_V1_0)
 #define IQS9320_MM_ACTIVATION_FLAGS             0x100A
@@ -82,6 +128,9 @@
 #define IQS9320_MM_LTA_BETA_FILTER              0x313A
 #define IQS9320_MM_REFERENCE_HALT_TIMEOUT       0x3144
 #define IQS9320_MM_ACTIVATION_HYSTERESIS        0x3145
+#define IQS9320_MM_TIMING_GENERATOR             0x3146
+#define IQS9320_MM_HARDWARE_SETTINGS            0x3148
+#define IQS9320_FLAG_FIELD_SIZE                 4
 #endif
 
 // System event bits
@@ -108,10 +157,12 @@
 typedef enum {
         IQS9320_INIT_NONE = (uint8_t) 0x00,
         IQS9320_INIT_VERIFY_PRODUCT,
+        IQS9320_INIT_TRAIN_CLOCK,
         IQS9320_INIT_READ_RESET,
 	IQS9320_INIT_CHIP_RESET,
         IQS9320_INIT_ACK_RESET,
         IQS9320_INIT_UPDATE_SETTINGS,
+        IQS9320_INIT_VERIFY_SETTINGS,
         IQS9320_INIT_DEFAULT_READ_SYS_STATUS,
         IQS9320_INIT_RECONFIG_DEV,
         IQS9320_INIT_ATI,
@@ -128,6 +179,7 @@ typedef enum {
         IQS9320_STATE_SW_RESET,
         IQS9320_STATE_CHECK_RESET,
 	IQS9320_STATE_RUN,
+        IQS9320_STATE_WAIT_FOR_DATA,
         IQS9320_STATE_IDLE,
 } iqs9320_state_e;
 
@@ -160,6 +212,27 @@ typedef enum {
         IQS9320_ULTRA_LOW_POWER,
 } iqs9320_power_mode_e;
 
+/* Number of power modes, for the per mode counters */
+#define IQS9320_POWER_MODES             3
+
+/* NP/LP timeouts written by applyPowerPolicy() */
+typedef enum {
+        IQS9320_TIMEOUTS_INIT = (uint8_t) 0x00, // Timeouts of the init file
+        IQS9320_TIMEOUTS_SESSION,               // NP timeout 0, stays in NP
+        IQS9320_TIMEOUTS_IDLE,                  // Short timeouts of setIdleTimeouts()
+} iqs9320_timeouts_e;
+
+typedef enum {
+        IQS9320_READ_BURST = (uint8_t) 0x00,    // Every frame reads all flags (and debug data)
+        IQS9320_READ_ADAPTIVE,                  // Status and activation first, the rest on a change
+} iqs9320_read_plan_e;
+
+typedef enum {
+        IQS9320_BETA_LTA = (uint8_t) 0x00,
+        IQS9320_BETA_FAST_LTA,
+        IQS9320_BETA_COUNTS,
+} iqs9320_beta_e;
+
 typedef enum
 {
         IQS9320_CH_NONE = (uint8_t) 0x00,
@@ -170,7 +243,7 @@ typedef enum
 
 /* IQS9320 Memory map data variables, only save the data that might be used
 during program runtime */
-#pragma pack(1)
+#pragma pack(push, 1)
 typedef struct
 {
 	/* READ ONLY */			        //  I2C Addresses:
@@ -187,14 +260,90 @@ typedef struct
 	uint8_t SYSTEM_CONTROL[2]; 	        // 	0x2000
         uint8_t MIRROR_SELECTION[40];           // 	0x3000 -> 0x301D
 } IQS9320_MEMORY_MAP;
-#pragma pack(4)
+#pragma pack(pop)
+
+/* Bytes of VERSION_DETAILS, read in one burst from IQS9320_MM_PROD_NUM */
+#define IQS9320_VERSION_DETAILS_LENGTH  12
+
+/**
+* @brief  iqs9320 Device Information, one entry of the enumerate() table.
+*/
+typedef struct {
+        uint8_t  address;               // 7-bit I2C address
+        uint16_t product;               // IQS9320_PRODUCT_NUM for an IQS9320
+        uint8_t  major;
+        uint8_t  minor;
+        uint8_t  details[IQS9320_VERSION_DETAILS_LENGTH];
+} iqs9320_device_info_s;
+
+/* Number of register blocks written by updateSettings() */
+#define IQS9320_SETTINGS_BLOCKS         18
+
+/**
+* @brief  iqs9320 Settings Block, one register write of updateSettings().
+*/
+typedef struct {
+        uint16_t    address;            // First register of the block
+        uint8_t     length;             // Number of bytes, 0 if not used
+        const char *name;               // Description for the serial log
+        uint8_t     data[20];           // Values from the init file
+} iqs9320_settings_block_s;
+
+/* Settings read-back, see verifySettings(). Blocks closer than the gap are
+read in one burst of at most IQS9320_VERIFY_BUFFER bytes */
+#define IQS9320_VERIFY_BUFFER           128
+#define IQS9320_VERIFY_GAP              8
+#define IQS9320_VERIFY_MAX_RANGES       8
+
+/**
+* @brief  iqs9320 Register Range.
+*/
+typedef struct {
+        uint16_t address;
+        uint8_t  length;
+} iqs9320_range_s;
+
+/**
+* @brief  iqs9320 Settings Verification Result.
+*/
+typedef struct {
+        uint16_t bytes;                 // Setting bytes compared
+        uint8_t  reads;                 // Read-back bursts
+        uint8_t  writes;                // Rewritten ranges
+        uint8_t  nRanges;               // Mismatched ranges, the first IQS9320_VERIFY_MAX_RANGES are listed
+        iqs9320_range_s ranges[IQS9320_VERIFY_MAX_RANGES];
+} iqs9320_verify_s;
+
+/**
+* @brief  iqs9320 Read Plan Counters, see getReadStats().
+*/
+typedef struct {
+        uint32_t frames;                // Frames read
+        uint32_t probes;                // Frames started with the status and activation read
+        uint32_t probe_hits;            // Probes that found a change and read the rest
+        uint32_t bus_bytes;             // Bytes on the bus, including IQS9320_READ_OVERHEAD
+        uint32_t bytes_avoided;         // Bytes saved against a full read of every frame
+} iqs9320_read_stats_s;
+
+/**
+* @brief  iqs9320 Power Mode Counters, see getPowerStats().
+*/
+typedef struct {
+        uint32_t time_ms[IQS9320_POWER_MODES];  // Time in NP, LP and ULP by SYSTEM_STATUS
+        uint32_t switches;                      // Power mode changes seen between frames
+        uint32_t timeout_writes;                // NP/LP timeout commits of applyPowerPolicy()
+} iqs9320_power_stats_s;
 
-#pragma pack(1)
+/* Written settings that wait for commitSettings() */
+#define IQS9320_SETTINGS_RECONFIG       0x01    // Used after RECONFIG_DEV
+#define IQS9320_SETTINGS_ATI            0x02    // Changes the channel tuning, needs ATI
+
+#pragma pack(push, 1)
 typedef struct {
         iqs9320_state_e        state;
         iqs9320_init_e         init_state;
 }iqs9320_s;
-#pragma pack(4)
+#pragma pack(pop)
 
 // Class Prototype
 class IQS9320
@@ -220,12 +369,18 @@ public:
         uint16_t getProductNum(bool stopOrRestart);
         uint8_t getmajorVersion(bool stopOrRestart);
         uint8_t getminorVersion(bool stopOrRestart);
+        bool readVersionDetails(bool stopOrRestart);
+        void setVersionDetails(const iqs9320_device_info_s *info);
+        uint8_t enumerate(const uint8_t addresses[], uint8_t nAddresses, iqs9320_device_info_s table[], uint8_t maxDevices);
 
         bool readATIactive(void);
         void acknowledgeReset(bool stopOrRestart);
         void ReATI(bool stopOrRestart);
         void ReSeed(bool stopOrRestart);
         void SW_Reset(bool stopOrRestart);
+        bool HW_Reset(void);
+        uint32_t getResetTime(void);
+        uint32_t getWorstResetTime(void);
 
         void DebugOn(void);
         void DebugOff(void);
@@ -234,12 +389,35 @@ public:
         bool checkReset(void);
 
         void updateSettings(bool stopOrRestart);
+        bool getSettingsBlock(uint8_t step, iqs9320_settings_block_s *block);
+        bool verifySettings(bool repair, iqs9320_verify_s *result);
         void reconfigureDevice(bool stopOrRestart);
         void enableMovement(bool enable, bool stopOrRestart);
         void changeDefaultRead(uint16_t read_address, bool stopOrRestart);
         void executeCallibration(bool stopOrRestart);
         void readATIMirrors(bool stopOrRestart);
 
+        void setActivationThreshold(uint8_t threshold);
+        void setChannelThreshold(iqs9320_channel_e ch, uint8_t threshold);
+        void setHysteresis(uint8_t hysteresis);
+        void setSamplingInterval(iqs9320_power_mode_e mode, uint16_t interval_ms);
+        void setModeTimeout(iqs9320_power_mode_e mode, uint16_t timeout_ms);
+        void setFilterBeta(iqs9320_beta_e filter, iqs9320_power_mode_e mode, uint8_t beta);
+        void setATITarget(uint16_t target, uint16_t band);
+        bool commitSettings(bool stopOrRestart);
+
+        void beginSession(bool stopOrRestart);
+        void endSession(bool stopOrRestart);
+        void notifyActivity(bool stopOrRestart);
+        void setIdleTimeouts(uint32_t idle_ms, uint16_t np_timeout_ms, uint16_t lp_timeout_ms);
+        bool applyPowerPolicy(bool stopOrRestart);
+        void getPowerStats(iqs9320_power_stats_s *stats);
+        void clearPowerStats(void);
+
+        void setReadPlan(iqs9320_read_plan_e plan);
+        void getReadStats(iqs9320_read_stats_s *stats);
+        void clearReadStats(void);
+
         bool getChannelActivation(iqs9320_channel_e ch);
         bool getChannelFilterHalt(iqs9320_channel_e ch);
         uint8_t getChannelNormDelta(iqs9320_channel_e ch);
@@ -247,18 +425,117 @@ public:
         int16_t getChannelDelta(iqs9320_channel_e ch);
         iqs9320_power_mode_e getPowerMode(void);
 
+        uint8_t getChannelCount(void);
+        void decodeFrame(iqs9320_frame_s *frame, uint8_t slot);
+
+        void setCaptureCallback(iqs9320_capture_cb callback);
+
+        void setTransferPort(IQS9320TransferPort *port);
+        uint32_t trainClock(void);
+        void setClockLimit(uint32_t frequency);
+        uint32_t getClock(void);
+        void shareClock(IQS9320 *owner);
+        uint8_t recoverBus(void);
+        void getBusStats(iqs9320_bus_stats_s *stats);
+        bool queueRead(uint16_t memoryAddress, uint8_t numBytes, uint8_t bytesArray[], iqs9320_transfer_s *transfer, iqs9320_transfer_cb callback);
+        bool queueWrite(uint16_t memoryAddress, uint8_t numBytes, uint8_t bytesArray[], iqs9320_transfer_s *transfer, iqs9320_transfer_cb callback);
+        bool transfersPending(void);
+
 private:
+        /* The coroutine driver uses the transfer queue and frame reads */
+        friend class IQS9320Coro;
+
+        /* The multi-device start-up runs init() without blocking waits */
+        friend class IQS9320Group;
+
+        /* The fixed-size driver replaces the frame reads */
+        template<uint8_t Version, uint8_t NChannels, uint8_t Features> friend class IQS9320Fixed;
+
         // Private Variables
         uint8_t _deviceAddress;
         uint8_t _nChannels;
         uint8_t _mclr_pin;
         bool _debug_en;
+        uint8_t _settings_pending;      // IQS9320_SETTINGS_* of written settings
+        bool _version_valid;            // VERSION_DETAILS set by setVersionDetails()
+
+        /* Transfer engine and the jobs of one frame */
+        IQS9320Transfer _transfer;
+        IQS9320WirePort _wire_port;
+        iqs9320_transfer_s _frame_jobs[4];
+        uint8_t _frame_job_count;
+        uint8_t _flags_buffer[2+3*IQS9320_FLAG_FIELD_SIZE];
+
+        /* Read plan of the frames */
+        iqs9320_read_plan_e _read_plan;
+        bool _frame_probe;              // Current frame started with a probe
+        bool _frame_failed;             // A read of the last frame failed
+        bool _plan_burst;               // Adaptive plan reads full frames
+        uint16_t _plan_rate;            // Frames with a change, in 1/256
+        uint8_t _plan_refresh;          // Probed frames since the last full read
+        uint16_t _frame_bytes;          // Bus bytes of the current frame
+        iqs9320_read_stats_s _read_stats;
+
+        /* Trained I2C clock and the error window at runtime */
+        uint32_t _clock_limit;
+        uint8_t _clock_steps;
+        uint8_t _clock_step;
+        uint32_t _clock_jobs;
+        uint32_t _clock_errors;
+        IQS9320 *_clock_owner;          // Device that sets the clock of the bus
+
+        /* Reset to ready times and the failed frame count for MCLR */
+        uint32_t _reset_time_us;
+        uint32_t _reset_worst_us;
+        uint8_t _mclr_retries;
+        uint8_t _failed_frames;
+        uint32_t _bus_jobs;
+        uint32_t _bus_errors;
+
+        /* Time in each power mode, see countPowerMode() */
+        bool _power_timing;             // _power_frame_ms holds the time of a frame
+        uint32_t _power_frame_ms;
+        iqs9320_power_mode_e _power_mode;       // Power mode of the last frame
+        iqs9320_power_stats_s _power_stats;
+
+        /* Session and host idle policy, see applyPowerPolicy() */
+        bool _power_session;            // Between beginSession() and endSession()
+        iqs9320_timeouts_e _power_applied;      // Timeouts on the device
+        uint32_t _activity_ms;          // Last notifyActivity()
+        uint32_t _idle_ms;              // Host idle time for the short timeouts, 0 off
+        uint16_t _idle_np_timeout;
+        uint16_t _idle_lp_timeout;
+
+        /* Waits of init(), see initWait() */
+        uint8_t _init_reads;            // Reads of IQS9320_INIT_READ_DATA
+        bool _init_scheduled;           // Set by IQS9320Group
+        uint32_t _init_wait_start;
+        uint32_t _init_wait_us;
 
         // Private Methods
+        void startValueUpdates(void);
+        bool valueUpdatesDone(void);
+        bool continueValueUpdates(void);
+        void finishValueUpdates(void);
+        bool frameFailed(void);
+        void queueFrameRead(uint16_t memoryAddress, uint8_t numBytes, uint8_t bytesArray[]);
+        void queueFullRead(void);
+        uint8_t flagsLength(void);
+        uint16_t fullReadBytes(void);
+        uint32_t clockFrequency(uint8_t step);
+        uint8_t probeClock(const uint8_t reference[]);
+        void checkClock(void);
+        bool readVersion(uint8_t deviceAddress, iqs9320_device_info_s *info, bool stopOrRestart);
+        bool waitReady(uint32_t start_us);
+        void initWait(uint16_t ms);
+        uint32_t initWaitRemaining(void);
+        bool checkBus(void);
+        void countPowerMode(void);
         void readRandomBytes8(uint8_t deviceAddress, uint8_t memoryAddress, uint8_t numBytes, uint8_t bytesArray[], bool stopOrRestart);
         void readRandomBytes16(uint8_t deviceAddress, uint16_t memoryAddress, uint8_t numBytes, uint8_t bytesArray[], bool stopOrRestart);
         void writeRandomBytes8(uint8_t deviceAddress, uint8_t memoryAddress, uint8_t numBytes, uint8_t bytesArray[], bool stopOrRestart);
         void writeRandomBytes16(uint8_t deviceAddress, uint16_t memoryAddress, uint8_t numBytes, uint8_t bytesArray[], bool stopOrRestart);
+        void writeSetting(uint16_t memoryAddress, uint8_t numBytes, uint8_t bytesArray[], uint8_t pending);
         bool getBit(uint8_t data, uint8_t bit_number);
         uint8_t setBit(uint8_t data, uint8_t bit_number);
         uint8_t clearBit(uint8_t data, uint8_t bit_number);
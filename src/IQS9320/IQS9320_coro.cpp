@@ -0,0 +1,853 @@
+/******************************************************************************
+ *                                                                            *
+ *                                Copyright by                                *
+ *                                                                            *
+ *                              Azoteq (Pty) Ltd                              *
+ *                          Republic of South Africa                          *
+ *                                                                            *
+ *                           Tel: +27(0)21 863 0033                           *
+ *                           E-mail: info@azoteq.com                          *
+ *                                                                            *
+ * ========================================================================== *
+ * @file        IQS9320_coro.cpp                                              *
+ * @brief       This file contains the coroutine task, the single-threaded    *
+ *              executor and the coroutine versions of the IQS9320 start-up   *
+ *              routine and main loop.                                        *
+ * @author      Azoteq PTY Ltd                                                *
+ * @version     v1.5.3                                                        *
+ * @date        2024                                                          *
+ *****************************************************************************/
+
+/* Include Files */
+#include "IQS9320_coro.h"
+
+#ifdef IQS9320_CORO_AVAILABLE
+
+#include <algorithm>
+#include <utility>
+
+/*****************************************************************************/
+/*                                  TASK                                     */
+/*****************************************************************************/
+IQS9320Task::IQS9320Task(IQS9320Task &&other) noexcept
+{
+  _handle = std::exchange(other._handle, nullptr);
+}
+
+IQS9320Task &IQS9320Task::operator=(IQS9320Task &&other) noexcept
+{
+  if(this != &other)
+  {
+    if(_handle)
+    {
+      _handle.destroy();
+    }
+    _handle = std::exchange(other._handle, nullptr);
+  }
+  return *this;
+}
+
+IQS9320Task::~IQS9320Task()
+{
+  if(_handle)
+  {
+    _handle.destroy();
+  }
+}
+
+/**
+  * @name   done
+  * @brief  A method that reports if the coroutine has returned.
+  * @param  None.
+  * @retval bool -> true once co_return has been reached.
+  */
+bool IQS9320Task::done(void) const
+{
+  return !_handle || _handle.done();
+}
+
+/**
+  * @name   result
+  * @brief  A method that returns the co_return value of a finished task.
+  * @param  None.
+  * @retval bool -> The returned value, false while the task is running.
+  */
+bool IQS9320Task::result(void) const
+{
+  return done() && _handle && _handle.promise().value;
+}
+
+/*****************************************************************************/
+/*                             TRANSFER AWAITER                              */
+/*****************************************************************************/
+IQS9320TransferAwaiter::IQS9320TransferAwaiter(IQS9320Executor *executor, IQS9320Transfer *queue, uint8_t device, uint16_t reg, uint8_t data[], uint8_t length, bool read, bool stop, uint32_t *errors)
+{
+  _executor = executor;
+  _queue = queue;
+  _submitted = NULL;
+  _errors = errors;
+  iqs9320_transfer_setup(&_job, device, reg, data, length, read, stop);
+}
+
+IQS9320TransferAwaiter::IQS9320TransferAwaiter(IQS9320Executor *executor, iqs9320_transfer_s *submitted, uint32_t *errors)
+{
+  _executor = executor;
+  _queue = NULL;
+  _submitted = submitted;
+  _errors = errors;
+}
+
+/**
+  * @name   await_ready
+  * @brief  Skip the suspension when waiting for a job that already completed,
+  *         e.g. on a blocking port.
+  */
+bool IQS9320TransferAwaiter::await_ready(void)
+{
+  if(_queue)
+  {
+    return false;
+  }
+  return (_submitted->status == IQS9320_TRANSFER_DONE) || (_submitted->status == IQS9320_TRANSFER_ERROR);
+}
+
+/**
+  * @name   await_suspend
+  * @brief  Attach the completion callback and submit the job. When the queue
+  *         is full the executor submits it again on its next turn.
+  * @note   The callback only schedules the coroutine, it is resumed by the
+  *         executor after await_suspend() has returned.
+  */
+void IQS9320TransferAwaiter::await_suspend(std::coroutine_handle<> handle)
+{
+  iqs9320_transfer_s *transfer = job();
+
+  _handle = handle;
+  transfer->context = this;
+  transfer->callback = done;
+
+  if(_queue && !submit())
+  {
+    _executor->retry(this);
+  }
+}
+
+/**
+  * @name   await_resume
+  * @brief  Count a failed job and return the result.
+  * @retval bool -> true if the job completed without a bus error.
+  */
+bool IQS9320TransferAwaiter::await_resume(void)
+{
+  bool ok = (job()->status == IQS9320_TRANSFER_DONE);
+
+  if(!ok && _errors)
+  {
+    (*_errors)++;
+  }
+  return ok;
+}
+
+/**
+  * @name   submit
+  * @brief  A method that adds the own job to the device queue.
+  * @retval bool -> false if the queue is full.
+  */
+bool IQS9320TransferAwaiter::submit(void)
+{
+  return _queue->submit(&_job);
+}
+
+/* Completion callback of the job, hands the coroutine back to the executor */
+void IQS9320TransferAwaiter::done(iqs9320_transfer_s *transfer)
+{
+  IQS9320TransferAwaiter *awaiter = (IQS9320TransferAwaiter *)transfer->context;
+
+  transfer->callback = NULL;
+  awaiter->_executor->schedule(awaiter->_handle);
+}
+
+/*****************************************************************************/
+/*                                EXECUTOR                                   */
+/*****************************************************************************/
+IQS9320Executor::IQS9320Executor()
+{
+}
+
+IQS9320Executor::~IQS9320Executor()
+{
+  /* Drop the references into the coroutine frames before they are destroyed */
+  _ready.clear();
+  _timers.clear();
+  _blocked.clear();
+  _tasks.clear();
+}
+
+/**
+  * @name   addQueue
+  * @brief  A method that adds the transfer queue of a device to the queues
+  *         serviced on every turn.
+  * @param  queue ->  The transfer queue, added once.
+  * @retval None.
+  */
+void IQS9320Executor::addQueue(IQS9320Transfer *queue)
+{
+  if(std::find(_queues.begin(), _queues.end(), queue) == _queues.end())
+  {
+    _queues.push_back(queue);
+  }
+}
+
+/**
+  * @name   spawn
+  * @brief  A method that takes ownership of a task and starts it on the next
+  *         turn.
+  * @param  task ->  A task that has not been started or awaited.
+  * @retval None.
+  */
+void IQS9320Executor::spawn(IQS9320Task &&task)
+{
+  schedule(task._handle);
+  _tasks.push_back(std::move(task));
+}
+
+/**
+  * @name   schedule
+  * @brief  A method that resumes a suspended coroutine on the next turn.
+  * @param  handle ->  The coroutine.
+  * @retval None.
+  */
+void IQS9320Executor::schedule(std::coroutine_handle<> handle)
+{
+  _ready.push_back(handle);
+}
+
+/**
+  * @name   retry
+  * @brief  A method that keeps a job that did not fit in its queue and
+  *         submits it again on every turn until it is accepted.
+  * @param  awaiter ->  The suspended transfer.
+  * @retval None.
+  */
+void IQS9320Executor::retry(IQS9320TransferAwaiter *awaiter)
+{
+  _blocked.push_back(awaiter);
+}
+
+/**
+  * @name   sleep_for
+  * @brief  A method that returns an awaitable delay.
+  * @param  ms ->  Delay in milliseconds.
+  * @retval Sleep -> co_await it to suspend the coroutine.
+  */
+IQS9320Executor::Sleep IQS9320Executor::sleep_for(uint32_t ms)
+{
+  return sleep_until((uint32_t)micros() + ms * 1000UL);
+}
+
+/**
+  * @name   sleep_until
+  * @brief  A method that returns an awaitable that resumes at a deadline.
+  * @param  deadline_us ->  micros() value to resume at.
+  * @retval Sleep -> co_await it to suspend the coroutine.
+  */
+IQS9320Executor::Sleep IQS9320Executor::sleep_until(uint32_t deadline_us)
+{
+  Sleep sleep;
+
+  sleep.executor = this;
+  sleep.deadline = deadline_us;
+  return sleep;
+}
+
+/**
+  * @name   runOnce
+  * @brief  A method that performs one turn: services the transfer queues,
+  *         wakes expired timers and resumes every ready coroutine. Waits for
+  *         the next timer or transfer when there was nothing to resume.
+  * @param  None.
+  * @retval bool -> true while spawned tasks are still running.
+  */
+bool IQS9320Executor::runOnce(void)
+{
+  uint32_t now;
+
+  for(size_t i = 0; i < _queues.size(); i++)
+  {
+    _queues[i]->service();
+  }
+
+  /* Submit jobs again that found their queue full */
+  for(size_t i = 0; i < _blocked.size();)
+  {
+    if(_blocked[i]->submit())
+    {
+      _blocked.erase(_blocked.begin() + i);
+    }
+    else
+    {
+      i++;
+    }
+  }
+
+  /* Wake the coroutines whose deadline has passed */
+  now = (uint32_t)micros();
+  for(size_t i = 0; i < _timers.size();)
+  {
+    if((int32_t)(_timers[i].deadline - now) <= 0)
+    {
+      _ready.push_back(_timers[i].handle);
+      _timers[i] = _timers.back();
+      _timers.pop_back();
+    }
+    else
+    {
+      i++;
+    }
+  }
+
+  if(_ready.empty())
+  {
+    idle();
+  }
+  else
+  {
+    /* Resumed coroutines schedule into _ready, which is resumed next turn */
+    _running.swap(_ready);
+    for(size_t i = 0; i < _running.size(); i++)
+    {
+      _running[i].resume();
+    }
+    _running.clear();
+  }
+
+  /* Release the finished top-level tasks */
+  for(size_t i = 0; i < _tasks.size();)
+  {
+    if(_tasks[i].done())
+    {
+      _tasks.erase(_tasks.begin() + i);
+    }
+    else
+    {
+      i++;
+    }
+  }
+
+  return !_tasks.empty();
+}
+
+/**
+  * @name   run
+  * @brief  A method that runs until all spawned tasks have returned.
+  * @param  None.
+  * @retval None.
+  */
+void IQS9320Executor::run(void)
+{
+  while(runOnce())
+  {
+  }
+}
+
+/**
+  * @name   runFor
+  * @brief  A method that runs for a time or until all tasks have returned.
+  * @param  ms ->  Time to run in milliseconds.
+  * @retval None.
+  */
+void IQS9320Executor::runFor(uint32_t ms)
+{
+  uint32_t end = (uint32_t)micros() + ms * 1000UL;
+
+  while(runOnce() && ((int32_t)(end - (uint32_t)micros()) > 0))
+  {
+  }
+}
+
+/**
+  * @name   tasks
+  * @brief  A method that returns the number of running top-level tasks.
+  * @param  None.
+  * @retval size_t -> Spawned tasks that have not returned.
+  */
+size_t IQS9320Executor::tasks(void) const
+{
+  return _tasks.size();
+}
+
+/* Resume the coroutine once micros() has passed the deadline */
+void IQS9320Executor::addTimer(uint32_t deadline, std::coroutine_handle<> handle)
+{
+  Timer timer;
+
+  timer.deadline = deadline;
+  timer.handle = handle;
+  _timers.push_back(timer);
+}
+
+/* Wait for the earliest timer, in short steps while transfers are running */
+void IQS9320Executor::idle(void)
+{
+  uint32_t wait = 0;
+  bool busy = !_blocked.empty();
+  uint32_t now = (uint32_t)micros();
+
+  for(size_t i = 0; i < _queues.size(); i++)
+  {
+    busy |= !_queues[i]->idle();
+  }
+
+  for(size_t i = 0; i < _timers.size(); i++)
+  {
+    uint32_t left = _timers[i].deadline - now;
+    if((i == 0) || (left < wait))
+    {
+      wait = left;
+    }
+  }
+
+  if(busy && ((_timers.empty()) || (wait > IQS9320_EXECUTOR_POLL_US)))
+  {
+    wait = IQS9320_EXECUTOR_POLL_US;
+  }
+
+  if(wait > 0)
+  {
+    delayMicroseconds(wait);
+  }
+}
+
+/*****************************************************************************/
+/*                              DEVICE DRIVER                                */
+/*****************************************************************************/
+/* co_await results are stored before they are tested, GCC 12 builds a broken
+   coroutine frame for a co_await inside an if() condition */
+IQS9320Coro::IQS9320Coro(IQS9320Executor &executor, IQS9320 &device)
+  : _executor(executor), _device(device)
+{
+  _errors = 0;
+  _frames = 0;
+  _resets = 0;
+  _executor.addQueue(&_device._transfer);
+}
+
+/**
+  * @name   read
+  * @brief  A method that returns an awaitable register read.
+  * @param  memoryAddress ->  The register address to read from.
+  * @param  numBytes      ->  Number of bytes to read.
+  * @param  bytesArray    ->  Destination, must stay valid until resumed.
+  * @param  stopOrRestart ->  Use the STOP and RESTART definitions.
+  * @retval IQS9320TransferAwaiter -> co_await returns true on success.
+  */
+IQS9320TransferAwaiter IQS9320Coro::read(uint16_t memoryAddress, uint8_t numBytes, uint8_t bytesArray[], bool stopOrRestart)
+{
+  return IQS9320TransferAwaiter(&_executor, &_device._transfer, _device._deviceAddress, memoryAddress, bytesArray, numBytes, true, stopOrRestart, &_errors);
+}
+
+/**
+  * @name   write
+  * @brief  A method that returns an awaitable register write.
+  * @param  memoryAddress ->  The register address to write to.
+  * @param  numBytes      ->  Number of bytes to write.
+  * @param  bytesArray    ->  Source, must stay valid until resumed.
+  * @param  stopOrRestart ->  Use the STOP and RESTART definitions.
+  * @retval IQS9320TransferAwaiter -> co_await returns true on success.
+  */
+IQS9320TransferAwaiter IQS9320Coro::write(uint16_t memoryAddress, uint8_t numBytes, uint8_t bytesArray[], bool stopOrRestart)
+{
+  return IQS9320TransferAwaiter(&_executor, &_device._transfer, _device._deviceAddress, memoryAddress, bytesArray, numBytes, false, stopOrRestart, &_errors);
+}
+
+/**
+  * @name   sleep_for
+  * @brief  A method that returns an awaitable delay, the replacement of
+  *         delay() in the coroutines.
+  * @param  ms ->  Delay in milliseconds.
+  * @retval IQS9320Executor::Sleep -> co_await it.
+  */
+IQS9320Executor::Sleep IQS9320Coro::sleep_for(uint32_t ms)
+{
+  return _executor.sleep_for(ms);
+}
+
+/**
+  * @name   bringUp
+  * @brief  The start-up routine of init() as a coroutine: verify the
+  *         product, handle the reset, write and verify the settings, run ATI
+  *         and reseed.
+  * @param  None.
+  * @retval IQS9320Task -> co_return true once the device is running, false
+  *         if it is not an IQS9320, does not report a reset, keeps settings
+  *         that differ, does not finish ATI within
+  *         IQS9320_CORO_ATI_TIMEOUT_MS or a transfer failed.
+  * @note   The I2C clock is not trained: trainClock() blocks on its probe
+  *         reads, so the device keeps the clock of its transfer port.
+  */
+IQS9320Task IQS9320Coro::bringUp(void)
+{
+  uint8_t transferBytes[2];
+  iqs9320_settings_block_s block;
+  uint32_t errors = _errors;
+  uint32_t start_us;
+  uint8_t attempt;
+  bool ok;
+
+  _device.new_data_available = false;
+  _device.iqs9320_state.state = IQS9320_STATE_INIT;
+
+  /* Verify the product number */
+  _device.iqs9320_state.init_state = IQS9320_INIT_VERIFY_PRODUCT;
+  transferBytes[0] = 0;
+  transferBytes[1] = 0;
+  ok = co_await read(IQS9320_MM_PROD_NUM, 2, transferBytes);
+  if(!ok)
+  {
+    co_return false;
+  }
+  if((uint16_t)(transferBytes[0] | (transferBytes[1] << 8)) != IQS9320_PRODUCT_NUM)
+  {
+    _device.iqs9320_state.init_state = IQS9320_INIT_NONE;
+    co_return false;
+  }
+
+  /* Wait for the reset event, request a software reset if there is none */
+  for(attempt = 0; ; attempt++)
+  {
+    _device.iqs9320_state.init_state = IQS9320_INIT_READ_RESET;
+    co_await read(IQS9320_MM_SYSTEM_STATUS, 2, _device.IQSMemoryMap.SYSTEM_STATUS);
+    if(_device.checkReset())
+    {
+      break;
+    }
+    if(attempt >= IQS9320_CORO_RESET_ATTEMPTS)
+    {
+      co_return false;
+    }
+
+    _device.iqs9320_state.init_state = IQS9320_INIT_CHIP_RESET;
+    start_us = (uint32_t)micros();
+    co_await setControlBits(IQS9320_MM_SYSTEM_CONTROL, 0, 1 << IQS9320_SW_RESET_BIT);
+
+    /* Poll until the device shows the reset instead of waiting 100 ms, as
+    IQS9320::waitReady(). A starting device does not answer, those polls
+    are not counted as errors */
+    do
+    {
+      co_await _executor.sleep_until((uint32_t)micros() + IQS9320_RESET_POLL_US);
+      transferBytes[0] = 0;
+      ok = co_await IQS9320TransferAwaiter(&_executor, &_device._transfer, _device._deviceAddress, IQS9320_MM_SYSTEM_STATUS, transferBytes, 2, true, STOP, NULL);
+    } while(!(ok && _device.getBit(transferBytes[0], IQS9320_SHOW_RESET_BIT))
+            && ((uint32_t)micros() - start_us < (uint32_t)IQS9320_RESET_TIMEOUT_MS * 1000UL));
+  }
+
+  /* Acknowledge the reset */
+  _device.iqs9320_state.init_state = IQS9320_INIT_ACK_RESET;
+  co_await setControlBits(IQS9320_MM_SYSTEM_CONTROL, 0, 1 << IQS9320_ACK_RESET_BIT);
+  co_await sleep_for(10);
+
+  /* Write the settings of the init file */
+  _device.iqs9320_state.init_state = IQS9320_INIT_UPDATE_SETTINGS;
+  for(uint8_t step = 0; step < IQS9320_SETTINGS_BLOCKS; step++)
+  {
+    _device.getSettingsBlock(step, &block);
+    if(block.length > 0)
+    {
+      co_await write(block.address, block.length, block.data);
+    }
+  }
+
+  /* Read the settings back and rewrite the bytes that differ */
+  _device.iqs9320_state.init_state = IQS9320_INIT_VERIFY_SETTINGS;
+  ok = co_await verifySettings();
+  if(!ok)
+  {
+    co_return false;
+  }
+
+  /* Default read from the System Status */
+  _device.iqs9320_state.init_state = IQS9320_INIT_DEFAULT_READ_SYS_STATUS;
+  transferBytes[0] = (uint8_t)IQS9320_MM_SYSTEM_STATUS;
+  transferBytes[1] = (uint8_t)(IQS9320_MM_SYSTEM_STATUS >> 8);
+  co_await write(IQS9320_MM_DEFAULT_READ_LOCATION, 2, transferBytes);
+
+  _device.iqs9320_state.init_state = IQS9320_INIT_RECONFIG_DEV;
+  co_await setControlBits(IQS9320_MM_SYSTEM_CONTROL, 0, 1 << IQS9320_RECONFIG_DEV_BIT);
+  co_await sleep_for(10);
+
+  /* Enable ATI and ATI on configure, reconfigure and start ATI, as ReATI() */
+  _device.iqs9320_state.init_state = IQS9320_INIT_ATI;
+  co_await setControlBits(IQS9320_MM_SYSTEM_CONFIGURATION, 0, (1 << 3) | (1 << 5));
+  co_await setControlBits(IQS9320_MM_SYSTEM_CONTROL, 0, 1 << IQS9320_RECONFIG_DEV_BIT);
+  co_await setControlBits(IQS9320_MM_SYSTEM_CONTROL, 0, 1 << IQS9320_RE_ATI_BIT);
+
+  /* A failed read leaves the previous status, stop rather than wait on a
+  stale ATI active bit */
+  _device.iqs9320_state.init_state = IQS9320_INIT_WAIT_FOR_ATI;
+  start_us = (uint32_t)micros();
+  do
+  {
+    co_await sleep_for(10);
+    ok = co_await read(IQS9320_MM_SYSTEM_STATUS, 2, _device.IQSMemoryMap.SYSTEM_STATUS);
+    if(!ok || ((uint32_t)micros() - start_us >= (uint32_t)IQS9320_CORO_ATI_TIMEOUT_MS * 1000UL))
+    {
+      co_return false;
+    }
+  } while(_device.getBit(_device.IQSMemoryMap.SYSTEM_STATUS[0], IQS9320_ATI_ACTIVE_BIT));
+
+  _device.iqs9320_state.init_state = IQS9320_INIT_RESEED;
+  co_await setControlBits(IQS9320_MM_SYSTEM_CONTROL, 0, 1 << IQS9320_RESEED_BIT);
+
+  /* Read the first data */
+  _device.iqs9320_state.init_state = IQS9320_INIT_READ_DATA;
+  co_await readFrame();
+  co_await sleep_for(10);
+  co_await readFrame();
+  co_await sleep_for(10);
+
+  _device.iqs9320_state.init_state = IQS9320_INIT_DONE;
+  _device.iqs9320_state.state = IQS9320_STATE_IDLE;
+  _device.new_data_available = true;
+  _device._power_timing = false;
+  _device._power_applied = IQS9320_TIMEOUTS_INIT;
+  _device._activity_ms = millis();
+
+  co_return (_errors == errors);
+}
+
+/**
+  * @name   readFrame
+  * @brief  The reads of queueValueUpdates() as a coroutine, the jobs are the
+  *         same as those run() queues.
+  * @param  None.
+  * @retval IQS9320Task -> co_return true if all reads succeeded.
+  */
+IQS9320Task IQS9320Coro::readFrame(void)
+{
+  bool ok;
+
+  _device.startValueUpdates();
+  do
+  {
+    ok = co_await IQS9320TransferAwaiter(&_executor, &_device._frame_jobs[_device._frame_job_count - 1], &_errors);
+  }while(ok && _device.continueValueUpdates());
+  _device.finishValueUpdates();
+
+  co_return ok;
+}
+
+/**
+  * @name   acquire
+  * @brief  The main loop of run() as a coroutine, reads a frame every
+  *         interval and checks for a reset.
+  * @param  interval_ms ->  Frame period in milliseconds.
+  * @param  frames      ->  Number of frames to read, 0 to run until a reset.
+  * @param  callback    ->  Called after every valid frame, or NULL.
+  * @param  context     ->  Passed to the callback.
+  * @retval IQS9320Task -> co_return true after the frames were read, false
+  *         when the device reset and needs bringUp() again.
+  */
+IQS9320Task IQS9320Coro::acquire(uint32_t interval_ms, uint32_t frames, iqs9320_coro_frame_cb callback, void *context)
+{
+  uint32_t deadline = (uint32_t)micros();
+  bool recovered;
+
+  for(uint32_t frame = 0; (frames == 0) || (frame < frames); frame++)
+  {
+    _device.iqs9320_state.state = IQS9320_STATE_WAIT_FOR_DATA;
+    _device.new_data_available = false;
+    co_await readFrame();
+
+    /* A hung bus is recovered and the frame is skipped, the next frame
+    reads the status again. A device that stopped answering is reset through
+    MCLR */
+    _device.iqs9320_state.state = IQS9320_STATE_CHECK_RESET;
+    recovered = _device.checkBus();
+    if((_device.iqs9320_state.state == IQS9320_STATE_START) || (!recovered && _device.checkReset()))
+    {
+      _resets++;
+      _device.iqs9320_state.state = IQS9320_STATE_START;
+      _device.iqs9320_state.init_state = IQS9320_INIT_VERIFY_PRODUCT;
+      co_return false;
+    }
+
+    _device.iqs9320_state.state = IQS9320_STATE_IDLE;
+    if(!recovered && !_device._frame_failed)
+    {
+      _device.new_data_available = true;
+      _device.countPowerMode();
+      _frames++;
+      if(callback)
+      {
+        callback(&_device, context);
+      }
+    }
+
+    /* Keep the frame rate independent of the transfer time */
+    deadline += interval_ms * 1000UL;
+    co_await _executor.sleep_until(deadline);
+  }
+
+  co_return true;
+}
+
+/**
+  * @name   run
+  * @brief  Bring the device up and acquire frames, bring it up again after a
+  *         reset. Spawn one per device on the executor.
+  * @param  interval_ms ->  Frame period in milliseconds.
+  * @param  frames      ->  Number of frames to read, 0 to run forever.
+  * @param  callback    ->  Called after every valid frame, or NULL.
+  * @param  context     ->  Passed to the callback.
+  * @retval IQS9320Task -> co_return true once the frames were read.
+  * @note   A failed bring-up is retried after one second.
+  */
+IQS9320Task IQS9320Coro::run(uint32_t interval_ms, uint32_t frames, iqs9320_coro_frame_cb callback, void *context)
+{
+  bool ok;
+
+  while((frames == 0) || (_frames < frames))
+  {
+    ok = co_await bringUp();
+    if(ok)
+    {
+      co_await acquire(interval_ms, (frames == 0) ? 0 : frames - _frames, callback, context);
+    }
+    else
+    {
+      co_await sleep_for(1000);
+    }
+  }
+
+  co_return true;
+}
+
+/**
+  * @name   device
+  * @brief  A method that returns the driven device.
+  * @retval IQS9320* -> The device passed to the constructor.
+  */
+IQS9320 *IQS9320Coro::device(void)
+{
+  return &_device;
+}
+
+/**
+  * @name   errors
+  * @brief  A method that returns the number of failed transfers.
+  * @retval uint32_t -> Transfers that completed with a bus error.
+  */
+uint32_t IQS9320Coro::errors(void) const
+{
+  return _errors;
+}
+
+/**
+  * @name   frames
+  * @brief  A method that returns the number of frames read by acquire().
+  * @retval uint32_t -> Valid frames.
+  */
+uint32_t IQS9320Coro::frames(void) const
+{
+  return _frames;
+}
+
+/**
+  * @name   resets
+  * @brief  A method that returns the number of resets seen by acquire().
+  * @retval uint32_t -> Unexpected device resets.
+  */
+uint32_t IQS9320Coro::resets(void) const
+{
+  return _resets;
+}
+
+/* Read-modify-write of one byte of a 2 byte register, as the control
+   methods of IQS9320 do */
+IQS9320Task IQS9320Coro::setControlBits(uint16_t memoryAddress, uint8_t byte, uint8_t mask)
+{
+  uint8_t transferBytes[2];
+  bool ok;
+
+  ok = co_await read(memoryAddress, 2, transferBytes);
+  if(!ok)
+  {
+    co_return false;
+  }
+  transferBytes[byte] |= mask;
+  ok = co_await write(memoryAddress, 2, transferBytes);
+
+  co_return ok;
+}
+
+/**
+  * @name   verifySettings
+  * @brief  IQS9320::verifySettings() with repair as a coroutine: every
+  *         block of the init file is read back, and the bytes that differ
+  *         are rewritten and read once more.
+  * @param  None.
+  * @retval IQS9320Task -> co_return true if the device holds the settings,
+  *         false if they still differ or a transfer failed.
+  * @note   One read per block, the blocks are not joined into bursts.
+  *         SYSTEM_CONTROL is not compared, its command bits clear themselves.
+  */
+IQS9320Task IQS9320Coro::verifySettings(void)
+{
+  iqs9320_settings_block_s block;
+  uint8_t readback[sizeof(block.data)];
+  bool verified = true;
+  bool ok;
+
+  for(uint8_t step = 0; step < IQS9320_SETTINGS_BLOCKS; step++)
+  {
+    int16_t lo = -1;
+    int16_t hi = -1;
+
+    _device.getSettingsBlock(step, &block);
+    if(block.length == 0)
+    {
+      continue;
+    }
+    ok = co_await read(block.address, block.length, readback);
+    if(!ok)
+    {
+      co_return false;
+    }
+
+    for(uint8_t i = 0; i < block.length; i++)
+    {
+      if((uint16_t)(block.address + i - IQS9320_MM_SYSTEM_CONTROL) < 2)
+      {
+        continue; // Command bits
+      }
+      if(readback[i] != block.data[i])
+      {
+        lo = (lo < 0) ? i : lo;
+        hi = i;
+      }
+    }
+    if(lo < 0)
+    {
+      continue;
+    }
+
+    ok = co_await write(block.address + lo, hi - lo + 1, &block.data[lo]);
+    if(ok)
+    {
+      ok = co_await read(block.address + lo, hi - lo + 1, &readback[lo]);
+    }
+    if(!ok)
+    {
+      co_return false;
+    }
+    if(memcmp(&readback[lo], &block.data[lo], hi - lo + 1) != 0)
+    {
+      verified = false;
+    }
+  }
+
+  co_return verified;
+}
+
+#endif // IQS9320_CORO_AVAILABLE
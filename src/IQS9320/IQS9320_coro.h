@@ -0,0 +1,250 @@
+/******************************************************************************
+ *                                                                            *
+ *                                Copyright by                                *
+ *                                                                            *
+ *                              Azoteq (Pty) Ltd                              *
+ *                          Republic of South Africa                          *
+ *                                                                            *
+ *                           Tel: +27(0)21 863 0033                           *
+ *                           E-mail: info@azoteq.com                          *
+ *                                                                            *
+ * ========================================================================== *
+ * @file        IQS9320_coro.h                                                *
+ * @brief       C++20 coroutine front-end for the IQS9320. Bring-up and the   *
+ *              acquisition loop are written as co_await read(...) and        *
+ *              co_await sleep_for(...) and run on a single-threaded          *
+ *              executor that serves many devices without threads or         *
+ *              blocking waits.                                               *
+ * @author      Azoteq PTY Ltd                                                *
+ * @version     v1.5.3                                                        *
+ * @date        2024                                                          *
+ * ========================================================================== *
+ * @attention  Only compiled with C++20 and <coroutine>, e.g. Linux gateway   *
+ *             builds. Arduino builds skip this module and keep using init()  *
+ *             and run(). Every device has its own transfer queue and port,   *
+ *             see IQS9320::setTransferPort().                                *
+ ******************************************************************************/
+
+#ifndef IQS9320_CORO_H
+#define IQS9320_CORO_H
+
+#if defined(__has_include)
+#if (__cplusplus >= 202002L) && __has_include(<coroutine>)
+#define IQS9320_CORO_AVAILABLE
+#endif
+#endif
+
+#ifdef IQS9320_CORO_AVAILABLE
+
+#include <coroutine>
+#include <exception>
+#include <vector>
+#include "IQS9320.h"
+
+/* Longest idle wait of the executor while transfers are on the bus */
+#ifndef IQS9320_EXECUTOR_POLL_US
+#define IQS9320_EXECUTOR_POLL_US        50
+#endif
+
+/* Software resets requested by bringUp() before it gives up */
+#ifndef IQS9320_CORO_RESET_ATTEMPTS
+#define IQS9320_CORO_RESET_ATTEMPTS     3
+#endif
+
+/* Longest ATI routine bringUp() waits for */
+#ifndef IQS9320_CORO_ATI_TIMEOUT_MS
+#define IQS9320_CORO_ATI_TIMEOUT_MS     2000
+#endif
+
+class IQS9320Executor;
+class IQS9320Coro;
+
+/* Called by acquire() after every frame */
+typedef void (*iqs9320_coro_frame_cb)(IQS9320 *device, void *context);
+
+/**
+* @brief  Coroutine that returns a bool. Awaiting a task runs it and resumes
+*         the caller once it returns, IQS9320Executor::spawn() runs it at the
+*         top level.
+*/
+class IQS9320Task
+{
+public:
+        struct promise_type
+        {
+                std::coroutine_handle<> continuation;
+                bool value = false;
+
+                /* Resume the awaiting coroutine, if any, once the task returns */
+                struct FinalAwaiter
+                {
+                        bool await_ready() noexcept { return false; }
+                        std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept
+                        {
+                                std::coroutine_handle<> next = handle.promise().continuation;
+                                return next ? next : std::noop_coroutine();
+                        }
+                        void await_resume() noexcept {}
+                };
+
+                IQS9320Task get_return_object() { return IQS9320Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+                std::suspend_always initial_suspend() noexcept { return {}; }
+                FinalAwaiter final_suspend() noexcept { return {}; }
+                void return_value(bool result) { value = result; }
+                void unhandled_exception() { std::terminate(); }
+        };
+
+        IQS9320Task(IQS9320Task &&other) noexcept;
+        IQS9320Task &operator=(IQS9320Task &&other) noexcept;
+        IQS9320Task(const IQS9320Task &) = delete;
+        IQS9320Task &operator=(const IQS9320Task &) = delete;
+        ~IQS9320Task();
+
+        bool done(void) const;
+        bool result(void) const;
+
+        // Awaitable
+        bool await_ready(void) const noexcept { return !_handle || _handle.done(); }
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept
+        {
+                _handle.promise().continuation = caller;
+                return _handle;
+        }
+        bool await_resume(void) const noexcept { return _handle.promise().value; }
+
+private:
+        friend class IQS9320Executor;
+        explicit IQS9320Task(std::coroutine_handle<promise_type> handle) : _handle(handle) {}
+
+        std::coroutine_handle<promise_type> _handle;
+};
+
+/**
+* @brief  Awaitable transfer job. Either submits its own job to a queue or
+*         waits for a job that was submitted already. co_await returns true
+*         when the job completed without a bus error.
+*/
+class IQS9320TransferAwaiter
+{
+public:
+        IQS9320TransferAwaiter(IQS9320Executor *executor, IQS9320Transfer *queue, uint8_t device, uint16_t reg, uint8_t data[], uint8_t length, bool read, bool stop, uint32_t *errors);
+        IQS9320TransferAwaiter(IQS9320Executor *executor, iqs9320_transfer_s *submitted, uint32_t *errors);
+        IQS9320TransferAwaiter(const IQS9320TransferAwaiter &) = delete;
+        IQS9320TransferAwaiter &operator=(const IQS9320TransferAwaiter &) = delete;
+
+        bool await_ready(void);
+        void await_suspend(std::coroutine_handle<> handle);
+        bool await_resume(void);
+
+        bool submit(void);
+
+private:
+        IQS9320Executor *_executor;
+        IQS9320Transfer *_queue;        // NULL when waiting for a submitted job
+        iqs9320_transfer_s _job;
+        iqs9320_transfer_s *_submitted;
+        std::coroutine_handle<> _handle;
+        uint32_t *_errors;
+
+        iqs9320_transfer_s *job(void) { return _queue ? &_job : _submitted; }
+        static void done(iqs9320_transfer_s *transfer);
+};
+
+/**
+* @brief  Single-threaded executor. Services the transfer queue of every
+*         device, resumes coroutines whose transfer or timer completed and
+*         waits with delayMicroseconds() when there is nothing to do.
+*/
+class IQS9320Executor
+{
+public:
+        /* co_await sleep_until(), resumes once micros() passed the deadline */
+        struct Sleep
+        {
+                IQS9320Executor *executor;
+                uint32_t deadline;
+
+                bool await_ready(void) const noexcept { return (int32_t)(deadline - (uint32_t)micros()) <= 0; }
+                void await_suspend(std::coroutine_handle<> handle) { executor->addTimer(deadline, handle); }
+                void await_resume(void) const noexcept {}
+        };
+
+        // Public Constructors
+        IQS9320Executor();
+        ~IQS9320Executor();
+
+        // Public Methods
+        void addQueue(IQS9320Transfer *queue);
+        void spawn(IQS9320Task &&task);
+        void schedule(std::coroutine_handle<> handle);
+        void retry(IQS9320TransferAwaiter *awaiter);
+
+        Sleep sleep_for(uint32_t ms);
+        Sleep sleep_until(uint32_t deadline_us);
+
+        bool runOnce(void);
+        void run(void);
+        void runFor(uint32_t ms);
+        size_t tasks(void) const;
+
+private:
+        struct Timer
+        {
+                uint32_t deadline;
+                std::coroutine_handle<> handle;
+        };
+
+        // Private Variables
+        std::vector<IQS9320Transfer *> _queues;
+        std::vector<std::coroutine_handle<>> _ready;
+        std::vector<std::coroutine_handle<>> _running;
+        std::vector<Timer> _timers;
+        std::vector<IQS9320TransferAwaiter *> _blocked;
+        std::vector<IQS9320Task> _tasks;
+
+        // Private Methods
+        void addTimer(uint32_t deadline, std::coroutine_handle<> handle);
+        void idle(void);
+};
+
+/**
+* @brief  Coroutine driver of one IQS9320. The device is set up with begin()
+*         and, for concurrent transfers, its own port with setTransferPort().
+*/
+class IQS9320Coro
+{
+public:
+        // Public Constructors
+        IQS9320Coro(IQS9320Executor &executor, IQS9320 &device);
+
+        // Public Methods
+        IQS9320TransferAwaiter read(uint16_t memoryAddress, uint8_t numBytes, uint8_t bytesArray[], bool stopOrRestart = STOP);
+        IQS9320TransferAwaiter write(uint16_t memoryAddress, uint8_t numBytes, uint8_t bytesArray[], bool stopOrRestart = STOP);
+        IQS9320Executor::Sleep sleep_for(uint32_t ms);
+
+        IQS9320Task bringUp(void);
+        IQS9320Task readFrame(void);
+        IQS9320Task acquire(uint32_t interval_ms, uint32_t frames, iqs9320_coro_frame_cb callback, void *context);
+        IQS9320Task run(uint32_t interval_ms, uint32_t frames, iqs9320_coro_frame_cb callback, void *context);
+
+        IQS9320 *device(void);
+        uint32_t errors(void) const;
+        uint32_t frames(void) const;
+        uint32_t resets(void) const;
+
+private:
+        // Private Variables
+        IQS9320Executor &_executor;
+        IQS9320 &_device;
+        uint32_t _errors;
+        uint32_t _frames;
+        uint32_t _resets;
+
+        // Private Methods
+        IQS9320Task setControlBits(uint16_t memoryAddress, uint8_t byte, uint8_t mask);
+        IQS9320Task verifySettings(void);
+};
+
+#endif // IQS9320_CORO_AVAILABLE
+
+#endif // IQS9320_CORO_H
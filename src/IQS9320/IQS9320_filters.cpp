@@ -0,0 +1,429 @@
+/******************************************************************************
+ *                                                                            *
+ *                                Copyright by                                *
+ *                                                                            *
+ *                              Azoteq (Pty) Ltd                              *
+ *                          Republic of South Africa                          *
+ *                                                                            *
+ *                           Tel: +27(0)21 863 0033                           *
+ *                           E-mail: info@azoteq.com                          *
+ *                                                                            *
+ * ========================================================================== *
+ * @file        IQS9320_filters.cpp                                           *
+ * @brief       This file contains the delta processing pipeline. Each call   *
+ *              to process() runs one frame of channel deltas through the     *
+ *              enabled stages in the order:                                  *
+ *              median -> moving average -> IIR -> baseline -> threshold.     *
+ * @author      Azoteq PTY Ltd                                                *
+ * @version     v1.5.3                                                        *
+ * @date        2024                                                          *
+ *****************************************************************************/
+
+/* Include Files */
+#include "IQS9320_filters.h"
+#include <string.h>
+
+/* Select the SIMD implementation available on the target */
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define IQS9320_FILTER_SSE2
+#elif defined(__ARM_FEATURE_SIMD32) && defined(__ARM_FEATURE_DSP)
+#include <arm_acle.h>
+#define IQS9320_FILTER_ARM_DSP
+#endif
+
+/* Private Functions */
+
+/* Saturate a 32-bit intermediate to the Q15 range */
+static inline q15_t sat_q15(int32_t x)
+{
+  if(x > IQS9320_Q15_MAX)
+  {
+    return IQS9320_Q15_MAX;
+  }
+  if(x < IQS9320_Q15_MIN)
+  {
+    return IQS9320_Q15_MIN;
+  }
+  return (q15_t)x;
+}
+
+/* One first-order IIR step, state + alpha*(input - state). The difference is
+   saturated before the multiply so that all SIMD paths give the same result. */
+static inline q15_t iir_step(q15_t state, q15_t input, q15_t alpha)
+{
+  int32_t diff = sat_q15((int32_t)input - state);
+  int32_t step = (diff * alpha) >> 15;
+  return sat_q15((int32_t)state + step);
+}
+
+/* Median of three values */
+static inline q15_t median3(q15_t a, q15_t b, q15_t c)
+{
+  q15_t lo = (a < b) ? a : b;
+  q15_t hi = (a < b) ? b : a;
+  q15_t mid = (hi < c) ? hi : c;
+  return (lo > mid) ? lo : mid;
+}
+
+/*****************************************************************************/
+/*                             CONSTRUCTORS                                  */
+/*****************************************************************************/
+IQS9320Filter::IQS9320Filter(){
+}
+
+/*****************************************************************************/
+/*                            PUBLIC METHODS                                 */
+/*****************************************************************************/
+
+/**
+  * @name   begin
+  * @brief  A method to set up the filter pipeline for a number of channels.
+  * @param  nChannels ->  Number of channels in every frame passed to process().
+  *                       Limited to IQS9320_FILTER_MAX_CHANNELS.
+  * @param  config    ->  Stage enables, filter factors and thresholds.
+  * @retval None.
+  */
+void IQS9320Filter::begin(uint8_t nChannels, const iqs9320_filter_config_s *config)
+{
+  if(nChannels > IQS9320_FILTER_MAX_CHANNELS)
+  {
+    nChannels = IQS9320_FILTER_MAX_CHANNELS;
+  }
+
+  _config = *config;
+  _nChannels = nChannels;
+  _nLanes = (nChannels + 7) & ~7;
+
+  reset();
+}
+
+/**
+  * @name   reset
+  * @brief  A method that clears all filter history. The next frame passed to
+  *         process() is used to seed the filters.
+  * @param  None.
+  * @retval None.
+  */
+void IQS9320Filter::reset(void)
+{
+  memset(_median, 0, sizeof(_median));
+  memset(_ma, 0, sizeof(_ma));
+  memset(_ma_sum, 0, sizeof(_ma_sum));
+  memset(_iir, 0, sizeof(_iir));
+  memset(_baseline, 0, sizeof(_baseline));
+  memset(_output, 0, sizeof(_output));
+
+  _median_idx = 0;
+  _ma_idx = 0;
+  _active_mask = 0;
+  _primed = false;
+}
+
+/**
+  * @name   process
+  * @brief  A method that runs one frame of channel deltas through the pipeline.
+  * @param  delta ->  Array of _nChannels delta values, e.g. from
+  *                   IQS9320::getChannelDelta().
+  * @retval None.
+  * @note   Results are available through getOutput() and getActiveMask().
+  */
+void IQS9320Filter::process(const int16_t delta[])
+{
+  load(delta);
+
+  if(!_primed)
+  {
+    prime();
+  }
+
+  if(_config.stages & IQS9320_FILTER_MEDIAN_EN)
+  {
+    stageMedian();
+  }
+
+  if(_config.stages & IQS9320_FILTER_MA_EN)
+  {
+    stageMovingAverage();
+  }
+
+  if(_config.stages & IQS9320_FILTER_IIR_EN)
+  {
+    stageIIR(_iir, _output, _config.iir_alpha);
+    memcpy(_output, _iir, _nLanes * sizeof(q15_t));
+  }
+
+  if(_config.stages & IQS9320_FILTER_BASELINE_EN)
+  {
+    stageBaseline();
+  }
+
+  stageThreshold();
+}
+
+/**
+  * @name   processBlock
+  * @brief  A method that runs a block of recorded frames through the pipeline.
+  * @param  frames  ->  Delta values, frame after frame.
+  * @param  nFrames ->  Number of frames in the block.
+  * @param  stride  ->  Distance between consecutive frames in the frames array.
+  * @param  outputs ->  Optional array receiving nFrames * _nChannels filtered
+  *                     values. Pass NULL if only the final state is needed.
+  * @retval None.
+  */
+void IQS9320Filter::processBlock(const int16_t frames[], uint32_t nFrames, uint8_t stride, int16_t outputs[])
+{
+  for(uint32_t f = 0; f < nFrames; f++)
+  {
+    process(&frames[f * stride]);
+
+    if(outputs)
+    {
+      memcpy(&outputs[f * _nChannels], _output, _nChannels * sizeof(q15_t));
+    }
+  }
+}
+
+/**
+  * @name   getOutput
+  * @brief  A method that returns the filtered value of a channel.
+  * @param  ch ->  The channel for which the value is returned.
+  * @retval q15_t -> Filtered, baseline corrected delta.
+  */
+q15_t IQS9320Filter::getOutput(uint8_t ch)
+{
+  return _output[ch];
+}
+
+/**
+  * @name   getBaseline
+  * @brief  A method that returns the tracked baseline of a channel.
+  * @param  ch ->  The channel for which the baseline is returned.
+  * @retval q15_t -> Baseline value.
+  */
+q15_t IQS9320Filter::getBaseline(uint8_t ch)
+{
+  return _baseline[ch];
+}
+
+/**
+  * @name   getActive
+  * @brief  A method that returns the hysteretic threshold state of a channel.
+  * @param  ch ->  The channel for which the state is returned.
+  * @retval bool -> true while the channel is active.
+  */
+bool IQS9320Filter::getActive(uint8_t ch)
+{
+  return (_active_mask >> ch) & 0x01;
+}
+
+/**
+  * @name   getActiveMask
+  * @brief  A method that returns the threshold state of all channels.
+  * @param  None.
+  * @retval uint32_t -> Bit n is set while channel n is active.
+  */
+uint32_t IQS9320Filter::getActiveMask(void)
+{
+  return _active_mask;
+}
+
+/**
+  * @name   getOutputs
+  * @brief  A method that returns the filtered values of all channels.
+  * @param  None.
+  * @retval const q15_t* -> Array of _nChannels filtered values.
+  */
+const q15_t *IQS9320Filter::getOutputs(void)
+{
+  return _output;
+}
+
+/*****************************************************************************/
+/*                            PRIVATE METHODS                                */
+/*****************************************************************************/
+
+/**
+  * @name   load
+  * @brief  Copy a frame into the working buffer and clear the padding lanes.
+  */
+void IQS9320Filter::load(const int16_t delta[])
+{
+  memcpy(_output, delta, _nChannels * sizeof(q15_t));
+  for(uint8_t i = _nChannels; i < _nLanes; i++)
+  {
+    _output[i] = 0;
+  }
+}
+
+/**
+  * @name   prime
+  * @brief  Seed the filter history with the first frame to avoid a start-up
+  *         transient. The baseline starts at zero since deltas are already
+  *         referenced to the LTA of the IQS9320.
+  */
+void IQS9320Filter::prime(void)
+{
+  for(uint8_t t = 0; t < IQS9320_FILTER_MEDIAN_LENGTH; t++)
+  {
+    memcpy(_median[t], _output, _nLanes * sizeof(q15_t));
+  }
+
+  for(uint8_t t = 0; t < IQS9320_FILTER_MA_LENGTH; t++)
+  {
+    memcpy(_ma[t], _output, _nLanes * sizeof(q15_t));
+  }
+
+  for(uint8_t i = 0; i < _nLanes; i++)
+  {
+    _ma_sum[i] = (int32_t)_output[i] << IQS9320_FILTER_MA_SHIFT;
+  }
+
+  memcpy(_iir, _output, _nLanes * sizeof(q15_t));
+  _primed = true;
+}
+
+/**
+  * @name   stageMedian
+  * @brief  3-tap median filter to remove single sample spikes.
+  */
+void IQS9320Filter::stageMedian(void)
+{
+  memcpy(_median[_median_idx], _output, _nLanes * sizeof(q15_t));
+  if(++_median_idx >= IQS9320_FILTER_MEDIAN_LENGTH)
+  {
+    _median_idx = 0;
+  }
+
+  const q15_t *a = _median[0];
+  const q15_t *b = _median[1];
+  const q15_t *c = _median[2];
+
+#ifdef IQS9320_FILTER_SSE2
+  for(uint8_t i = 0; i < _nLanes; i += 8)
+  {
+    __m128i va = _mm_loadu_si128((const __m128i *)&a[i]);
+    __m128i vb = _mm_loadu_si128((const __m128i *)&b[i]);
+    __m128i vc = _mm_loadu_si128((const __m128i *)&c[i]);
+    __m128i lo = _mm_min_epi16(va, vb);
+    __m128i hi = _mm_max_epi16(va, vb);
+    __m128i mid = _mm_max_epi16(lo, _mm_min_epi16(hi, vc));
+    _mm_storeu_si128((__m128i *)&_output[i], mid);
+  }
+#else
+  for(uint8_t i = 0; i < _nLanes; i++)
+  {
+    _output[i] = median3(a[i], b[i], c[i]);
+  }
+#endif
+}
+
+/**
+  * @name   stageMovingAverage
+  * @brief  Boxcar average over the last IQS9320_FILTER_MA_LENGTH samples using
+  *         a running sum per channel.
+  */
+void IQS9320Filter::stageMovingAverage(void)
+{
+  q15_t *oldest = _ma[_ma_idx];
+
+  for(uint8_t i = 0; i < _nLanes; i++)
+  {
+    _ma_sum[i] += (int32_t)_output[i] - oldest[i];
+    oldest[i] = _output[i];
+    _output[i] = (q15_t)(_ma_sum[i] >> IQS9320_FILTER_MA_SHIFT);
+  }
+
+  if(++_ma_idx >= IQS9320_FILTER_MA_LENGTH)
+  {
+    _ma_idx = 0;
+  }
+}
+
+/**
+  * @name   stageIIR
+  * @brief  First-order IIR low-pass, state += alpha * (input - state).
+  * @param  state ->  Filter state, updated in place.
+  * @param  input ->  New samples.
+  * @param  alpha ->  Q15 smoothing factor.
+  */
+void IQS9320Filter::stageIIR(q15_t state[], const q15_t input[], q15_t alpha)
+{
+#if defined(IQS9320_FILTER_SSE2)
+  const __m128i va = _mm_set1_epi16(alpha);
+  for(uint8_t i = 0; i < _nLanes; i += 8)
+  {
+    __m128i s = _mm_loadu_si128((const __m128i *)&state[i]);
+    __m128i x = _mm_loadu_si128((const __m128i *)&input[i]);
+    __m128i d = _mm_subs_epi16(x, s);
+    /* (d * alpha) >> 15 rebuilt from the high and low product halves */
+    __m128i hi = _mm_mulhi_epi16(d, va);
+    __m128i lo = _mm_mullo_epi16(d, va);
+    __m128i step = _mm_or_si128(_mm_slli_epi16(hi, 1), _mm_srli_epi16(lo, 15));
+    _mm_storeu_si128((__m128i *)&state[i], _mm_adds_epi16(s, step));
+  }
+#elif defined(IQS9320_FILTER_ARM_DSP)
+  for(uint8_t i = 0; i < _nLanes; i += 2)
+  {
+    int16x2_t s, x;
+    memcpy(&s, &state[i], sizeof(s));
+    memcpy(&x, &input[i], sizeof(x));
+    int16x2_t d = __qsub16(x, s);
+    int32_t step_lo = __smulbb(d, alpha) >> 15;
+    int32_t step_hi = __smultb(d, alpha) >> 15;
+    int16x2_t step = (int16x2_t)(((uint32_t)(uint16_t)step_lo) | ((uint32_t)step_hi << 16));
+    s = __qadd16(s, step);
+    memcpy(&state[i], &s, sizeof(s));
+  }
+#else
+  for(uint8_t i = 0; i < _nLanes; i++)
+  {
+    state[i] = iir_step(state[i], input[i], alpha);
+  }
+#endif
+}
+
+/**
+  * @name   stageBaseline
+  * @brief  Track the slow drift of each channel and subtract it. Tracking is
+  *         halted while a channel is active so that a long press is not
+  *         absorbed into the baseline.
+  */
+void IQS9320Filter::stageBaseline(void)
+{
+  for(uint8_t i = 0; i < _nLanes; i++)
+  {
+    if(!((_active_mask >> i) & 0x01))
+    {
+      _baseline[i] = iir_step(_baseline[i], _output[i], _config.baseline_alpha);
+    }
+    _output[i] = sat_q15((int32_t)_output[i] - _baseline[i]);
+  }
+}
+
+/**
+  * @name   stageThreshold
+  * @brief  Hysteretic threshold of the filtered values into _active_mask.
+  */
+void IQS9320Filter::stageThreshold(void)
+{
+  uint32_t mask = 0;
+
+  for(uint8_t i = 0; i < _nChannels; i++)
+  {
+    bool active = (_active_mask >> i) & 0x01;
+
+    if(active)
+    {
+      active = (_output[i] >= _config.off_threshold);
+    }
+    else
+    {
+      active = (_output[i] >= _config.on_threshold);
+    }
+
+    mask |= (uint32_t)active << i;
+  }
+
+  _active_mask = mask;
+}
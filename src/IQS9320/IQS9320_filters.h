@@ -0,0 +1,129 @@
+/******************************************************************************
+ *                                                                            *
+ *                                Copyright by                                *
+ *                                                                            *
+ *                              Azoteq (Pty) Ltd                              *
+ *                          Republic of South Africa                          *
+ *                                                                            *
+ *                           Tel: +27(0)21 863 0033                           *
+ *                           E-mail: info@azoteq.com                          *
+ *                                                                            *
+ * ========================================================================== *
+ * @file        IQS9320_filters.h                                             *
+ * @brief       Host-side delta processing pipeline for the IQS9320. The      *
+ *              channel deltas streamed with DebugOn() are passed through a   *
+ *              median, moving average and IIR filter, a baseline tracker and *
+ *              a hysteretic threshold. All arithmetic is Q15 fixed point and *
+ *              the channel state is kept as a structure of arrays.           *
+ * @author      Azoteq PTY Ltd                                                *
+ * @version     v1.5.3                                                        *
+ * @date        2024                                                          *
+ * ========================================================================== *
+ * @attention  Only depends on <stdint.h>, so the same code runs on the       *
+ *             Arduino target and on a PC for offline processing.             *
+ *             - ARM cores with the DSP extension (Cortex-M4/M7/M33) use the  *
+ *               dual 16-bit saturating instructions.                         *
+ *             - x86 hosts with SSE2 process 8 channels per instruction.      *
+ *             - All other targets (e.g. Cortex-M0, AVR) use the scalar path. *
+ *             All three paths produce bit-identical results.                 *
+ ******************************************************************************/
+
+#ifndef IQS9320_FILTERS_H
+#define IQS9320_FILTERS_H
+
+#include <stdint.h>
+
+/* Maximum number of channels processed by one filter instance */
+#ifndef IQS9320_FILTER_MAX_CHANNELS
+#define IQS9320_FILTER_MAX_CHANNELS     20
+#endif
+
+/* Moving average length, must be a power of 2 */
+#define IQS9320_FILTER_MA_SHIFT         2
+#define IQS9320_FILTER_MA_LENGTH        (1 << IQS9320_FILTER_MA_SHIFT)
+
+/* Median filter length, fixed to a 3-tap median */
+#define IQS9320_FILTER_MEDIAN_LENGTH    3
+
+/* Channel storage is rounded up to a multiple of 8 for the SIMD paths */
+#define IQS9320_FILTER_STORAGE          ((IQS9320_FILTER_MAX_CHANNELS + 7) & ~7)
+
+/* Pipeline stage enable bits for iqs9320_filter_config_s.stages */
+#define IQS9320_FILTER_MEDIAN_EN        0x01
+#define IQS9320_FILTER_MA_EN            0x02
+#define IQS9320_FILTER_IIR_EN           0x04
+#define IQS9320_FILTER_BASELINE_EN      0x08
+
+/* Q15 helpers */
+#define IQS9320_Q15_MAX                 32767
+#define IQS9320_Q15_MIN                 (-32768)
+#define IQS9320_Q15(x)                  ((q15_t)((x) >= 1.0 ? IQS9320_Q15_MAX : (x) * 32768.0))
+
+typedef int16_t q15_t;
+
+/**
+* @brief  iqs9320 Filter Configuration.
+* @note   iir_alpha and baseline_alpha are Q15 smoothing factors. Q15 stops
+*         at IQS9320_Q15_MAX (1 - 2^-15), so IQS9320_Q15(1.0) still leaves the
+*         output up to one LSB behind the input per step; clear the stage bit
+*         for an unfiltered output.
+*         A channel becomes active when its output reaches on_threshold and is
+*         released once the output falls below off_threshold.
+*/
+typedef struct
+{
+        uint8_t stages;                 // IQS9320_FILTER_*_EN bits
+        q15_t   iir_alpha;              // IIR smoothing factor (Q15)
+        q15_t   baseline_alpha;         // Baseline tracking factor (Q15)
+        q15_t   on_threshold;           // Activation threshold
+        q15_t   off_threshold;          // Release threshold
+} iqs9320_filter_config_s;
+
+// Class Prototype
+class IQS9320Filter
+{
+public:
+        // Public Constructors
+        IQS9320Filter();
+
+        // Public Methods
+        void begin(uint8_t nChannels, const iqs9320_filter_config_s *config);
+        void reset(void);
+        void process(const int16_t delta[]);
+        void processBlock(const int16_t frames[], uint32_t nFrames, uint8_t stride, int16_t outputs[]);
+
+        q15_t getOutput(uint8_t ch);
+        q15_t getBaseline(uint8_t ch);
+        bool getActive(uint8_t ch);
+        uint32_t getActiveMask(void);
+        const q15_t *getOutputs(void);
+
+private:
+        // Private Variables
+        iqs9320_filter_config_s _config;
+        uint8_t _nChannels;
+        uint8_t _nLanes;                // _nChannels rounded up to 8
+        uint8_t _median_idx;
+        uint8_t _ma_idx;
+        bool _primed;
+        uint32_t _active_mask;
+
+        /* Per channel state, one array per quantity */
+        q15_t _median[IQS9320_FILTER_MEDIAN_LENGTH][IQS9320_FILTER_STORAGE];
+        q15_t _ma[IQS9320_FILTER_MA_LENGTH][IQS9320_FILTER_STORAGE];
+        int32_t _ma_sum[IQS9320_FILTER_STORAGE];
+        q15_t _iir[IQS9320_FILTER_STORAGE];
+        q15_t _baseline[IQS9320_FILTER_STORAGE];
+        q15_t _output[IQS9320_FILTER_STORAGE];
+
+        // Private Methods
+        void prime(void);
+        void load(const int16_t delta[]);
+        void stageMedian(void);
+        void stageMovingAverage(void);
+        void stageIIR(q15_t state[], const q15_t input[], q15_t alpha);
+        void stageBaseline(void);
+        void stageThreshold(void);
+};
+
+#endif // IQS9320_FILTERS_H
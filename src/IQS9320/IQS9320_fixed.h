@@ -0,0 +1,389 @@
+/******************************************************************************
+ *                                                                            *
+ *                                Copyright by                                *
+ *                                                                            *
+ *                              Azoteq (Pty) Ltd                              *
+ *                          Republic of South Africa                          *
+ *                                                                            *
+ *                           Tel: +27(0)21 863 0033                           *
+ *                           E-mail: info@azoteq.com                          *
+ *                                                                            *
+ * ========================================================================== *
+ * @file        IQS9320_fixed.h                                               *
+ * @brief       IQS9320 driver with the firmware version, channel count and   *
+ *              the data read every frame fixed at compile time. The register *
+ *              addresses, flag offsets and read lengths of the frame are     *
+ *              constants, so that run() and decodeFrame() are straight-line  *
+ *              code with fixed-size copies, and the reads that are not       *
+ *              selected are not compiled in.                                 *
+ * @author      Azoteq PTY Ltd                                                *
+ * @version     v1.5.3                                                        *
+ * @date        2024                                                          *
+ * ========================================================================== *
+ * @attention  C++11, header only. IQS9320Fixed is an IQS9320: start-up,      *
+ *             settings and the channel getters are shared, run(), begin()    *
+ *             and decodeFrame() are replaced. The settings of one version    *
+ *             are compiled in (see IQS9320.h), so Version must match         *
+ *             IQS9320_VERSION, and NChannels should not exceed the channels  *
+ *             enabled in the init file.                                      *
+ *                                                                            *
+ *             The replaced methods hide those of IQS9320, they are not       *
+ *             virtual. Call them on the IQS9320Fixed itself: through an      *
+ *             IQS9320 pointer or reference (IQS9320Group, IQS9320Coro and    *
+ *             the host tools) the generic begin(), frame reads and           *
+ *             decodeFrame() of IQS9320 run instead. Only the two start-up    *
+ *             reads of init() use the generic reads; after a bus recovery    *
+ *             checkBus() leaves the read of the frame to run(), so that the  *
+ *             frame is read again with the fixed reads.                      *
+ *                                                                            *
+ *               IQS9320Fixed<IQS9320_VERSION, 20, IQS9320_FEATURE_DEBUG> kb; *
+ *               kb.begin(0x3E, 5);                                           *
+ ******************************************************************************/
+
+#ifndef IQS9320_FIXED_H
+#define IQS9320_FIXED_H
+
+#include "IQS9320.h"
+
+/* Channel data read every frame besides the flags */
+#define IQS9320_FEATURE_NORM_DELTA      0x01
+#define IQS9320_FEATURE_MOVEMENT        0x02
+#define IQS9320_FEATURE_DELTA           0x04
+#define IQS9320_FEATURE_DEBUG           (IQS9320_FEATURE_NORM_DELTA | IQS9320_FEATURE_MOVEMENT | IQS9320_FEATURE_DELTA)
+
+/**
+* @brief  iqs9320 Register Map of a firmware version, for the frame reads.
+*         Offsets are bytes from SYSTEM_STATUS in the flags read.
+*/
+template<uint8_t Version>
+struct iqs9320_version_s;
+
+struct iqs9320_version_v07_s
+{
+        static constexpr uint16_t norm_delta    = 0x100E;
+        static constexpr uint16_t movement      = 0x100E + IQS9320_MAX_CHANNELS;
+        static constexpr uint16_t delta         = 0x1036;
+        static constexpr uint8_t  field_size    = 4;
+        static constexpr bool     has_ati_error = true;
+        static constexpr uint8_t  ati_error     = 2;
+        static constexpr uint8_t  filter_halt   = 2 + 4;
+        static constexpr uint8_t  activation    = 2 + 2 * 4;    // Last field
+        static constexpr uint8_t  last_field    = activation;
+};
+
+template<>
+struct iqs9320_version_s<IQS9320_VERSION_1_0> : iqs9320_version_v07_s {};
+
+template<>
+struct iqs9320_version_s<IQS9320_VERSION_0_7> : iqs9320_version_v07_s {};
+
+template<>
+struct iqs9320_version_s<IQS9320_VERSION_0_4>
+{
+        static constexpr uint16_t norm_delta    = 0x100C;
+        static constexpr uint16_t movement      = 0x100C + IQS9320_MAX_CHANNELS;
+        static constexpr uint16_t delta         = 0x1034;
+        static constexpr uint8_t  field_size    = 3;
+        static constexpr bool     has_ati_error = false;
+        static constexpr uint8_t  ati_error     = 0;
+        static constexpr uint8_t  activation    = 2;
+        static constexpr uint8_t  filter_halt   = 2 + 3;        // Last field
+        static constexpr uint8_t  last_field    = filter_halt;
+};
+
+// Class Prototype
+template<uint8_t Version = IQS9320_VERSION, uint8_t NChannels = IQS9320_MAX_CHANNELS, uint8_t Features = 0>
+class IQS9320Fixed : public IQS9320
+{
+public:
+        typedef iqs9320_version_s<Version> map;
+
+        // Public Constants
+        static constexpr uint8_t channels = NChannels;
+        static constexpr uint8_t field_bytes = (NChannels + 7) / 8;
+        static constexpr uint8_t flags_length = map::last_field + field_bytes;
+        static constexpr uint8_t frame_jobs = 1 + ((Features & IQS9320_FEATURE_NORM_DELTA) != 0)
+                                                + ((Features & IQS9320_FEATURE_MOVEMENT) != 0)
+                                                + ((Features & IQS9320_FEATURE_DELTA) != 0);
+
+        // Public Methods
+        void begin(uint8_t deviceAddressIn, uint8_t mclr_pin);
+        void run(void);
+        void decodeFrame(iqs9320_frame_s *frame, uint8_t slot);
+
+private:
+        static_assert(Version == IQS9320_VERSION, "IQS9320Fixed: Version must be the version selected in IQS9320.h");
+        static_assert((NChannels > 0) && (NChannels <= IQS9320_MAX_CHANNELS), "IQS9320Fixed: 1 to 20 channels");
+        static_assert(frame_jobs <= IQS9320_TRANSFER_QUEUE_LENGTH, "IQS9320Fixed: transfer queue too short");
+
+        // Private Variables
+        iqs9320_transfer_s _jobs[frame_jobs];
+        uint8_t _flags[flags_length];
+
+        // Private Methods
+        void startFrame(void);
+        bool frameDone(void);
+        void finishFrame(void);
+};
+
+/*****************************************************************************/
+/*                            PUBLIC METHODS                                 */
+/*****************************************************************************/
+
+/**
+  * @name   begin
+  * @brief  A method to initialize the device, see IQS9320::begin(). The
+  *         channel count is NChannels.
+  * @param  deviceAddressIn ->  The address of the IQS9320 device.
+  * @param  mclr_pin        ->  The Arduino pin connected to MCLR.
+  * @retval None.
+  */
+template<uint8_t Version, uint8_t NChannels, uint8_t Features>
+void IQS9320Fixed<Version, NChannels, Features>::begin(uint8_t deviceAddressIn, uint8_t mclr_pin)
+{
+  IQS9320::begin(deviceAddressIn, mclr_pin, NChannels);
+
+  /* The reads during start-up follow the same selection */
+  _debug_en = (Features != 0);
+}
+
+/**
+  * @name   run
+  * @brief  The main state machine, see IQS9320::run(). A frame is read with
+  *         the fixed reads of this driver.
+  * @param  None.
+  * @retval None.
+  */
+template<uint8_t Version, uint8_t NChannels, uint8_t Features>
+void IQS9320Fixed<Version, NChannels, Features>::run(void)
+{
+  /* Advance the queued transfers, a no-op with the blocking Wire port */
+  _transfer.service();
+
+  switch (iqs9320_state.state)
+  {
+    case IQS9320_STATE_START:
+      iqs9320_state.state = IQS9320_STATE_INIT;
+    break;
+
+    case IQS9320_STATE_INIT:
+      if(init())
+      {
+        iqs9320_state.state = IQS9320_STATE_IDLE;
+      }
+    break;
+
+    case IQS9320_STATE_SW_RESET:
+      SW_Reset(STOP);
+      iqs9320_state.state = IQS9320_STATE_RUN;
+    break;
+
+    case IQS9320_STATE_CHECK_RESET:
+      checkClock();
+      if(checkBus())
+      {
+        break;
+      }
+      if(checkReset())
+      {
+        Serial.println("Reset Occurred!\n");
+        new_data_available = false;
+        iqs9320_state.state = IQS9320_STATE_START;
+        iqs9320_state.init_state = IQS9320_INIT_VERIFY_PRODUCT;
+      }
+      else
+      {
+        new_data_available = !_frame_failed;
+        if(new_data_available)
+        {
+          countPowerMode();
+        }
+        iqs9320_state.state = IQS9320_STATE_IDLE;
+      }
+    break;
+
+    case IQS9320_STATE_RUN:
+      startFrame();
+      new_data_available = false;
+      iqs9320_state.state = IQS9320_STATE_WAIT_FOR_DATA;
+      // fall through, a blocking port has completed the reads already
+
+    case IQS9320_STATE_WAIT_FOR_DATA:
+      if(frameDone())
+      {
+        finishFrame();
+        iqs9320_state.state = IQS9320_STATE_CHECK_RESET;
+      }
+    break;
+
+    default:
+    break;
+  }
+}
+
+/**
+  * @name   decodeFrame
+  * @brief  A method that decodes the latest data into a slot of a frame, see
+  *         IQS9320::decodeFrame(). Data that is not read reads as 0.
+  * @param  frame ->  The frame to fill, shared between devices.
+  * @param  slot  ->  The device slot in the frame.
+  * @retval None.
+  */
+template<uint8_t Version, uint8_t NChannels, uint8_t Features>
+void IQS9320Fixed<Version, NChannels, Features>::decodeFrame(iqs9320_frame_s *frame, uint8_t slot)
+{
+  uint16_t base = slot * IQS9320_MAX_CHANNELS;
+  uint32_t activation = 0;
+  uint32_t filter_halt = 0;
+
+  if(slot >= IQS9320_FRAME_MAX_DEVICES)
+  {
+    return;
+  }
+  if(slot >= frame->nDevices)
+  {
+    frame->nDevices = slot + 1;
+  }
+
+  for(uint8_t i = 0; i < field_bytes; i++)
+  {
+    activation |= (uint32_t)IQSMemoryMap.ACTIVATION_FLAGS[i] << (8 * i);
+    filter_halt |= (uint32_t)IQSMemoryMap.FILTER_HALT_FLAGS[i] << (8 * i);
+  }
+  frame->system_status[slot] = (uint16_t)IQSMemoryMap.SYSTEM_STATUS[0] | ((uint16_t)IQSMemoryMap.SYSTEM_STATUS[1] << 8);
+  frame->activation[slot] = activation;
+  frame->filter_halt[slot] = filter_halt;
+
+  if(Features & IQS9320_FEATURE_NORM_DELTA)
+  {
+    memcpy(&frame->norm[base], IQSMemoryMap.CH_NORM_DELTA, NChannels);
+  }
+  else
+  {
+    memset(&frame->norm[base], 0, NChannels);
+  }
+  if(Features & IQS9320_FEATURE_MOVEMENT)
+  {
+    memcpy(&frame->move[base], IQSMemoryMap.CH_MOVEMENT, NChannels);
+  }
+  else
+  {
+    memset(&frame->move[base], 0, NChannels);
+  }
+  if(Features & IQS9320_FEATURE_DELTA)
+  {
+    /* Deltas are little-endian on the IQS9320 */
+    #if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+    memcpy(&frame->delta[base], IQSMemoryMap.CH_DELTA, NChannels * 2);
+    #else
+    for(uint8_t i = 0; i < NChannels; i++)
+    {
+      frame->delta[base + i] = (int16_t)((uint16_t)IQSMemoryMap.CH_DELTA[2*i] | ((uint16_t)IQSMemoryMap.CH_DELTA[2*i + 1] << 8));
+    }
+    #endif
+  }
+  else
+  {
+    memset(&frame->delta[base], 0, NChannels * 2);
+  }
+
+  /* Channels that are not enabled read as 0 */
+  if(NChannels < IQS9320_MAX_CHANNELS)
+  {
+    memset(&frame->delta[base + NChannels], 0, (IQS9320_MAX_CHANNELS - NChannels) * 2);
+    memset(&frame->norm[base + NChannels], 0, IQS9320_MAX_CHANNELS - NChannels);
+    memset(&frame->move[base + NChannels], 0, IQS9320_MAX_CHANNELS - NChannels);
+  }
+
+  frame->timestamp = millis();
+}
+
+/*****************************************************************************/
+/*                           PRIVATE METHODS                                 */
+/*****************************************************************************/
+
+/**
+  * @name   startFrame
+  * @brief  A method that queues the reads of one frame: the flags up to the
+  *         last used byte of the last flag field and the selected channel
+  *         data of the enabled channels.
+  * @param  None.
+  * @retval None.
+  */
+template<uint8_t Version, uint8_t NChannels, uint8_t Features>
+void IQS9320Fixed<Version, NChannels, Features>::startFrame(void)
+{
+  uint8_t job = 0;
+
+  /* Wait for room in the queue, only happens with many queued user jobs */
+  while(_transfer.pending() > IQS9320_TRANSFER_QUEUE_LENGTH - frame_jobs)
+  {
+    _transfer.service();
+  }
+
+  iqs9320_transfer_setup(&_jobs[job], _deviceAddress, IQS9320_MM_SYSTEM_STATUS, _flags, flags_length, true, STOP);
+  _transfer.submit(&_jobs[job++]);
+
+  if(Features & IQS9320_FEATURE_NORM_DELTA)
+  {
+    iqs9320_transfer_setup(&_jobs[job], _deviceAddress, map::norm_delta, IQSMemoryMap.CH_NORM_DELTA, NChannels, true, STOP);
+    _transfer.submit(&_jobs[job++]);
+  }
+  if(Features & IQS9320_FEATURE_MOVEMENT)
+  {
+    iqs9320_transfer_setup(&_jobs[job], _deviceAddress, map::movement, IQSMemoryMap.CH_MOVEMENT, NChannels, true, STOP);
+    _transfer.submit(&_jobs[job++]);
+  }
+  if(Features & IQS9320_FEATURE_DELTA)
+  {
+    iqs9320_transfer_setup(&_jobs[job], _deviceAddress, map::delta, IQSMemoryMap.CH_DELTA, NChannels * 2, true, STOP);
+    _transfer.submit(&_jobs[job++]);
+  }
+}
+
+/**
+  * @name   frameDone
+  * @brief  A method that checks if the last read of the frame has completed.
+  * @param  None.
+  * @retval bool -> true when the frame has been read or failed.
+  */
+template<uint8_t Version, uint8_t NChannels, uint8_t Features>
+bool IQS9320Fixed<Version, NChannels, Features>::frameDone(void)
+{
+  uint8_t status = _jobs[frame_jobs - 1].status;
+
+  return (status == IQS9320_TRANSFER_DONE) || (status == IQS9320_TRANSFER_ERROR);
+}
+
+/**
+  * @name   finishFrame
+  * @brief  A method that copies the flags of a completed frame into
+  *         IQSMemoryMap. A frame with a failed or short read is dropped.
+  * @param  None.
+  * @retval None.
+  */
+template<uint8_t Version, uint8_t NChannels, uint8_t Features>
+void IQS9320Fixed<Version, NChannels, Features>::finishFrame(void)
+{
+  _frame_failed = false;
+  for(uint8_t i = 0; i < frame_jobs; i++)
+  {
+    _frame_failed |= (_jobs[i].status == IQS9320_TRANSFER_ERROR);
+  }
+  if(_frame_failed)
+  {
+    return;
+  }
+
+  IQSMemoryMap.SYSTEM_STATUS[0] = _flags[0];
+  IQSMemoryMap.SYSTEM_STATUS[1] = _flags[1];
+
+  if(map::has_ati_error)
+  {
+    memcpy(IQSMemoryMap.ATI_ERROR, &_flags[map::ati_error], field_bytes);
+  }
+  memcpy(IQSMemoryMap.FILTER_HALT_FLAGS, &_flags[map::filter_halt], field_bytes);
+  memcpy(IQSMemoryMap.ACTIVATION_FLAGS, &_flags[map::activation], field_bytes);
+}
+
+#endif // IQS9320_FIXED_H
@@ -0,0 +1,99 @@
+/******************************************************************************
+ *                                                                            *
+ *                                Copyright by                                *
+ *                                                                            *
+ *                              Azoteq (Pty) Ltd                              *
+ *                          Republic of South Africa                          *
+ *                                                                            *
+ *                           Tel: +27(0)21 863 0033                           *
+ *                           E-mail: info@azoteq.com                          *
+ *                                                                            *
+ * ========================================================================== *
+ * @file        IQS9320_frame.h                                               *
+ * @brief       Decoded frame of one or more IQS9320 devices. Channel data of *
+ *              all devices is stored in contiguous arrays, device n owns     *
+ *              channels [n*IQS9320_MAX_CHANNELS, (n+1)*IQS9320_MAX_CHANNELS).*
+ *              The frame is filled once per sample with                      *
+ *              IQS9320::decodeFrame() and can then be processed as a whole.  *
+ * @author      Azoteq PTY Ltd                                                *
+ * @version     v1.5.3                                                        *
+ * @date        2024                                                          *
+ * ========================================================================== *
+ * @attention  Only depends on <stdint.h> so that host tools can share it.    *
+ ******************************************************************************/
+
+#ifndef IQS9320_FRAME_H
+#define IQS9320_FRAME_H
+
+#include <stdint.h>
+#include <string.h>
+
+/* Number of channels of a single IQS9320 */
+#define IQS9320_MAX_CHANNELS            20
+
+/* Number of devices aggregated in one frame */
+#ifndef IQS9320_FRAME_MAX_DEVICES
+#if defined(__AVR__)
+#define IQS9320_FRAME_MAX_DEVICES       1
+#else
+#define IQS9320_FRAME_MAX_DEVICES       8
+#endif
+#endif
+
+#define IQS9320_FRAME_CHANNELS          (IQS9320_FRAME_MAX_DEVICES * IQS9320_MAX_CHANNELS)
+
+/**
+* @brief  iqs9320 Decoded Frame.
+* @note   Bit n of activation/filter_halt is channel n of that device.
+*         Channels that are not enabled on a device read as 0.
+*/
+typedef struct
+{
+        uint32_t timestamp;                             // millis() of the read
+        uint8_t  nDevices;                              // Highest used slot + 1
+        uint16_t system_status[IQS9320_FRAME_MAX_DEVICES];
+        uint32_t activation[IQS9320_FRAME_MAX_DEVICES];
+        uint32_t filter_halt[IQS9320_FRAME_MAX_DEVICES];
+        int16_t  delta[IQS9320_FRAME_CHANNELS];
+        uint8_t  norm[IQS9320_FRAME_CHANNELS];
+        uint8_t  move[IQS9320_FRAME_CHANNELS];
+} iqs9320_frame_s;
+
+/**
+  * @name   iqs9320_frame_clear
+  * @brief  Clear all data in a frame.
+  * @param  frame ->  The frame to clear.
+  * @retval None.
+  */
+static inline void iqs9320_frame_clear(iqs9320_frame_s *frame)
+{
+  memset(frame, 0, sizeof(iqs9320_frame_s));
+}
+
+/**
+  * @name   iqs9320_frame_threshold
+  * @brief  Compare the deltas of every channel in the frame to a threshold.
+  * @param  frame     ->  The decoded frame.
+  * @param  threshold ->  Delta value at or above which a channel is reported.
+  * @param  masks     ->  Array of frame->nDevices channel masks, bit n is set
+  *                       when channel n of that device reached the threshold.
+  * @retval None.
+  * @note   The inner loop has a fixed trip count and no early exits, so it is
+  *         vectorised by the compiler on targets with SIMD support.
+  */
+static inline void iqs9320_frame_threshold(const iqs9320_frame_s *frame, int16_t threshold, uint32_t masks[])
+{
+  for(uint8_t d = 0; d < frame->nDevices; d++)
+  {
+    const int16_t *delta = &frame->delta[d * IQS9320_MAX_CHANNELS];
+    uint32_t mask = 0;
+
+    for(uint8_t i = 0; i < IQS9320_MAX_CHANNELS; i++)
+    {
+      mask |= (uint32_t)(delta[i] >= threshold) << i;
+    }
+    masks[d] = mask;
+  }
+}
+
+#endif // IQS9320_FRAME_H
@@ -0,0 +1,227 @@
+/******************************************************************************
+ *                                                                            *
+ *                                Copyright by                                *
+ *                                                                            *
+ *                              Azoteq (Pty) Ltd                              *
+ *                          Republic of South Africa                          *
+ *                                                                            *
+ *                           Tel: +27(0)21 863 0033                           *
+ *                           E-mail: info@azoteq.com                          *
+ *                                                                            *
+ * ========================================================================== *
+ * @file        IQS9320_group.cpp                                             *
+ * @brief       Interleaved start-up of several IQS9320 devices, see          *
+ *              IQS9320_group.h.                                              *
+ * @author      Azoteq PTY Ltd                                                *
+ * @version     v1.5.3                                                        *
+ * @date        2024                                                          *
+ *****************************************************************************/
+
+/* Include Files */
+#include "IQS9320_group.h"
+
+/*****************************************************************************/
+/*                             CONSTRUCTORS                                  */
+/*****************************************************************************/
+IQS9320Group::IQS9320Group(){
+  _count = 0;
+  _start_us = 0;
+  _init_us = 0;
+}
+
+/*****************************************************************************/
+/*                            PUBLIC METHODS                                 */
+/*****************************************************************************/
+
+/**
+  * @name   add
+  * @brief  A method that adds a device to the group.
+  * @param  device ->  A device after begin(), its state machine is in
+  *                    IQS9320_STATE_START.
+  * @retval bool -> false if the group is full.
+  * @note   The devices after the first share its I2C clock, see
+  *         IQS9320::shareClock(). Only the first device trains the clock.
+  */
+bool IQS9320Group::add(IQS9320 *device)
+{
+  if(_count >= IQS9320_GROUP_MAX_DEVICES)
+  {
+    return false;
+  }
+  /* One clock for the bus, trained by the first device */
+  device->shareClock(_count > 0 ? _devices[0] : NULL);
+  _devices[_count++] = device;
+  return true;
+}
+
+/**
+  * @name   getDeviceCount
+  * @brief  A method that returns the number of devices in the group.
+  * @param  None.
+  * @retval uint8_t -> Number of devices.
+  */
+uint8_t IQS9320Group::getDeviceCount(void)
+{
+  return _count;
+}
+
+/**
+  * @name   init
+  * @brief  A method that runs the start-up routine of all devices, and
+  *         sleeps while every device is waiting.
+  * @param  timeout_ms ->  Longest time for the start-up.
+  * @retval bool -> true if every device reached IQS9320_STATE_IDLE, false
+  *         after the timeout or if a device is not an IQS9320.
+  */
+bool IQS9320Group::init(uint32_t timeout_ms)
+{
+  bool done;
+
+  start();
+  while(!(done = run()))
+  {
+    uint32_t wait = getWait();
+
+    if((uint32_t)(micros() - _start_us) >= timeout_ms * 1000UL)
+    {
+      break;
+    }
+    if(wait > 0)
+    {
+      delayMicroseconds((unsigned int)wait);
+    }
+  }
+  stop();
+
+  for(uint8_t d = 0; d < _count; d++)
+  {
+    done &= (_devices[d]->iqs9320_state.state == IQS9320_STATE_IDLE);
+  }
+  return done;
+}
+
+/**
+  * @name   start
+  * @brief  A method that starts a scheduled start-up, after which run() is
+  *         called until it returns true.
+  * @param  None.
+  * @retval None.
+  */
+void IQS9320Group::start(void)
+{
+  _start_us = micros();
+  for(uint8_t d = 0; d < _count; d++)
+  {
+    _devices[d]->_init_scheduled = true;
+  }
+}
+
+/**
+  * @name   run
+  * @brief  A method that gives every device that is not waiting one step of
+  *         its start-up routine.
+  * @param  None.
+  * @retval bool -> true once every device is idle, or stopped in
+  *         IQS9320_INIT_NONE because it is not an IQS9320.
+  * @note   Calls stop() when it returns true.
+  */
+bool IQS9320Group::run(void)
+{
+  bool done = true;
+
+  for(uint8_t d = 0; d < _count; d++)
+  {
+    IQS9320 *device = _devices[d];
+
+    /* The START and INIT cases of IQS9320::run() */
+    if(device->iqs9320_state.state == IQS9320_STATE_START)
+    {
+      device->iqs9320_state.state = IQS9320_STATE_INIT;
+    }
+    if(device->iqs9320_state.state != IQS9320_STATE_INIT)
+    {
+      continue;
+    }
+    if(device->iqs9320_state.init_state == IQS9320_INIT_NONE)
+    {
+      continue;
+    }
+    if(device->init())
+    {
+      device->iqs9320_state.state = IQS9320_STATE_IDLE;
+    }
+    else
+    {
+      done = false;
+    }
+  }
+
+  if(done)
+  {
+    _init_us = micros() - _start_us;
+    stop();
+  }
+  return done;
+}
+
+/**
+  * @name   stop
+  * @brief  A method that returns the devices to blocking waits, for a later
+  *         start-up from IQS9320::run() after a reset.
+  * @param  None.
+  * @retval None.
+  */
+void IQS9320Group::stop(void)
+{
+  for(uint8_t d = 0; d < _count; d++)
+  {
+    _devices[d]->_init_scheduled = false;
+    _devices[d]->_init_wait_us = 0;
+  }
+}
+
+/**
+  * @name   getWait
+  * @brief  A method that returns how long every device still has to wait.
+  * @param  None.
+  * @retval uint32_t -> Time in us until the next device can continue, 0 if
+  *         one can continue now.
+  */
+uint32_t IQS9320Group::getWait(void)
+{
+  uint32_t wait = 0;
+  bool waiting = false;
+
+  for(uint8_t d = 0; d < _count; d++)
+  {
+    IQS9320 *device = _devices[d];
+    uint32_t remaining;
+
+    if((device->iqs9320_state.state != IQS9320_STATE_INIT) || (device->iqs9320_state.init_state == IQS9320_INIT_NONE))
+    {
+      continue;
+    }
+    remaining = device->initWaitRemaining();
+    if(remaining == 0)
+    {
+      return 0;
+    }
+    if(!waiting || (remaining < wait))
+    {
+      wait = remaining;
+      waiting = true;
+    }
+  }
+  return wait;
+}
+
+/**
+  * @name   getInitTime
+  * @brief  A method that returns the duration of the last start-up.
+  * @param  None.
+  * @retval uint32_t -> Time in us from start() until every device was idle.
+  */
+uint32_t IQS9320Group::getInitTime(void)
+{
+  return _init_us;
+}
@@ -0,0 +1,68 @@
+/******************************************************************************
+ *                                                                            *
+ *                                Copyright by                                *
+ *                                                                            *
+ *                              Azoteq (Pty) Ltd                              *
+ *                          Republic of South Africa                          *
+ *                                                                            *
+ *                           Tel: +27(0)21 863 0033                           *
+ *                           E-mail: info@azoteq.com                          *
+ *                                                                            *
+ * ========================================================================== *
+ * @file        IQS9320_group.h                                               *
+ * @brief       Start-up of several IQS9320 devices on one bus. The steps of  *
+ *              init() are interleaved over the devices, so that the settings *
+ *              of one device are written while the others wait for their     *
+ *              reset acknowledge, reconfiguration or ATI.                    *
+ * @author      Azoteq PTY Ltd                                                *
+ * @version     v1.5.3                                                        *
+ * @date        2024                                                          *
+ * ========================================================================== *
+ * @attention  Every pass of run() gives each device one step of init(). The *
+ *             waits between the steps (10 ms after the reset acknowledge    *
+ *             and the reconfiguration, the ATI polls and the first reads)    *
+ *             do not block while the group runs the start-up; a device that *
+ *             is waiting is skipped. The devices reach IQS9320_INIT_ATI in   *
+ *             the same few passes, so their ATI routines run at the same     *
+ *             time and the ATI active bits are polled in one sweep every     *
+ *             10 ms. The start-up takes about one ATI plus the bus time of   *
+ *             all devices, instead of one ATI per device.                    *
+ ******************************************************************************/
+
+#ifndef IQS9320_GROUP_H
+#define IQS9320_GROUP_H
+
+#include "IQS9320.h"
+
+/* Number of devices in one group */
+#ifndef IQS9320_GROUP_MAX_DEVICES
+#define IQS9320_GROUP_MAX_DEVICES       8
+#endif
+
+// Class Prototype
+class IQS9320Group
+{
+public:
+        // Public Constructors
+        IQS9320Group();
+
+        // Public Methods
+        bool add(IQS9320 *device);
+        uint8_t getDeviceCount(void);
+
+        bool init(uint32_t timeout_ms);
+        void start(void);
+        bool run(void);
+        void stop(void);
+        uint32_t getWait(void);
+        uint32_t getInitTime(void);
+
+private:
+        // Private Variables
+        IQS9320 *_devices[IQS9320_GROUP_MAX_DEVICES];
+        uint8_t _count;
+        uint32_t _start_us;
+        uint32_t _init_us;              // Duration of the last start-up
+};
+
+#endif // IQS9320_GROUP_H
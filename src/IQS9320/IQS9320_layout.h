@@ -0,0 +1,183 @@
+/******************************************************************************
+ *                                                                            *
+ *                                Copyright by                                *
+ *                                                                            *
+ *                              Azoteq (Pty) Ltd                              *
+ *                          Republic of South Africa                          *
+ *                                                                            *
+ *                           Tel: +27(0)21 863 0033                           *
+ *                           E-mail: info@azoteq.com                          *
+ *                                                                            *
+ * ========================================================================== *
+ * @file        IQS9320_layout.h                                              *
+ * @brief       Compile-time key layout of a board. The layout lists the      *
+ *              channel of every key in physical order (row by row from the   *
+ *              top left) as template parameters; the inverse map and the bit *
+ *              shuffles that move activation masks between channel order and *
+ *              key order are calculated by the compiler.                     *
+ * @author      Azoteq PTY Ltd                                                *
+ * @version     v1.5.3                                                        *
+ * @date        2024                                                          *
+ * ========================================================================== *
+ * @attention  C++11, header only, no library dependencies (AVR builds have   *
+ *             no <array> or <utility>). Example for a 2x2 board:             *
+ *                                                                            *
+ *               typedef IQS9320Layout<2, 2,  3, 0,                           *
+ *                                            1, 2> Board;                    *
+ *               Board::channel(0)             // 3, the top left key         *
+ *               Board::key(0)                 // 1                           *
+ *               Board::toKeyOrder(1UL << 3)   // 0x1, the top left key       *
+ *                                                                            *
+ *             toKeyOrder() groups the channels by the distance their bit     *
+ *             moves; every group costs one AND, one shift and one OR, and    *
+ *             groups without channels are removed by the compiler.           *
+ ******************************************************************************/
+
+#ifndef IQS9320_LAYOUT_H
+#define IQS9320_LAYOUT_H
+
+#include <stdint.h>
+
+/* Returned by key() for channels that are not on the board */
+#define IQS9320_LAYOUT_NONE             0xFF
+
+/* Bits of an activation mask */
+#define IQS9320_LAYOUT_BITS             32
+
+/* Checks of the template parameters: every channel is below 32 and used
+once. Free functions, as the class is incomplete in its static_asserts */
+constexpr bool iqs9320_layout_unique(uint8_t)
+{
+  return true;
+}
+
+template<typename... T>
+constexpr bool iqs9320_layout_unique(uint8_t ch, uint8_t first, T... rest)
+{
+  return (ch != first) && iqs9320_layout_unique(ch, rest...);
+}
+
+constexpr bool iqs9320_layout_valid(void)
+{
+  return true;
+}
+
+template<typename... T>
+constexpr bool iqs9320_layout_valid(uint8_t first, T... rest)
+{
+  return (first < IQS9320_LAYOUT_BITS) && iqs9320_layout_unique(first, rest...) && iqs9320_layout_valid(rest...);
+}
+
+// Class Prototype
+template<uint8_t Rows, uint8_t Cols, uint8_t... Channels>
+class IQS9320Layout
+{
+public:
+        // Public Constants
+        static constexpr uint8_t rows = Rows;
+        static constexpr uint8_t cols = Cols;
+        static constexpr uint8_t keys = sizeof...(Channels);
+        static constexpr uint8_t channels[sizeof...(Channels)] = {Channels...};
+
+        // Public Methods
+        /* Channel of a key */
+        static constexpr uint8_t channel(uint8_t key)
+        {
+          return channels[key];
+        }
+
+        /* Key of a channel, IQS9320_LAYOUT_NONE if it is not on the board */
+        static constexpr uint8_t key(uint8_t ch, uint8_t from = 0)
+        {
+          return (from >= keys) ? IQS9320_LAYOUT_NONE : (channels[from] == ch) ? from : key(ch, from + 1);
+        }
+
+        static constexpr uint8_t row(uint8_t key)
+        {
+          return key / Cols;
+        }
+
+        static constexpr uint8_t col(uint8_t key)
+        {
+          return key % Cols;
+        }
+
+        /* Mask of the channels on the board */
+        static constexpr uint32_t channelMask(uint8_t from = 0)
+        {
+          return (from >= keys) ? 0 : ((1UL << channels[from]) | channelMask(from + 1));
+        }
+
+        /* Channels whose bit moves up by distance (down when negative) on
+        the way to key order */
+        static constexpr uint32_t shiftMask(int8_t distance, uint8_t from = 0)
+        {
+          return (from >= keys) ? 0 : ((((int)from - (int)channels[from] == distance) ? (1UL << channels[from]) : 0)
+                                       | shiftMask(distance, from + 1));
+        }
+
+        /* Keys whose bit moves down by distance (up when negative) on the
+        way back to channel order */
+        static constexpr uint32_t keyShiftMask(int8_t distance, uint8_t from = 0)
+        {
+          return (from >= keys) ? 0 : ((((int)from - (int)channels[from] == distance) ? (1UL << from) : 0)
+                                       | keyShiftMask(distance, from + 1));
+        }
+
+        /* Activation mask in channel order to a mask with bit n for key n */
+        static inline uint32_t toKeyOrder(uint32_t mask)
+        {
+          return Shuffle<nextDistance(1 - IQS9320_LAYOUT_BITS, false), false>::apply(mask);
+        }
+
+        /* Mask with bit n for key n to a mask in channel order */
+        static inline uint32_t toChannelOrder(uint32_t mask)
+        {
+          return Shuffle<nextDistance(1 - IQS9320_LAYOUT_BITS, true), true>::apply(mask);
+        }
+
+private:
+        static_assert(sizeof...(Channels) <= Rows * Cols, "IQS9320Layout: more channels than keys");
+        static_assert(sizeof...(Channels) <= IQS9320_LAYOUT_BITS, "IQS9320Layout: more than 32 channels");
+        static_assert(iqs9320_layout_valid(Channels...), "IQS9320Layout: channels must be below 32 and used once");
+
+        /* First distance from distance on that moves any bit */
+        static constexpr int nextDistance(int distance, bool inverse)
+        {
+          return (distance >= IQS9320_LAYOUT_BITS) ? IQS9320_LAYOUT_BITS
+                 : ((inverse ? keyShiftMask(-distance) : shiftMask(distance)) != 0) ? distance
+                 : nextDistance(distance + 1, inverse);
+        }
+
+        /* Moves the bits of one distance at a time, from the largest
+        downward shift to the largest upward shift. Only distances that move
+        any bit are instantiated */
+        template<int Distance, bool Inverse, bool End = (Distance >= IQS9320_LAYOUT_BITS)>
+        struct Shuffle
+        {
+          /* Key order to channel order moves the key bits back */
+          static constexpr uint32_t bits = Inverse ? keyShiftMask(-Distance) : shiftMask(Distance);
+
+          static inline uint32_t apply(uint32_t mask)
+          {
+            return ((Distance >= 0) ? ((mask & bits) << (Distance & 31)) : ((mask & bits) >> ((-Distance) & 31)))
+                   | Shuffle<nextDistance(Distance + 1, Inverse), Inverse>::apply(mask);
+          }
+        };
+
+        template<int Distance, bool Inverse>
+        struct Shuffle<Distance, Inverse, true>
+        {
+          static inline uint32_t apply(uint32_t)
+          {
+            return 0;
+          }
+        };
+};
+
+/* Definition of the channel table for ODR-use, e.g. channels[i] with a
+variable i */
+template<uint8_t Rows, uint8_t Cols, uint8_t... Channels>
+constexpr uint8_t IQS9320Layout<Rows, Cols, Channels...>::channels[sizeof...(Channels)];
+
+#endif // IQS9320_LAYOUT_H
@@ -0,0 +1,280 @@
+/******************************************************************************
+ *                                                                            *
+ *                                Copyright by                                *
+ *                                                                            *
+ *                              Azoteq (Pty) Ltd                              *
+ *                          Republic of South Africa                          *
+ *                                                                            *
+ *                           Tel: +27(0)21 863 0033                           *
+ *                           E-mail: info@azoteq.com                          *
+ *                                                                            *
+ * ========================================================================== *
+ * @file        IQS9320_model.cpp                                             *
+ * @brief       Software model of the activation and reference halt logic,    *
+ *              see IQS9320_model.h.                                          *
+ * @author      Azoteq PTY Ltd                                                *
+ * @version     v1.5.3                                                        *
+ * @date        2024                                                          *
+ *****************************************************************************/
+
+/* Include Files */
+#include "IQS9320_model.h"
+#include <string.h>
+
+/*****************************************************************************/
+/*                             CONSTRUCTORS                                  */
+/*****************************************************************************/
+IQS9320Model::IQS9320Model(){
+  memset(&_config, 0, sizeof(_config));
+  begin(0, &_config);
+}
+
+/*****************************************************************************/
+/*                            PUBLIC METHODS                                 */
+/*****************************************************************************/
+
+/**
+  * @name   begin
+  * @brief  A method that sets the number of channels and the settings, and
+  *         resets the model.
+  * @param  nChannels ->  Number of channels, at most IQS9320_MODEL_MAX_CHANNELS.
+  * @param  config    ->  The settings to model.
+  * @retval None.
+  */
+void IQS9320Model::begin(uint8_t nChannels, const iqs9320_model_config_s *config)
+{
+  _nChannels = (nChannels > IQS9320_MODEL_MAX_CHANNELS) ? IQS9320_MODEL_MAX_CHANNELS : nChannels;
+  _config = *config;
+  _timeout_ms = _config.halt_timeout ? (uint32_t)_config.halt_timeout * 1000UL : UINT32_MAX;
+  _used = (_nChannels >= 32) ? 0xFFFFFFFFUL : ((1UL << _nChannels) - 1UL);
+
+  /* Resolve the thresholds of every channel once, unused lanes never
+  activate or halt */
+  for(uint8_t ch = 0; ch < IQS9320_MODEL_LANES; ch++)
+  {
+    int32_t on = 256;
+
+    if(ch < _nChannels)
+    {
+      on = _config.individual_threshold[ch] ? _config.individual_threshold[ch] : _config.activation_threshold;
+    }
+    _on[ch] = on;
+    _off[ch] = (on > _config.hysteresis) ? on - _config.hysteresis : 0;
+  }
+  reset();
+}
+
+/**
+  * @name   reset
+  * @brief  A method that clears the channel state, as after ATI.
+  * @param  None.
+  * @retval None.
+  */
+void IQS9320Model::reset(void)
+{
+  _activation = 0;
+  _halt = 0;
+  memset(_reference, 0, sizeof(_reference));
+  memset(_delta, 0, sizeof(_delta));
+  memset(_active, 0, sizeof(_active));
+  memset(_halted, 0, sizeof(_halted));
+  memset(_halt_start, 0, sizeof(_halt_start));
+}
+
+/**
+  * @name   process
+  * @brief  A method that runs the model for one sample of all channels.
+  * @param  timestamp_ms ->  Time of the sample, for the halt timeout.
+  * @param  norm         ->  Normalised delta of every channel.
+  * @retval None.
+  */
+void IQS9320Model::process(uint32_t timestamp_ms, const uint8_t norm[])
+{
+  uint8_t lanes[IQS9320_MODEL_LANES] = {0};
+
+  memcpy(lanes, norm, _nChannels);
+  step(timestamp_ms, lanes);
+  updateMasks();
+}
+
+/**
+  * @name   processBlock
+  * @brief  A method that runs the model over a block of frames and stores the
+  *         flags of every frame.
+  * @param  block ->  The frames, and where the flags are stored.
+  * @retval None.
+  */
+void IQS9320Model::processBlock(const iqs9320_model_block_s *block)
+{
+  uint8_t lanes[IQS9320_MODEL_LANES] = {0};
+
+  for(uint32_t n = 0; n < block->frames; n++)
+  {
+    memcpy(lanes, &block->norm[(size_t)n * block->stride], _nChannels);
+    step(block->time_ms[n], lanes);
+    updateMasks();
+
+    if(block->activation)
+    {
+      block->activation[n] = _activation;
+    }
+    if(block->filter_halt)
+    {
+      block->filter_halt[n] = _halt;
+    }
+  }
+}
+
+/**
+  * @name   validate
+  * @brief  A method that runs the model over a block of recorded frames and
+  *         compares its flags with the flags the device reported. The model
+  *         is reset first and should be set up with the settings that were
+  *         active during the recording.
+  * @param  block       ->  The recorded frames, outputs are ignored.
+  * @param  activation  ->  Recorded ACTIVATION_FLAGS of every frame.
+  * @param  filter_halt ->  Recorded FILTER_HALT_FLAGS of every frame.
+  * @param  result      ->  Where the agreement is stored.
+  * @retval None.
+  */
+void IQS9320Model::validate(const iqs9320_model_block_s *block, const uint32_t activation[], const uint32_t filter_halt[],
+                            iqs9320_model_validation_s *result)
+{
+  uint8_t lanes[IQS9320_MODEL_LANES] = {0};
+
+  memset(result, 0, sizeof(*result));
+  result->frames = block->frames;
+  result->first_mismatch = -1;
+  reset();
+
+  for(uint32_t n = 0; n < block->frames; n++)
+  {
+    uint32_t activation_diff;
+    uint32_t halt_diff;
+
+    memcpy(lanes, &block->norm[(size_t)n * block->stride], _nChannels);
+    step(block->time_ms[n], lanes);
+    updateMasks();
+
+    activation_diff = (_activation ^ activation[n]) & _used;
+    halt_diff = (_halt ^ filter_halt[n]) & _used;
+    result->activation_frames += (activation_diff == 0);
+    result->halt_frames += (halt_diff == 0);
+    if((activation_diff | halt_diff) && (result->first_mismatch < 0))
+    {
+      result->first_mismatch = (int32_t)n;
+    }
+    while(activation_diff)
+    {
+      result->activation_errors[__builtin_ctz(activation_diff)]++;
+      activation_diff &= activation_diff - 1;
+    }
+    while(halt_diff)
+    {
+      result->halt_errors[__builtin_ctz(halt_diff)]++;
+      halt_diff &= halt_diff - 1;
+    }
+  }
+}
+
+/**
+  * @name   getActivation
+  * @brief  A method that returns the modelled activation flags.
+  * @param  None.
+  * @retval Bit n is set when channel n is active.
+  */
+uint32_t IQS9320Model::getActivation(void) const
+{
+  return _activation;
+}
+
+/**
+  * @name   getFilterHalt
+  * @brief  A method that returns the modelled filter halt flags.
+  * @param  None.
+  * @retval Bit n is set when the reference of channel n is halted.
+  */
+uint32_t IQS9320Model::getFilterHalt(void) const
+{
+  return _halt;
+}
+
+/**
+  * @name   getDelta
+  * @brief  A method that returns the delta compared with the thresholds.
+  * @param  ch ->  The channel.
+  * @retval Normalised delta above the reference.
+  */
+uint8_t IQS9320Model::getDelta(uint8_t ch) const
+{
+  return (ch < _nChannels) ? (uint8_t)_delta[ch] : 0;
+}
+
+/*****************************************************************************/
+/*                           PRIVATE METHODS                                 */
+/*****************************************************************************/
+
+/**
+  * @name   step
+  * @brief  A method that advances every lane by one sample. Written without
+  *         branches so that the loop is vectorised.
+  * @param  timestamp_ms ->  Time of the sample.
+  * @param  norm         ->  IQS9320_MODEL_LANES normalised deltas.
+  * @retval None.
+  */
+void IQS9320Model::step(uint32_t timestamp_ms, const uint8_t *__restrict norm)
+{
+  const int32_t halt_threshold = _config.halt_threshold;
+  const uint32_t timeout_ms = _timeout_ms;
+
+  /* Conditions are kept as all-ones/all-zeros masks and applied with
+  bitwise selects, so that the compiler sees no control flow */
+  for(uint8_t ch = 0; ch < IQS9320_MODEL_LANES; ch++)
+  {
+    int32_t value = norm[ch];
+    int32_t reference = _reference[ch];
+    int32_t halted = -_halted[ch];
+    int32_t lower = -(int32_t)(value < reference);
+    int32_t above;
+    int32_t expired;
+    int32_t threshold;
+
+    /* The re-seeded reference follows the delta down */
+    reference = (value & lower) | (reference & ~lower);
+    value -= reference;
+
+    /* Reference halt with timeout */
+    above = -(int32_t)(value >= halt_threshold);
+    _halt_start[ch] = (timestamp_ms & (uint32_t)(above & ~halted)) | (_halt_start[ch] & ~(uint32_t)(above & ~halted));
+    expired = above & halted & -(int32_t)((uint32_t)(timestamp_ms - _halt_start[ch]) >= timeout_ms);
+    reference += value & expired;
+    value &= ~expired;
+    _halted[ch] = above & ~expired & 1;
+    _reference[ch] = reference;
+
+    /* Activation with hysteresis */
+    threshold = (_off[ch] & -_active[ch]) | (_on[ch] & ~(-_active[ch]));
+    _active[ch] = (value >= threshold);
+    _delta[ch] = value;
+  }
+}
+
+/**
+  * @name   updateMasks
+  * @brief  A method that packs the flags of the channels into the masks.
+  * @param  None.
+  * @retval None.
+  */
+void IQS9320Model::updateMasks(void)
+{
+  uint32_t activation = 0;
+  uint32_t halt = 0;
+
+  for(uint8_t ch = 0; ch < IQS9320_MODEL_MAX_CHANNELS; ch++)
+  {
+    activation |= (uint32_t)_active[ch] << ch;
+    halt |= (uint32_t)_halted[ch] << ch;
+  }
+  _activation = activation & _used;
+  _halt = halt & _used;
+}
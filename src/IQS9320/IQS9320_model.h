@@ -0,0 +1,140 @@
+/******************************************************************************
+ *                                                                            *
+ *                                Copyright by                                *
+ *                                                                            *
+ *                              Azoteq (Pty) Ltd                              *
+ *                          Republic of South Africa                          *
+ *                                                                            *
+ *                           Tel: +27(0)21 863 0033                           *
+ *                           E-mail: info@azoteq.com                          *
+ *                                                                            *
+ * ========================================================================== *
+ * @file        IQS9320_model.h                                               *
+ * @brief       Software model of the IQS9320 activation and reference halt   *
+ *              decisions. Normalised channel deltas are compared against the *
+ *              activation thresholds with hysteresis and against the         *
+ *              reference halt threshold with its timeout, giving activation  *
+ *              and filter halt masks in the layout of ACTIVATION_FLAGS and   *
+ *              FILTER_HALT_FLAGS.                                            *
+ * @author      Azoteq PTY Ltd                                                *
+ * @version     v1.5.3                                                        *
+ * @date        2024                                                          *
+ * ========================================================================== *
+ * @attention  Only depends on <stdint.h>, so that settings can be evaluated  *
+ *             on a PC against recordings before they are written to a        *
+ *             device. The model works on the normalised delta (0-255) of     *
+ *             CH_NORM_DELTA, which the device has already taken through its  *
+ *             counts filter and long-term average:                           *
+ *             - a channel activates when its delta reaches its threshold and *
+ *               is released when it falls below threshold - hysteresis,      *
+ *             - the individual threshold of a channel is used when it is not *
+ *               0, ACTIVATION_THRESHOLD otherwise,                           *
+ *             - the reference is halted while the delta is at or above the   *
+ *               halt threshold; after the halt timeout the reference is      *
+ *               re-seeded to the current delta, which releases the channel.  *
+ *             A timeout shorter than the one of the recording is modelled    *
+ *             by the re-seed, a longer one is not: the recorded delta has    *
+ *             already dropped. Use validate() with the recorded settings to  *
+ *             check how closely a recording is reproduced.                   *
+ *                                                                            *
+ *             The state is kept per quantity in arrays of                    *
+ *             IQS9320_MODEL_LANES channels and every step is free of         *
+ *             branches, so that processBlock() runs all channels of a frame  *
+ *             in a few vector instructions.                                  *
+ ******************************************************************************/
+
+#ifndef IQS9320_MODEL_H
+#define IQS9320_MODEL_H
+
+#include <stdint.h>
+
+/* Maximum number of channels of one model instance */
+#ifndef IQS9320_MODEL_MAX_CHANNELS
+#define IQS9320_MODEL_MAX_CHANNELS      20
+#endif
+
+/* Channels processed together, the state arrays are padded to this width */
+#define IQS9320_MODEL_LANES             ((IQS9320_MODEL_MAX_CHANNELS + 7) & ~7)
+
+/**
+* @brief  iqs9320 Model Settings, in the units of the init header registers.
+*/
+typedef struct
+{
+        uint8_t activation_threshold;                                   // ACTIVATION_THRESHOLD
+        uint8_t individual_threshold[IQS9320_MODEL_MAX_CHANNELS];       // INDIVIDUAL_THRESHOLDS_n, 0 for the global threshold
+        uint8_t hysteresis;                                             // ACTIVATION_HYSTERESIS_0
+        uint8_t halt_threshold;                                         // REFERENCE_HALT_THRESHOLD
+        uint8_t halt_timeout;                                           // REF_HALT_TIMEOUT_0 in s, 0 never times out
+} iqs9320_model_config_s;
+
+/**
+* @brief  A block of frames for processBlock(), frame n of channel ch is
+*         norm[n * stride + ch].
+*/
+typedef struct
+{
+        uint32_t frames;
+        uint32_t stride;                        // At least the number of channels
+        const uint32_t *time_ms;
+        const uint8_t *norm;
+        uint32_t *activation;                   // Output per frame, may be NULL
+        uint32_t *filter_halt;                  // Output per frame, may be NULL
+} iqs9320_model_block_s;
+
+/**
+* @brief  Agreement of the model with recorded flags, see validate().
+*/
+typedef struct
+{
+        uint32_t frames;
+        uint32_t activation_frames;             // Frames with identical ACTIVATION_FLAGS
+        uint32_t halt_frames;                   // Frames with identical FILTER_HALT_FLAGS
+        uint32_t activation_errors[IQS9320_MODEL_MAX_CHANNELS];
+        uint32_t halt_errors[IQS9320_MODEL_MAX_CHANNELS];
+        int32_t first_mismatch;                 // Frame of the first difference, -1 if none
+} iqs9320_model_validation_s;
+
+// Class Prototype
+class IQS9320Model
+{
+public:
+        // Public Constructors
+        IQS9320Model();
+
+        // Public Methods
+        void begin(uint8_t nChannels, const iqs9320_model_config_s *config);
+        void reset(void);
+        void process(uint32_t timestamp_ms, const uint8_t norm[]);
+        void processBlock(const iqs9320_model_block_s *block);
+        void validate(const iqs9320_model_block_s *block, const uint32_t activation[], const uint32_t filter_halt[],
+                      iqs9320_model_validation_s *result);
+
+        uint32_t getActivation(void) const;
+        uint32_t getFilterHalt(void) const;
+        uint8_t getDelta(uint8_t ch) const;
+
+private:
+        // Private Variables
+        iqs9320_model_config_s _config;
+        uint8_t _nChannels;
+        uint32_t _timeout_ms;
+        uint32_t _used;                                 // Mask of the channels
+        uint32_t _activation;
+        uint32_t _halt;
+
+        /* Per channel state, one array per quantity, 0/1 for the flags */
+        int32_t _on[IQS9320_MODEL_LANES];               // Threshold to activate
+        int32_t _off[IQS9320_MODEL_LANES];              // Release below this value
+        int32_t _reference[IQS9320_MODEL_LANES];        // Re-seeded reference
+        int32_t _delta[IQS9320_MODEL_LANES];
+        int32_t _active[IQS9320_MODEL_LANES];
+        int32_t _halted[IQS9320_MODEL_LANES];
+        uint32_t _halt_start[IQS9320_MODEL_LANES];
+
+        // Private Methods
+        void step(uint32_t timestamp_ms, const uint8_t *__restrict norm);
+        void updateMasks(void);
+};
+
+#endif // IQS9320_MODEL_H
@@ -0,0 +1,985 @@
+/******************************************************************************
+ *                                                                            *
+ *                                Copyright by                                *
+ *                                                                            *
+ *                              Azoteq (Pty) Ltd                              *
+ *                          Republic of South Africa                          *
+ *                                                                            *
+ *                           Tel: +27(0)21 863 0033                           *
+ *                           E-mail: info@azoteq.com                          *
+ *                                                                            *
+ * ========================================================================== *
+ * @file        IQS9320_record.cpp                                            *
+ * @brief       Chunked frame recordings, see IQS9320_record.h.               *
+ * @author      Azoteq PTY Ltd                                                *
+ * @version     v1.5.3                                                        *
+ * @date        2024                                                          *
+ ******************************************************************************/
+
+/* Include Files */
+#include "IQS9320_record.h"
+
+#ifdef IQS9320_RECORD_AVAILABLE
+
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define RECORD_MAGIC_FILE       0x52535149UL    // "IQSR"
+#define RECORD_MAGIC_CHUNK      0x4B535149UL    // "IQSK"
+#define RECORD_MAGIC_END        0x45535149UL    // "IQSE"
+
+/*****************************************************************************/
+/*                                 ENCODING                                  */
+/*****************************************************************************/
+static void put_u32(uint8_t *p, uint32_t value)
+{
+  for(uint8_t i = 0; i < 4; i++)
+  {
+    p[i] = (uint8_t)(value >> (8 * i));
+  }
+}
+
+static void put_u64(uint8_t *p, uint64_t value)
+{
+  for(uint8_t i = 0; i < 8; i++)
+  {
+    p[i] = (uint8_t)(value >> (8 * i));
+  }
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t get_u64(const uint8_t *p)
+{
+  return (uint64_t)get_u32(p) | ((uint64_t)get_u32(p + 4) << 32);
+}
+
+static uint8_t *put_varint(uint8_t *p, uint64_t value)
+{
+  while(value >= 0x80)
+  {
+    *p++ = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+  *p++ = (uint8_t)value;
+  return p;
+}
+
+/* Returns NULL when the varint runs past the end */
+static inline const uint8_t *get_varint(const uint8_t *p, const uint8_t *end, uint64_t *value)
+{
+  uint64_t result = 0;
+  uint8_t shift = 0;
+
+  /* Most values are unchanged channels and small differences */
+  if((p < end) && !(*p & 0x80))
+  {
+    *value = *p;
+    return p + 1;
+  }
+
+  while(p < end && shift < 64)
+  {
+    uint8_t byte = *p++;
+    result |= (uint64_t)(byte & 0x7F) << shift;
+    if(!(byte & 0x80))
+    {
+      *value = result;
+      return p;
+    }
+    shift += 7;
+  }
+  return NULL;
+}
+
+static uint32_t zigzag(int32_t value)
+{
+  return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int32_t unzigzag(uint32_t value)
+{
+  return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+/* FNV-1a over a chunk payload */
+static uint32_t checksum(const uint8_t *data, size_t length)
+{
+  uint32_t hash = 2166136261UL;
+
+  for(size_t i = 0; i < length; i++)
+  {
+    hash = (hash ^ data[i]) * 16777619UL;
+  }
+  return hash;
+}
+
+/* Changed channels as a mask, followed by their differences */
+template <typename T>
+static uint8_t *put_channels(uint8_t *p, const T now[], const T last[], uint8_t nChannels)
+{
+  uint32_t mask = 0;
+
+  for(uint8_t i = 0; i < nChannels; i++)
+  {
+    if(now[i] != last[i])
+    {
+      mask |= 1UL << i;
+    }
+  }
+  p = put_varint(p, mask);
+  for(uint8_t i = 0; i < nChannels; i++)
+  {
+    if(mask & (1UL << i))
+    {
+      p = put_varint(p, zigzag((int32_t)now[i] - (int32_t)last[i]));
+    }
+  }
+  return p;
+}
+
+template <typename T>
+static const uint8_t *get_channels(const uint8_t *p, const uint8_t *end, T now[], uint8_t nChannels)
+{
+  uint64_t mask;
+  uint64_t value;
+
+  if(!(p = get_varint(p, end, &mask)))
+  {
+    return NULL;
+  }
+  if(mask >> nChannels)
+  {
+    return NULL;
+  }
+
+  /* Visit the changed channels only */
+  while(mask)
+  {
+    uint8_t i = (uint8_t)__builtin_ctzll(mask);
+
+    mask &= mask - 1;
+    if(!(p = get_varint(p, end, &value)))
+    {
+      return NULL;
+    }
+    now[i] = (T)((int32_t)now[i] + unzigzag((uint32_t)value));
+  }
+  return p;
+}
+
+static size_t encode_frame(iqs9320_record_state_s *state, const iqs9320_record_frame_s *frame, uint8_t *out)
+{
+  iqs9320_record_frame_s *last = &state->last[frame->slot];
+  uint8_t *p = out;
+  uint8_t *flags;
+
+  p = put_varint(p, frame->timestamp_us - state->last_us);
+  *p++ = frame->slot;
+  flags = p++;
+  *flags = 0;
+
+  if(frame->system_status != last->system_status)
+  {
+    *flags |= IQS9320_RECORD_FLAG_STATUS;
+    p = put_varint(p, frame->system_status);
+  }
+  if(frame->activation != last->activation)
+  {
+    *flags |= IQS9320_RECORD_FLAG_ACTIVATION;
+    p = put_varint(p, frame->activation);
+  }
+  if(frame->filter_halt != last->filter_halt)
+  {
+    *flags |= IQS9320_RECORD_FLAG_HALT;
+    p = put_varint(p, frame->filter_halt);
+  }
+  if(frame->nChannels != last->nChannels)
+  {
+    *flags |= IQS9320_RECORD_FLAG_CHANNELS;
+    *p++ = frame->nChannels;
+  }
+  if(frame->fields & IQS9320_RECORD_DELTA)
+  {
+    *flags |= IQS9320_RECORD_FLAG_DELTA;
+    p = put_channels(p, frame->delta, last->delta, frame->nChannels);
+  }
+  if(frame->fields & IQS9320_RECORD_NORM)
+  {
+    *flags |= IQS9320_RECORD_FLAG_NORM;
+    p = put_channels(p, frame->norm, last->norm, frame->nChannels);
+  }
+  if(frame->fields & IQS9320_RECORD_MOVE)
+  {
+    *flags |= IQS9320_RECORD_FLAG_MOVE;
+    p = put_channels(p, frame->move, last->move, frame->nChannels);
+  }
+
+  /* Fields that are not included keep their reference */
+  last->system_status = frame->system_status;
+  last->activation = frame->activation;
+  last->filter_halt = frame->filter_halt;
+  last->nChannels = frame->nChannels;
+  if(frame->fields & IQS9320_RECORD_DELTA)
+  {
+    memcpy(last->delta, frame->delta, sizeof(last->delta));
+  }
+  if(frame->fields & IQS9320_RECORD_NORM)
+  {
+    memcpy(last->norm, frame->norm, sizeof(last->norm));
+  }
+  if(frame->fields & IQS9320_RECORD_MOVE)
+  {
+    memcpy(last->move, frame->move, sizeof(last->move));
+  }
+  state->last_us = frame->timestamp_us;
+
+  return (size_t)(p - out);
+}
+
+static const uint8_t *decode_frame(iqs9320_record_state_s *state, const uint8_t *p, const uint8_t *end, iqs9320_record_frame_s *frame)
+{
+  iqs9320_record_frame_s *last;
+  uint64_t value;
+  uint8_t flags;
+
+  if(!(p = get_varint(p, end, &value)) || (end - p < 2))
+  {
+    return NULL;
+  }
+  state->last_us += value;
+  last = &state->last[p[0]];
+  flags = p[1];
+  p += 2;
+
+  if(flags & IQS9320_RECORD_FLAG_STATUS)
+  {
+    if(!(p = get_varint(p, end, &value)))
+    {
+      return NULL;
+    }
+    last->system_status = (uint16_t)value;
+  }
+  if(flags & IQS9320_RECORD_FLAG_ACTIVATION)
+  {
+    if(!(p = get_varint(p, end, &value)))
+    {
+      return NULL;
+    }
+    last->activation = (uint32_t)value;
+  }
+  if(flags & IQS9320_RECORD_FLAG_HALT)
+  {
+    if(!(p = get_varint(p, end, &value)))
+    {
+      return NULL;
+    }
+    last->filter_halt = (uint32_t)value;
+  }
+  if(flags & IQS9320_RECORD_FLAG_CHANNELS)
+  {
+    if((p >= end) || (*p > IQS9320_MAX_CHANNELS))
+    {
+      return NULL;
+    }
+    last->nChannels = *p++;
+  }
+  if((flags & IQS9320_RECORD_FLAG_DELTA) && !(p = get_channels(p, end, last->delta, last->nChannels)))
+  {
+    return NULL;
+  }
+  if((flags & IQS9320_RECORD_FLAG_NORM) && !(p = get_channels(p, end, last->norm, last->nChannels)))
+  {
+    return NULL;
+  }
+  if((flags & IQS9320_RECORD_FLAG_MOVE) && !(p = get_channels(p, end, last->move, last->nChannels)))
+  {
+    return NULL;
+  }
+
+  *frame = *last;
+  frame->timestamp_us = state->last_us;
+  frame->slot = (uint8_t)(last - state->last);
+  frame->fields = ((flags & IQS9320_RECORD_FLAG_DELTA) ? IQS9320_RECORD_DELTA : 0)
+                | ((flags & IQS9320_RECORD_FLAG_NORM) ? IQS9320_RECORD_NORM : 0)
+                | ((flags & IQS9320_RECORD_FLAG_MOVE) ? IQS9320_RECORD_MOVE : 0);
+  return p;
+}
+
+static void reset_state(iqs9320_record_state_s *state, uint64_t first_us)
+{
+  memset(state->last, 0, sizeof(state->last));
+  state->last_us = first_us;
+}
+
+/**
+  * @name   iqs9320_record_from_frame
+  * @brief  Fill a recorded frame from one device slot of a decoded frame.
+  * @param  frame     ->  The decoded frame.
+  * @param  slot      ->  Device slot in the frame, also used as the slot of
+  *                       the recorded frame.
+  * @param  nChannels ->  Number of channels to record.
+  * @param  fields    ->  IQS9320_RECORD_DELTA/NORM/MOVE to record.
+  * @param  out       ->  Receives the frame, the timestamp is not changed.
+  * @retval None.
+  */
+void iqs9320_record_from_frame(const iqs9320_frame_s *frame, uint8_t slot, uint8_t nChannels, uint8_t fields, iqs9320_record_frame_s *out)
+{
+  uint16_t base = slot * IQS9320_MAX_CHANNELS;
+
+  if(nChannels > IQS9320_MAX_CHANNELS)
+  {
+    nChannels = IQS9320_MAX_CHANNELS;
+  }
+
+  out->slot          = slot;
+  out->nChannels     = nChannels;
+  out->fields        = fields;
+  out->system_status = frame->system_status[slot];
+  out->activation    = frame->activation[slot];
+  out->filter_halt   = frame->filter_halt[slot];
+
+  memset(out->delta, 0, sizeof(out->delta));
+  memset(out->norm, 0, sizeof(out->norm));
+  memset(out->move, 0, sizeof(out->move));
+  memcpy(out->delta, &frame->delta[base], nChannels * sizeof(int16_t));
+  memcpy(out->norm, &frame->norm[base], nChannels);
+  memcpy(out->move, &frame->move[base], nChannels);
+}
+
+/*****************************************************************************/
+/*                                  WRITER                                   */
+/*****************************************************************************/
+IQS9320RecordWriter::IQS9320RecordWriter()
+{
+  _file = NULL;
+  _chunk_frames = IQS9320_RECORD_CHUNK_FRAMES;
+  _offset = 0;
+  _frames = 0;
+  memset(&_chunk, 0, sizeof(_chunk));
+  _state = NULL;
+}
+
+IQS9320RecordWriter::~IQS9320RecordWriter()
+{
+  close();
+}
+
+/**
+  * @name   open
+  * @brief  A method that creates a recording and writes its header.
+  * @param  path         ->  File to create, an existing file is replaced.
+  * @param  chunk_frames ->  Frames per chunk. Smaller chunks seek faster and
+  *                          lose less on a crash, larger chunks compress
+  *                          slightly better.
+  * @retval Returns false when the file cannot be created.
+  */
+bool IQS9320RecordWriter::open(const char *path, uint32_t chunk_frames)
+{
+  uint8_t header[IQS9320_RECORD_HEADER_SIZE];
+  struct timespec ts;
+
+  close();
+  _file = fopen(path, "wb");
+  if(!_file)
+  {
+    return false;
+  }
+
+  clock_gettime(CLOCK_REALTIME, &ts);
+  memset(header, 0, sizeof(header));
+  put_u32(&header[0], RECORD_MAGIC_FILE);
+  header[4] = IQS9320_RECORD_VERSION;
+  header[6] = IQS9320_RECORD_HEADER_SIZE;
+  put_u32(&header[8], chunk_frames);
+  put_u64(&header[16], (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL);
+  if(fwrite(header, 1, sizeof(header), _file) != sizeof(header))
+  {
+    fclose(_file);
+    _file = NULL;
+    return false;
+  }
+
+  _state = (iqs9320_record_state_s *)malloc(sizeof(iqs9320_record_state_s));
+  _chunk_frames = chunk_frames ? chunk_frames : IQS9320_RECORD_CHUNK_FRAMES;
+  _offset = sizeof(header);
+  _frames = 0;
+  _payload.clear();
+  _payload.reserve(IQS9320_RECORD_CHUNK_BYTES + IQS9320_RECORD_MAX_FRAME);
+  _index.clear();
+  _chunk.frames = 0;
+  return _state != NULL;
+}
+
+/**
+  * @name   write
+  * @brief  A method that appends a frame. Timestamps that go backwards are
+  *         recorded as the previous timestamp, so that the file stays ordered
+  *         by time.
+  * @param  frame ->  The frame to record.
+  * @retval Returns false on a write error.
+  */
+bool IQS9320RecordWriter::write(const iqs9320_record_frame_s *frame)
+{
+  iqs9320_record_frame_s copy;
+  size_t length;
+
+  if(!_file)
+  {
+    return false;
+  }
+
+  copy = *frame;
+  if(copy.nChannels > IQS9320_MAX_CHANNELS)
+  {
+    copy.nChannels = IQS9320_MAX_CHANNELS;
+  }
+
+  if(_chunk.frames == 0)
+  {
+    _chunk.offset = _offset;
+    _chunk.first_us = (_index.empty() || (copy.timestamp_us > _index.back().last_us)) ? copy.timestamp_us : _index.back().last_us;
+    reset_state(_state, _chunk.first_us);
+  }
+  if(copy.timestamp_us < _state->last_us)
+  {
+    copy.timestamp_us = _state->last_us;
+  }
+
+  length = _payload.size();
+  _payload.resize(length + IQS9320_RECORD_MAX_FRAME);
+  length += encode_frame(_state, &copy, &_payload[length]);
+  _payload.resize(length);
+
+  _chunk.last_us = copy.timestamp_us;
+  _chunk.frames++;
+  _frames++;
+
+  if((_chunk.frames >= _chunk_frames) || (_payload.size() >= IQS9320_RECORD_CHUNK_BYTES))
+  {
+    return flush();
+  }
+  return true;
+}
+
+/**
+  * @name   flush
+  * @brief  A method that writes the current chunk to the file, even when it
+  *         is not full. Called automatically when a chunk is full.
+  * @param  None.
+  * @retval Returns false on a write error.
+  */
+bool IQS9320RecordWriter::flush(void)
+{
+  uint8_t header[IQS9320_RECORD_CHUNK_HEADER];
+
+  if(!_file)
+  {
+    return false;
+  }
+  if(_chunk.frames == 0)
+  {
+    return true;
+  }
+
+  put_u32(&header[0], RECORD_MAGIC_CHUNK);
+  put_u32(&header[4], (uint32_t)_payload.size());
+  put_u32(&header[8], _chunk.frames);
+  put_u32(&header[12], checksum(_payload.data(), _payload.size()));
+  put_u64(&header[16], _chunk.first_us);
+  put_u64(&header[24], _chunk.last_us);
+
+  if((fwrite(header, 1, sizeof(header), _file) != sizeof(header))
+     || (fwrite(_payload.data(), 1, _payload.size(), _file) != _payload.size())
+     || (fflush(_file) != 0))
+  {
+    return false;
+  }
+
+  _offset += sizeof(header) + _payload.size();
+  _index.push_back(_chunk);
+  _payload.clear();
+  _chunk.frames = 0;
+  return true;
+}
+
+/**
+  * @name   close
+  * @brief  A method that writes the last chunk and the chunk index and
+  *         closes the file.
+  * @param  None.
+  * @retval Returns false on a write error.
+  */
+bool IQS9320RecordWriter::close(void)
+{
+  uint8_t entry[IQS9320_RECORD_INDEX_ENTRY];
+  uint8_t trailer[IQS9320_RECORD_TRAILER_SIZE];
+  bool ok;
+
+  if(!_file)
+  {
+    return true;
+  }
+
+  ok = flush();
+  for(size_t i = 0; ok && (i < _index.size()); i++)
+  {
+    memset(entry, 0, sizeof(entry));
+    put_u64(&entry[0], _index[i].offset);
+    put_u64(&entry[8], _index[i].first_us);
+    put_u64(&entry[16], _index[i].last_us);
+    put_u32(&entry[24], _index[i].frames);
+    ok = (fwrite(entry, 1, sizeof(entry), _file) == sizeof(entry));
+  }
+  put_u64(&trailer[0], _offset);
+  put_u32(&trailer[8], (uint32_t)_index.size());
+  put_u32(&trailer[12], RECORD_MAGIC_END);
+  ok = ok && (fwrite(trailer, 1, sizeof(trailer), _file) == sizeof(trailer));
+
+  ok = (fclose(_file) == 0) && ok;
+  _file = NULL;
+  free(_state);
+  _state = NULL;
+  return ok;
+}
+
+/**
+  * @name   frames
+  * @brief  A method that returns the number of frames written.
+  * @param  None.
+  * @retval Frames since open().
+  */
+uint64_t IQS9320RecordWriter::frames(void) const
+{
+  return _frames;
+}
+
+/**
+  * @name   bytes
+  * @brief  A method that returns the size of the complete chunks written.
+  * @param  None.
+  * @retval File size without the chunk being filled and the index.
+  */
+uint64_t IQS9320RecordWriter::bytes(void) const
+{
+  return _offset;
+}
+
+/*****************************************************************************/
+/*                                  READER                                   */
+/*****************************************************************************/
+IQS9320RecordReader::IQS9320RecordReader()
+{
+  _map = NULL;
+  _size = 0;
+  _recovered = false;
+  _errors = 0;
+  _chunk = 0;
+  _pos = NULL;
+  _end = NULL;
+  _remaining = 0;
+  _state = NULL;
+  _has_pending = false;
+}
+
+IQS9320RecordReader::~IQS9320RecordReader()
+{
+  close();
+}
+
+/**
+  * @name   open
+  * @brief  A method that maps a recording and loads its chunk index. The
+  *         index is rebuilt from the chunk headers when the recording was
+  *         not closed.
+  * @param  path ->  The recording.
+  * @retval Returns false when the file is not a recording.
+  */
+bool IQS9320RecordReader::open(const char *path)
+{
+  struct stat st;
+  void *map;
+  int fd;
+
+  close();
+  fd = ::open(path, O_RDONLY);
+  if(fd < 0)
+  {
+    return false;
+  }
+  if((fstat(fd, &st) != 0) || ((size_t)st.st_size < IQS9320_RECORD_HEADER_SIZE))
+  {
+    ::close(fd);
+    return false;
+  }
+  map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if(map == MAP_FAILED)
+  {
+    return false;
+  }
+
+  _map = (const uint8_t *)map;
+  _size = (size_t)st.st_size;
+  if((get_u32(&_map[0]) != RECORD_MAGIC_FILE) || (_map[4] != IQS9320_RECORD_VERSION))
+  {
+    close();
+    return false;
+  }
+  madvise(map, _size, MADV_SEQUENTIAL);
+
+  _state = (iqs9320_record_state_s *)malloc(sizeof(iqs9320_record_state_s));
+  if(!_state)
+  {
+    close();
+    return false;
+  }
+
+  _errors = 0;
+  _recovered = !loadIndex();
+  if(_recovered)
+  {
+    scanChunks();
+  }
+  rewind();
+  return true;
+}
+
+/**
+  * @name   close
+  * @brief  A method that unmaps the recording.
+  * @param  None.
+  * @retval None.
+  */
+void IQS9320RecordReader::close(void)
+{
+  if(_map)
+  {
+    munmap((void *)_map, _size);
+    _map = NULL;
+  }
+  free(_state);
+  _state = NULL;
+  _index.clear();
+  _remaining = 0;
+}
+
+/* Index written by IQS9320RecordWriter::close() */
+bool IQS9320RecordReader::loadIndex(void)
+{
+  const uint8_t *trailer;
+  uint64_t offset;
+  uint32_t count;
+
+  if(_size < IQS9320_RECORD_HEADER_SIZE + IQS9320_RECORD_TRAILER_SIZE)
+  {
+    return false;
+  }
+  trailer = &_map[_size - IQS9320_RECORD_TRAILER_SIZE];
+  offset = get_u64(&trailer[0]);
+  count = get_u32(&trailer[8]);
+  if((get_u32(&trailer[12]) != RECORD_MAGIC_END)
+     || (offset + (uint64_t)count * IQS9320_RECORD_INDEX_ENTRY + IQS9320_RECORD_TRAILER_SIZE != _size))
+  {
+    return false;
+  }
+
+  _index.resize(count);
+  for(uint32_t i = 0; i < count; i++)
+  {
+    const uint8_t *entry = &_map[offset + (uint64_t)i * IQS9320_RECORD_INDEX_ENTRY];
+
+    _index[i].offset = get_u64(&entry[0]);
+    _index[i].first_us = get_u64(&entry[8]);
+    _index[i].last_us = get_u64(&entry[16]);
+    _index[i].frames = get_u32(&entry[24]);
+    if(_index[i].offset + IQS9320_RECORD_CHUNK_HEADER > offset)
+    {
+      _index.clear();
+      return false;
+    }
+  }
+  return true;
+}
+
+/* Walk the chunk headers up to the first incomplete chunk */
+void IQS9320RecordReader::scanChunks(void)
+{
+  uint64_t offset = IQS9320_RECORD_HEADER_SIZE;
+  iqs9320_record_chunk_s chunk;
+
+  _index.clear();
+  while(offset + IQS9320_RECORD_CHUNK_HEADER <= _size)
+  {
+    const uint8_t *header = &_map[offset];
+    uint32_t length = get_u32(&header[4]);
+
+    if((get_u32(&header[0]) != RECORD_MAGIC_CHUNK) || (offset + IQS9320_RECORD_CHUNK_HEADER + length > _size))
+    {
+      break;
+    }
+    chunk.offset = offset;
+    chunk.frames = get_u32(&header[8]);
+    chunk.first_us = get_u64(&header[16]);
+    chunk.last_us = get_u64(&header[24]);
+    _index.push_back(chunk);
+    offset += IQS9320_RECORD_CHUNK_HEADER + length;
+  }
+}
+
+bool IQS9320RecordReader::enterChunk(uint32_t index)
+{
+  const uint8_t *header;
+
+  _chunk = index;
+  _remaining = 0;
+  _has_pending = false;
+  if(index >= _index.size())
+  {
+    return false;
+  }
+
+  header = &_map[_index[index].offset];
+  _pos = header + IQS9320_RECORD_CHUNK_HEADER;
+  _end = _pos + get_u32(&header[4]);
+  if((get_u32(&header[0]) != RECORD_MAGIC_CHUNK) || (_end > _map + _size))
+  {
+    _errors++;
+    return false;
+  }
+  _remaining = get_u32(&header[8]);
+  reset_state(_state, get_u64(&header[16]));
+  return true;
+}
+
+/**
+  * @name   rewind
+  * @brief  A method that moves to the first frame.
+  * @param  None.
+  * @retval None.
+  */
+void IQS9320RecordReader::rewind(void)
+{
+  if(_map)
+  {
+    enterChunk(0);
+  }
+}
+
+/**
+  * @name   seek
+  * @brief  A method that moves to the first frame at or after a time. The
+  *         chunk is found with a binary search over the index, the frames
+  *         before the time in that chunk are decoded and skipped.
+  * @param  timestamp_us ->  Time to move to.
+  * @retval Returns false when all frames are older.
+  */
+bool IQS9320RecordReader::seek(uint64_t timestamp_us)
+{
+  uint32_t low = 0;
+  uint32_t high = (uint32_t)_index.size();
+
+  if(!_map)
+  {
+    return false;
+  }
+
+  /* First chunk whose last frame is not older than the time */
+  while(low < high)
+  {
+    uint32_t mid = low + (high - low) / 2;
+
+    if(_index[mid].last_us < timestamp_us)
+    {
+      low = mid + 1;
+    }
+    else
+    {
+      high = mid;
+    }
+  }
+  if(!enterChunk(low))
+  {
+    return false;
+  }
+
+  /* Keep the first frame that is not older, next() returns it first */
+  while(next(&_pending))
+  {
+    if(_pending.timestamp_us >= timestamp_us)
+    {
+      _has_pending = true;
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+  * @name   next
+  * @brief  A method that decodes the next frame.
+  * @param  frame ->  Receives the frame.
+  * @retval Returns false at the end of the recording. Chunks that cannot be
+  *         decoded are skipped and counted in errors().
+  */
+bool IQS9320RecordReader::next(iqs9320_record_frame_s *frame)
+{
+  const uint8_t *pos;
+
+  if(_has_pending)
+  {
+    *frame = _pending;
+    _has_pending = false;
+    return true;
+  }
+  if(!_map)
+  {
+    return false;
+  }
+
+  /* A chunk that cannot be entered leaves _remaining at 0 and is skipped */
+  while(_remaining == 0)
+  {
+    if(_chunk + 1 >= _index.size())
+    {
+      return false;
+    }
+    enterChunk(_chunk + 1);
+  }
+
+  pos = decode_frame(_state, _pos, _end, frame);
+  if(!pos)
+  {
+    /* Corrupt payload, continue with the next chunk */
+    _errors++;
+    _remaining = 0;
+    return next(frame);
+  }
+  _pos = pos;
+  _remaining--;
+  return true;
+}
+
+/**
+  * @name   verify
+  * @brief  A method that checks the checksum of a chunk.
+  * @param  chunk ->  Index of the chunk.
+  * @retval Returns true when the payload matches its checksum.
+  */
+bool IQS9320RecordReader::verify(uint32_t chunk) const
+{
+  const uint8_t *header;
+
+  if(!_map || (chunk >= _index.size()))
+  {
+    return false;
+  }
+  header = &_map[_index[chunk].offset];
+  return checksum(header + IQS9320_RECORD_CHUNK_HEADER, get_u32(&header[4])) == get_u32(&header[12]);
+}
+
+/**
+  * @name   chunks
+  * @brief  A method that returns the number of chunks.
+  * @param  None.
+  * @retval Complete chunks in the recording.
+  */
+uint32_t IQS9320RecordReader::chunks(void) const
+{
+  return (uint32_t)_index.size();
+}
+
+/**
+  * @name   chunk
+  * @brief  A method that returns the location and time span of a chunk.
+  * @param  index ->  Index of the chunk.
+  * @retval The chunk, or NULL when there is no such chunk.
+  */
+const iqs9320_record_chunk_s *IQS9320RecordReader::chunk(uint32_t index) const
+{
+  return (index < _index.size()) ? &_index[index] : NULL;
+}
+
+/**
+  * @name   frames
+  * @brief  A method that returns the number of frames, from the index.
+  * @param  None.
+  * @retval Frames in all complete chunks.
+  */
+uint64_t IQS9320RecordReader::frames(void) const
+{
+  uint64_t total = 0;
+
+  for(size_t i = 0; i < _index.size(); i++)
+  {
+    total += _index[i].frames;
+  }
+  return total;
+}
+
+/**
+  * @name   firstTimestamp
+  * @brief  A method that returns the time of the first frame.
+  * @param  None.
+  * @retval Timestamp in us, 0 for an empty recording.
+  */
+uint64_t IQS9320RecordReader::firstTimestamp(void) const
+{
+  return _index.empty() ? 0 : _index.front().first_us;
+}
+
+/**
+  * @name   lastTimestamp
+  * @brief  A method that returns the time of the last frame.
+  * @param  None.
+  * @retval Timestamp in us, 0 for an empty recording.
+  */
+uint64_t IQS9320RecordReader::lastTimestamp(void) const
+{
+  return _index.empty() ? 0 : _index.back().last_us;
+}
+
+/**
+  * @name   size
+  * @brief  A method that returns the size of the mapped file.
+  * @param  None.
+  * @retval File size in bytes.
+  */
+uint64_t IQS9320RecordReader::size(void) const
+{
+  return _size;
+}
+
+/**
+  * @name   recovered
+  * @brief  A method that reports if the index was rebuilt because the
+  *         recording was not closed.
+  * @param  None.
+  * @retval Returns true when the index was rebuilt from the chunk headers.
+  */
+bool IQS9320RecordReader::recovered(void) const
+{
+  return _recovered;
+}
+
+/**
+  * @name   errors
+  * @brief  A method that returns the number of chunks that could not be
+  *         decoded.
+  * @param  None.
+  * @retval Decoding errors since open().
+  */
+uint32_t IQS9320RecordReader::errors(void) const
+{
+  return _errors;
+}
+
+#endif // IQS9320_RECORD_AVAILABLE
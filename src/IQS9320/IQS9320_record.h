@@ -0,0 +1,214 @@
+/******************************************************************************
+ *                                                                            *
+ *                                Copyright by                                *
+ *                                                                            *
+ *                              Azoteq (Pty) Ltd                              *
+ *                          Republic of South Africa                          *
+ *                                                                            *
+ *                           Tel: +27(0)21 863 0033                           *
+ *                           E-mail: info@azoteq.com                          *
+ *                                                                            *
+ * ========================================================================== *
+ * @file        IQS9320_record.h                                              *
+ * @brief       Compact on-disk recording of frames for long delta captures.  *
+ *              Frames are written in self-contained chunks: every field is   *
+ *              stored as the change from the previous frame of the same      *
+ *              device, as zigzag varints, and channels that did not change   *
+ *              cost one bit. An index of the chunks is appended when the     *
+ *              recording is closed; the reader maps the file and seeks by    *
+ *              time with a binary search over the chunks.                    *
+ * @author      Azoteq PTY Ltd                                                *
+ * @version     v1.5.3                                                        *
+ * @date        2024                                                          *
+ * ========================================================================== *
+ * @attention  Host builds with POSIX mmap only, Arduino builds skip this     *
+ *             module. A recording that was not closed, e.g. after a crash,   *
+ *             is still readable up to its last complete chunk.               *
+ *                                                                            *
+ *             File layout, all values little-endian:                         *
+ *               header   "IQSR", version, header size, chunk frames,         *
+ *                        creation time                        (32 bytes)     *
+ *               chunk    "IQSK", payload size, frames, checksum, first and   *
+ *                        last timestamp (32 bytes), then the payload         *
+ *               ...                                                          *
+ *               index    per chunk: offset, first and last timestamp,        *
+ *                        frames                               (32 bytes)     *
+ *               trailer  index offset, chunks, "IQSE"         (16 bytes)     *
+ *                                                                            *
+ *             Frame in a chunk payload:                                      *
+ *               varint   time since the previous frame of the chunk, us      *
+ *               u8       slot                                                *
+ *               u8       flags (IQS9320_RECORD_FLAG_*)                       *
+ *               varint   status, activation, halt        (if changed)        *
+ *               u8       nChannels                       (if changed)        *
+ *               per included array (delta, norm, move):                      *
+ *                 varint mask of the channels that changed, then one zigzag  *
+ *                 varint difference per changed channel                      *
+ ******************************************************************************/
+
+#ifndef IQS9320_RECORD_H
+#define IQS9320_RECORD_H
+
+#if defined(__unix__) || defined(__APPLE__)
+#define IQS9320_RECORD_AVAILABLE
+#endif
+
+#ifdef IQS9320_RECORD_AVAILABLE
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <vector>
+#include "IQS9320_frame.h"
+
+/* Default number of frames per chunk, the unit of seeking and recovery */
+#define IQS9320_RECORD_CHUNK_FRAMES     4096
+
+/* Largest chunk payload, a chunk is closed early when it is reached */
+#define IQS9320_RECORD_CHUNK_BYTES      (256UL * 1024UL)
+
+/* Devices that can be told apart in a recording */
+#define IQS9320_RECORD_SLOTS            256
+
+#define IQS9320_RECORD_VERSION          1
+#define IQS9320_RECORD_HEADER_SIZE      32
+#define IQS9320_RECORD_CHUNK_HEADER     32
+#define IQS9320_RECORD_INDEX_ENTRY      32
+#define IQS9320_RECORD_TRAILER_SIZE     16
+
+/* Fields present in a frame */
+#define IQS9320_RECORD_DELTA            0x01
+#define IQS9320_RECORD_NORM             0x02
+#define IQS9320_RECORD_MOVE             0x04
+
+/* Flags of an encoded frame */
+#define IQS9320_RECORD_FLAG_STATUS      0x01
+#define IQS9320_RECORD_FLAG_ACTIVATION  0x02
+#define IQS9320_RECORD_FLAG_HALT        0x04
+#define IQS9320_RECORD_FLAG_DELTA       0x08
+#define IQS9320_RECORD_FLAG_NORM        0x10
+#define IQS9320_RECORD_FLAG_MOVE        0x20
+#define IQS9320_RECORD_FLAG_CHANNELS    0x40
+
+/* Longest encoded frame */
+#define IQS9320_RECORD_MAX_FRAME        (10 + 2 + 3 + 5 + 5 + 1 + 3 * (3 + 3 * IQS9320_MAX_CHANNELS))
+
+/**
+* @brief  One recorded frame of one device.
+*/
+typedef struct
+{
+        uint64_t timestamp_us;
+        uint8_t  slot;
+        uint8_t  nChannels;
+        uint8_t  fields;                        // IQS9320_RECORD_DELTA/NORM/MOVE
+        uint16_t system_status;
+        uint32_t activation;
+        uint32_t filter_halt;
+        int16_t  delta[IQS9320_MAX_CHANNELS];
+        uint8_t  norm[IQS9320_MAX_CHANNELS];
+        uint8_t  move[IQS9320_MAX_CHANNELS];
+} iqs9320_record_frame_s;
+
+/**
+* @brief  Location and time span of one chunk.
+*/
+typedef struct
+{
+        uint64_t offset;                        // Chunk header in the file
+        uint64_t first_us;
+        uint64_t last_us;
+        uint32_t frames;
+} iqs9320_record_chunk_s;
+
+/**
+* @brief  Previous frame of every slot, the reference of the differences.
+*         Cleared at the start of every chunk.
+*/
+typedef struct
+{
+        iqs9320_record_frame_s last[IQS9320_RECORD_SLOTS];
+        uint64_t last_us;
+} iqs9320_record_state_s;
+
+void iqs9320_record_from_frame(const iqs9320_frame_s *frame, uint8_t slot, uint8_t nChannels, uint8_t fields, iqs9320_record_frame_s *out);
+
+// Class Prototypes
+class IQS9320RecordWriter
+{
+public:
+        // Public Constructors
+        IQS9320RecordWriter();
+        ~IQS9320RecordWriter();
+
+        // Public Methods
+        bool open(const char *path, uint32_t chunk_frames = IQS9320_RECORD_CHUNK_FRAMES);
+        bool write(const iqs9320_record_frame_s *frame);
+        bool flush(void);
+        bool close(void);
+
+        uint64_t frames(void) const;
+        uint64_t bytes(void) const;
+
+private:
+        // Private Variables
+        FILE *_file;
+        uint32_t _chunk_frames;
+        uint64_t _offset;
+        uint64_t _frames;
+        std::vector<uint8_t> _payload;
+        std::vector<iqs9320_record_chunk_s> _index;
+        iqs9320_record_chunk_s _chunk;
+        iqs9320_record_state_s *_state;
+};
+
+class IQS9320RecordReader
+{
+public:
+        // Public Constructors
+        IQS9320RecordReader();
+        ~IQS9320RecordReader();
+
+        // Public Methods
+        bool open(const char *path);
+        void close(void);
+
+        void rewind(void);
+        bool seek(uint64_t timestamp_us);
+        bool next(iqs9320_record_frame_s *frame);
+        bool verify(uint32_t chunk) const;
+
+        uint32_t chunks(void) const;
+        const iqs9320_record_chunk_s *chunk(uint32_t index) const;
+        uint64_t frames(void) const;
+        uint64_t firstTimestamp(void) const;
+        uint64_t lastTimestamp(void) const;
+        uint64_t size(void) const;
+        bool recovered(void) const;
+        uint32_t errors(void) const;
+
+private:
+        // Private Variables
+        const uint8_t *_map;
+        size_t _size;
+        std::vector<iqs9320_record_chunk_s> _index;
+        bool _recovered;
+        uint32_t _errors;
+
+        uint32_t _chunk;                        // Chunk being decoded
+        const uint8_t *_pos;
+        const uint8_t *_end;
+        uint32_t _remaining;                    // Frames left in the chunk
+        iqs9320_record_state_s *_state;
+        iqs9320_record_frame_s _pending;        // Frame found by seek()
+        bool _has_pending;
+
+        // Private Methods
+        bool loadIndex(void);
+        void scanChunks(void);
+        bool enterChunk(uint32_t index);
+};
+
+#endif // IQS9320_RECORD_AVAILABLE
+
+#endif // IQS9320_RECORD_H
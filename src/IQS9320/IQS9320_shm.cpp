@@ -0,0 +1,515 @@
+/******************************************************************************
+ *                                                                            *
+ *                                Copyright by                                *
+ *                                                                            *
+ *                              Azoteq (Pty) Ltd                              *
+ *                          Republic of South Africa                          *
+ *                                                                            *
+ *                           Tel: +27(0)21 863 0033                           *
+ *                           E-mail: info@azoteq.com                          *
+ *                                                                            *
+ * ========================================================================== *
+ * @file        IQS9320_shm.cpp                                               *
+ * @brief       Shared-memory frame ring, see IQS9320_shm.h.                  *
+ * @author      Azoteq PTY Ltd                                                *
+ * @version     v1.5.3                                                        *
+ * @date        2024                                                          *
+ ******************************************************************************/
+
+/* Include Files */
+#include "IQS9320_shm.h"
+
+#ifdef IQS9320_SHM_AVAILABLE
+
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+static size_t shm_size(uint32_t slots)
+{
+  return sizeof(iqs9320_shm_header_s) + (size_t)slots * sizeof(iqs9320_shm_slot_s);
+}
+
+/*****************************************************************************/
+/*                                  FRAMES                                   */
+/*****************************************************************************/
+
+/**
+  * @name   iqs9320_shm_from_frame
+  * @brief  Fill a ring frame from one device slot of a decoded frame.
+  * @param  frame     ->  The decoded frame.
+  * @param  slot      ->  Device slot in the frame.
+  * @param  nChannels ->  Number of channels to copy.
+  * @param  out       ->  Receives the frame, the sequence number and timestamp
+  *                       are not changed.
+  * @retval None.
+  */
+void iqs9320_shm_from_frame(const iqs9320_frame_s *frame, uint8_t slot, uint8_t nChannels, iqs9320_shm_frame_s *out)
+{
+  uint16_t base = slot * IQS9320_MAX_CHANNELS;
+
+  if(nChannels > IQS9320_MAX_CHANNELS)
+  {
+    nChannels = IQS9320_MAX_CHANNELS;
+  }
+
+  out->system_status = frame->system_status[slot];
+  out->slot          = slot;
+  out->nChannels     = nChannels;
+  out->activation    = frame->activation[slot];
+  out->filter_halt   = frame->filter_halt[slot];
+  out->reserved      = 0;
+
+  memset(out->delta, 0, sizeof(out->delta));
+  memset(out->norm, 0, sizeof(out->norm));
+  memset(out->move, 0, sizeof(out->move));
+  memcpy(out->delta, &frame->delta[base], nChannels * sizeof(int16_t));
+  memcpy(out->norm, &frame->norm[base], nChannels);
+  memcpy(out->move, &frame->move[base], nChannels);
+}
+
+/*****************************************************************************/
+/*                                  WRITER                                   */
+/*****************************************************************************/
+IQS9320ShmWriter::IQS9320ShmWriter()
+{
+  _name[0] = '\0';
+  _header = NULL;
+  _slots = NULL;
+  _size = 0;
+  _next = 0;
+}
+
+IQS9320ShmWriter::~IQS9320ShmWriter()
+{
+  close();
+}
+
+/**
+  * @name   create
+  * @brief  A method that creates, or recreates, the shared-memory ring.
+  *         Readers that still map a previous ring of the same name keep it
+  *         until they open the name again.
+  * @param  name  ->  Object name, starting with '/'.
+  * @param  slots ->  Number of frames held by the ring, a power of two.
+  * @retval Returns false when the object cannot be created or mapped.
+  */
+bool IQS9320ShmWriter::create(const char *name, uint32_t slots)
+{
+  int fd;
+  void *map;
+
+  if((slots == 0) || ((slots & (slots - 1)) != 0))
+  {
+    return false;
+  }
+
+  close();
+  shm_unlink(name);
+  fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+  if(fd < 0)
+  {
+    return false;
+  }
+
+  _size = shm_size(slots);
+  if(ftruncate(fd, (off_t)_size) != 0)
+  {
+    ::close(fd);
+    shm_unlink(name);
+    return false;
+  }
+  map = mmap(NULL, _size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if(map == MAP_FAILED)
+  {
+    shm_unlink(name);
+    return false;
+  }
+
+  snprintf(_name, sizeof(_name), "%s", name);
+  _header = (iqs9320_shm_header_s *)map;
+  _slots = (iqs9320_shm_slot_s *)((uint8_t *)map + sizeof(iqs9320_shm_header_s));
+  _next = 0;
+
+  /* The object is zero-filled by ftruncate(), the magic is written last so
+  that readers never see a partly set up header */
+  _header->version = IQS9320_SHM_VERSION;
+  _header->slot_size = sizeof(iqs9320_shm_slot_s);
+  _header->slots = slots;
+  __atomic_store_n(&_header->magic, (uint32_t)IQS9320_SHM_MAGIC, __ATOMIC_RELEASE);
+
+  return true;
+}
+
+/**
+  * @name   close
+  * @brief  A method that unmaps and removes the ring. Mapped readers keep
+  *         their mapping.
+  * @param  None.
+  * @retval None.
+  */
+void IQS9320ShmWriter::close(void)
+{
+  if(_header)
+  {
+    munmap(_header, _size);
+    shm_unlink(_name);
+    _header = NULL;
+    _slots = NULL;
+  }
+}
+
+/**
+  * @name   publish
+  * @brief  A method that writes a frame into the next slot and wakes the
+  *         readers blocked in wait(). The cost does not depend on the number
+  *         of readers: a store per slot word and, only when a reader is
+  *         blocked, one futex wake.
+  * @param  frame ->  The frame, the sequence number is set by the ring.
+  * @retval None.
+  */
+void IQS9320ShmWriter::publish(const iqs9320_shm_frame_s *frame)
+{
+  iqs9320_shm_slot_s *slot;
+  uint64_t sequence = _next++;
+
+  if(!_header)
+  {
+    return;
+  }
+
+  slot = &_slots[sequence & (_header->slots - 1)];
+
+  /* Odd version while the slot is written, readers discard what they copy */
+  __atomic_store_n(&slot->version, 2 * sequence + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  slot->frame = *frame;
+  slot->frame.sequence = sequence;
+  __atomic_store_n(&slot->version, 2 * sequence + 2, __ATOMIC_RELEASE);
+
+  __atomic_store_n(&_header->published, sequence + 1, __ATOMIC_RELEASE);
+  __atomic_fetch_add(&_header->futex, 1, __ATOMIC_RELEASE);
+  if(__atomic_load_n(&_header->waiters, __ATOMIC_SEQ_CST) != 0)
+  {
+    syscall(SYS_futex, &_header->futex, FUTEX_WAKE, INT32_MAX, NULL, NULL, 0);
+  }
+}
+
+/**
+  * @name   publish
+  * @brief  A method that publishes one device slot of a decoded frame.
+  * @param  frame        ->  The decoded frame.
+  * @param  slot         ->  Device slot in the frame.
+  * @param  nChannels    ->  Number of channels to copy.
+  * @param  timestamp_us ->  Sample time of the frame.
+  * @retval None.
+  */
+void IQS9320ShmWriter::publish(const iqs9320_frame_s *frame, uint8_t slot, uint8_t nChannels, uint64_t timestamp_us)
+{
+  iqs9320_shm_frame_s out;
+
+  iqs9320_shm_from_frame(frame, slot, nChannels, &out);
+  out.timestamp_us = timestamp_us;
+  publish(&out);
+}
+
+/**
+  * @name   published
+  * @brief  A method that returns the number of frames written.
+  * @param  None.
+  * @retval Frames written since create().
+  */
+uint64_t IQS9320ShmWriter::published(void) const
+{
+  return _next;
+}
+
+/*****************************************************************************/
+/*                                  READER                                   */
+/*****************************************************************************/
+IQS9320ShmReader::IQS9320ShmReader()
+{
+  _header = NULL;
+  _slots = NULL;
+  _size = 0;
+  _next = 0;
+  _lost = 0;
+  _peeked = 0;
+}
+
+IQS9320ShmReader::~IQS9320ShmReader()
+{
+  close();
+}
+
+/**
+  * @name   open
+  * @brief  A method that maps the ring of a writer. Reading starts with the
+  *         next frame that is published.
+  * @param  name ->  Object name used by the writer.
+  * @retval Returns false when the ring does not exist or is not compatible.
+  */
+bool IQS9320ShmReader::open(const char *name)
+{
+  struct stat st;
+  iqs9320_shm_header_s *header;
+  int fd;
+  void *map;
+
+  close();
+  fd = shm_open(name, O_RDWR, 0);
+  if(fd < 0)
+  {
+    return false;
+  }
+  if((fstat(fd, &st) != 0) || ((size_t)st.st_size < sizeof(iqs9320_shm_header_s)))
+  {
+    ::close(fd);
+    return false;
+  }
+
+  map = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if(map == MAP_FAILED)
+  {
+    return false;
+  }
+
+  header = (iqs9320_shm_header_s *)map;
+  if((__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != IQS9320_SHM_MAGIC)
+     || (header->version != IQS9320_SHM_VERSION)
+     || (header->slot_size != sizeof(iqs9320_shm_slot_s))
+     || (header->slots == 0) || ((header->slots & (header->slots - 1)) != 0)
+     || ((size_t)st.st_size < shm_size(header->slots)))
+  {
+    munmap(map, (size_t)st.st_size);
+    return false;
+  }
+
+  _header = header;
+  _slots = (iqs9320_shm_slot_s *)((uint8_t *)map + sizeof(iqs9320_shm_header_s));
+  _size = (size_t)st.st_size;
+  _lost = 0;
+  seekLatest();
+  return true;
+}
+
+/**
+  * @name   close
+  * @brief  A method that unmaps the ring.
+  * @param  None.
+  * @retval None.
+  */
+void IQS9320ShmReader::close(void)
+{
+  if(_header)
+  {
+    munmap(_header, _size);
+    _header = NULL;
+    _slots = NULL;
+  }
+}
+
+/**
+  * @name   locate
+  * @brief  A method that finds the slot of the next frame. Frames that were
+  *         overwritten before they were read are skipped and counted.
+  * @param  None.
+  * @retval The slot, or NULL when no frame is available.
+  */
+const iqs9320_shm_slot_s *IQS9320ShmReader::locate(void)
+{
+  const iqs9320_shm_slot_s *slot;
+  uint64_t published;
+  uint64_t version;
+
+  if(!_header)
+  {
+    return NULL;
+  }
+
+  for(;;)
+  {
+    published = __atomic_load_n(&_header->published, __ATOMIC_ACQUIRE);
+    if(_next >= published)
+    {
+      return NULL;
+    }
+    if(published - _next > _header->slots)
+    {
+      _lost += published - _header->slots - _next;
+      _next = published - _header->slots;
+    }
+
+    slot = &_slots[_next & (_header->slots - 1)];
+    version = __atomic_load_n(&slot->version, __ATOMIC_ACQUIRE);
+    if(version == 2 * _next + 2)
+    {
+      _peeked = version;
+      return slot;
+    }
+
+    /* Overwritten since published was read */
+    _lost++;
+    _next++;
+  }
+}
+
+/**
+  * @name   read
+  * @brief  A method that copies the next frame out of the ring.
+  * @param  frame ->  Receives the frame.
+  * @retval Returns false when no frame is available.
+  */
+bool IQS9320ShmReader::read(iqs9320_shm_frame_s *frame)
+{
+  const iqs9320_shm_slot_s *slot;
+
+  while((slot = locate()) != NULL)
+  {
+    memcpy(frame, (const void *)&slot->frame, sizeof(*frame));
+    if(consume())
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+  * @name   peek
+  * @brief  A method that returns the next frame in place, without copying it.
+  *         The writer can overwrite the slot at any time, so the fields read
+  *         are only valid if consume() returns true afterwards.
+  * @param  None.
+  * @retval The frame in the ring, or NULL when no frame is available.
+  */
+const iqs9320_shm_frame_s *IQS9320ShmReader::peek(void)
+{
+  const iqs9320_shm_slot_s *slot = locate();
+
+  return slot ? &slot->frame : NULL;
+}
+
+/**
+  * @name   consume
+  * @brief  A method that moves past the frame returned by peek() and checks
+  *         that the writer did not touch it in the meantime.
+  * @param  None.
+  * @retval Returns true when the data read from the frame is valid, false
+  *         when it was overwritten and has to be discarded.
+  */
+bool IQS9320ShmReader::consume(void)
+{
+  const iqs9320_shm_slot_s *slot;
+  bool valid;
+
+  if(!_header || (_peeked == 0))
+  {
+    return false;
+  }
+
+  slot = &_slots[_next & (_header->slots - 1)];
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  valid = (__atomic_load_n(&slot->version, __ATOMIC_RELAXED) == _peeked);
+  if(!valid)
+  {
+    _lost++;
+  }
+  _peeked = 0;
+  _next++;
+  return valid;
+}
+
+/**
+  * @name   wait
+  * @brief  A method that blocks until a frame is available.
+  * @param  timeout_ms ->  Longest wait, 0 to wait without a time limit.
+  * @retval Returns true when a frame is available.
+  */
+bool IQS9320ShmReader::wait(uint32_t timeout_ms)
+{
+  struct timespec ts;
+  uint32_t futex;
+
+  if(!_header)
+  {
+    return false;
+  }
+
+  ts.tv_sec = timeout_ms / 1000;
+  ts.tv_nsec = (long)(timeout_ms % 1000) * 1000000L;
+
+  /* Read the futex word before checking for frames, a publish in between
+  changes it and the wait returns at once */
+  futex = __atomic_load_n(&_header->futex, __ATOMIC_ACQUIRE);
+  if(available())
+  {
+    return true;
+  }
+
+  __atomic_fetch_add(&_header->waiters, 1, __ATOMIC_SEQ_CST);
+  if(__atomic_load_n(&_header->futex, __ATOMIC_SEQ_CST) == futex)
+  {
+    syscall(SYS_futex, &_header->futex, FUTEX_WAIT, futex, timeout_ms ? &ts : NULL, NULL, 0);
+  }
+  __atomic_fetch_sub(&_header->waiters, 1, __ATOMIC_SEQ_CST);
+
+  return available() != 0;
+}
+
+/**
+  * @name   seekLatest
+  * @brief  A method that skips all frames published so far.
+  * @param  None.
+  * @retval None.
+  */
+void IQS9320ShmReader::seekLatest(void)
+{
+  if(_header)
+  {
+    _next = __atomic_load_n(&_header->published, __ATOMIC_ACQUIRE);
+  }
+  _peeked = 0;
+}
+
+/**
+  * @name   available
+  * @brief  A method that returns the number of frames not read yet,
+  *         including frames that will be lost.
+  * @param  None.
+  * @retval Published frames after the read position.
+  */
+uint64_t IQS9320ShmReader::available(void) const
+{
+  uint64_t published;
+
+  if(!_header)
+  {
+    return 0;
+  }
+  published = __atomic_load_n(&_header->published, __ATOMIC_ACQUIRE);
+  return (published > _next) ? (published - _next) : 0;
+}
+
+/**
+  * @name   lost
+  * @brief  A method that returns the number of frames overwritten before
+  *         this reader got to them.
+  * @param  None.
+  * @retval Lost frames since open().
+  */
+uint64_t IQS9320ShmReader::lost(void) const
+{
+  return _lost;
+}
+
+#endif // IQS9320_SHM_AVAILABLE
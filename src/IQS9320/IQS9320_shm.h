@@ -0,0 +1,155 @@
+/******************************************************************************
+ *                                                                            *
+ *                                Copyright by                                *
+ *                                                                            *
+ *                              Azoteq (Pty) Ltd                              *
+ *                          Republic of South Africa                          *
+ *                                                                            *
+ *                           Tel: +27(0)21 863 0033                           *
+ *                           E-mail: info@azoteq.com                          *
+ *                                                                            *
+ * ========================================================================== *
+ * @file        IQS9320_shm.h                                                 *
+ * @brief       Publication of decoded frames in a POSIX shared-memory ring.  *
+ *              One writer fills versioned slots, any number of reader        *
+ *              processes map the ring and consume the frames in place,       *
+ *              without system calls. Readers that want to block wait on a    *
+ *              futex in the ring header.                                     *
+ * @author      Azoteq PTY Ltd                                                *
+ * @version     v1.5.3                                                        *
+ * @date        2024                                                          *
+ * ========================================================================== *
+ * @attention  Linux only, e.g. HMI or gateway builds. Arduino builds skip    *
+ *             this module. The writer never waits for the readers: a reader  *
+ *             that falls more than a ring behind loses the oldest frames and *
+ *             counts them in lost().                                         *
+ ******************************************************************************/
+
+#ifndef IQS9320_SHM_H
+#define IQS9320_SHM_H
+
+#if defined(__linux__)
+#define IQS9320_SHM_AVAILABLE
+#endif
+
+#ifdef IQS9320_SHM_AVAILABLE
+
+#include <stdint.h>
+#include <stddef.h>
+#include "IQS9320_frame.h"
+
+/* Default object name, see shm_open() */
+#define IQS9320_SHM_NAME                "/iqs9320"
+
+/* Default number of slots, a power of two */
+#define IQS9320_SHM_SLOTS               1024
+
+#define IQS9320_SHM_MAGIC               0x48535149UL    // "IQSH"
+#define IQS9320_SHM_VERSION             1
+
+/**
+* @brief  One published frame of one device.
+*/
+typedef struct
+{
+        uint64_t sequence;                      // Frame number in the ring, from 0
+        uint64_t timestamp_us;                  // Sample time given by the writer
+        uint16_t system_status;
+        uint8_t  slot;                          // Device, as chosen by the writer
+        uint8_t  nChannels;                     // Valid entries in the arrays below
+        uint32_t activation;
+        uint32_t filter_halt;
+        uint32_t reserved;
+        int16_t  delta[IQS9320_MAX_CHANNELS];
+        uint8_t  norm[IQS9320_MAX_CHANNELS];
+        uint8_t  move[IQS9320_MAX_CHANNELS];
+} iqs9320_shm_frame_s;
+
+/**
+* @brief  Ring slot. The version is odd while the writer fills the slot and
+*         2 * (sequence + 1) once frame n = sequence is complete.
+*/
+typedef struct alignas(64)
+{
+        uint64_t version;
+        iqs9320_shm_frame_s frame;
+} iqs9320_shm_slot_s;
+
+/**
+* @brief  Ring header, followed by the slots. The counters the writer and
+*         the readers update live on their own cache lines.
+*/
+typedef struct
+{
+        uint32_t magic;
+        uint16_t version;
+        uint16_t slot_size;
+        uint32_t slots;
+        uint32_t reserved;
+        alignas(64) uint64_t published;         // Frames written
+        alignas(64) uint32_t futex;             // Incremented on every publish
+        uint32_t waiters;                       // Readers blocked in wait()
+} iqs9320_shm_header_s;
+
+void iqs9320_shm_from_frame(const iqs9320_frame_s *frame, uint8_t slot, uint8_t nChannels, iqs9320_shm_frame_s *out);
+
+// Class Prototypes
+class IQS9320ShmWriter
+{
+public:
+        // Public Constructors
+        IQS9320ShmWriter();
+        ~IQS9320ShmWriter();
+
+        // Public Methods
+        bool create(const char *name = IQS9320_SHM_NAME, uint32_t slots = IQS9320_SHM_SLOTS);
+        void close(void);
+        void publish(const iqs9320_shm_frame_s *frame);
+        void publish(const iqs9320_frame_s *frame, uint8_t slot, uint8_t nChannels, uint64_t timestamp_us);
+        uint64_t published(void) const;
+
+private:
+        // Private Variables
+        char _name[64];
+        iqs9320_shm_header_s *_header;
+        iqs9320_shm_slot_s *_slots;
+        size_t _size;
+        uint64_t _next;
+};
+
+class IQS9320ShmReader
+{
+public:
+        // Public Constructors
+        IQS9320ShmReader();
+        ~IQS9320ShmReader();
+
+        // Public Methods
+        bool open(const char *name = IQS9320_SHM_NAME);
+        void close(void);
+
+        bool read(iqs9320_shm_frame_s *frame);
+        const iqs9320_shm_frame_s *peek(void);
+        bool consume(void);
+        bool wait(uint32_t timeout_ms);
+
+        void seekLatest(void);
+        uint64_t available(void) const;
+        uint64_t lost(void) const;
+
+private:
+        // Private Variables
+        iqs9320_shm_header_s *_header;
+        iqs9320_shm_slot_s *_slots;
+        size_t _size;
+        uint64_t _next;
+        uint64_t _lost;
+        uint64_t _peeked;                       // Version seen by peek(), 0 if none
+
+        // Private Methods
+        const iqs9320_shm_slot_s *locate(void);
+};
+
+#endif // IQS9320_SHM_AVAILABLE
+
+#endif // IQS9320_SHM_H
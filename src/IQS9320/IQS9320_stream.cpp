@@ -0,0 +1,408 @@
+/******************************************************************************
+ *                                                                            *
+ *                                Copyright by                                *
+ *                                                                            *
+ *                              Azoteq (Pty) Ltd                              *
+ *                          Republic of South Africa                          *
+ *                                                                            *
+ *                           Tel: +27(0)21 863 0033                           *
+ *                           E-mail: info@azoteq.com                          *
+ *                                                                            *
+ * ========================================================================== *
+ * @file        IQS9320_stream.cpp                                            *
+ * @brief       This file contains the encoder and decoder of the IQS9320     *
+ *              binary streaming protocol. See IQS9320_stream.h for the       *
+ *              packet layout.                                                *
+ * @author      Azoteq PTY Ltd                                                *
+ * @version     v1.5.3                                                        *
+ * @date        2024                                                          *
+ *****************************************************************************/
+
+/* Include Files */
+#include "IQS9320_stream.h"
+
+/*****************************************************************************/
+/*                           PACKET ENCODING                                 */
+/*****************************************************************************/
+
+/**
+  * @name   iqs9320_stream_crc16
+  * @brief  CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF).
+  * @param  data   ->  Bytes to include in the CRC.
+  * @param  length ->  Number of bytes.
+  * @retval uint16_t -> The CRC value.
+  * @note   Computed bit-wise to avoid a 512 byte table on small targets.
+  */
+uint16_t iqs9320_stream_crc16(const uint8_t data[], size_t length)
+{
+  uint16_t crc = 0xFFFF;
+
+  for(size_t i = 0; i < length; i++)
+  {
+    crc ^= (uint16_t)data[i] << 8;
+    for(uint8_t b = 0; b < 8; b++)
+    {
+      crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+  }
+
+  return crc;
+}
+
+/**
+  * @name   iqs9320_stream_encode
+  * @brief  Serialise a packet, add the CRC and frame it with COBS.
+  * @param  packet ->  The packet to encode.
+  * @param  out    ->  Output buffer of at least IQS9320_STREAM_MAX_PACKET bytes.
+  * @retval size_t -> Number of bytes to transmit, including both delimiters.
+  */
+size_t iqs9320_stream_encode(const iqs9320_stream_packet_s *packet, uint8_t out[])
+{
+  uint8_t payload[IQS9320_STREAM_MAX_PAYLOAD];
+  size_t n = 0;
+
+  payload[n++] = packet->type;
+  payload[n++] = packet->seq;
+  payload[n++] = packet->slot;
+  payload[n++] = (uint8_t)(packet->system_status);
+  payload[n++] = (uint8_t)(packet->system_status >> 8);
+  payload[n++] = (uint8_t)(packet->activation);
+  payload[n++] = (uint8_t)(packet->activation >> 8);
+  payload[n++] = (uint8_t)(packet->activation >> 16);
+  payload[n++] = (uint8_t)(packet->filter_halt);
+  payload[n++] = (uint8_t)(packet->filter_halt >> 8);
+  payload[n++] = (uint8_t)(packet->filter_halt >> 16);
+
+  if(packet->type == IQS9320_STREAM_TYPE_DELTA)
+  {
+    uint8_t nDeltas = packet->nDeltas;
+    if(nDeltas > IQS9320_MAX_CHANNELS)
+    {
+      nDeltas = IQS9320_MAX_CHANNELS;
+    }
+
+    payload[n++] = nDeltas;
+    for(uint8_t i = 0; i < nDeltas; i++)
+    {
+      payload[n++] = (uint8_t)(packet->delta[i]);
+      payload[n++] = (uint8_t)((uint16_t)packet->delta[i] >> 8);
+    }
+  }
+
+  return iqs9320_stream_frame(payload, n, out);
+}
+
+/**
+  * @name   iqs9320_stream_encode_raw
+  * @brief  Frame an arbitrary block of data, e.g. a trace record, as a packet
+  *         of the given type.
+  * @param  type   ->  Packet type, IQS9320_STREAM_TYPE_TRACE for trace records.
+  * @param  data   ->  Bytes to send, at most IQS9320_STREAM_MAX_PAYLOAD - 3.
+  * @param  length ->  Number of bytes.
+  * @param  out    ->  Output buffer of at least IQS9320_STREAM_MAX_PACKET bytes.
+  * @retval size_t -> Number of bytes to transmit, 0 if the data is too long.
+  */
+size_t iqs9320_stream_encode_raw(uint8_t type, const uint8_t data[], size_t length, uint8_t out[])
+{
+  uint8_t payload[IQS9320_STREAM_MAX_PAYLOAD];
+
+  if(length + 1 + IQS9320_STREAM_CRC_SIZE > IQS9320_STREAM_MAX_PAYLOAD)
+  {
+    return 0;
+  }
+
+  payload[0] = type;
+  for(size_t i = 0; i < length; i++)
+  {
+    payload[1 + i] = data[i];
+  }
+
+  return iqs9320_stream_frame(payload, length + 1, out);
+}
+
+/**
+  * @name   iqs9320_stream_frame
+  * @brief  Append the CRC to a payload and frame it with COBS.
+  * @param  payload ->  Payload buffer with room for the 2 CRC bytes.
+  * @param  length  ->  Number of payload bytes.
+  * @param  out     ->  Output buffer of at least IQS9320_STREAM_MAX_PACKET bytes.
+  * @retval size_t -> Number of bytes to transmit, including both delimiters.
+  */
+size_t iqs9320_stream_frame(uint8_t payload[], size_t length, uint8_t out[])
+{
+  uint16_t crc = iqs9320_stream_crc16(payload, length);
+  payload[length++] = (uint8_t)(crc);
+  payload[length++] = (uint8_t)(crc >> 8);
+
+  /* A leading delimiter flushes any partial data on the receiving side */
+  size_t n = 0;
+  out[n++] = 0x00;
+  n += iqs9320_cobs_encode(payload, length, &out[n]);
+  out[n++] = 0x00;
+
+  return n;
+}
+
+/**
+  * @name   iqs9320_stream_decode
+  * @brief  Decode one COBS frame, verify its CRC and parse the packet.
+  * @param  in     ->  Frame bytes between two delimiters.
+  * @param  length ->  Number of frame bytes.
+  * @param  packet ->  Receives the decoded packet.
+  * @retval bool -> true if a valid STATUS or DELTA packet was decoded.
+  */
+bool iqs9320_stream_decode(const uint8_t in[], size_t length, iqs9320_stream_packet_s *packet)
+{
+  uint8_t payload[IQS9320_STREAM_MAX_PACKET];
+
+  size_t n = iqs9320_stream_unframe(in, length, payload);
+  return (n > 0) && iqs9320_stream_parse(payload, n, packet);
+}
+
+/**
+  * @name   iqs9320_stream_unframe
+  * @brief  Decode one COBS frame and verify its CRC.
+  * @param  in      ->  Frame bytes between two delimiters.
+  * @param  length  ->  Number of frame bytes.
+  * @param  payload ->  Receives the payload, at least length bytes.
+  * @retval size_t -> Payload length without the CRC, 0 if the frame is invalid.
+  */
+size_t iqs9320_stream_unframe(const uint8_t in[], size_t length, uint8_t payload[])
+{
+  if(length > IQS9320_STREAM_MAX_PACKET)
+  {
+    return 0;
+  }
+
+  size_t n = iqs9320_cobs_decode(in, length, payload);
+  if(n < 1 + IQS9320_STREAM_CRC_SIZE)
+  {
+    return 0;
+  }
+
+  uint16_t crc = (uint16_t)payload[n - 2] | ((uint16_t)payload[n - 1] << 8);
+  n -= IQS9320_STREAM_CRC_SIZE;
+  if(crc != iqs9320_stream_crc16(payload, n))
+  {
+    return 0;
+  }
+
+  return n;
+}
+
+/**
+  * @name   iqs9320_stream_parse
+  * @brief  Parse the payload of a STATUS or DELTA packet.
+  * @param  payload ->  Payload without CRC.
+  * @param  n       ->  Payload length.
+  * @param  packet  ->  Receives the packet.
+  * @retval bool -> true if the payload is a well formed STATUS or DELTA packet.
+  */
+bool iqs9320_stream_parse(const uint8_t payload[], size_t n, iqs9320_stream_packet_s *packet)
+{
+  if(n < IQS9320_STREAM_HEADER_SIZE)
+  {
+    return false;
+  }
+
+  packet->type          = payload[0];
+  packet->seq           = payload[1];
+  packet->slot          = payload[2];
+  packet->system_status = (uint16_t)payload[3] | ((uint16_t)payload[4] << 8);
+  packet->activation    = (uint32_t)payload[5] | ((uint32_t)payload[6] << 8) | ((uint32_t)payload[7] << 16);
+  packet->filter_halt   = (uint32_t)payload[8] | ((uint32_t)payload[9] << 8) | ((uint32_t)payload[10] << 16);
+  packet->nDeltas       = 0;
+
+  if(packet->type == IQS9320_STREAM_TYPE_DELTA)
+  {
+    if(n < IQS9320_STREAM_HEADER_SIZE + 1)
+    {
+      return false;
+    }
+
+    uint8_t nDeltas = payload[IQS9320_STREAM_HEADER_SIZE];
+    if((nDeltas > IQS9320_MAX_CHANNELS) || (n != (size_t)IQS9320_STREAM_HEADER_SIZE + 1 + 2*nDeltas))
+    {
+      return false;
+    }
+
+    const uint8_t *d = &payload[IQS9320_STREAM_HEADER_SIZE + 1];
+    for(uint8_t i = 0; i < nDeltas; i++)
+    {
+      packet->delta[i] = (int16_t)((uint16_t)d[2*i] | ((uint16_t)d[2*i + 1] << 8));
+    }
+    packet->nDeltas = nDeltas;
+    return true;
+  }
+
+  return (packet->type == IQS9320_STREAM_TYPE_STATUS) && (n == IQS9320_STREAM_HEADER_SIZE);
+}
+
+/**
+  * @name   iqs9320_stream_from_frame
+  * @brief  Fill a packet from one device slot of a decoded frame.
+  * @param  frame   ->  The decoded frame.
+  * @param  slot    ->  Device slot in the frame.
+  * @param  nDeltas ->  Number of channel deltas to include, 0 for a STATUS
+  *                     packet.
+  * @param  packet  ->  Receives the packet, the sequence number is not changed.
+  * @retval None.
+  */
+void iqs9320_stream_from_frame(const iqs9320_frame_s *frame, uint8_t slot, uint8_t nDeltas, iqs9320_stream_packet_s *packet)
+{
+  packet->type          = nDeltas ? IQS9320_STREAM_TYPE_DELTA : IQS9320_STREAM_TYPE_STATUS;
+  packet->slot          = slot;
+  packet->system_status = frame->system_status[slot];
+  packet->activation    = frame->activation[slot];
+  packet->filter_halt   = frame->filter_halt[slot];
+  packet->nDeltas       = nDeltas;
+
+  for(uint8_t i = 0; i < nDeltas && i < IQS9320_MAX_CHANNELS; i++)
+  {
+    packet->delta[i] = frame->delta[slot * IQS9320_MAX_CHANNELS + i];
+  }
+}
+
+/*****************************************************************************/
+/*                             COBS FRAMING                                  */
+/*****************************************************************************/
+
+/**
+  * @name   iqs9320_cobs_encode
+  * @brief  Consistent Overhead Byte Stuffing, removes all 0x00 bytes.
+  * @param  in     ->  Data to encode.
+  * @param  length ->  Number of bytes to encode.
+  * @param  out    ->  Output buffer of at least length + length/254 + 1 bytes.
+  * @retval size_t -> Number of encoded bytes, excluding delimiters.
+  */
+size_t iqs9320_cobs_encode(const uint8_t in[], size_t length, uint8_t out[])
+{
+  size_t write = 1;
+  size_t code_idx = 0;
+  uint8_t code = 1;
+
+  for(size_t read = 0; read < length; read++)
+  {
+    if(in[read] == 0x00)
+    {
+      out[code_idx] = code;
+      code = 1;
+      code_idx = write++;
+    }
+    else
+    {
+      out[write++] = in[read];
+      if(++code == 0xFF)
+      {
+        out[code_idx] = code;
+        code = 1;
+        code_idx = write++;
+      }
+    }
+  }
+  out[code_idx] = code;
+
+  return write;
+}
+
+/**
+  * @name   iqs9320_cobs_decode
+  * @brief  Reverse of iqs9320_cobs_encode.
+  * @param  in     ->  Encoded bytes, excluding delimiters.
+  * @param  length ->  Number of encoded bytes.
+  * @param  out    ->  Output buffer of at least length bytes.
+  * @retval size_t -> Number of decoded bytes, 0 if the input is malformed.
+  */
+size_t iqs9320_cobs_decode(const uint8_t in[], size_t length, uint8_t out[])
+{
+  size_t read = 0;
+  size_t write = 0;
+
+  while(read < length)
+  {
+    uint8_t code = in[read];
+    if((code == 0x00) || (read + code > length))
+    {
+      return 0;
+    }
+    read++;
+
+    for(uint8_t i = 1; i < code; i++)
+    {
+      out[write++] = in[read++];
+    }
+
+    if((code != 0xFF) && (read != length))
+    {
+      out[write++] = 0x00;
+    }
+  }
+
+  return write;
+}
+
+/*****************************************************************************/
+/*                             STREAM READER                                 */
+/*****************************************************************************/
+IQS9320StreamReader::IQS9320StreamReader()
+{
+  packets_ok = 0;
+  packets_bad = 0;
+  payload_length = 0;
+  _length = 0;
+  _overflow = false;
+}
+
+/**
+  * @name   feed
+  * @brief  A method that passes one received byte to the stream reader.
+  * @param  byte ->  The received byte.
+  * @retval bool -> true when a valid packet was completed. STATUS and DELTA
+  *                 packets are available in the packet member, for TRACE
+  *                 packets packet.type is set and the record follows the
+  *                 type byte in payload.
+  * @note   Anything that is not a valid packet, e.g. text printed during
+  *         start-up, is discarded and counted in packets_bad.
+  */
+bool IQS9320StreamReader::feed(uint8_t byte)
+{
+  if(byte != 0x00)
+  {
+    if(_length < sizeof(_buffer))
+    {
+      _buffer[_length++] = byte;
+    }
+    else
+    {
+      _overflow = true;
+    }
+    return false;
+  }
+
+  /* Delimiter, ignore empty frames between back to back delimiters */
+  bool ok = false;
+  if(_length > 0)
+  {
+    payload_length = _overflow ? 0 : iqs9320_stream_unframe(_buffer, _length, payload);
+    if(payload_length > 0)
+    {
+      /* Other packet types are left in payload for the caller */
+      packet.type = payload[0];
+      ok = (packet.type == IQS9320_STREAM_TYPE_TRACE)
+        || iqs9320_stream_parse(payload, payload_length, &packet);
+    }
+
+    if(ok)
+    {
+      packets_ok++;
+    }
+    else
+    {
+      packets_bad++;
+    }
+  }
+
+  _length = 0;
+  _overflow = false;
+  return ok;
+}
@@ -0,0 +1,114 @@
+/******************************************************************************
+ *                                                                            *
+ *                                Copyright by                                *
+ *                                                                            *
+ *                              Azoteq (Pty) Ltd                              *
+ *                          Republic of South Africa                          *
+ *                                                                            *
+ *                           Tel: +27(0)21 863 0033                           *
+ *                           E-mail: info@azoteq.com                          *
+ *                                                                            *
+ * ========================================================================== *
+ * @file        IQS9320_stream.h                                              *
+ * @brief       Compact binary streaming protocol for IQS9320 frames. Each    *
+ *              packet carries the system status, activation and filter halt  *
+ *              masks and optionally the channel deltas, protected by a       *
+ *              CRC-16 and framed with COBS so that 0x00 only appears as the  *
+ *              packet delimiter.                                             *
+ * @author      Azoteq PTY Ltd                                                *
+ * @version     v1.5.3                                                        *
+ * @date        2024                                                          *
+ * ========================================================================== *
+ * @attention  Only depends on <stdint.h> so that the host decoder in         *
+ *             tools/iqs9320-stream shares the same code.                     *
+ *                                                                            *
+ *             Packet payload (before COBS, little-endian):                   *
+ *               [0]      Packet type (IQS9320_STREAM_TYPE_*)                 *
+ *               [1]      Sequence number                                     *
+ *               [2]      Device slot                                         *
+ *               [3..4]   System status                                       *
+ *               [5..7]   Activation flags, bit n = channel n                 *
+ *               [8..10]  Filter halt flags, bit n = channel n                *
+ *               [11]     Number of deltas N (DELTA packets only)             *
+ *               [12..]   N x int16 channel deltas (DELTA packets only)       *
+ *               [last 2] CRC-16/CCITT-FALSE over all previous bytes          *
+ *             TRACE packets carry the type byte, one trace record (see       *
+ *             IQS9320_trace.h) and the CRC.                                  *
+ *             On the wire: 0x00, COBS(payload), 0x00                         *
+ ******************************************************************************/
+
+#ifndef IQS9320_STREAM_H
+#define IQS9320_STREAM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "IQS9320_frame.h"
+#include "IQS9320_trace.h"
+
+/* Packet types */
+#define IQS9320_STREAM_TYPE_STATUS      0x01
+#define IQS9320_STREAM_TYPE_DELTA       0x02
+#define IQS9320_STREAM_TYPE_TRACE       0x03  // Type byte followed by one trace record
+
+/* Sizes */
+#define IQS9320_STREAM_HEADER_SIZE      11
+#define IQS9320_STREAM_CRC_SIZE         2
+/* Largest payload including CRC: DELTA packet 54 bytes, TRACE packet 62 bytes */
+#define IQS9320_STREAM_MAX_PAYLOAD      (1 + IQS9320_TRACE_MAX_RECORD + IQS9320_STREAM_CRC_SIZE)
+/* COBS adds one byte per 254 bytes, plus the two delimiters */
+#define IQS9320_STREAM_MAX_PACKET       (IQS9320_STREAM_MAX_PAYLOAD + 1 + 2)
+
+/**
+* @brief  iqs9320 Stream Packet.
+*/
+typedef struct
+{
+        uint8_t  type;
+        uint8_t  seq;
+        uint8_t  slot;
+        uint16_t system_status;
+        uint32_t activation;
+        uint32_t filter_halt;
+        uint8_t  nDeltas;
+        int16_t  delta[IQS9320_MAX_CHANNELS];
+} iqs9320_stream_packet_s;
+
+/* Packet encoding and decoding */
+uint16_t iqs9320_stream_crc16(const uint8_t data[], size_t length);
+size_t iqs9320_stream_encode(const iqs9320_stream_packet_s *packet, uint8_t out[]);
+size_t iqs9320_stream_encode_raw(uint8_t type, const uint8_t data[], size_t length, uint8_t out[]);
+size_t iqs9320_stream_frame(uint8_t payload[], size_t length, uint8_t out[]);
+bool iqs9320_stream_decode(const uint8_t in[], size_t length, iqs9320_stream_packet_s *packet);
+size_t iqs9320_stream_unframe(const uint8_t in[], size_t length, uint8_t payload[]);
+bool iqs9320_stream_parse(const uint8_t payload[], size_t n, iqs9320_stream_packet_s *packet);
+void iqs9320_stream_from_frame(const iqs9320_frame_s *frame, uint8_t slot, uint8_t nDeltas, iqs9320_stream_packet_s *packet);
+
+/* COBS framing */
+size_t iqs9320_cobs_encode(const uint8_t in[], size_t length, uint8_t out[]);
+size_t iqs9320_cobs_decode(const uint8_t in[], size_t length, uint8_t out[]);
+
+// Class Prototype
+class IQS9320StreamReader
+{
+public:
+        // Public Constructors
+        IQS9320StreamReader();
+
+        // Public Variables
+        iqs9320_stream_packet_s packet;
+        uint32_t packets_ok;
+        uint32_t packets_bad;
+        uint8_t payload[IQS9320_STREAM_MAX_PACKET];
+        size_t payload_length;
+
+        // Public Methods
+        bool feed(uint8_t byte);
+
+private:
+        // Private Variables
+        uint8_t _buffer[IQS9320_STREAM_MAX_PACKET];
+        size_t _length;
+        bool _overflow;
+};
+
+#endif // IQS9320_STREAM_H
@@ -0,0 +1,120 @@
+/******************************************************************************
+ *                                                                            *
+ *                                Copyright by                                *
+ *                                                                            *
+ *                              Azoteq (Pty) Ltd                              *
+ *                          Republic of South Africa                          *
+ *                                                                            *
+ *                           Tel: +27(0)21 863 0033                           *
+ *                           E-mail: info@azoteq.com                          *
+ *                                                                            *
+ * ========================================================================== *
+ * @file        IQS9320_trace.cpp                                             *
+ * @brief       This file contains the encoder and decoder of the I2C trace   *
+ *              records. See IQS9320_trace.h for the record layout.           *
+ * @author      Azoteq PTY Ltd                                                *
+ * @version     v1.5.3                                                        *
+ * @date        2024                                                          *
+ *****************************************************************************/
+
+/* Include Files */
+#include "IQS9320_trace.h"
+
+/**
+  * @name   iqs9320_trace_encode
+  * @brief  Serialise one trace record.
+  * @param  record   ->  The record to encode.
+  * @param  previous ->  Timestamp of the previous record, only the difference
+  *                      is stored.
+  * @param  out      ->  Output buffer of at least IQS9320_TRACE_MAX_RECORD bytes.
+  * @retval size_t -> Number of bytes written.
+  */
+size_t iqs9320_trace_encode(const iqs9320_trace_record_s *record, uint32_t previous, uint8_t out[])
+{
+  size_t n = 0;
+  uint8_t length = record->length;
+  uint8_t flags = record->flags;
+
+  if(length > IQS9320_TRACE_MAX_DATA)
+  {
+    length = IQS9320_TRACE_MAX_DATA;
+  }
+
+  out[n++] = flags;
+  out[n++] = record->device;
+  out[n++] = (uint8_t)(record->reg);
+  out[n++] = (uint8_t)(record->reg >> 8);
+  out[n++] = record->requested;
+  out[n++] = length;
+
+  /* Time difference as an unsigned LEB128 varint, 1 byte up to 127 us */
+  uint32_t dt = record->timestamp - previous;
+  do
+  {
+    uint8_t byte = dt & 0x7F;
+    dt >>= 7;
+    out[n++] = dt ? (byte | 0x80) : byte;
+  } while(dt);
+
+  for(uint8_t i = 0; i < length; i++)
+  {
+    out[n++] = record->data[i];
+  }
+
+  return n;
+}
+
+/**
+  * @name   iqs9320_trace_decode
+  * @brief  Parse one trace record.
+  * @param  in       ->  Encoded bytes.
+  * @param  length   ->  Number of bytes available.
+  * @param  previous ->  Timestamp of the previous record.
+  * @param  record   ->  Receives the record, data points into the input.
+  * @retval size_t -> Number of bytes consumed, 0 if the input is incomplete
+  *                   or malformed.
+  */
+size_t iqs9320_trace_decode(const uint8_t in[], size_t length, uint32_t previous, iqs9320_trace_record_s *record)
+{
+  size_t n = 6;
+
+  if(length < n + 1)
+  {
+    return 0;
+  }
+
+  record->flags     = in[0];
+  record->device    = in[1];
+  record->reg       = (uint16_t)in[2] | ((uint16_t)in[3] << 8);
+  record->requested = in[4];
+  record->length    = in[5];
+
+  if((record->length > IQS9320_TRACE_MAX_DATA) || ((record->flags & IQS9320_TRACE_OP_MASK) == 0))
+  {
+    return 0;
+  }
+
+  uint32_t dt = 0;
+  uint8_t shift = 0;
+  uint8_t byte;
+  do
+  {
+    if((n >= length) || (shift > 28))
+    {
+      return 0;
+    }
+    byte = in[n++];
+    dt |= (uint32_t)(byte & 0x7F) << shift;
+    shift += 7;
+  } while(byte & 0x80);
+
+  if(n + record->length > length)
+  {
+    return 0;
+  }
+
+  record->timestamp = previous + dt;
+  record->data = &in[n];
+
+  return n + record->length;
+}
@@ -0,0 +1,82 @@
+/******************************************************************************
+ *                                                                            *
+ *                                Copyright by                                *
+ *                                                                            *
+ *                              Azoteq (Pty) Ltd                              *
+ *                          Republic of South Africa                          *
+ *                                                                            *
+ *                           Tel: +27(0)21 863 0033                           *
+ *                           E-mail: info@azoteq.com                          *
+ *                                                                            *
+ * ========================================================================== *
+ * @file        IQS9320_trace.h                                               *
+ * @brief       Compact binary trace of the I2C transactions made by the      *
+ *              IQS9320 driver. Records are captured on the target through    *
+ *              IQS9320::setCaptureCallback() and replayed on a PC with       *
+ *              tools/iqs9320-replay.                                         *
+ * @author      Azoteq PTY Ltd                                                *
+ * @version     v1.5.3                                                        *
+ * @date        2024                                                          *
+ * ========================================================================== *
+ * @attention  Only depends on <stdint.h> so that host tools can share it.    *
+ *                                                                            *
+ *             Record layout:                                                 *
+ *               [0]      Flags, IQS9320_TRACE_* bits                         *
+ *               [1]      I2C device address                                  *
+ *               [2..3]   Register address, little-endian                     *
+ *               [4]      Requested number of bytes                           *
+ *               [5]      Transferred number of bytes N                       *
+ *               [6..]    Time since previous record in us, LEB128 varint     *
+ *               [..]     N data bytes                                        *
+ *             A trace file starts with IQS9320_TRACE_MAGIC followed by       *
+ *             records back to back.                                          *
+ ******************************************************************************/
+
+#ifndef IQS9320_TRACE_H
+#define IQS9320_TRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Record flags */
+#define IQS9320_TRACE_READ              0x01
+#define IQS9320_TRACE_WRITE             0x02
+#define IQS9320_TRACE_OP_MASK           0x03
+#define IQS9320_TRACE_STOP              0x10  // Transfer ended with STOP
+#define IQS9320_TRACE_NACK              0x20  // endTransmission() reported an error
+#define IQS9320_TRACE_SHORT             0x40  // Fewer bytes than requested
+
+/* Longest data block stored in one record, longer transfers are truncated.
+Covers the longest read of the driver, the settings verification burst of
+IQS9320_VERIFY_BUFFER bytes, so that start-up traces replay */
+#ifndef IQS9320_TRACE_MAX_DATA
+#define IQS9320_TRACE_MAX_DATA          128
+#endif
+#define IQS9320_TRACE_MAX_RECORD        (6 + 5 + IQS9320_TRACE_MAX_DATA)
+
+/* File header, "IQTR" followed by the format version */
+#define IQS9320_TRACE_MAGIC             "IQTR\x01"
+#define IQS9320_TRACE_MAGIC_SIZE        5
+
+/**
+* @brief  iqs9320 Trace Record.
+*/
+typedef struct
+{
+        uint8_t  flags;
+        uint8_t  device;
+        uint16_t reg;
+        uint8_t  requested;
+        uint8_t  length;
+        uint32_t timestamp;             // micros() at the end of the transfer
+        const uint8_t *data;
+} iqs9320_trace_record_s;
+
+/* Called by the driver after every transaction */
+typedef void (*iqs9320_capture_cb)(const iqs9320_trace_record_s *record);
+
+/* Record encoding and decoding */
+size_t iqs9320_trace_encode(const iqs9320_trace_record_s *record, uint32_t previous, uint8_t out[]);
+size_t iqs9320_trace_decode(const uint8_t in[], size_t length, uint32_t previous, iqs9320_trace_record_s *record);
+
+#endif // IQS9320_TRACE_H
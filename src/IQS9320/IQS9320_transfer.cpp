@@ -0,0 +1,619 @@
+/******************************************************************************
+ *                                                                            *
+ *                                Copyright by                                *
+ *                                                                            *
+ *                              Azoteq (Pty) Ltd                              *
+ *                          Republic of South Africa                          *
+ *                                                                            *
+ *                           Tel: +27(0)21 863 0033                           *
+ *                           E-mail: info@azoteq.com                          *
+ *                                                                            *
+ * ========================================================================== *
+ * @file        IQS9320_transfer.cpp                                          *
+ * @brief       This file contains the queued I2C transfer engine and the     *
+ *              default Wire port used by the IQS9320 driver.                 *
+ * @author      Azoteq PTY Ltd                                                *
+ * @version     v1.5.3                                                        *
+ * @date        2024                                                          *
+ *****************************************************************************/
+
+/* Include Files */
+#include "Arduino.h"
+#include "Wire.h"
+#include "IQS9320_transfer.h"
+#include <string.h>
+
+/* Bytes the Wire library can buffer in one transaction. Jobs are split into
+chunks of this size, a write chunk also carries the 2 register address bytes */
+#ifndef IQS9320_WIRE_BUFFER_LENGTH
+#if defined(I2C_BUFFER_LENGTH)
+#define IQS9320_WIRE_BUFFER_LENGTH      I2C_BUFFER_LENGTH       // ESP32, 128
+#elif defined(ARDUINO_ARCH_SAMD)
+#define IQS9320_WIRE_BUFFER_LENGTH      256                     // SAMD, RingBufferN<256>
+#elif defined(BUFFER_LENGTH)
+#define IQS9320_WIRE_BUFFER_LENGTH      BUFFER_LENGTH           // AVR, 32
+#else
+#define IQS9320_WIRE_BUFFER_LENGTH      32
+#endif
+#endif
+
+#define IQS9320_WIRE_READ_CHUNK         ((IQS9320_WIRE_BUFFER_LENGTH > 255) ? 255 : IQS9320_WIRE_BUFFER_LENGTH)
+#define IQS9320_WIRE_WRITE_CHUNK        ((IQS9320_WIRE_BUFFER_LENGTH > 257) ? 255 : (IQS9320_WIRE_BUFFER_LENGTH - 2))
+
+/* Longest Wire transaction on cores with a timeout (AVR WIRE_HAS_TIMEOUT,
+ESP32). A bus that is held low then fails with status 5 instead of blocking */
+#ifndef IQS9320_WIRE_TIMEOUT_US
+#define IQS9320_WIRE_TIMEOUT_US         25000
+#endif
+#define IQS9320_WIRE_ERROR_ADDRESS      2       // Wire.endTransmission() status of an address NACK
+#define IQS9320_WIRE_ERROR_TIMEOUT      5       // Wire.endTransmission() status of a timeout
+
+/* Bus lines for the recovery, taken from the variant of the board */
+#if !defined(IQS9320_SDA_PIN) && defined(PIN_WIRE_SDA) && defined(PIN_WIRE_SCL)
+#define IQS9320_SDA_PIN                 PIN_WIRE_SDA
+#define IQS9320_SCL_PIN                 PIN_WIRE_SCL
+#endif
+
+/* Recovery: up to 9 SCL clocks until the device releases SDA, then a STOP.
+The clock runs at 100 kHz, SCL held low by a stretching device is waited for */
+#define IQS9320_RECOVERY_CLOCKS         9
+#define IQS9320_RECOVERY_HALF_US        5
+#define IQS9320_RECOVERY_STRETCH_US     1000
+
+/**
+  * @name   iqs9320_transfer_setup
+  * @brief  Fill in a transfer job before it is submitted.
+  * @param  transfer ->  The job.
+  * @param  device   ->  The I2C address of the device.
+  * @param  reg      ->  The 16-bit register address.
+  * @param  data     ->  Destination of a read or source of a write.
+  * @param  length   ->  Number of bytes to transfer.
+  * @param  read     ->  true for a read, false for a write.
+  * @param  stop     ->  End with a STOP (true) or RESTART (false).
+  * @retval None.
+  * @note   The callback and context are cleared, set them afterwards if
+  *         required.
+  */
+void iqs9320_transfer_setup(iqs9320_transfer_s *transfer, uint8_t device, uint16_t reg, uint8_t data[], uint8_t length, bool read, bool stop)
+{
+  transfer->device      = device;
+  transfer->reg         = reg;
+  transfer->data        = data;
+  transfer->length      = length;
+  transfer->transferred = 0;
+  transfer->read        = read;
+  transfer->stop        = stop;
+  transfer->status      = IQS9320_TRANSFER_IDLE;
+  transfer->error       = 0;
+  transfer->callback    = NULL;
+  transfer->context     = NULL;
+}
+
+/*****************************************************************************/
+/*                               WIRE PORT                                   */
+/*****************************************************************************/
+IQS9320WirePort::IQS9320WirePort()
+{
+  _frequency = 100000;
+}
+
+/**
+  * @name   begin
+  * @brief  A method that starts the Wire library with the clock and, where
+  *         the core supports it, the transaction timeout.
+  * @param  frequency ->  SCL frequency in Hz.
+  * @retval None.
+  */
+void IQS9320WirePort::begin(uint32_t frequency)
+{
+  _frequency = frequency;
+  Wire.begin();
+  Wire.setClock(frequency);
+  #if defined(WIRE_HAS_TIMEOUT)
+  Wire.setWireTimeout(IQS9320_WIRE_TIMEOUT_US, true);
+  #elif defined(ARDUINO_ARCH_ESP32)
+  Wire.setTimeOut(IQS9320_WIRE_TIMEOUT_US / 1000);
+  #endif
+}
+
+
+/**
+  * @name   start
+  * @brief  A method that performs the job on the Wire library. The register
+  *         address is sent low byte first, reads use a repeated start. Jobs
+  *         longer than the Wire buffer are split into chunks that each start
+  *         at the register after the previous chunk; chunks before the last
+  *         end with a repeated start so that the communication window stays
+  *         open.
+  * @param  transfer ->  The job.
+  * @retval bool -> Always true, the job is complete on return.
+  */
+bool IQS9320WirePort::start(iqs9320_transfer_s *transfer)
+{
+  uint8_t done = 0;
+  uint8_t chunk = transfer->read ? IQS9320_WIRE_READ_CHUNK : IQS9320_WIRE_WRITE_CHUNK;
+
+  transfer->error = 0;
+  do
+  {
+    uint8_t length = ((uint8_t)(transfer->length - done) > chunk) ? chunk : (uint8_t)(transfer->length - done);
+    bool last = (done + length) >= transfer->length;
+    uint8_t received = transferChunk(transfer, done, length, last ? transfer->stop : false);
+
+    done += received;
+    if(transfer->error || (received < length))
+    {
+      break; // The rest of the job is not attempted
+    }
+  }while(done < transfer->length);
+  transfer->transferred = done;
+
+  return true;
+}
+
+/**
+  * @name   transferChunk
+  * @brief  A method that performs one Wire transaction of a job.
+  * @param  transfer ->  The job, error is set on a bus error.
+  * @param  offset   ->  First byte of the chunk in the job.
+  * @param  length   ->  Bytes in the chunk, at most the Wire buffer.
+  * @param  stop     ->  End with a STOP (true) or RESTART (false).
+  * @retval uint8_t -> Bytes transferred.
+  */
+uint8_t IQS9320WirePort::transferChunk(iqs9320_transfer_s *transfer, uint8_t offset, uint8_t length, bool stop)
+{
+  uint16_t reg = transfer->reg + offset;
+  uint8_t *data = &transfer->data[offset];
+  uint8_t i = 0;
+
+  Wire.beginTransmission(transfer->device);
+  Wire.write((uint8_t)reg);
+  Wire.write((uint8_t)(reg >> 8));
+
+  if(!transfer->read)
+  {
+    for(i = 0; i < length; i++)
+    {
+      Wire.write(data[i]);
+    }
+    // End the transmission, user decides to STOP or RESTART.
+    transfer->error = Wire.endTransmission(stop);
+    return length;
+  }
+
+  /* Complete the selection, restart for the read that follows. Requests on
+  a bus that timed out would only time out again, and without the address
+  ACK the register pointer was not set */
+  transfer->error = Wire.endTransmission(false);
+  if((transfer->error == IQS9320_WIRE_ERROR_TIMEOUT) || (transfer->error == IQS9320_WIRE_ERROR_ADDRESS))
+  {
+    return 0;
+  }
+
+  /* Request the bytes, this sometimes takes a few attempts */
+  uint8_t counter = 0;
+  do
+  {
+    Wire.requestFrom((int)transfer->device, (int)length, (int)stop);
+
+    #if defined(WIRE_HAS_TIMEOUT)
+    if(Wire.getWireTimeoutFlag())
+    {
+      Wire.clearWireTimeoutFlag();
+      transfer->error = IQS9320_WIRE_ERROR_TIMEOUT;
+      return 0;
+    }
+    #endif
+
+    /* break out of request loop if max retry is reached */
+    if(counter++ >= IQS9320_I2C_RETRY)
+    {
+      break;
+    }
+  }while(Wire.available() == 0);
+
+  /* Load the received bytes until there are no more */
+  while(Wire.available())
+  {
+    uint8_t byte = Wire.read();
+    if(i < length)
+    {
+      data[i++] = byte;
+    }
+  }
+
+  return i;
+}
+
+/**
+  * @name   setClock
+  * @brief  A method that sets the clock of the Wire library.
+  * @param  frequency ->  SCL frequency in Hz.
+  * @retval None.
+  */
+void IQS9320WirePort::setClock(uint32_t frequency)
+{
+  _frequency = frequency;
+  Wire.setClock(frequency);
+}
+
+/**
+  * @name   recover
+  * @brief  A method that releases a bus held by a device that was stopped in
+  *         the middle of a byte. The Wire peripheral is stopped, SCL is
+  *         clocked until the device releases SDA (at most 9 clocks) and a
+  *         STOP is sent, then Wire is started again with the same clock.
+  * @param  None.
+  * @retval uint8_t -> iqs9320_recover_e, IQS9320_RECOVER_NONE if the bus
+  *                    pins of the board are not known (only Wire is
+  *                    restarted).
+  * @note   The lines are driven open-drain: low as an output, released as an
+  *         input with pull-up. Takes at most IQS9320_RECOVERY_STRETCH_US plus
+  *         about 0.2 ms.
+  */
+uint8_t IQS9320WirePort::recover(void)
+{
+  uint8_t result = IQS9320_RECOVER_NONE;
+
+  Wire.end();
+
+  #if defined(IQS9320_SDA_PIN) && defined(IQS9320_SCL_PIN)
+  {
+    uint32_t start_us = micros();
+    bool held;
+
+    pinMode(IQS9320_SDA_PIN, INPUT_PULLUP);
+    pinMode(IQS9320_SCL_PIN, INPUT_PULLUP);
+    delayMicroseconds(IQS9320_RECOVERY_HALF_US);
+
+    /* Wait for a device that stretches the clock */
+    while((digitalRead(IQS9320_SCL_PIN) == LOW) && ((uint32_t)(micros() - start_us) < IQS9320_RECOVERY_STRETCH_US))
+    {
+      delayMicroseconds(IQS9320_RECOVERY_HALF_US);
+    }
+    held = (digitalRead(IQS9320_SCL_PIN) == LOW) || (digitalRead(IQS9320_SDA_PIN) == LOW);
+
+    /* Clock out the rest of the byte the device is sending */
+    for(uint8_t i = 0; (i < IQS9320_RECOVERY_CLOCKS) && (digitalRead(IQS9320_SDA_PIN) == LOW); i++)
+    {
+      digitalWrite(IQS9320_SCL_PIN, LOW);
+      pinMode(IQS9320_SCL_PIN, OUTPUT);
+      delayMicroseconds(IQS9320_RECOVERY_HALF_US);
+      pinMode(IQS9320_SCL_PIN, INPUT_PULLUP);
+      delayMicroseconds(IQS9320_RECOVERY_HALF_US);
+    }
+
+    /* STOP: SDA rises while SCL is high */
+    digitalWrite(IQS9320_SCL_PIN, LOW);
+    pinMode(IQS9320_SCL_PIN, OUTPUT);
+    digitalWrite(IQS9320_SDA_PIN, LOW);
+    pinMode(IQS9320_SDA_PIN, OUTPUT);
+    delayMicroseconds(IQS9320_RECOVERY_HALF_US);
+    pinMode(IQS9320_SCL_PIN, INPUT_PULLUP);
+    delayMicroseconds(IQS9320_RECOVERY_HALF_US);
+    pinMode(IQS9320_SDA_PIN, INPUT_PULLUP);
+    delayMicroseconds(IQS9320_RECOVERY_HALF_US);
+
+    if((digitalRead(IQS9320_SCL_PIN) == LOW) || (digitalRead(IQS9320_SDA_PIN) == LOW))
+    {
+      result = IQS9320_RECOVER_STUCK;
+    }
+    else
+    {
+      result = held ? IQS9320_RECOVER_RELEASED : IQS9320_RECOVER_IDLE;
+    }
+  }
+  #endif
+
+  begin(_frequency);
+
+  return result;
+}
+
+/**
+  * @name   poll
+  * @brief  A method that reports completion of a job, Wire jobs complete in
+  *         start().
+  * @param  transfer ->  The job.
+  * @retval bool -> Always true.
+  */
+bool IQS9320WirePort::poll(iqs9320_transfer_s *transfer)
+{
+  (void)transfer;
+  return true;
+}
+
+/*****************************************************************************/
+/*                            TRANSFER ENGINE                                */
+/*****************************************************************************/
+IQS9320Transfer::IQS9320Transfer()
+{
+  _port = NULL;
+  _capture_cb = NULL;
+  _jobs = 0;
+  _errors = 0;
+  memset(&_bus_stats, 0, sizeof(_bus_stats));
+  _head = 0;
+  _count = 0;
+}
+
+/**
+  * @name   begin
+  * @brief  A method that selects the port and empties the queue.
+  * @param  port ->  The bus back-end.
+  * @retval None.
+  * @note   Jobs still in the queue are dropped without a callback.
+  */
+void IQS9320Transfer::begin(IQS9320TransferPort *port)
+{
+  _port = port;
+  _head = 0;
+  _count = 0;
+}
+
+/**
+  * @name   setPort
+  * @brief  A method that replaces the port, e.g. with a DMA back-end.
+  * @param  port ->  The bus back-end.
+  * @retval None.
+  * @note   Queued jobs are completed on the current port first.
+  */
+void IQS9320Transfer::setPort(IQS9320TransferPort *port)
+{
+  while(_count > 0)
+  {
+    service();
+  }
+  _port = port;
+}
+
+/**
+  * @name   setCaptureCallback
+  * @brief  A method that registers a function which receives a trace record
+  *         of every completed job.
+  * @param  callback ->  Capture function, NULL to stop capturing.
+  * @retval None.
+  */
+void IQS9320Transfer::setCaptureCallback(iqs9320_capture_cb callback)
+{
+  _capture_cb = callback;
+}
+
+/**
+  * @name   setClock
+  * @brief  A method that changes the bus clock of the port once the queued
+  *         jobs have completed.
+  * @param  frequency ->  SCL frequency in Hz.
+  * @retval None.
+  */
+void IQS9320Transfer::setClock(uint32_t frequency)
+{
+  while(_count > 0)
+  {
+    service();
+  }
+  if(_port)
+  {
+    _port->setClock(frequency);
+  }
+}
+
+/**
+  * @name   submit
+  * @brief  A method that adds a job to the end of the queue and starts it if
+  *         the bus is free.
+  * @param  transfer ->  The job, set up with iqs9320_transfer_setup().
+  * @retval bool -> false if the queue is full, the job is not queued.
+  * @note   With a blocking port the job may be complete on return.
+  */
+bool IQS9320Transfer::submit(iqs9320_transfer_s *transfer)
+{
+  if(_count >= IQS9320_TRANSFER_QUEUE_LENGTH)
+  {
+    return false;
+  }
+
+  transfer->status = IQS9320_TRANSFER_QUEUED;
+  _queue[(_head + _count) % IQS9320_TRANSFER_QUEUE_LENGTH] = transfer;
+  _count++;
+
+  service();
+  return true;
+}
+
+/**
+  * @name   service
+  * @brief  A method that advances the queue: polls the running job, completes
+  *         it and starts the next one. Call it from the main loop.
+  * @param  None.
+  * @retval None.
+  */
+void IQS9320Transfer::service(void)
+{
+  while(_count > 0)
+  {
+    iqs9320_transfer_s *transfer = _queue[_head];
+
+    if(transfer->status == IQS9320_TRANSFER_QUEUED)
+    {
+      if(!_port || !_port->start(transfer))
+      {
+        return; // Port is not ready, try again later
+      }
+      transfer->status = IQS9320_TRANSFER_BUSY;
+    }
+
+    if(!_port->poll(transfer))
+    {
+      return; // Still on the bus
+    }
+
+    _head = (_head + 1) % IQS9320_TRANSFER_QUEUE_LENGTH;
+    _count--;
+    complete(transfer);
+  }
+}
+
+/**
+  * @name   wait
+  * @brief  A method that services the queue until the job has completed.
+  * @param  transfer ->  A submitted job.
+  * @retval None.
+  */
+void IQS9320Transfer::wait(iqs9320_transfer_s *transfer)
+{
+  while((transfer->status == IQS9320_TRANSFER_QUEUED) || (transfer->status == IQS9320_TRANSFER_BUSY))
+  {
+    service();
+  }
+}
+
+/**
+  * @name   idle
+  * @brief  A method that reports if all jobs have completed.
+  * @param  None.
+  * @retval bool -> true if the queue is empty.
+  */
+bool IQS9320Transfer::idle(void)
+{
+  return _count == 0;
+}
+
+/**
+  * @name   pending
+  * @brief  A method that returns the number of jobs not yet completed.
+  * @param  None.
+  * @retval uint8_t -> Jobs in the queue, including the running one.
+  */
+uint8_t IQS9320Transfer::pending(void)
+{
+  return _count;
+}
+
+/**
+  * @name   getJobCount
+  * @brief  A method that returns the number of completed jobs.
+  * @param  None.
+  * @retval uint32_t -> Jobs completed since start-up, wraps around.
+  */
+uint32_t IQS9320Transfer::getJobCount(void)
+{
+  return _jobs;
+}
+
+/**
+  * @name   getErrorCount
+  * @brief  A method that returns the number of jobs that failed.
+  * @param  None.
+  * @retval uint32_t -> Jobs with a NACK or fewer bytes than requested since
+  *                     start-up, wraps around.
+  */
+uint32_t IQS9320Transfer::getErrorCount(void)
+{
+  return _errors;
+}
+
+/**
+  * @name   recover
+  * @brief  A method that releases a hung bus through the port and counts the
+  *         recovery.
+  * @param  None.
+  * @retval uint8_t -> iqs9320_recover_e of the port.
+  * @note   Jobs in the queue are completed first. A job that never completes
+  *         on a hung bus must be failed by the port with its timeout.
+  */
+uint8_t IQS9320Transfer::recover(void)
+{
+  uint32_t start_us;
+  uint8_t result;
+
+  while(_count > 0)
+  {
+    service();
+  }
+  if(!_port)
+  {
+    return IQS9320_RECOVER_NONE;
+  }
+
+  start_us = micros();
+  result = _port->recover();
+  _bus_stats.recovery_us = micros() - start_us;
+  if(_bus_stats.recovery_us > _bus_stats.worst_recovery_us)
+  {
+    _bus_stats.worst_recovery_us = _bus_stats.recovery_us;
+  }
+  _bus_stats.recoveries++;
+  if((result == IQS9320_RECOVER_RELEASED) || (result == IQS9320_RECOVER_STUCK))
+  {
+    _bus_stats.stuck_lines++;
+  }
+  if(result == IQS9320_RECOVER_STUCK)
+  {
+    _bus_stats.failed_recoveries++;
+  }
+
+  return result;
+}
+
+/**
+  * @name   getBusStats
+  * @brief  A method that copies the bus health counters.
+  * @param  stats ->  Where the counters are stored.
+  * @retval None.
+  */
+void IQS9320Transfer::getBusStats(iqs9320_bus_stats_s *stats)
+{
+  *stats = _bus_stats;
+}
+
+/**
+  * @name   complete
+  * @brief  A method that sets the final status of a job, passes it to the
+  *         capture callback and calls its completion callback.
+  * @param  transfer ->  The finished job.
+  * @retval None.
+  * @note   A job that moved fewer bytes than requested ends with
+  *         IQS9320_TRANSFER_ERROR like a bus error, its buffer is only
+  *         partly filled.
+  */
+void IQS9320Transfer::complete(iqs9320_transfer_s *transfer)
+{
+  if(_capture_cb)
+  {
+    iqs9320_trace_record_s record;
+
+    record.flags     = (transfer->read ? IQS9320_TRACE_READ : IQS9320_TRACE_WRITE)
+                     | (transfer->error ? IQS9320_TRACE_NACK : 0)
+                     | (transfer->stop ? IQS9320_TRACE_STOP : 0)
+                     | ((transfer->transferred < transfer->length) ? IQS9320_TRACE_SHORT : 0);
+    record.device    = transfer->device;
+    record.reg       = transfer->reg;
+    record.requested = transfer->length;
+    record.length    = transfer->transferred;
+    record.timestamp = micros();
+    record.data      = transfer->data;
+
+    _capture_cb(&record);
+  }
+
+  _jobs++;
+  if(transfer->error || (transfer->transferred < transfer->length))
+  {
+    transfer->status = IQS9320_TRANSFER_ERROR;
+    _errors++;
+  }
+  else
+  {
+    transfer->status = IQS9320_TRANSFER_DONE;
+  }
+  if(transfer->error == IQS9320_WIRE_ERROR_TIMEOUT)
+  {
+    _bus_stats.timeouts++;
+  }
+
+  if(transfer->callback)
+  {
+    transfer->callback(transfer);
+  }
+}
@@ -0,0 +1,192 @@
+/******************************************************************************
+ *                                                                            *
+ *                                Copyright by                                *
+ *                                                                            *
+ *                              Azoteq (Pty) Ltd                              *
+ *                          Republic of South Africa                          *
+ *                                                                            *
+ *                           Tel: +27(0)21 863 0033                           *
+ *                           E-mail: info@azoteq.com                          *
+ *                                                                            *
+ * ========================================================================== *
+ * @file        IQS9320_transfer.h                                            *
+ * @brief       Queued I2C transfer engine for the IQS9320. Every register    *
+ *              read or write is a job that is started and polled by          *
+ *              service(), so the caller never has to wait on the bus.        *
+ * @author      Azoteq PTY Ltd                                                *
+ * @version     v1.5.3                                                        *
+ * @date        2024                                                          *
+ * ========================================================================== *
+ * @attention  The bus is reached through an IQS9320TransferPort. The default *
+ *             IQS9320WirePort uses the blocking Wire library, so a job       *
+ *             completes inside start(). A port for an I2C peripheral with    *
+ *             DMA or interrupts (e.g. SAMD SERCOM, ESP32 i2c_master) returns *
+ *             from start() at once and reports completion from poll(), and   *
+ *             the CPU is free while the transfer runs.                       *
+ ******************************************************************************/
+
+#ifndef IQS9320_TRANSFER_H
+#define IQS9320_TRANSFER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "IQS9320_trace.h"
+
+/* Number of jobs that can wait in one queue */
+#ifndef IQS9320_TRANSFER_QUEUE_LENGTH
+#define IQS9320_TRANSFER_QUEUE_LENGTH   8
+#endif
+
+/* Number of requestFrom() attempts before a read is given up */
+#ifndef IQS9320_I2C_RETRY
+#define IQS9320_I2C_RETRY               10
+#endif
+
+/**
+* @brief  iqs9320 Transfer Status Enumeration.
+*/
+typedef enum {
+        IQS9320_TRANSFER_IDLE = (uint8_t) 0x00, // Not queued
+        IQS9320_TRANSFER_QUEUED,                // Waiting for the bus
+        IQS9320_TRANSFER_BUSY,                  // Started by the port
+        IQS9320_TRANSFER_DONE,                  // Completed successfully
+        IQS9320_TRANSFER_ERROR,                 // Completed with a bus error or short read
+} iqs9320_transfer_status_e;
+
+/**
+* @brief  iqs9320 Bus Recovery Result, see IQS9320TransferPort::recover().
+*/
+typedef enum {
+        IQS9320_RECOVER_NONE = (uint8_t) 0x00,  // The port can not check or clock the lines
+        IQS9320_RECOVER_IDLE,                   // Both lines were released, the peripheral was restarted
+        IQS9320_RECOVER_RELEASED,               // A line was held low and has been released
+        IQS9320_RECOVER_STUCK,                  // A line is still held low
+} iqs9320_recover_e;
+
+/**
+* @brief  iqs9320 Bus Health Counters, see IQS9320Transfer::getBusStats().
+*/
+typedef struct {
+        uint32_t timeouts;              // Jobs that ended with a bus timeout
+        uint32_t recoveries;            // Recoveries run
+        uint32_t stuck_lines;           // Recoveries that found a line held low
+        uint32_t failed_recoveries;     // Recoveries that could not release the line
+        uint32_t recovery_us;           // Duration of the last recovery
+        uint32_t worst_recovery_us;     // Longest recovery
+} iqs9320_bus_stats_s;
+
+struct iqs9320_transfer_s;
+
+/* Called once the job has completed */
+typedef void (*iqs9320_transfer_cb)(struct iqs9320_transfer_s *transfer);
+
+/**
+* @brief  iqs9320 Transfer Job. The job and its data must stay valid until the
+*         status is DONE or ERROR, poll the status or use the callback.
+*/
+typedef struct iqs9320_transfer_s
+{
+        uint8_t  device;                // 7-bit I2C address
+        uint16_t reg;                   // 16-bit register address
+        uint8_t *data;                  // Read destination or write source
+        uint8_t  length;                // Number of bytes to transfer
+        uint8_t  transferred;           // Number of bytes transferred
+        bool     read;                  // true to read, false to write
+        bool     stop;                  // STOP (true) or RESTART (false) at the end
+        volatile uint8_t status;        // iqs9320_transfer_status_e, poll until DONE or ERROR
+        uint8_t  error;                 // Wire.endTransmission() status
+        iqs9320_transfer_cb callback;   // Optional, NULL to poll the status
+        void    *context;               // Free for the owner of the job
+} iqs9320_transfer_s;
+
+/* Fill in a job, the status and result fields are cleared */
+void iqs9320_transfer_setup(iqs9320_transfer_s *transfer, uint8_t device, uint16_t reg, uint8_t data[], uint8_t length, bool read, bool stop);
+
+/**
+* @brief  Bus back-end used by the transfer engine.
+*/
+class IQS9320TransferPort
+{
+public:
+        virtual ~IQS9320TransferPort() {}
+
+        /* Start the job. Return false when the port can not take it yet, it
+           is offered again on the next service() call */
+        virtual bool start(iqs9320_transfer_s *transfer) = 0;
+
+        /* Return true once the job has finished, with transferred and error
+           filled in */
+        virtual bool poll(iqs9320_transfer_s *transfer) = 0;
+
+        /* Change the bus clock, ignored by ports with a fixed clock */
+        virtual void setClock(uint32_t frequency) { (void)frequency; }
+
+        /* Release a hung bus and restart the peripheral, called with no job
+           on the bus. Returns an iqs9320_recover_e */
+        virtual uint8_t recover(void) { return IQS9320_RECOVER_NONE; }
+};
+
+/**
+* @brief  Default port on the Arduino Wire library, completes every job inside
+*         start(). Jobs longer than the Wire buffer (32 bytes on AVR, 128 on
+*         ESP32, 256 on SAMD, see IQS9320_WIRE_BUFFER_LENGTH) are split into
+*         consecutive transactions.
+*/
+class IQS9320WirePort : public IQS9320TransferPort
+{
+public:
+        IQS9320WirePort();
+
+        void begin(uint32_t frequency);
+        bool start(iqs9320_transfer_s *transfer);
+        bool poll(iqs9320_transfer_s *transfer);
+        void setClock(uint32_t frequency);
+        uint8_t recover(void);
+
+private:
+        uint32_t _frequency;
+
+        uint8_t transferChunk(iqs9320_transfer_s *transfer, uint8_t offset, uint8_t length, bool stop);
+};
+
+/**
+* @brief  FIFO of transfer jobs for one bus.
+*/
+class IQS9320Transfer
+{
+public:
+        // Public Constructors
+        IQS9320Transfer();
+
+        // Public Methods
+        void begin(IQS9320TransferPort *port);
+        void setPort(IQS9320TransferPort *port);
+        void setCaptureCallback(iqs9320_capture_cb callback);
+        void setClock(uint32_t frequency);
+
+        bool submit(iqs9320_transfer_s *transfer);
+        void service(void);
+        void wait(iqs9320_transfer_s *transfer);
+        bool idle(void);
+        uint8_t pending(void);
+        uint32_t getJobCount(void);
+        uint32_t getErrorCount(void);
+        uint8_t recover(void);
+        void getBusStats(iqs9320_bus_stats_s *stats);
+
+private:
+        // Private Variables
+        IQS9320TransferPort *_port;
+        iqs9320_capture_cb _capture_cb;
+        uint32_t _jobs;                 // Completed jobs
+        uint32_t _errors;               // Jobs with a bus error or a short read
+        iqs9320_bus_stats_s _bus_stats;
+        iqs9320_transfer_s *_queue[IQS9320_TRANSFER_QUEUE_LENGTH];
+        uint8_t _head;
+        uint8_t _count;
+
+        // Private Methods
+        void complete(iqs9320_transfer_s *transfer);
+};
+
+#endif // IQS9320_TRANSFER_H
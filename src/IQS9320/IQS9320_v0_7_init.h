@@ -338,8 +338,8 @@
 #define CYCLE_0_SELECT                           0x0A
 #define CYCLE_1_SELECT                           0x0A
 #define CHANNEL_DISABLE_0                        0x00
-#define CHANNEL_DISABLE_0                        0x00
-#define CHANNEL_DISABLE_0                        0x00
+#define CHANNEL_DISABLE_1                        0x00
+#define CHANNEL_DISABLE_2                        0x00
 
 /* Change the Rx Select */
 /* Memory Map Position 0x310A - 0x311D */
@@ -424,7 +424,7 @@
 /* Change the Timing Generator Settings */
 /* Memory Map Position 0x3146 - 0x3147 */
 #define TIMING_GENERATOR_0                       0x00
-#define TIMING_GENERATOR_0                       0x00
+#define TIMING_GENERATOR_1                       0x00
 
 /* Change the Hardware Settings */
 /* Memory Map Position 0x3148 - 0x3149 */
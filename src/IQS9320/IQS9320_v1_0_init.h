@@ -284,12 +284,12 @@
 #define ACTIVATION_HYSTERESIS_0                  0x05
 
 /* Change the Timing Generator Settings */
-/* Memory Map Position 0x3146 - 0x3146 */
+/* Memory Map Position 0x3146 - 0x3147 */
 #define TIMING_GENERATOR_0                       0x00
 #define TIMING_GENERATOR_1                       0x00
 
 /* Change the Hardware Settings */
-/* Memory Map Position 0x3148 - 0x3148 */
+/* Memory Map Position 0x3148 - 0x3149 */
 #define HARDWARE_SETTINGS_0                      0x8C
 #define HARDWARE_SETTINGS_1                      0x01
 
@@ -34,8 +34,12 @@
 #define IQS9320_MM_SYSTEM_CONTROL               0x2000
 #define IQS9320_MM_SYSTEM_CONFIGURATION         0x2002
 #define IQS9320_MM_DEFAULT_READ_LOCATION        0x2010
+#define IQS9320_MM_NORMAL_POWER_SAMPLING        0x2004
 #define IQS9320_MM_NORMAL_POWER_TIMEOUT         0x2006
+#define IQS9320_MM_LOW_POWER_SAMPLING           0x2008
 #define IQS9320_MM_LOW_POWER_TIMEOUT            0x200A
+#define IQS9320_MM_ULTRA_LOW_POWER_SAMPLING     0x200C
+#define IQS9320_MM_ULTRA_LOW_POWER_TIMEOUT      0x200E
 
 /* CHANNEL CONFIGURATION: 0x3000 - 0x3120 */
 #define IQS9320_MM_MIRROR_SELECTION_CH0         0x3000
@@ -0,0 +1,99 @@
+/******************************************************************************
+ *                                                                            *
+ *                                Copyright by                                *
+ *                                                                            *
+ *                              Azoteq (Pty) Ltd                              *
+ *                          Republic of South Africa                          *
+ *                                                                            *
+ *                           Tel: +27(0)21 863 0033                           *
+ *                           E-mail: info@azoteq.com                          *
+ *                                                                            *
+ * ========================================================================== *
+ * @file        Arduino.h                                                     *
+ * @brief       Minimal Arduino core for building the IQS9320 library on a    *
+ *              PC. Time is virtual by default: delay() advances the clock    *
+ *              instantly, so the driver runs faster than real time and is    *
+ *              fully deterministic. GPIO calls are accepted and ignored.     *
+ * @author      Azoteq PTY Ltd                                                *
+ * @version     v1.5.3                                                        *
+ * @date        2024                                                          *
+ *****************************************************************************/
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#define HIGH                    1
+#define LOW                     0
+#define INPUT                   0
+#define OUTPUT                  1
+#define INPUT_PULLUP            2
+
+#define DEC                     10
+#define HEX                     16
+#define BIN                     2
+
+#define PROGMEM
+#define pgm_read_byte(p)        (*(const uint8_t *)(p))
+
+/* GPIO, ignored on the host */
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+
+/* Time */
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+/* Host clock control, virtual unless host_clock_realtime(true) is called */
+void host_clock_realtime(bool realtime);
+void host_clock_set_us(uint64_t us);
+void host_clock_advance_us(uint64_t us);
+uint64_t host_clock_us(void);
+
+/**
+* @brief  Serial port replacement, text is written to a stdio stream or
+*         discarded when no stream is set.
+*/
+class HostSerial
+{
+public:
+        HostSerial();
+
+        void setOutput(FILE *out);
+
+        void begin(unsigned long baud);
+        int available(void);
+        int read(void);
+        operator bool() const { return true; }
+
+        size_t write(uint8_t c);
+        size_t write(const uint8_t *buffer, size_t size);
+
+        size_t print(const char *s);
+        size_t print(char c);
+        size_t print(unsigned char n, int base = DEC);
+        size_t print(int n, int base = DEC);
+        size_t print(unsigned int n, int base = DEC);
+        size_t print(long n, int base = DEC);
+        size_t print(unsigned long n, int base = DEC);
+        size_t print(double n, int digits = 2);
+
+        size_t println(void);
+        template <typename T> size_t println(T value) { size_t n = print(value); return n + println(); }
+        template <typename T> size_t println(T value, int format) { size_t n = print(value, format); return n + println(); }
+
+private:
+        FILE *_out;
+        size_t printNumber(unsigned long n, int base, bool negative);
+};
+
+extern HostSerial Serial;
+
+#endif // HOST_ARDUINO_H
@@ -0,0 +1,84 @@
+/******************************************************************************
+ *                                                                            *
+ *                                Copyright by                                *
+ *                                                                            *
+ *                              Azoteq (Pty) Ltd                              *
+ *                          Republic of South Africa                          *
+ *                                                                            *
+ *                           Tel: +27(0)21 863 0033                           *
+ *                           E-mail: info@azoteq.com                          *
+ *                                                                            *
+ * ========================================================================== *
+ * @file        Wire.h                                                        *
+ * @brief       TwoWire replacement for building the IQS9320 library on a PC. *
+ *              Transactions are handed to a HostI2CBus back-end, e.g. a      *
+ *              trace replay, a simulated device or Linux i2c-dev.            *
+ * @author      Azoteq PTY Ltd                                                *
+ * @version     v1.5.3                                                        *
+ * @date        2024                                                          *
+ *****************************************************************************/
+
+#ifndef HOST_WIRE_H
+#define HOST_WIRE_H
+
+#include "Arduino.h"
+
+/* Same buffer size as the SAMD/ESP32 cores, the AVR core uses 32 */
+#ifndef BUFFER_LENGTH
+#define BUFFER_LENGTH           256
+#endif
+
+/**
+* @brief  I2C back-end interface.
+* @note   write() returns the Wire.endTransmission() status: 0 success,
+*         2 address NACK, 3 data NACK, 4 other error.
+*         read() returns the number of bytes received.
+*/
+class HostI2CBus
+{
+public:
+        virtual ~HostI2CBus() {}
+        virtual uint8_t write(uint8_t address, const uint8_t data[], size_t length, bool stop) = 0;
+        virtual size_t read(uint8_t address, uint8_t data[], size_t length, bool stop) = 0;
+        virtual void setClock(uint32_t frequency) { (void)frequency; }
+};
+
+class TwoWire
+{
+public:
+        TwoWire();
+
+        /* Host only: select the back-end that carries the transactions */
+        void setBus(HostI2CBus *bus);
+        HostI2CBus *getBus(void);
+
+        void begin(void);
+        void end(void);
+        void setClock(uint32_t frequency);
+
+        void beginTransmission(uint8_t address);
+        void beginTransmission(int address) { beginTransmission((uint8_t)address); }
+        uint8_t endTransmission(bool stop = true);
+        uint8_t endTransmission(int stop) { return endTransmission((bool)stop); }
+
+        uint8_t requestFrom(uint8_t address, uint8_t quantity, uint8_t stop = true);
+        uint8_t requestFrom(int address, int quantity, int stop = 1) { return requestFrom((uint8_t)address, (uint8_t)quantity, (uint8_t)stop); }
+
+        size_t write(uint8_t data);
+        size_t write(const uint8_t *data, size_t length);
+        int available(void);
+        int read(void);
+
+private:
+        HostI2CBus *_bus;
+        uint8_t _address;
+        uint8_t _tx[BUFFER_LENGTH];
+        size_t _tx_length;
+        uint8_t _rx[BUFFER_LENGTH];
+        size_t _rx_length;
+        size_t _rx_index;
+};
+
+extern TwoWire Wire;
+
+#endif // HOST_WIRE_H
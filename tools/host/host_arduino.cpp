@@ -0,0 +1,332 @@
+/******************************************************************************
+ *                                                                            *
+ *                                Copyright by                                *
+ *                                                                            *
+ *                              Azoteq (Pty) Ltd                              *
+ *                          Republic of South Africa                          *
+ *                                                                            *
+ *                           Tel: +27(0)21 863 0033                           *
+ *                           E-mail: info@azoteq.com                          *
+ *                                                                            *
+ * ========================================================================== *
+ * @file        host_arduino.cpp                                              *
+ * @brief       Implementation of the host Arduino core and TwoWire used to   *
+ *              build the IQS9320 library on a PC.                            *
+ * @author      Azoteq PTY Ltd                                                *
+ * @version     v1.5.3                                                        *
+ * @date        2024                                                          *
+ *****************************************************************************/
+
+/* Include Files */
+#include "Arduino.h"
+#include "Wire.h"
+
+#include <time.h>
+
+HostSerial Serial;
+TwoWire Wire;
+
+/*****************************************************************************/
+/*                                 CLOCK                                     */
+/*****************************************************************************/
+static bool clock_realtime = false;
+static uint64_t clock_virtual_us = 0;
+
+static uint64_t monotonic_us(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+void host_clock_realtime(bool realtime)
+{
+  clock_realtime = realtime;
+}
+
+void host_clock_set_us(uint64_t us)
+{
+  clock_virtual_us = us;
+}
+
+void host_clock_advance_us(uint64_t us)
+{
+  clock_virtual_us += us;
+}
+
+uint64_t host_clock_us(void)
+{
+  return clock_realtime ? monotonic_us() : clock_virtual_us;
+}
+
+unsigned long millis(void)
+{
+  return (unsigned long)(host_clock_us() / 1000ULL);
+}
+
+unsigned long micros(void)
+{
+  return (unsigned long)host_clock_us();
+}
+
+void delay(unsigned long ms)
+{
+  delayMicroseconds(ms * 1000UL);
+}
+
+void delayMicroseconds(unsigned int us)
+{
+  if(clock_realtime)
+  {
+    struct timespec ts;
+    ts.tv_sec = us / 1000000UL;
+    ts.tv_nsec = (long)(us % 1000000UL) * 1000L;
+    nanosleep(&ts, NULL);
+  }
+  else
+  {
+    clock_virtual_us += us;
+  }
+}
+
+/*****************************************************************************/
+/*                                  GPIO                                     */
+/*****************************************************************************/
+void pinMode(uint8_t pin, uint8_t mode)
+{
+  (void)pin;
+  (void)mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+  (void)pin;
+  (void)value;
+}
+
+int digitalRead(uint8_t pin)
+{
+  (void)pin;
+  return HIGH;
+}
+
+/*****************************************************************************/
+/*                                 SERIAL                                    */
+/*****************************************************************************/
+HostSerial::HostSerial()
+{
+  _out = NULL;
+}
+
+void HostSerial::setOutput(FILE *out)
+{
+  _out = out;
+}
+
+void HostSerial::begin(unsigned long baud)
+{
+  (void)baud;
+}
+
+int HostSerial::available(void)
+{
+  return 0;
+}
+
+int HostSerial::read(void)
+{
+  return -1;
+}
+
+size_t HostSerial::write(uint8_t c)
+{
+  if(_out)
+  {
+    fputc(c, _out);
+  }
+  return 1;
+}
+
+size_t HostSerial::write(const uint8_t *buffer, size_t size)
+{
+  if(_out)
+  {
+    fwrite(buffer, 1, size, _out);
+  }
+  return size;
+}
+
+size_t HostSerial::print(const char *s)
+{
+  return write((const uint8_t *)s, strlen(s));
+}
+
+size_t HostSerial::print(char c)
+{
+  return write((uint8_t)c);
+}
+
+size_t HostSerial::print(unsigned char n, int base)
+{
+  return printNumber(n, base, false);
+}
+
+size_t HostSerial::print(int n, int base)
+{
+  return print((long)n, base);
+}
+
+size_t HostSerial::print(unsigned int n, int base)
+{
+  return printNumber(n, base, false);
+}
+
+size_t HostSerial::print(long n, int base)
+{
+  if((n < 0) && (base == DEC))
+  {
+    return printNumber((unsigned long)(-n), base, true);
+  }
+  return printNumber((unsigned long)n, base, false);
+}
+
+size_t HostSerial::print(unsigned long n, int base)
+{
+  return printNumber(n, base, false);
+}
+
+size_t HostSerial::print(double n, int digits)
+{
+  char buffer[48];
+  int length = snprintf(buffer, sizeof(buffer), "%.*f", digits, n);
+  return write((const uint8_t *)buffer, (size_t)length);
+}
+
+size_t HostSerial::println(void)
+{
+  return print("\r\n");
+}
+
+size_t HostSerial::printNumber(unsigned long n, int base, bool negative)
+{
+  char buffer[8 * sizeof(long) + 2];
+  char *p = &buffer[sizeof(buffer) - 1];
+
+  if(base < 2)
+  {
+    base = DEC;
+  }
+
+  *p = '\0';
+  do
+  {
+    unsigned long digit = n % (unsigned long)base;
+    *--p = (char)(digit < 10 ? '0' + digit : 'A' + digit - 10);
+    n /= (unsigned long)base;
+  } while(n);
+
+  if(negative)
+  {
+    *--p = '-';
+  }
+
+  return print(p);
+}
+
+/*****************************************************************************/
+/*                                  WIRE                                     */
+/*****************************************************************************/
+TwoWire::TwoWire()
+{
+  _bus = NULL;
+  _address = 0;
+  _tx_length = 0;
+  _rx_length = 0;
+  _rx_index = 0;
+}
+
+void TwoWire::setBus(HostI2CBus *bus)
+{
+  _bus = bus;
+}
+
+HostI2CBus *TwoWire::getBus(void)
+{
+  return _bus;
+}
+
+void TwoWire::begin(void)
+{
+  _tx_length = 0;
+  _rx_length = 0;
+  _rx_index = 0;
+}
+
+void TwoWire::end(void)
+{
+}
+
+void TwoWire::setClock(uint32_t frequency)
+{
+  if(_bus)
+  {
+    _bus->setClock(frequency);
+  }
+}
+
+void TwoWire::beginTransmission(uint8_t address)
+{
+  _address = address;
+  _tx_length = 0;
+}
+
+uint8_t TwoWire::endTransmission(bool stop)
+{
+  if(!_bus)
+  {
+    return 4;
+  }
+  return _bus->write(_address, _tx, _tx_length, stop);
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity, uint8_t stop)
+{
+  _rx_index = 0;
+  _rx_length = _bus ? _bus->read(address, _rx, quantity, stop != 0) : 0;
+
+  return (uint8_t)_rx_length;
+}
+
+size_t TwoWire::write(uint8_t data)
+{
+  if(_tx_length >= BUFFER_LENGTH)
+  {
+    return 0;
+  }
+  _tx[_tx_length++] = data;
+  return 1;
+}
+
+size_t TwoWire::write(const uint8_t *data, size_t length)
+{
+  size_t n = 0;
+  while((n < length) && write(data[n]))
+  {
+    n++;
+  }
+  return n;
+}
+
+int TwoWire::available(void)
+{
+  return (int)(_rx_length - _rx_index);
+}
+
+int TwoWire::read(void)
+{
+  if(_rx_index >= _rx_length)
+  {
+    return -1;
+  }
+  return _rx[_rx_index++];
+}
@@ -0,0 +1,165 @@
+/******************************************************************************
+ *                                                                            *
+ *                                Copyright by                                *
+ *                                                                            *
+ *                              Azoteq (Pty) Ltd                              *
+ *                          Republic of South Africa                          *
+ *                                                                            *
+ *                           Tel: +27(0)21 863 0033                           *
+ *                           E-mail: info@azoteq.com                          *
+ *                                                                            *
+ * ========================================================================== *
+ * @file        host_i2cdev.cpp                                               *
+ * @brief       Implementation of the Linux i2c-dev bus back-end.             *
+ * @author      Azoteq PTY Ltd                                                *
+ * @version     v1.5.3                                                        *
+ * @date        2024                                                          *
+ *****************************************************************************/
+
+/* Include Files */
+#include "host_i2cdev.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+
+/* Map an ioctl failure to the Wire.endTransmission() status */
+static uint8_t i2cdev_status(void)
+{
+  return ((errno == ENXIO) || (errno == EREMOTEIO)) ? 2 : 4;
+}
+
+HostI2CDevBus::HostI2CDevBus()
+{
+  _fd = -1;
+  _held_address = 0;
+  _held_length = 0;
+}
+
+HostI2CDevBus::~HostI2CDevBus()
+{
+  close();
+}
+
+/**
+  * @name   open
+  * @brief  A method that opens the adapter, e.g. "/dev/i2c-1".
+  * @param  path ->  Device node of the adapter.
+  * @retval bool -> false if the node can not be opened.
+  */
+bool HostI2CDevBus::open(const char *path)
+{
+  close();
+  _fd = ::open(path, O_RDWR);
+  return _fd >= 0;
+}
+
+void HostI2CDevBus::close(void)
+{
+  if(_fd >= 0)
+  {
+    ::close(_fd);
+  }
+  _fd = -1;
+  _held_length = 0;
+}
+
+/**
+  * @name   write
+  * @brief  Send the bytes, or hold them until the next read when the
+  *         transaction ends in a RESTART.
+  * @retval uint8_t -> Wire.endTransmission() status.
+  */
+uint8_t HostI2CDevBus::write(uint8_t address, const uint8_t data[], size_t length, bool stop)
+{
+  uint8_t status = flush();
+
+  if(status || (length > BUFFER_LENGTH))
+  {
+    return status ? status : 4;
+  }
+
+  memcpy(_held, data, length);
+  _held_address = address;
+  _held_length = length;
+
+  return stop ? flush() : 0;
+}
+
+/**
+  * @name   read
+  * @brief  Read the bytes, combined with a held write as one transaction.
+  * @retval size_t -> Number of bytes received, 0 on a bus error.
+  */
+size_t HostI2CDevBus::read(uint8_t address, uint8_t data[], size_t length, bool stop)
+{
+  struct i2c_msg msgs[2];
+  struct i2c_rdwr_ioctl_data rdwr;
+  uint32_t n = 0;
+
+  (void)stop;
+
+  if(_fd < 0)
+  {
+    _held_length = 0;
+    return 0;
+  }
+
+  if(_held_length && (_held_address == address))
+  {
+    msgs[n].addr = address;
+    msgs[n].flags = 0;
+    msgs[n].len = (uint16_t)_held_length;
+    msgs[n].buf = _held;
+    n++;
+  }
+  else if(flush())
+  {
+    return 0;
+  }
+  _held_length = 0;
+
+  msgs[n].addr = address;
+  msgs[n].flags = I2C_M_RD;
+  msgs[n].len = (uint16_t)length;
+  msgs[n].buf = data;
+  n++;
+
+  rdwr.msgs = msgs;
+  rdwr.nmsgs = n;
+  if(ioctl(_fd, I2C_RDWR, &rdwr) < 0)
+  {
+    return 0;
+  }
+  return length;
+}
+
+/* Send a held write on its own */
+uint8_t HostI2CDevBus::flush(void)
+{
+  struct i2c_msg msg;
+  struct i2c_rdwr_ioctl_data rdwr;
+
+  if(_held_length == 0)
+  {
+    return 0;
+  }
+  if(_fd < 0)
+  {
+    _held_length = 0;
+    return 4;
+  }
+
+  msg.addr = _held_address;
+  msg.flags = 0;
+  msg.len = (uint16_t)_held_length;
+  msg.buf = _held;
+  _held_length = 0;
+
+  rdwr.msgs = &msg;
+  rdwr.nmsgs = 1;
+  return (ioctl(_fd, I2C_RDWR, &rdwr) < 0) ? i2cdev_status() : 0;
+}
@@ -0,0 +1,50 @@
+/******************************************************************************
+ *                                                                            *
+ *                                Copyright by                                *
+ *                                                                            *
+ *                              Azoteq (Pty) Ltd                              *
+ *                          Republic of South Africa                          *
+ *                                                                            *
+ *                           Tel: +27(0)21 863 0033                           *
+ *                           E-mail: info@azoteq.com                          *
+ *                                                                            *
+ * ========================================================================== *
+ * @file        host_i2cdev.h                                                 *
+ * @brief       HostI2CBus on a Linux i2c-dev adapter (/dev/i2c-N). A write   *
+ *              that ends in a RESTART is held back and sent with the read    *
+ *              that follows in one I2C_RDWR call, so the register selection  *
+ *              and the read share a repeated start as the IQS9320 requires.  *
+ * @author      Azoteq PTY Ltd                                                *
+ * @version     v1.5.3                                                        *
+ * @date        2024                                                          *
+ *****************************************************************************/
+
+#ifndef HOST_I2CDEV_H
+#define HOST_I2CDEV_H
+
+#include "Arduino.h"
+#include "Wire.h"
+
+class HostI2CDevBus : public HostI2CBus
+{
+public:
+        HostI2CDevBus();
+        ~HostI2CDevBus();
+
+        bool open(const char *path);
+        void close(void);
+        bool isOpen(void) const { return _fd >= 0; }
+
+        uint8_t write(uint8_t address, const uint8_t data[], size_t length, bool stop);
+        size_t read(uint8_t address, uint8_t data[], size_t length, bool stop);
+
+private:
+        int _fd;
+        uint8_t _held_address;
+        uint8_t _held[BUFFER_LENGTH];
+        size_t _held_length;
+
+        uint8_t flush(void);
+};
+
+#endif // HOST_I2CDEV_H
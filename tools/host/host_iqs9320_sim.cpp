@@ -0,0 +1,253 @@
+/******************************************************************************
+ *                                                                            *
+ *                                Copyright by                                *
+ *                                                                            *
+ *                              Azoteq (Pty) Ltd                              *
+ *                          Republic of South Africa                          *
+ *                                                                            *
+ *                           Tel: +27(0)21 863 0033                           *
+ *                           E-mail: info@azoteq.com                          *
+ *                                                                            *
+ * ========================================================================== *
+ * @file        host_iqs9320_sim.cpp                                          *
+ * @brief       Implementation of the simulated IQS9320.                      *
+ * @author      Azoteq PTY Ltd                                                *
+ * @version     v1.5.3                                                        *
+ * @date        2024                                                          *
+ *****************************************************************************/
+
+/* Include Files */
+#include "host_iqs9320_sim.h"
+
+/* SYSTEM_CONTROL bits that are commands and read back as 0 */
+#define HOST_SIM_CONTROL_COMMANDS   ((1 << IQS9320_RECONFIG_DEV_BIT) | (1 << IQS9320_RESEED_BIT) \
+                                    | (1 << IQS9320_RE_ATI_BIT) | (1 << IQS9320_EXE_CALLIBRATION_BIT) \
+                                    | (1 << IQS9320_ACK_RESET_BIT) | (1 << IQS9320_SW_RESET_BIT))
+
+HostIQS9320Sim::HostIQS9320Sim(uint8_t address, uint8_t channels, uint8_t seed)
+{
+  _address = address;
+  _channels = (channels > IQS9320_MAX_CHANNELS) ? IQS9320_MAX_CHANNELS : channels;
+  _seed = seed;
+  powerOn();
+}
+
+/**
+  * @name   powerOn
+  * @brief  A method that clears the register map and reports a reset, as
+  *         after power-on or a software reset.
+  * @param  None.
+  * @retval None.
+  */
+void HostIQS9320Sim::powerOn(void)
+{
+  memset(_memory, 0, sizeof(_memory));
+  _pointer = 0;
+  _ati_until = 0;
+  _ati_active = false;
+
+  _memory[IQS9320_MM_PROD_NUM]          = (uint8_t)IQS9320_PRODUCT_NUM;
+  _memory[IQS9320_MM_PROD_NUM + 1]      = (uint8_t)(IQS9320_PRODUCT_NUM >> 8);
+  #if defined(IQS9320_V1_0)
+  _memory[IQS9320_MM_MAJOR_VERSION_NUM] = 1;
+  _memory[IQS9320_MM_MINOR_VERSION_NUM] = 0;
+  #elif defined(IQS9320_V0_7)
+  _memory[IQS9320_MM_MAJOR_VERSION_NUM] = 0;
+  _memory[IQS9320_MM_MINOR_VERSION_NUM] = 7;
+  #else
+  _memory[IQS9320_MM_MAJOR_VERSION_NUM] = 0;
+  _memory[IQS9320_MM_MINOR_VERSION_NUM] = 4;
+  #endif
+  _memory[IQS9320_MM_SYSTEM_STATUS]     = (1 << IQS9320_SHOW_RESET_BIT);
+}
+
+/**
+  * @name   write
+  * @brief  Set the register pointer and store the data that follows it.
+  * @retval uint8_t -> 0, or 2 (address NACK) for another address.
+  */
+uint8_t HostIQS9320Sim::write(uint8_t address, const uint8_t data[], size_t length, bool stop)
+{
+  (void)stop;
+
+  if(address != _address)
+  {
+    return 2;
+  }
+  if(length < 2)
+  {
+    return 0;
+  }
+
+  _pointer = (uint16_t)(data[0] | (data[1] << 8));
+  for(size_t i = 2; i < length; i++)
+  {
+    _memory[(uint16_t)(_pointer + i - 2)] = data[i];
+  }
+
+  if((length > 2) && (_pointer <= IQS9320_MM_SYSTEM_CONTROL) && (_pointer + length - 2 > IQS9320_MM_SYSTEM_CONTROL))
+  {
+    writeControl();
+  }
+  return 0;
+}
+
+/**
+  * @name   read
+  * @brief  Return the registers from the pointer onwards.
+  * @retval size_t -> Number of bytes, 0 for another address.
+  */
+size_t HostIQS9320Sim::read(uint8_t address, uint8_t data[], size_t length, bool stop)
+{
+  (void)stop;
+
+  if(address != _address)
+  {
+    return 0;
+  }
+
+  updateStatus();
+  for(size_t i = 0; i < length; i++)
+  {
+    data[i] = _memory[(uint16_t)(_pointer + i)];
+  }
+  return length;
+}
+
+/* Act on the command bits written to SYSTEM_CONTROL */
+void HostIQS9320Sim::writeControl(void)
+{
+  uint8_t control = _memory[IQS9320_MM_SYSTEM_CONTROL];
+
+  if(control & (1 << IQS9320_SW_RESET_BIT))
+  {
+    powerOn();
+    return;
+  }
+  if(control & (1 << IQS9320_ACK_RESET_BIT))
+  {
+    _memory[IQS9320_MM_SYSTEM_STATUS] &= ~(1 << IQS9320_SHOW_RESET_BIT);
+  }
+  if(control & (1 << IQS9320_RE_ATI_BIT))
+  {
+    _ati_active = true;
+    _ati_until = micros() + HOST_SIM_ATI_US;
+    _memory[IQS9320_MM_SYSTEM_STATUS] |= (1 << IQS9320_ATI_ACTIVE_BIT);
+  }
+
+  _memory[IQS9320_MM_SYSTEM_CONTROL] = control & ~HOST_SIM_CONTROL_COMMANDS;
+}
+
+/* End the ATI routine and press one of the channels in use at a time */
+void HostIQS9320Sim::updateStatus(void)
+{
+  uint32_t now = micros();
+  uint8_t pressed;
+
+  if(_ati_active && ((int32_t)(now - _ati_until) >= 0))
+  {
+    _ati_active = false;
+    _memory[IQS9320_MM_SYSTEM_STATUS] &= ~(1 << IQS9320_ATI_ACTIVE_BIT);
+  }
+
+  if(_channels == 0)
+  {
+    return;
+  }
+  pressed = (uint8_t)((now / HOST_SIM_PRESS_US + _seed) % _channels);
+
+  for(uint8_t i = 0; i < IQS9320_FLAG_FIELD_SIZE; i++)
+  {
+    _memory[IQS9320_MM_ACTIVATION_FLAGS + i] = 0;
+    _memory[IQS9320_MM_REFERENCE_HALT_FLAGS + i] = 0;
+  }
+  _memory[IQS9320_MM_ACTIVATION_FLAGS + pressed/8] |= (uint8_t)(1 << (pressed % 8));
+  _memory[IQS9320_MM_REFERENCE_HALT_FLAGS + pressed/8] |= (uint8_t)(1 << (pressed % 8));
+
+  for(uint8_t ch = 0; ch < IQS9320_MAX_CHANNELS; ch++)
+  {
+    uint16_t delta = (ch == pressed) ? 400 : (uint16_t)((now >> 10) + ch) % 8;
+    _memory[IQS9320_MM_CH0_NORM_DELTA + ch] = (uint8_t)(delta >> 2);
+    _memory[IQS9320_MM_CH0_DELTA + 2*ch] = (uint8_t)delta;
+    _memory[IQS9320_MM_CH0_DELTA + 2*ch + 1] = (uint8_t)(delta >> 8);
+  }
+}
+
+/*****************************************************************************/
+/*                               SIMULATED BUS                               */
+/*****************************************************************************/
+HostSimBus::HostSimBus()
+{
+  _count = 0;
+  _frequency = 400000;
+  _timed = false;
+}
+
+/**
+  * @name   add
+  * @brief  A method that connects a device to the bus.
+  * @param  device ->  The simulated device, owned by the caller.
+  * @retval bool -> false if the bus is full.
+  */
+bool HostSimBus::add(HostIQS9320Sim *device)
+{
+  if(_count >= HOST_SIM_BUS_DEVICES)
+  {
+    return false;
+  }
+  _devices[_count++] = device;
+  return true;
+}
+
+/**
+  * @name   device
+  * @brief  A method that finds the device at an address.
+  * @param  address ->  7-bit I2C address.
+  * @retval HostIQS9320Sim* -> The device, NULL if none answers.
+  */
+HostIQS9320Sim *HostSimBus::device(uint8_t address)
+{
+  for(uint8_t i = 0; i < _count; i++)
+  {
+    if(_devices[i]->address() == address)
+    {
+      return _devices[i];
+    }
+  }
+  return NULL;
+}
+
+uint8_t HostSimBus::write(uint8_t address, const uint8_t data[], size_t length, bool stop)
+{
+  HostIQS9320Sim *target = device(address);
+
+  wire(1 + length);
+  return target ? target->write(address, data, length, stop) : 2;
+}
+
+size_t HostSimBus::read(uint8_t address, uint8_t data[], size_t length, bool stop)
+{
+  HostIQS9320Sim *target = device(address);
+
+  wire(1 + length);
+  return target ? target->read(address, data, length, stop) : 0;
+}
+
+void HostSimBus::setClock(uint32_t frequency)
+{
+  _frequency = frequency ? frequency : 1;
+}
+
+void HostSimBus::setTimed(bool timed)
+{
+  _timed = timed;
+}
+
+/* Take the time of the bytes on the wire, 9 clocks per byte */
+void HostSimBus::wire(size_t bytes)
+{
+  if(_timed)
+  {
+    delayMicroseconds((unsigned int)(((uint64_t)bytes * 9 * 1000000ULL) / _frequency));
+  }
+}
@@ -0,0 +1,89 @@
+/******************************************************************************
+ *                                                                            *
+ *                                Copyright by                                *
+ *                                                                            *
+ *                              Azoteq (Pty) Ltd                              *
+ *                          Republic of South Africa                          *
+ *                                                                            *
+ *                           Tel: +27(0)21 863 0033                           *
+ *                           E-mail: info@azoteq.com                          *
+ *                                                                            *
+ * ========================================================================== *
+ * @file        host_iqs9320_sim.h                                            *
+ * @brief       Simulated IQS9320 on a HostI2CBus for host tools. Models the  *
+ *              register map, the reset and ATI handshakes of the start-up    *
+ *              routine and a key press that moves across the channels.      *
+ * @author      Azoteq PTY Ltd                                                *
+ * @version     v1.5.3                                                        *
+ * @date        2024                                                          *
+ *****************************************************************************/
+
+#ifndef HOST_IQS9320_SIM_H
+#define HOST_IQS9320_SIM_H
+
+#include "Arduino.h"
+#include "Wire.h"
+#include "IQS9320.h"
+
+/* Time the simulated ATI routine keeps the ATI active bit set */
+#define HOST_SIM_ATI_US                 30000
+
+/* Time one simulated key press lasts */
+#define HOST_SIM_PRESS_US               100000
+
+/* Number of devices on one simulated bus */
+#define HOST_SIM_BUS_DEVICES            8
+
+class HostIQS9320Sim : public HostI2CBus
+{
+public:
+        HostIQS9320Sim(uint8_t address = 0x30, uint8_t channels = IQS9320_MAX_CHANNELS, uint8_t seed = 0);
+
+        void powerOn(void);
+
+        uint8_t write(uint8_t address, const uint8_t data[], size_t length, bool stop);
+        size_t read(uint8_t address, uint8_t data[], size_t length, bool stop);
+
+        uint8_t address(void) const { return _address; }
+        uint8_t *memory(void) { return _memory; }
+
+private:
+        uint8_t _address;
+        uint8_t _channels;
+        uint8_t _seed;
+        uint16_t _pointer;
+        uint32_t _ati_until;
+        bool _ati_active;
+        uint8_t _memory[65536];
+
+        void updateStatus(void);
+        void writeControl(void);
+};
+
+/**
+* @brief  Simulated bus with several devices. With a clock set, every
+*         transaction sleeps for its time on the wire, like i2c-dev does.
+*/
+class HostSimBus : public HostI2CBus
+{
+public:
+        HostSimBus();
+
+        bool add(HostIQS9320Sim *device);
+        HostIQS9320Sim *device(uint8_t address);
+
+        uint8_t write(uint8_t address, const uint8_t data[], size_t length, bool stop);
+        size_t read(uint8_t address, uint8_t data[], size_t length, bool stop);
+        void setClock(uint32_t frequency);
+        void setTimed(bool timed);
+
+private:
+        HostIQS9320Sim *_devices[HOST_SIM_BUS_DEVICES];
+        uint8_t _count;
+        uint32_t _frequency;
+        bool _timed;
+
+        void wire(size_t bytes);
+};
+
+#endif // HOST_IQS9320_SIM_H
@@ -0,0 +1,120 @@
+/******************************************************************************
+ *                                                                            *
+ *                                Copyright by                                *
+ *                                                                            *
+ *                              Azoteq (Pty) Ltd                              *
+ *                          Republic of South Africa                          *
+ *                                                                            *
+ *                           Tel: +27(0)21 863 0033                           *
+ *                           E-mail: info@azoteq.com                          *
+ *                                                                            *
+ * ========================================================================== *
+ * @file        host_port.cpp                                                 *
+ * @brief       Implementation of the HostI2CBus transfer port.               *
+ * @author      Azoteq PTY Ltd                                                *
+ * @version     v1.5.3                                                        *
+ * @date        2024                                                          *
+ *****************************************************************************/
+
+/* Include Files */
+#include "host_port.h"
+
+/* Bits per byte on the wire, 8 data and the acknowledge */
+#define HOST_PORT_BITS_PER_BYTE     9
+
+HostTransferPort::HostTransferPort(HostI2CBus *bus, uint32_t frequency, bool timed)
+{
+  _bus = bus;
+  _frequency = frequency;
+  _timed = timed;
+  _done_at = 0;
+  _transfers = 0;
+  _bus_time_us = 0;
+
+  if(_bus)
+  {
+    _bus->setClock(_frequency);
+  }
+}
+
+void HostTransferPort::setBus(HostI2CBus *bus)
+{
+  _bus = bus;
+  if(_bus)
+  {
+    _bus->setClock(_frequency);
+  }
+}
+
+void HostTransferPort::setClock(uint32_t frequency)
+{
+  _frequency = frequency;
+  if(_bus)
+  {
+    _bus->setClock(_frequency);
+  }
+}
+
+void HostTransferPort::setTimed(bool timed)
+{
+  _timed = timed;
+}
+
+/**
+  * @name   start
+  * @brief  A method that performs the job on the bus back-end, the register
+  *         address is sent low byte first and reads use a repeated start.
+  * @param  transfer ->  The job.
+  * @retval bool -> Always true.
+  */
+bool HostTransferPort::start(iqs9320_transfer_s *transfer)
+{
+  uint8_t buffer[2 + 255];
+  uint32_t bytes;
+
+  if(!_bus)
+  {
+    transfer->error = 4;
+    transfer->transferred = 0;
+    _done_at = micros();
+    return true;
+  }
+
+  buffer[0] = (uint8_t)transfer->reg;
+  buffer[1] = (uint8_t)(transfer->reg >> 8);
+
+  if(transfer->read)
+  {
+    transfer->error = _bus->write(transfer->device, buffer, 2, false);
+    transfer->transferred = (uint8_t)_bus->read(transfer->device, transfer->data, transfer->length, transfer->stop);
+    bytes = 1 + 2 + 1 + transfer->length;
+  }
+  else
+  {
+    memcpy(&buffer[2], transfer->data, transfer->length);
+    transfer->error = _bus->write(transfer->device, buffer, 2 + transfer->length, transfer->stop);
+    transfer->transferred = transfer->error ? 0 : transfer->length;
+    bytes = 1 + 2 + transfer->length;
+  }
+
+  /* Time on the wire at the selected clock */
+  bytes = (uint32_t)(((uint64_t)bytes * HOST_PORT_BITS_PER_BYTE * 1000000ULL) / (_frequency ? _frequency : 1));
+  _bus_time_us += bytes;
+  _done_at = micros() + bytes;
+  _transfers++;
+
+  return true;
+}
+
+/**
+  * @name   poll
+  * @brief  A method that reports completion of the running job.
+  * @param  transfer ->  The job.
+  * @retval bool -> true once the wire time has passed, at once when timing
+  *         is disabled.
+  */
+bool HostTransferPort::poll(iqs9320_transfer_s *transfer)
+{
+  (void)transfer;
+  return !_timed || ((int32_t)(micros() - _done_at) >= 0);
+}
@@ -0,0 +1,56 @@
+/******************************************************************************
+ *                                                                            *
+ *                                Copyright by                                *
+ *                                                                            *
+ *                              Azoteq (Pty) Ltd                              *
+ *                          Republic of South Africa                          *
+ *                                                                            *
+ *                           Tel: +27(0)21 863 0033                           *
+ *                           E-mail: info@azoteq.com                          *
+ *                                                                            *
+ * ========================================================================== *
+ * @file        host_port.h                                                   *
+ * @brief       IQS9320TransferPort on a HostI2CBus, so every device on a PC  *
+ *              can have its own bus back-end instead of the global Wire.     *
+ * @author      Azoteq PTY Ltd                                                *
+ * @version     v1.5.3                                                        *
+ * @date        2024                                                          *
+ * ========================================================================== *
+ * @attention  With timing enabled a job completes in poll() once the time    *
+ *             the transfer takes on the wire has passed, like a DMA port.    *
+ *             The blocking IQS9320 methods then need the real-time clock,    *
+ *             on the virtual clock only the coroutine executor moves time.   *
+ ******************************************************************************/
+
+#ifndef HOST_PORT_H
+#define HOST_PORT_H
+
+#include "Arduino.h"
+#include "Wire.h"
+#include "IQS9320_transfer.h"
+
+class HostTransferPort : public IQS9320TransferPort
+{
+public:
+        HostTransferPort(HostI2CBus *bus, uint32_t frequency = 400000, bool timed = false);
+
+        void setBus(HostI2CBus *bus);
+        void setClock(uint32_t frequency);
+        void setTimed(bool timed);
+
+        bool start(iqs9320_transfer_s *transfer);
+        bool poll(iqs9320_transfer_s *transfer);
+
+        uint32_t transfers(void) const { return _transfers; }
+        uint32_t busTime(void) const { return _bus_time_us; }
+
+private:
+        HostI2CBus *_bus;
+        uint32_t _frequency;
+        bool _timed;
+        uint32_t _done_at;
+        uint32_t _transfers;
+        uint32_t _bus_time_us;
+};
+
+#endif // HOST_PORT_H
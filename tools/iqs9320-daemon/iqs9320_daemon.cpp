@@ -0,0 +1,754 @@
+/******************************************************************************
+ *                                                                            *
+ *                                Copyright by                                *
+ *                                                                            *
+ *                              Azoteq (Pty) Ltd                              *
+ *                          Republic of South Africa                          *
+ *                                                                            *
+ *                           Tel: +27(0)21 863 0033                           *
+ *                           E-mail: info@azoteq.com                          *
+ *                                                                            *
+ * ========================================================================== *
+ * @file        iqs9320_daemon.cpp                                            *
+ * @brief       Linux acquisition daemon for IQS9320s on several I2C buses.   *
+ *              Every bus has a worker thread, pinned to its own core, that   *
+ *              runs the IQS9320 state machine of each device on the bus at   *
+ *              the frame interval and pushes the frames into a lock-free     *
+ *              queue. An aggregator thread merges the queues into one stream *
+ *              ordered by sample time and measures the latency per bus.      *
+ *                                                                            *
+ *              Usage: iqs9320-daemon [options] <bus> [<bus> ...]             *
+ *                <bus>         /dev/i2c-N:0x30[,0x31...] for an adapter, or  *
+ *                              sim:<n> for a fake bus with n simulated       *
+ *                              devices                                       *
+ *                -i <us>       Frame interval in microseconds (default       *
+ *                              10000)                                        *
+ *                -k <hz>       I2C clock of the fake buses (default 400000)  *
+ *                -c <n>        Number of channels passed to begin()          *
+ *                              (default 20)                                  *
+ *                -d            Read deltas as well (DebugOn)                 *
+ *                -t <s>        Stop after s seconds, 0 to run until SIGINT   *
+ *                              or SIGTERM (default 10)                       *
+ *                -o <file>     Write the merged frames as stream packets     *
+ *                              (see IQS9320_stream.h), - for stdout          *
+ *                -s <name>     Publish the merged frames in a shared-memory  *
+ *                              ring (see IQS9320_shm.h), e.g. /iqs9320       *
+ *                -w <file>     Record the merged frames in a frame           *
+ *                              recording (see IQS9320_record.h)              *
+ *                -a            Do not pin the threads to cores               *
+ *                -p <prio>     Run the workers with SCHED_FIFO priority      *
+ *                -v            Print the merged frames as text               *
+ *                                                                            *
+ *              Build (Linux):                                                *
+ *                g++ -std=c++17 -O2 -pthread -I../host                       *
+ *                    -I../../src/IQS9320                                     *
+ *                    iqs9320_daemon.cpp ../host/host_arduino.cpp             *
+ *                    ../host/host_port.cpp ../host/host_iqs9320_sim.cpp      *
+ *                    ../host/host_i2cdev.cpp                                 *
+ *                    ../../src/IQS9320/IQS9320.cpp                           *
+ *                    ../../src/IQS9320/IQS9320_group.cpp                     *
+ *                    ../../src/IQS9320/IQS9320_record.cpp                    *
+ *                    ../../src/IQS9320/IQS9320_shm.cpp                       *
+ *                    ../../src/IQS9320/IQS9320_stream.cpp                    *
+ *                    ../../src/IQS9320/IQS9320_trace.cpp                     *
+ *                    ../../src/IQS9320/IQS9320_transfer.cpp                  *
+ *                    -o iqs9320-daemon                                       *
+ * @author      Azoteq PTY Ltd                                                *
+ * @version     v1.5.3                                                        *
+ * @date        2024                                                          *
+ *****************************************************************************/
+
+/* Include Files */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sched.h>
+#include <pthread.h>
+#include <time.h>
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include "Arduino.h"
+#include "Wire.h"
+#include "IQS9320.h"
+#include "IQS9320_group.h"
+#include "IQS9320_record.h"
+#include "IQS9320_shm.h"
+#include "IQS9320_stream.h"
+#include "host_port.h"
+#include "host_iqs9320_sim.h"
+#include "host_i2cdev.h"
+#include "spsc_queue.h"
+
+/* Buses served by one daemon */
+#define DAEMON_MAX_BUSES        16
+
+/* Devices on one bus */
+#define DAEMON_MAX_DEVICES      HOST_SIM_BUS_DEVICES
+
+/* Frames buffered between a worker and the aggregator, a power of two */
+#define DAEMON_QUEUE_LENGTH     1024
+
+/* Latency histograms have 1 us bins up to this value, plus an overflow bin */
+#define DAEMON_HISTOGRAM_US     10000
+
+/* Sleep of the aggregator when all queues are empty */
+#define DAEMON_POLL_US          50
+
+/* First address of the simulated devices on a fake bus */
+#define DAEMON_SIM_ADDRESS      0x30
+
+/**
+* @brief  One device frame as passed from a worker to the aggregator.
+*/
+typedef struct
+{
+        uint64_t sample_us;                     // Start of the frame interval
+        uint64_t done_us;                       // Read completed
+        uint8_t  bus;
+        uint8_t  slot;                          // Device index on the bus
+        uint16_t system_status;
+        uint32_t activation;
+        uint32_t filter_halt;
+        uint8_t  nChannels;
+        uint8_t  nDeltas;
+        int16_t  delta[IQS9320_MAX_CHANNELS];
+        uint8_t  norm[IQS9320_MAX_CHANNELS];
+        uint8_t  move[IQS9320_MAX_CHANNELS];
+} daemon_frame_s;
+
+/**
+* @brief  Latency histogram in microseconds.
+*/
+typedef struct
+{
+        uint32_t bins[DAEMON_HISTOGRAM_US + 1];
+        uint64_t count;
+        uint64_t max;
+} daemon_histogram_s;
+
+/**
+* @brief  One bus with its devices, worker thread and queue.
+*/
+typedef struct
+{
+        unsigned index;
+        const char *spec;
+
+        /* Back-end, either a fake bus or an i2c-dev adapter */
+        HostSimBus sim_bus;
+        HostIQS9320Sim *sims[DAEMON_MAX_DEVICES];
+        HostI2CDevBus i2cdev;
+        HostI2CBus *bus;
+
+        uint8_t nDevices;
+        uint8_t addresses[DAEMON_MAX_DEVICES];
+        HostTransferPort *ports[DAEMON_MAX_DEVICES];
+        IQS9320 *devices[DAEMON_MAX_DEVICES];
+
+        SpscQueue<daemon_frame_s, DAEMON_QUEUE_LENGTH> queue;
+        std::atomic<uint64_t> watermark;        // Frames sampled up to here are queued
+        pthread_t thread;
+        int cpu;
+
+        /* Worker statistics, read after the worker stopped */
+        uint64_t frames;
+        uint64_t dropped;
+        uint64_t resets;
+        uint64_t overruns;
+        daemon_histogram_s read_time;
+
+        /* Aggregator statistics */
+        uint64_t merged;
+        daemon_histogram_s latency;
+} daemon_bus_s;
+
+/* Settings shared by all threads, written before they start */
+static uint32_t interval_us = 10000;
+static uint32_t clock_hz = 400000;
+static uint8_t nChannels = IQS9320_MAX_CHANNELS;
+static bool debug = false;
+static bool pin = true;
+static int priority = 0;
+static bool verbose = false;
+static FILE *output = NULL;
+static IQS9320ShmWriter shm;
+static bool publish = false;
+static IQS9320RecordWriter recording;
+static bool record = false;
+
+static daemon_bus_s *buses[DAEMON_MAX_BUSES];
+static unsigned nBuses = 0;
+static std::atomic<bool> stop_workers(false);
+static std::atomic<bool> stop_aggregator(false);
+static volatile sig_atomic_t signalled = 0;
+
+static void on_signal(int sig)
+{
+  (void)sig;
+  signalled = 1;
+}
+
+static void histogram_add(daemon_histogram_s *histogram, uint64_t us)
+{
+  histogram->bins[(us < DAEMON_HISTOGRAM_US) ? us : DAEMON_HISTOGRAM_US]++;
+  histogram->count++;
+  histogram->max = (us > histogram->max) ? us : histogram->max;
+}
+
+/* Smallest bin that holds the fraction of the samples, in us */
+static uint64_t histogram_percentile(const daemon_histogram_s *histogram, double fraction)
+{
+  uint64_t target = (uint64_t)((double)histogram->count * fraction);
+  uint64_t sum = 0;
+
+  for(uint32_t i = 0; i <= DAEMON_HISTOGRAM_US; i++)
+  {
+    sum += histogram->bins[i];
+    if((sum > target) || (sum == histogram->count))
+    {
+      return (i < DAEMON_HISTOGRAM_US) ? i : histogram->max;
+    }
+  }
+  return 0;
+}
+
+static void sleep_until_us(uint64_t deadline)
+{
+  struct timespec ts;
+
+  ts.tv_sec = (time_t)(deadline / 1000000ULL);
+  ts.tv_nsec = (long)(deadline % 1000000ULL) * 1000L;
+  while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0)
+  {
+  }
+}
+
+static void pin_thread(int cpu)
+{
+  cpu_set_t set;
+
+  if(!pin || (cpu < 0))
+  {
+    return;
+  }
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+/*****************************************************************************/
+/*                                BUS WORKER                                 */
+/*****************************************************************************/
+/* Run the state machine of a device until it is idle, through init if the
+   device reset. Returns false when the daemon stops first. */
+static bool run_until_idle(IQS9320 *device)
+{
+  while(device->iqs9320_state.state != IQS9320_STATE_IDLE)
+  {
+    if(stop_workers.load(std::memory_order_relaxed))
+    {
+      return false;
+    }
+    device->run();
+  }
+  return true;
+}
+
+/* Start the devices of the bus and read them until the daemon stops */
+static void bus_run(daemon_bus_s *bus)
+{
+  iqs9320_frame_s frame = {};
+  daemon_frame_s out;
+  uint64_t deadline;
+
+  pin_thread(bus->cpu);
+  if(priority > 0)
+  {
+    struct sched_param param;
+    param.sched_priority = priority;
+    if(pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0)
+    {
+      fprintf(stderr, "bus %u: SCHED_FIFO not permitted, running with the default policy\n", bus->index);
+    }
+  }
+
+  /* Start-up routine of all devices, interleaved so that their ATI
+  routines overlap. Blocking on this bus only */
+  {
+    IQS9320Group group;
+    iqs9320_device_info_s found[DAEMON_MAX_DEVICES];
+    uint8_t nFound;
+
+    /* Identify the devices with one read each, the start-up then skips its
+    version reads */
+    nFound = bus->devices[0]->enumerate(bus->addresses, bus->nDevices, found, DAEMON_MAX_DEVICES);
+    for(uint8_t d = 0; d < bus->nDevices; d++)
+    {
+      for(uint8_t f = 0; f < nFound; f++)
+      {
+        if(found[f].address == bus->addresses[d])
+        {
+          bus->devices[d]->setVersionDetails(&found[f]);
+        }
+      }
+      group.add(bus->devices[d]);
+    }
+    group.start();
+    while(!group.run())
+    {
+      if(stop_workers.load(std::memory_order_relaxed))
+      {
+        group.stop();
+        return;
+      }
+      sleep_until_us(host_clock_us() + group.getWait());
+    }
+    for(uint8_t d = 0; d < bus->nDevices; d++)
+    {
+      if(!run_until_idle(bus->devices[d])) // Devices that are not an IQS9320
+      {
+        return;
+      }
+    }
+  }
+
+  deadline = host_clock_us();
+  while(!stop_workers.load(std::memory_order_relaxed))
+  {
+    /* Sample at a fixed rate, skip the intervals that were missed */
+    deadline += interval_us;
+    if(host_clock_us() > deadline + interval_us)
+    {
+      bus->overruns++;
+      deadline = host_clock_us();
+    }
+    sleep_until_us(deadline);
+
+    for(uint8_t d = 0; d < bus->nDevices; d++)
+    {
+      IQS9320 *device = bus->devices[d];
+
+      /* Read one frame, RUN -> CHECK_RESET -> IDLE */
+      device->requestData();
+      do
+      {
+        device->run();
+      } while((device->iqs9320_state.state != IQS9320_STATE_IDLE) && (device->iqs9320_state.state != IQS9320_STATE_START));
+
+      if(device->iqs9320_state.state == IQS9320_STATE_START)
+      {
+        bus->resets++;
+        run_until_idle(device);
+        continue;
+      }
+      if(!device->new_data_available)
+      {
+        continue;
+      }
+      device->new_data_available = false;
+
+      frame.nDevices = 0;
+      device->decodeFrame(&frame, 0);
+      out.sample_us = deadline;
+      out.done_us = host_clock_us();
+      out.bus = (uint8_t)bus->index;
+      out.slot = d;
+      out.system_status = frame.system_status[0];
+      out.activation = frame.activation[0];
+      out.filter_halt = frame.filter_halt[0];
+      out.nChannels = device->getChannelCount();
+      out.nDeltas = debug ? out.nChannels : 0;
+      memcpy(out.delta, frame.delta, sizeof(out.delta));
+      memcpy(out.norm, frame.norm, sizeof(out.norm));
+      memcpy(out.move, frame.move, sizeof(out.move));
+
+      histogram_add(&bus->read_time, out.done_us - out.sample_us);
+      bus->frames++;
+      if(!bus->queue.push(out))
+      {
+        bus->dropped++;
+      }
+    }
+
+    /* Every frame sampled before the next interval is queued */
+    bus->watermark.store(deadline + interval_us - 1, std::memory_order_release);
+  }
+}
+
+static void *bus_worker(void *arg)
+{
+  daemon_bus_s *bus = (daemon_bus_s *)arg;
+
+  bus_run(bus);
+
+  /* The bus no longer holds back the merge */
+  bus->watermark.store(UINT64_MAX, std::memory_order_release);
+  return NULL;
+}
+
+/*****************************************************************************/
+/*                                AGGREGATOR                                 */
+/*****************************************************************************/
+static bool frame_before(const daemon_frame_s &a, const daemon_frame_s &b)
+{
+  if(a.sample_us != b.sample_us)
+  {
+    return a.sample_us < b.sample_us;
+  }
+  if(a.bus != b.bus)
+  {
+    return a.bus < b.bus;
+  }
+  return a.slot < b.slot;
+}
+
+static void emit(const daemon_frame_s *frame, uint8_t seq)
+{
+  if(output)
+  {
+    iqs9320_stream_packet_s packet;
+    uint8_t buffer[IQS9320_STREAM_MAX_PACKET];
+
+    packet.type = frame->nDeltas ? IQS9320_STREAM_TYPE_DELTA : IQS9320_STREAM_TYPE_STATUS;
+    packet.seq = seq;
+    packet.slot = (uint8_t)(frame->bus * DAEMON_MAX_DEVICES + frame->slot);
+    packet.system_status = frame->system_status;
+    packet.activation = frame->activation;
+    packet.filter_halt = frame->filter_halt;
+    packet.nDeltas = frame->nDeltas;
+    memcpy(packet.delta, frame->delta, sizeof(packet.delta));
+    fwrite(buffer, 1, iqs9320_stream_encode(&packet, buffer), output);
+  }
+
+  if(publish)
+  {
+    iqs9320_shm_frame_s record;
+
+    record.timestamp_us = frame->sample_us;
+    record.system_status = frame->system_status;
+    record.slot = (uint8_t)(frame->bus * DAEMON_MAX_DEVICES + frame->slot);
+    record.nChannels = frame->nChannels;
+    record.activation = frame->activation;
+    record.filter_halt = frame->filter_halt;
+    record.reserved = 0;
+    memcpy(record.delta, frame->delta, sizeof(record.delta));
+    memcpy(record.norm, frame->norm, sizeof(record.norm));
+    memcpy(record.move, frame->move, sizeof(record.move));
+    shm.publish(&record);
+  }
+
+  if(record)
+  {
+    iqs9320_record_frame_s recorded;
+
+    recorded.timestamp_us = frame->sample_us;
+    recorded.slot = (uint8_t)(frame->bus * DAEMON_MAX_DEVICES + frame->slot);
+    recorded.nChannels = frame->nChannels;
+    recorded.fields = frame->nDeltas ? (IQS9320_RECORD_DELTA | IQS9320_RECORD_NORM | IQS9320_RECORD_MOVE) : 0;
+    recorded.system_status = frame->system_status;
+    recorded.activation = frame->activation;
+    recorded.filter_halt = frame->filter_halt;
+    memcpy(recorded.delta, frame->delta, sizeof(recorded.delta));
+    memcpy(recorded.norm, frame->norm, sizeof(recorded.norm));
+    memcpy(recorded.move, frame->move, sizeof(recorded.move));
+    recording.write(&recorded);
+  }
+
+  if(verbose)
+  {
+    printf("%12.3f  bus %2u  device %u  status 0x%04X  activation 0x%05X  halt 0x%05X\n",
+           (double)frame->sample_us / 1000.0, frame->bus, frame->slot, frame->system_status,
+           (unsigned)frame->activation, (unsigned)frame->filter_halt);
+  }
+}
+
+/* Drain all queues and emit the frames in sample time order. A frame is
+   held until every bus has queued the frames sampled up to its time, so the
+   order holds across buses and drains */
+static void *aggregator(void *arg)
+{
+  std::vector<daemon_frame_s> pending;
+  daemon_frame_s frame;
+  uint8_t seq = 0;
+
+  (void)arg;
+  pin_thread(0);
+  pending.reserve(DAEMON_MAX_BUSES * DAEMON_QUEUE_LENGTH);
+
+  for(;;)
+  {
+    bool stopping = stop_aggregator.load(std::memory_order_acquire);
+    uint64_t watermark = UINT64_MAX;
+    size_t ready = 0;
+
+    /* Read the watermarks before the queues, the frames they cover are then
+    all drained */
+    for(unsigned b = 0; b < nBuses; b++)
+    {
+      watermark = std::min(watermark, buses[b]->watermark.load(std::memory_order_acquire));
+    }
+    for(unsigned b = 0; b < nBuses; b++)
+    {
+      while(buses[b]->queue.pop(frame))
+      {
+        pending.push_back(frame);
+      }
+    }
+
+    std::sort(pending.begin(), pending.end(), frame_before);
+    while((ready < pending.size()) && (stopping || (pending[ready].sample_us <= watermark)))
+    {
+      ready++;
+    }
+
+    if(ready == 0)
+    {
+      if(stopping)
+      {
+        break;
+      }
+      sleep_until_us(host_clock_us() + DAEMON_POLL_US);
+      continue;
+    }
+
+    uint64_t now = host_clock_us();
+    for(size_t i = 0; i < ready; i++)
+    {
+      daemon_bus_s *bus = buses[pending[i].bus];
+
+      histogram_add(&bus->latency, now - pending[i].done_us);
+      bus->merged++;
+      emit(&pending[i], seq++);
+    }
+    pending.erase(pending.begin(), pending.begin() + ready);
+  }
+
+  if(output)
+  {
+    fflush(output);
+  }
+  return NULL;
+}
+
+/*****************************************************************************/
+/*                                   SETUP                                   */
+/*****************************************************************************/
+/* Parse /dev/i2c-N:0x30,0x31 or sim:<n> and create the devices */
+static bool open_bus(daemon_bus_s *bus, const char *spec)
+{
+  bus->spec = spec;
+
+  if(strncmp(spec, "sim:", 4) == 0)
+  {
+    unsigned count = (unsigned)strtoul(spec + 4, NULL, 10);
+
+    if((count == 0) || (count > DAEMON_MAX_DEVICES))
+    {
+      fprintf(stderr, "%s: 1 to %u devices per bus\n", spec, DAEMON_MAX_DEVICES);
+      return false;
+    }
+    for(unsigned d = 0; d < count; d++)
+    {
+      bus->addresses[d] = (uint8_t)(DAEMON_SIM_ADDRESS + d);
+      bus->sims[d] = new HostIQS9320Sim(bus->addresses[d], nChannels, (uint8_t)(bus->index * DAEMON_MAX_DEVICES + d));
+      bus->sim_bus.add(bus->sims[d]);
+    }
+    bus->nDevices = (uint8_t)count;
+    bus->sim_bus.setTimed(true);
+    bus->bus = &bus->sim_bus;
+  }
+  else
+  {
+    char path[64];
+    const char *colon = strrchr(spec, ':');
+    const char *p;
+
+    if(!colon)
+    {
+      fprintf(stderr, "%s: give the device addresses, e.g. /dev/i2c-1:0x30,0x31\n", spec);
+      return false;
+    }
+    snprintf(path, sizeof(path), "%.*s", (int)(colon - spec), spec);
+    if(!bus->i2cdev.open(path))
+    {
+      perror(path);
+      return false;
+    }
+
+    for(p = colon + 1; *p && (bus->nDevices < DAEMON_MAX_DEVICES); )
+    {
+      char *end;
+      bus->addresses[bus->nDevices++] = (uint8_t)strtol(p, &end, 0);
+      p = (*end == ',') ? end + 1 : end;
+      if(end == p)
+      {
+        break;
+      }
+    }
+    bus->bus = &bus->i2cdev;
+  }
+
+  for(uint8_t d = 0; d < bus->nDevices; d++)
+  {
+    bus->ports[d] = new HostTransferPort(bus->bus, clock_hz, false);
+    bus->devices[d] = new IQS9320();
+    bus->devices[d]->begin(bus->addresses[d], IQS9320_MCLR_NONE, nChannels);
+    bus->devices[d]->setTransferPort(bus->ports[d]);
+    bus->devices[d]->setClockLimit(clock_hz); // Trained up to the -k clock
+    if(debug)
+    {
+      bus->devices[d]->DebugOn();
+    }
+  }
+
+  return true;
+}
+
+static void usage(void)
+{
+  fprintf(stderr, "Usage: iqs9320-daemon [-i us] [-k hz] [-c channels] [-d] [-t seconds] [-o file] [-s name] [-w file] [-a] [-p prio] [-v] <bus> [<bus> ...]\n"
+                  "       <bus> is /dev/i2c-N:0x30[,0x31...] or sim:<devices>\n");
+}
+
+int main(int argc, char *argv[])
+{
+  double duration = 10.0;
+  const char *output_path = NULL;
+  const char *shm_name = NULL;
+  const char *record_path = NULL;
+  pthread_t aggregator_thread;
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  int opt;
+
+  while((opt = getopt(argc, argv, "i:k:c:dt:o:s:w:ap:vh")) != -1)
+  {
+    switch(opt)
+    {
+      case 'i':  interval_us = (uint32_t)strtoul(optarg, NULL, 10);  break;
+      case 'k':  clock_hz = (uint32_t)strtoul(optarg, NULL, 10);     break;
+      case 'c':  nChannels = (uint8_t)strtol(optarg, NULL, 10);      break;
+      case 'd':  debug = true;                                       break;
+      case 't':  duration = strtod(optarg, NULL);                    break;
+      case 'o':  output_path = optarg;                               break;
+      case 's':  shm_name = optarg;                                  break;
+      case 'w':  record_path = optarg;                               break;
+      case 'a':  pin = false;                                        break;
+      case 'p':  priority = (int)strtol(optarg, NULL, 10);           break;
+      case 'v':  verbose = true;                                     break;
+      default:
+        usage();
+        return 1;
+    }
+  }
+
+  if((optind >= argc) || (argc - optind > DAEMON_MAX_BUSES) || (interval_us == 0) || (clock_hz == 0)
+     || (nChannels == 0) || (nChannels > IQS9320_MAX_CHANNELS))
+  {
+    usage();
+    return 1;
+  }
+
+  if(output_path)
+  {
+    output = (strcmp(output_path, "-") == 0) ? stdout : fopen(output_path, "wb");
+    if(!output)
+    {
+      perror(output_path);
+      return 1;
+    }
+  }
+
+  if(shm_name)
+  {
+    if(!shm.create(shm_name))
+    {
+      perror(shm_name);
+      return 1;
+    }
+    publish = true;
+  }
+  if(record_path)
+  {
+    if(!recording.open(record_path))
+    {
+      perror(record_path);
+      return 1;
+    }
+    record = true;
+  }
+
+  /* The driver's delays and timestamps follow CLOCK_MONOTONIC */
+  host_clock_realtime(true);
+
+  for(int i = optind; i < argc; i++)
+  {
+    daemon_bus_s *bus = new daemon_bus_s();
+
+    bus->watermark.store(0);
+    bus->index = nBuses;
+    bus->cpu = (cpus > 1) ? (int)(1 + nBuses % (unsigned)(cpus - 1)) : 0;
+    buses[nBuses++] = bus;
+    if(!open_bus(bus, argv[i]))
+    {
+      return 1;
+    }
+  }
+
+  signal(SIGINT, on_signal);
+  signal(SIGTERM, on_signal);
+
+  pthread_create(&aggregator_thread, NULL, aggregator, NULL);
+  for(unsigned b = 0; b < nBuses; b++)
+  {
+    pthread_create(&buses[b]->thread, NULL, bus_worker, buses[b]);
+  }
+
+  uint64_t start = host_clock_us();
+  while(!signalled && ((duration <= 0) || ((double)(host_clock_us() - start) < duration * 1e6)))
+  {
+    sleep_until_us(host_clock_us() + 10000);
+  }
+
+  stop_workers.store(true);
+  for(unsigned b = 0; b < nBuses; b++)
+  {
+    pthread_join(buses[b]->thread, NULL);
+  }
+  stop_aggregator.store(true, std::memory_order_release);
+  pthread_join(aggregator_thread, NULL);
+
+  double elapsed = (double)(host_clock_us() - start) / 1e6;
+  uint64_t total = 0;
+
+  fprintf(stderr, "bus  devices  cpu    frames  dropped  resets  overruns  read p50/p99/max us  merge p50/p99/max us  spec\n");
+  for(unsigned b = 0; b < nBuses; b++)
+  {
+    daemon_bus_s *bus = buses[b];
+
+    fprintf(stderr, "%3u  %7u  %3d  %8llu  %7llu  %6llu  %8llu  %5llu %5llu %6llu    %5llu %5llu %6llu   %s\n",
+            b, bus->nDevices, pin ? bus->cpu : -1,
+            (unsigned long long)bus->frames, (unsigned long long)bus->dropped,
+            (unsigned long long)bus->resets, (unsigned long long)bus->overruns,
+            (unsigned long long)histogram_percentile(&bus->read_time, 0.50),
+            (unsigned long long)histogram_percentile(&bus->read_time, 0.99),
+            (unsigned long long)bus->read_time.max,
+            (unsigned long long)histogram_percentile(&bus->latency, 0.50),
+            (unsigned long long)histogram_percentile(&bus->latency, 0.99),
+            (unsigned long long)bus->latency.max, bus->spec);
+    total += bus->merged;
+  }
+  fprintf(stderr, "%llu frames merged in %.3f s (%.1f frames/s)\n",
+          (unsigned long long)total, elapsed, (elapsed > 0) ? (double)total / elapsed : 0.0);
+
+  if(output && (output != stdout))
+  {
+    fclose(output);
+  }
+  shm.close();
+  recording.close();
+  return 0;
+}
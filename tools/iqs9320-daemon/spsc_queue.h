@@ -0,0 +1,92 @@
+/******************************************************************************
+ *                                                                            *
+ *                                Copyright by                                *
+ *                                                                            *
+ *                              Azoteq (Pty) Ltd                              *
+ *                          Republic of South Africa                          *
+ *                                                                            *
+ *                           Tel: +27(0)21 863 0033                           *
+ *                           E-mail: info@azoteq.com                          *
+ *                                                                            *
+ * ========================================================================== *
+ * @file        spsc_queue.h                                                  *
+ * @brief       Lock-free single-producer single-consumer ring of fixed size  *
+ *              elements, used between a bus worker and the aggregator.       *
+ * @author      Azoteq PTY Ltd                                                *
+ * @version     v1.5.3                                                        *
+ * @date        2024                                                          *
+ * ========================================================================== *
+ * @attention  The head is only written by the consumer and the tail only by  *
+ *             the producer, each on its own cache line. Both sides keep a    *
+ *             cached copy of the other index and only reload it when the     *
+ *             ring looks full or empty.                                      *
+ ******************************************************************************/
+
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+#define SPSC_CACHE_LINE         64
+
+template <typename T, size_t N>
+class SpscQueue
+{
+        static_assert((N & (N - 1)) == 0, "N must be a power of two");
+
+public:
+        SpscQueue() : _head(0), _tail(0), _cached_head(0), _cached_tail(0) {}
+
+        /* Producer: copy an element in, false when the ring is full */
+        bool push(const T &item)
+        {
+                size_t tail = _tail.load(std::memory_order_relaxed);
+
+                if(tail - _cached_head >= N)
+                {
+                        _cached_head = _head.load(std::memory_order_acquire);
+                        if(tail - _cached_head >= N)
+                        {
+                                return false;
+                        }
+                }
+                _items[tail & (N - 1)] = item;
+                _tail.store(tail + 1, std::memory_order_release);
+                return true;
+        }
+
+        /* Consumer: copy the oldest element out, false when the ring is empty */
+        bool pop(T &item)
+        {
+                size_t head = _head.load(std::memory_order_relaxed);
+
+                if(head == _cached_tail)
+                {
+                        _cached_tail = _tail.load(std::memory_order_acquire);
+                        if(head == _cached_tail)
+                        {
+                                return false;
+                        }
+                }
+                item = _items[head & (N - 1)];
+                _head.store(head + 1, std::memory_order_release);
+                return true;
+        }
+
+        /* Either side: number of elements, exact only on the consumer */
+        size_t size(void) const
+        {
+                return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire);
+        }
+
+private:
+        alignas(SPSC_CACHE_LINE) std::atomic<size_t> _head;     // Consumer
+        alignas(SPSC_CACHE_LINE) std::atomic<size_t> _tail;     // Producer
+        alignas(SPSC_CACHE_LINE) size_t _cached_head;           // Producer's copy
+        alignas(SPSC_CACHE_LINE) size_t _cached_tail;           // Consumer's copy
+        alignas(SPSC_CACHE_LINE) T _items[N];
+};
+
+#endif // SPSC_QUEUE_H
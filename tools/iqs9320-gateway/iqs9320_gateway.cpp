@@ -0,0 +1,241 @@
+/******************************************************************************
+ *                                                                            *
+ *                                Copyright by                                *
+ *                                                                            *
+ *                              Azoteq (Pty) Ltd                              *
+ *                          Republic of South Africa                          *
+ *                                                                            *
+ *                           Tel: +27(0)21 863 0033                           *
+ *                           E-mail: info@azoteq.com                          *
+ *                                                                            *
+ * ========================================================================== *
+ * @file        iqs9320_gateway.cpp                                           *
+ * @brief       Runs many IQS9320 devices on one thread with the coroutine    *
+ *              driver. Every device is brought up and read at the frame      *
+ *              interval by its own coroutine, the executor interleaves them  *
+ *              while their transfers are on the bus.                         *
+ *                                                                            *
+ *              Usage: iqs9320-gateway [options] [/dev/i2c-N:address ...]     *
+ *                -n <count>    Simulated devices when no adapter is given    *
+ *                              (default 16)                                  *
+ *                -c <n>        Number of channels passed to begin()          *
+ *                              (default 20)                                  *
+ *                -f <frames>   Frames per device, 0 to run forever           *
+ *                              (default 100)                                 *
+ *                -i <ms>       Frame interval in milliseconds (default 10)   *
+ *                -k <hz>       I2C clock of the simulated buses              *
+ *                              (default 400000)                              *
+ *                -r            Run on the real-time clock, the default       *
+ *                              virtual clock runs as fast as possible        *
+ *                -v            Print every change of the activation flags    *
+ *                                                                            *
+ *              Build (Linux, GCC 10 or later):                               *
+ *                g++ -std=c++20 -O2 -I../host -I../../src/IQS9320            *
+ *                    iqs9320_gateway.cpp ../host/host_arduino.cpp            *
+ *                    ../host/host_port.cpp ../host/host_iqs9320_sim.cpp      *
+ *                    ../host/host_i2cdev.cpp                                 *
+ *                    ../../src/IQS9320/IQS9320.cpp                           *
+ *                    ../../src/IQS9320/IQS9320_coro.cpp                      *
+ *                    ../../src/IQS9320/IQS9320_trace.cpp                     *
+ *                    ../../src/IQS9320/IQS9320_transfer.cpp                  *
+ *                    -o iqs9320-gateway                                      *
+ * @author      Azoteq PTY Ltd                                                *
+ * @version     v1.5.3                                                        *
+ * @date        2024                                                          *
+ *****************************************************************************/
+
+/* Include Files */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <vector>
+
+#include "Arduino.h"
+#include "Wire.h"
+#include "IQS9320.h"
+#include "IQS9320_coro.h"
+#include "host_port.h"
+#include "host_iqs9320_sim.h"
+#include "host_i2cdev.h"
+
+#ifndef IQS9320_CORO_AVAILABLE
+#error "iqs9320-gateway needs C++20 coroutines, build with -std=c++20"
+#endif
+
+/* Devices on one executor */
+#define GATEWAY_MAX_DEVICES     128
+
+/**
+* @brief  One device with its bus, port and coroutine driver.
+*/
+typedef struct
+{
+        unsigned index;
+        HostI2CBus *bus;
+        HostTransferPort *port;
+        IQS9320 *device;
+        IQS9320Coro *driver;
+        uint32_t activation;
+        uint32_t presses;
+} gateway_device_s;
+
+static bool verbose = false;
+
+static double wall_seconds(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* Frame callback, counts new activations */
+static void on_frame(IQS9320 *device, void *context)
+{
+  gateway_device_s *gateway = (gateway_device_s *)context;
+  iqs9320_frame_s frame;
+
+  device->decodeFrame(&frame, 0);
+  if(frame.activation[0] != gateway->activation)
+  {
+    gateway->presses += (frame.activation[0] & ~gateway->activation) ? 1 : 0;
+    if(verbose)
+    {
+      printf("%10.3f  device %2u  activation 0x%05X\n", (double)host_clock_us() / 1000.0,
+             gateway->index, (unsigned)frame.activation[0]);
+    }
+  }
+  gateway->activation = frame.activation[0];
+}
+
+static void usage(void)
+{
+  fprintf(stderr, "Usage: iqs9320-gateway [-n devices] [-c channels] [-f frames] [-i ms] [-k hz] [-r] [-v] [/dev/i2c-N:address ...]\n");
+}
+
+int main(int argc, char *argv[])
+{
+  unsigned count = 16;
+  uint8_t nChannels = IQS9320_MAX_CHANNELS;
+  uint32_t frames = 100;
+  uint32_t interval = 10;
+  uint32_t clock = 400000;
+  bool realtime = false;
+  int opt;
+
+  while((opt = getopt(argc, argv, "n:c:f:i:k:rvh")) != -1)
+  {
+    switch(opt)
+    {
+      case 'n':  count = (unsigned)strtoul(optarg, NULL, 10);      break;
+      case 'c':  nChannels = (uint8_t)strtol(optarg, NULL, 10);    break;
+      case 'f':  frames = (uint32_t)strtoul(optarg, NULL, 10);     break;
+      case 'i':  interval = (uint32_t)strtoul(optarg, NULL, 10);   break;
+      case 'k':  clock = (uint32_t)strtoul(optarg, NULL, 10);      break;
+      case 'r':  realtime = true;                                  break;
+      case 'v':  verbose = true;                                   break;
+      default:
+        usage();
+        return 1;
+    }
+  }
+
+  if(optind < argc)
+  {
+    count = (unsigned)(argc - optind);
+  }
+  if((count == 0) || (count > GATEWAY_MAX_DEVICES) || (nChannels == 0) || (nChannels > IQS9320_MAX_CHANNELS) || (clock == 0))
+  {
+    usage();
+    return 1;
+  }
+
+  host_clock_realtime(realtime);
+
+  IQS9320Executor executor;
+  std::vector<gateway_device_s> devices(count);
+
+  for(unsigned i = 0; i < count; i++)
+  {
+    gateway_device_s *gateway = &devices[i];
+    uint8_t address = 0x30;
+
+    memset(gateway, 0, sizeof(*gateway));
+    gateway->index = i;
+
+    if(optind < argc)
+    {
+      /* A device on a Linux adapter, e.g. /dev/i2c-1:0x30 */
+      char path[64];
+      const char *colon = strrchr(argv[optind + i], ':');
+      size_t length = colon ? (size_t)(colon - argv[optind + i]) : strlen(argv[optind + i]);
+      HostI2CDevBus *i2cdev = new HostI2CDevBus();
+
+      snprintf(path, sizeof(path), "%.*s", (int)length, argv[optind + i]);
+      if(colon)
+      {
+        address = (uint8_t)strtol(colon + 1, NULL, 0);
+      }
+      if(!i2cdev->open(path))
+      {
+        perror(path);
+        return 1;
+      }
+      gateway->bus = i2cdev;
+      gateway->port = new HostTransferPort(i2cdev, clock, false);
+    }
+    else
+    {
+      /* A simulated device on its own bus, the port takes the wire time */
+      gateway->bus = new HostIQS9320Sim(address, nChannels, (uint8_t)i);
+      gateway->port = new HostTransferPort(gateway->bus, clock, true);
+    }
+
+    gateway->device = new IQS9320();
+    gateway->device->begin(address, IQS9320_MCLR_NONE, nChannels);
+    gateway->device->setTransferPort(gateway->port);
+    gateway->driver = new IQS9320Coro(executor, *gateway->device);
+
+    executor.spawn(gateway->driver->run(interval, frames, on_frame, gateway));
+  }
+
+  double start = wall_seconds();
+  uint64_t clock_start = host_clock_us();
+  uint64_t turns = 0;
+
+  while(executor.runOnce())
+  {
+    turns++;
+  }
+
+  double elapsed = wall_seconds() - start;
+  double run_time = (double)(host_clock_us() - clock_start) / 1e6;
+  uint64_t total = 0;
+  uint64_t bus_time = 0;
+
+  for(unsigned i = 0; i < count; i++)
+  {
+    gateway_device_s *gateway = &devices[i];
+
+    printf("device %2u  %6u frames  %4u presses  %u errors  %u resets  %u transfers\n",
+           i, (unsigned)gateway->driver->frames(), (unsigned)gateway->presses,
+           (unsigned)gateway->driver->errors(), (unsigned)gateway->driver->resets(),
+           (unsigned)gateway->port->transfers());
+    total += gateway->driver->frames();
+    bus_time += gateway->port->busTime();
+  }
+
+  fprintf(stderr, "%u devices, %llu frames in %.3f s device time (%.1f frames/s), bus busy %.1f%%, %llu turns, %.3f s wall\n",
+          count, (unsigned long long)total, run_time, (run_time > 0) ? (double)total / run_time : 0.0,
+          (run_time > 0) ? 100.0 * (double)bus_time / 1e6 / run_time / count : 0.0,
+          (unsigned long long)turns, elapsed);
+
+  for(unsigned i = 0; i < count; i++)
+  {
+    delete devices[i].driver;
+    devices[i].driver = NULL;
+  }
+
+  return 0;
+}
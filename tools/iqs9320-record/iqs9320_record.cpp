@@ -0,0 +1,251 @@
+/******************************************************************************
+ *                                                                            *
+ *                                Copyright by                                *
+ *                                                                            *
+ *                              Azoteq (Pty) Ltd                              *
+ *                          Republic of South Africa                          *
+ *                                                                            *
+ *                           Tel: +27(0)21 863 0033                           *
+ *                           E-mail: info@azoteq.com                          *
+ *                                                                            *
+ * ========================================================================== *
+ * @file        iqs9320_record.cpp                                            *
+ * @brief       Inspects and exports frame recordings (IQS9320_record.h), as  *
+ *              written by iqs9320-stream -w and iqs9320-daemon -w.           *
+ *                                                                            *
+ *              Usage: iqs9320-record [options] <file>                        *
+ *                -f <format>   info | csv | events (default info)            *
+ *                -s <s>        Start this many seconds after the first frame *
+ *                -e <s>        Stop this many seconds after the first frame  *
+ *                -c            Verify the checksum of every chunk            *
+ *                -b            Decode all frames and report the throughput   *
+ *                                                                            *
+ *              Build (Linux/macOS):                                          *
+ *                g++ -O2 -I../../src/IQS9320 iqs9320_record.cpp              *
+ *                    ../../src/IQS9320/IQS9320_record.cpp                    *
+ *                    -o iqs9320-record                                       *
+ * @author      Azoteq PTY Ltd                                                *
+ * @version     v1.5.3                                                        *
+ * @date        2024                                                          *
+ *****************************************************************************/
+
+/* Include Files */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "IQS9320_record.h"
+
+/* Output formats */
+typedef enum {
+        FORMAT_INFO = 0,
+        FORMAT_CSV,
+        FORMAT_EVENTS,
+} format_e;
+
+static double now_s(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void print_csv_header(void)
+{
+  printf("time_us,slot,system_status,activation,filter_halt");
+  for(uint8_t i = 0; i < IQS9320_MAX_CHANNELS; i++)
+  {
+    printf(",delta%u", i);
+  }
+  printf("\n");
+}
+
+static void print_csv(const iqs9320_record_frame_s *frame)
+{
+  printf("%llu,%u,0x%04X,0x%06X,0x%06X", (unsigned long long)frame->timestamp_us, frame->slot,
+         frame->system_status, (unsigned)frame->activation, (unsigned)frame->filter_halt);
+  for(uint8_t i = 0; i < IQS9320_MAX_CHANNELS; i++)
+  {
+    if((frame->fields & IQS9320_RECORD_DELTA) && (i < frame->nChannels))
+    {
+      printf(",%d", frame->delta[i]);
+    }
+    else
+    {
+      printf(",");
+    }
+  }
+  printf("\n");
+}
+
+/* Activation and halt changes per device, as iqs9320-stream -f events */
+static void print_event(const iqs9320_record_frame_s *frame, uint32_t activation[], uint32_t halt[])
+{
+  uint32_t pressed = frame->activation & ~activation[frame->slot];
+  uint32_t released = ~frame->activation & activation[frame->slot];
+  uint32_t halted = frame->filter_halt & ~halt[frame->slot];
+
+  for(uint8_t i = 0; i < IQS9320_MAX_CHANNELS; i++)
+  {
+    if(pressed & (1UL << i))
+    {
+      printf("%14.3f ms  slot %3u  CH%-2u pressed\n", (double)frame->timestamp_us / 1000.0, frame->slot, i);
+    }
+    if(released & (1UL << i))
+    {
+      printf("%14.3f ms  slot %3u  CH%-2u released\n", (double)frame->timestamp_us / 1000.0, frame->slot, i);
+    }
+    if(halted & (1UL << i))
+    {
+      printf("%14.3f ms  slot %3u  CH%-2u filter halt\n", (double)frame->timestamp_us / 1000.0, frame->slot, i);
+    }
+  }
+  activation[frame->slot] = frame->activation;
+  halt[frame->slot] = frame->filter_halt;
+}
+
+static void print_info(const IQS9320RecordReader *reader, const char *path)
+{
+  uint64_t frames = reader->frames();
+  double span = (double)(reader->lastTimestamp() - reader->firstTimestamp()) / 1e6;
+
+  printf("file        %s\n", path);
+  printf("size        %llu bytes\n", (unsigned long long)reader->size());
+  printf("chunks      %u%s\n", (unsigned)reader->chunks(), reader->recovered() ? " (not closed, index rebuilt)" : "");
+  printf("frames      %llu\n", (unsigned long long)frames);
+  printf("time        %llu .. %llu us (%.3f s)\n", (unsigned long long)reader->firstTimestamp(),
+         (unsigned long long)reader->lastTimestamp(), span);
+  if(frames)
+  {
+    printf("bytes/frame %.2f\n", (double)reader->size() / (double)frames);
+  }
+}
+
+static void usage(void)
+{
+  fprintf(stderr, "Usage: iqs9320-record [-f info|csv|events] [-s seconds] [-e seconds] [-c] [-b] <file>\n");
+}
+
+int main(int argc, char *argv[])
+{
+  IQS9320RecordReader reader;
+  iqs9320_record_frame_s frame;
+  format_e format = FORMAT_INFO;
+  double start_s = -1.0;
+  double end_s = -1.0;
+  bool check = false;
+  bool bench = false;
+  int opt;
+
+  while((opt = getopt(argc, argv, "f:s:e:cbh")) != -1)
+  {
+    switch(opt)
+    {
+      case 'f':
+        if(strcmp(optarg, "info") == 0)         format = FORMAT_INFO;
+        else if(strcmp(optarg, "csv") == 0)     format = FORMAT_CSV;
+        else if(strcmp(optarg, "events") == 0)  format = FORMAT_EVENTS;
+        else { usage(); return 1; }
+        break;
+      case 's':  start_s = strtod(optarg, NULL);  break;
+      case 'e':  end_s = strtod(optarg, NULL);    break;
+      case 'c':  check = true;                    break;
+      case 'b':  bench = true;                    break;
+      default:
+        usage();
+        return 1;
+    }
+  }
+
+  if(optind >= argc)
+  {
+    usage();
+    return 1;
+  }
+  if(!reader.open(argv[optind]))
+  {
+    fprintf(stderr, "%s: not a frame recording\n", argv[optind]);
+    return 1;
+  }
+
+  if(format == FORMAT_INFO)
+  {
+    print_info(&reader, argv[optind]);
+  }
+
+  if(check)
+  {
+    uint32_t bad = 0;
+
+    for(uint32_t i = 0; i < reader.chunks(); i++)
+    {
+      if(!reader.verify(i))
+      {
+        fprintf(stderr, "chunk %u at offset %llu: checksum mismatch\n", (unsigned)i, (unsigned long long)reader.chunk(i)->offset);
+        bad++;
+      }
+    }
+    fprintf(stderr, "%u of %u chunks valid\n", (unsigned)(reader.chunks() - bad), (unsigned)reader.chunks());
+    if(bad)
+    {
+      return 1;
+    }
+  }
+
+  if(bench)
+  {
+    double t0 = now_s();
+    uint64_t count = 0;
+    uint64_t pressed = 0;
+
+    while(reader.next(&frame))
+    {
+      pressed += (frame.activation != 0);
+      count++;
+    }
+    double elapsed = now_s() - t0;
+    fprintf(stderr, "%llu frames (%llu with a key pressed) decoded in %.3f s: %.1f Mframes/s, %.1f MB/s\n",
+            (unsigned long long)count, (unsigned long long)pressed, elapsed, (double)count / elapsed / 1e6,
+            (double)reader.size() / elapsed / 1e6);
+    return reader.errors() ? 1 : 0;
+  }
+
+  if(format == FORMAT_INFO)
+  {
+    return 0;
+  }
+
+  uint64_t end_us = (end_s >= 0.0) ? reader.firstTimestamp() + (uint64_t)(end_s * 1e6) : UINT64_MAX;
+  uint32_t activation[IQS9320_RECORD_SLOTS] = {0};
+  uint32_t halt[IQS9320_RECORD_SLOTS] = {0};
+
+  if((start_s > 0.0) && !reader.seek(reader.firstTimestamp() + (uint64_t)(start_s * 1e6)))
+  {
+    return 0;
+  }
+  if(format == FORMAT_CSV)
+  {
+    print_csv_header();
+  }
+  while(reader.next(&frame) && (frame.timestamp_us <= end_us))
+  {
+    if(format == FORMAT_CSV)
+    {
+      print_csv(&frame);
+    }
+    else
+    {
+      print_event(&frame, activation, halt);
+    }
+  }
+
+  if(reader.errors())
+  {
+    fprintf(stderr, "%u chunks could not be decoded\n", (unsigned)reader.errors());
+    return 1;
+  }
+  return 0;
+}
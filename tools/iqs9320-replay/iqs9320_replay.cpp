@@ -0,0 +1,445 @@
+/******************************************************************************
+ *                                                                            *
+ *                                Copyright by                                *
+ *                                                                            *
+ *                              Azoteq (Pty) Ltd                              *
+ *                          Republic of South Africa                          *
+ *                                                                            *
+ *                           Tel: +27(0)21 863 0033                           *
+ *                           E-mail: info@azoteq.com                          *
+ *                                                                            *
+ * ========================================================================== *
+ * @file        iqs9320_replay.cpp                                            *
+ * @brief       Replays a captured I2C trace through the IQS9320 driver on a  *
+ *              PC. Every transaction the driver makes is served from the     *
+ *              trace and compared against it, the clock follows the trace    *
+ *              timestamps, so a replay is deterministic and runs as fast as  *
+ *              the driver allows.                                            *
+ *                                                                            *
+ *              Usage: iqs9320-replay [options] <trace file | ->              *
+ *                -c <n>        Number of channels passed to begin()          *
+ *                              (default 20)                                  *
+ *                -d            Enable debug streaming (DebugOn), use when    *
+ *                              the capture was made with deltas enabled      *
+ *                -r            The capture starts in the run state, i.e.     *
+ *                              after the device was initialised              *
+ *                -n <count>    Replay the trace count times (default 1)      *
+ *                -q            Only print the summary                        *
+ *                -v            Print the driver's Serial output to stderr    *
+ *                                                                            *
+ *              Create a trace with a DEMO_IQS9320_BUS_CAPTURE build of the   *
+ *              example sketch and iqs9320-stream -f trace.                   *
+ *                                                                            *
+ *              Build (Linux/macOS):                                          *
+ *                g++ -O2 -I../host -I../../src/IQS9320 iqs9320_replay.cpp    *
+ *                    ../host/host_arduino.cpp ../../src/IQS9320/IQS9320.cpp  *
+ *                    ../../src/IQS9320/IQS9320_trace.cpp                     *
+ *                    ../../src/IQS9320/IQS9320_transfer.cpp                  *
+ *                    -o iqs9320-replay                                       *
+ * @author      Azoteq PTY Ltd                                                *
+ * @version     v1.5.3                                                        *
+ * @date        2024                                                          *
+ *****************************************************************************/
+
+/* Include Files */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <vector>
+
+#include "Arduino.h"
+#include "Wire.h"
+#include "IQS9320.h"
+
+/* How far ahead to look for the driver's transaction after a divergence */
+#define REPLAY_RESYNC_WINDOW    64
+
+/* Give up after this many driver iterations without a served transaction */
+#define REPLAY_STALL_LIMIT      100000
+
+/* Print at most this many divergences */
+#define REPLAY_MAX_REPORTS      20
+
+/* One decoded trace record with an absolute 64-bit timestamp */
+typedef struct
+{
+        iqs9320_trace_record_s record;
+        uint64_t time_us;
+} replay_entry_s;
+
+/* Load a trace file, the record data keeps pointing into the file buffer */
+static bool load_trace(FILE *in, std::vector<uint8_t> &file, std::vector<replay_entry_s> &entries)
+{
+  uint8_t buffer[4096];
+  size_t n;
+
+  while((n = fread(buffer, 1, sizeof(buffer), in)) > 0)
+  {
+    file.insert(file.end(), buffer, buffer + n);
+  }
+
+  if((file.size() < IQS9320_TRACE_MAGIC_SIZE) || (memcmp(&file[0], IQS9320_TRACE_MAGIC, IQS9320_TRACE_MAGIC_SIZE) != 0))
+  {
+    fprintf(stderr, "Not an IQS9320 trace file\n");
+    return false;
+  }
+
+  size_t offset = IQS9320_TRACE_MAGIC_SIZE;
+  uint32_t previous = 0;
+  uint64_t time_us = 0;
+
+  while(offset < file.size())
+  {
+    replay_entry_s entry;
+    size_t used = iqs9320_trace_decode(&file[offset], file.size() - offset, previous, &entry.record);
+    if(used == 0)
+    {
+      fprintf(stderr, "Trace truncated or corrupt at byte %u, %u records loaded\n",
+              (unsigned)offset, (unsigned)entries.size());
+      break;
+    }
+
+    /* The first record only sets the time base */
+    time_us += entries.empty() ? 0 : (uint32_t)(entry.record.timestamp - previous);
+    entry.time_us = time_us;
+    previous = entry.record.timestamp;
+    offset += used;
+
+    entries.push_back(entry);
+  }
+
+  return !entries.empty();
+}
+
+/**
+* @brief  I2C back-end that serves the driver's transactions from a trace.
+* @note   A read is seen as an address write without STOP, followed by
+*         requestFrom(). The first requestFrom() consumes the read record,
+*         retries the driver makes after an empty read get no data, as in the
+*         capture.
+*/
+class TraceBus : public HostI2CBus
+{
+public:
+        TraceBus(const std::vector<replay_entry_s> &entries, uint64_t time_base, bool quiet);
+
+        uint8_t write(uint8_t address, const uint8_t data[], size_t length, bool stop);
+        size_t read(uint8_t address, uint8_t data[], size_t length, bool stop);
+
+        bool done(void) const { return _index >= _entries.size(); }
+        uint64_t endTime(void) const { return _time_base + _entries.back().time_us; }
+
+        uint32_t transactions;
+        uint32_t divergences;
+
+private:
+        const std::vector<replay_entry_s> &_entries;
+        size_t _index;
+        uint64_t _time_base;
+        bool _quiet;
+        const iqs9320_trace_record_s *_pending;
+
+        const iqs9320_trace_record_s *next(uint8_t op, uint8_t address, uint16_t reg);
+        void diverge(const char *what, uint8_t address, uint16_t reg, const iqs9320_trace_record_s *expected);
+};
+
+TraceBus::TraceBus(const std::vector<replay_entry_s> &entries, uint64_t time_base, bool quiet)
+  : _entries(entries)
+{
+  transactions = 0;
+  divergences = 0;
+  _index = 0;
+  _time_base = time_base;
+  _quiet = quiet;
+  _pending = NULL;
+}
+
+/* Report the driver leaving the recorded sequence */
+void TraceBus::diverge(const char *what, uint8_t address, uint16_t reg, const iqs9320_trace_record_s *expected)
+{
+  divergences++;
+  if(_quiet || (divergences > REPLAY_MAX_REPORTS))
+  {
+    return;
+  }
+
+  fprintf(stderr, "record %u: %s 0x%02X:0x%04X", (unsigned)_index, what, address, reg);
+  if(expected)
+  {
+    fprintf(stderr, ", trace has %s 0x%02X:0x%04X",
+            (expected->flags & IQS9320_TRACE_READ) ? "read" : "write", expected->device, expected->reg);
+  }
+  fprintf(stderr, "\n");
+}
+
+/* Find the record for the driver's transaction, skipping ahead when the
+   driver and the trace disagree */
+const iqs9320_trace_record_s *TraceBus::next(uint8_t op, uint8_t address, uint16_t reg)
+{
+  const char *what = (op == IQS9320_TRACE_READ) ? "driver read" : "driver write";
+
+  if(done())
+  {
+    return NULL;
+  }
+
+  size_t end = _index + REPLAY_RESYNC_WINDOW;
+  if(end > _entries.size())
+  {
+    end = _entries.size();
+  }
+
+  for(size_t i = _index; i < end; i++)
+  {
+    const iqs9320_trace_record_s *r = &_entries[i].record;
+    if(((r->flags & IQS9320_TRACE_OP_MASK) == op) && (r->device == address) && (r->reg == reg))
+    {
+      if(i != _index)
+      {
+        diverge(what, address, reg, &_entries[_index].record);
+      }
+      _index = i + 1;
+
+      /* Never move the clock backwards, the driver's own delays count too */
+      uint64_t t = _time_base + _entries[i].time_us;
+      if(t > host_clock_us())
+      {
+        host_clock_set_us(t);
+      }
+      transactions++;
+      return r;
+    }
+  }
+
+  diverge(what, address, reg, &_entries[_index].record);
+  return NULL;
+}
+
+uint8_t TraceBus::write(uint8_t address, const uint8_t data[], size_t length, bool stop)
+{
+  if(length < 2)
+  {
+    return 4;
+  }
+
+  uint16_t reg = (uint16_t)data[0] | ((uint16_t)data[1] << 8);
+
+  /* Register selection of a read */
+  if((length == 2) && !stop)
+  {
+    _pending = next(IQS9320_TRACE_READ, address, reg);
+    if(!_pending)
+    {
+      return 2;
+    }
+    return (_pending->flags & IQS9320_TRACE_NACK) ? 2 : 0;
+  }
+
+  const iqs9320_trace_record_s *r = next(IQS9320_TRACE_WRITE, address, reg);
+  if(!r)
+  {
+    return 2;
+  }
+
+  if((r->length != length - 2) || (memcmp(r->data, &data[2], r->length) != 0))
+  {
+    diverge("data differs on write", address, reg, NULL);
+  }
+  if(((r->flags & IQS9320_TRACE_STOP) != 0) != stop)
+  {
+    diverge("stop differs on write", address, reg, NULL);
+  }
+
+  return (r->flags & IQS9320_TRACE_NACK) ? 3 : 0;
+}
+
+size_t TraceBus::read(uint8_t address, uint8_t data[], size_t length, bool stop)
+{
+  const iqs9320_trace_record_s *r = _pending;
+  _pending = NULL;
+
+  if(!r)
+  {
+    return 0;
+  }
+
+  if(r->requested != length)
+  {
+    diverge("length differs on read", address, r->reg, NULL);
+  }
+  if(((r->flags & IQS9320_TRACE_STOP) != 0) != stop)
+  {
+    diverge("stop differs on read", address, r->reg, NULL);
+  }
+
+  size_t n = (r->length < length) ? r->length : length;
+  memcpy(data, r->data, n);
+  return n;
+}
+
+/* Monotonic wall clock for the throughput figures */
+static double wall_seconds(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void usage(void)
+{
+  fprintf(stderr, "Usage: iqs9320-replay [-c channels] [-d] [-r] [-n count] [-q] [-v] <trace|->\n");
+}
+
+int main(int argc, char *argv[])
+{
+  uint8_t nChannels = IQS9320_MAX_CHANNELS;
+  bool debug = false;
+  bool run_state = false;
+  bool quiet = false;
+  long repeat = 1;
+  int opt;
+
+  while((opt = getopt(argc, argv, "c:drn:qvh")) != -1)
+  {
+    switch(opt)
+    {
+      case 'c':  nChannels = (uint8_t)strtol(optarg, NULL, 10);  break;
+      case 'd':  debug = true;                                   break;
+      case 'r':  run_state = true;                               break;
+      case 'n':  repeat = strtol(optarg, NULL, 10);              break;
+      case 'q':  quiet = true;                                   break;
+      case 'v':  Serial.setOutput(stderr);                       break;
+      default:
+        usage();
+        return 1;
+    }
+  }
+
+  if((optind >= argc) || (repeat < 1) || (nChannels == 0) || (nChannels > IQS9320_MAX_CHANNELS))
+  {
+    usage();
+    return 1;
+  }
+
+  FILE *in = stdin;
+  if(strcmp(argv[optind], "-") != 0)
+  {
+    in = fopen(argv[optind], "rb");
+    if(!in)
+    {
+      perror(argv[optind]);
+      return 1;
+    }
+  }
+
+  std::vector<uint8_t> file;
+  std::vector<replay_entry_s> entries;
+  if(!load_trace(in, file, entries))
+  {
+    return 1;
+  }
+
+  uint8_t address = entries[0].record.device;
+  uint64_t frames = 0;
+  uint64_t resets = 0;
+  uint64_t transactions = 0;
+  uint64_t divergences = 0;
+  uint64_t time_base = 0;
+  double start = wall_seconds();
+
+  host_clock_realtime(false);
+  host_clock_set_us(0);
+
+  for(long pass = 0; pass < repeat; pass++)
+  {
+    TraceBus bus(entries, time_base, quiet);
+    IQS9320 iqs9320;
+    iqs9320_frame_s frame;
+    uint32_t activation = 0;
+    uint32_t filter_halt = 0;
+    uint16_t status = 0;
+    bool first = true;
+    uint32_t stalled = 0;
+
+    Wire.setBus(&bus);
+    iqs9320.begin(address, IQS9320_MCLR_NONE, nChannels);
+    if(debug)
+    {
+      iqs9320.DebugOn();
+    }
+    if(run_state)
+    {
+      iqs9320.iqs9320_state.state = IQS9320_STATE_IDLE;
+    }
+
+    /* Request the next frame as soon as the driver is idle, the trace
+       timestamps set the pace */
+    while(!bus.done())
+    {
+      iqs9320_state_e before = iqs9320.iqs9320_state.state;
+      uint32_t served = bus.transactions;
+
+      iqs9320.run();
+
+      if((before != IQS9320_STATE_START) && (iqs9320.iqs9320_state.state == IQS9320_STATE_START))
+      {
+        resets++;
+        if(!quiet)
+        {
+          printf("%10.3f  reset\n", (double)host_clock_us() / 1000.0);
+        }
+      }
+
+      if(iqs9320.iqs9320_state.state == IQS9320_STATE_IDLE)
+      {
+        iqs9320.requestData();
+      }
+
+      if(iqs9320.new_data_available)
+      {
+        iqs9320.decodeFrame(&frame, 0);
+        frames++;
+
+        if(!quiet && (first || (frame.activation[0] != activation) || (frame.filter_halt[0] != filter_halt)
+           || ((frame.system_status[0] ^ status) & 0xFF)))
+        {
+          printf("%10.3f  status 0x%04X  activation 0x%05X  halt 0x%05X\n",
+                 (double)host_clock_us() / 1000.0, frame.system_status[0],
+                 (unsigned)frame.activation[0], (unsigned)frame.filter_halt[0]);
+        }
+        activation = frame.activation[0];
+        filter_halt = frame.filter_halt[0];
+        status = frame.system_status[0];
+        first = false;
+
+        iqs9320.new_data_available = false;
+      }
+
+      /* Stop when the driver no longer consumes the trace, e.g. it is
+         stuck in an init step the capture does not contain */
+      stalled = (bus.transactions == served) ? stalled + 1 : 0;
+      if(stalled >= REPLAY_STALL_LIMIT)
+      {
+        fprintf(stderr, "Driver stalled at record %u\n", (unsigned)bus.transactions);
+        break;
+      }
+    }
+
+    transactions += bus.transactions;
+    divergences += bus.divergences;
+    time_base = bus.endTime() + 1;
+    Wire.setBus(NULL);
+  }
+
+  double elapsed = wall_seconds() - start;
+
+  fprintf(stderr, "%u records x %ld, %llu transactions, %llu divergences, %llu frames, %llu resets\n",
+          (unsigned)entries.size(), repeat, (unsigned long long)transactions,
+          (unsigned long long)divergences, (unsigned long long)frames, (unsigned long long)resets);
+  fprintf(stderr, "%.3f s trace time in %.3f s, %.0f frames/s\n",
+          (double)time_base / 1e6, elapsed, (elapsed > 0) ? (double)frames / elapsed : 0.0);
+
+  return (divergences == 0) ? 0 : 2;
+}
@@ -0,0 +1,146 @@
+/******************************************************************************
+ *                                                                            *
+ *                                Copyright by                                *
+ *                                                                            *
+ *                              Azoteq (Pty) Ltd                              *
+ *                          Republic of South Africa                          *
+ *                                                                            *
+ *                           Tel: +27(0)21 863 0033                           *
+ *                           E-mail: info@azoteq.com                          *
+ *                                                                            *
+ * ========================================================================== *
+ * @file        iqs9320_shm.cpp                                               *
+ * @brief       Reader of the shared-memory frame ring published by           *
+ *              iqs9320-daemon -s. Prints the frames, or counts them, and     *
+ *              reports the frames lost because the reader fell behind.       *
+ *                                                                            *
+ *              Usage: iqs9320-shm [options] [name]                           *
+ *                name          Ring name (default /iqs9320)                  *
+ *                -n <frames>   Stop after this many frames                   *
+ *                -q            Only print the frame rate once per second     *
+ *                -d            Print the deltas as well                      *
+ *                                                                            *
+ *              Build (Linux):                                                *
+ *                g++ -O2 -I../../src/IQS9320 iqs9320_shm.cpp                 *
+ *                    ../../src/IQS9320/IQS9320_shm.cpp -lrt                  *
+ *                    -o iqs9320-shm                                          *
+ * @author      Azoteq PTY Ltd                                                *
+ * @version     v1.5.3                                                        *
+ * @date        2024                                                          *
+ *****************************************************************************/
+
+/* Include Files */
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "IQS9320_shm.h"
+
+static volatile sig_atomic_t signalled = 0;
+
+static void on_signal(int sig)
+{
+  (void)sig;
+  signalled = 1;
+}
+
+static uint64_t now_us(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+static void print_frame(const iqs9320_shm_frame_s *frame, bool deltas)
+{
+  printf("%10llu %12.3f  slot %3u  status 0x%04X  activation 0x%05X  halt 0x%05X",
+         (unsigned long long)frame->sequence, (double)frame->timestamp_us / 1000.0, frame->slot,
+         frame->system_status, (unsigned)frame->activation, (unsigned)frame->filter_halt);
+  if(deltas)
+  {
+    for(uint8_t i = 0; i < frame->nChannels; i++)
+    {
+      printf(" %d", frame->delta[i]);
+    }
+  }
+  printf("\n");
+}
+
+int main(int argc, char *argv[])
+{
+  IQS9320ShmReader reader;
+  const char *name = IQS9320_SHM_NAME;
+  uint64_t limit = 0;
+  uint64_t count = 0;
+  uint64_t interval_count = 0;
+  uint64_t report_us;
+  bool quiet = false;
+  bool deltas = false;
+  int opt;
+
+  while((opt = getopt(argc, argv, "n:qdh")) != -1)
+  {
+    switch(opt)
+    {
+      case 'n':  limit = strtoull(optarg, NULL, 10);  break;
+      case 'q':  quiet = true;                        break;
+      case 'd':  deltas = true;                       break;
+      default:
+        fprintf(stderr, "Usage: iqs9320-shm [-n frames] [-q] [-d] [name]\n");
+        return 1;
+    }
+  }
+  if(optind < argc)
+  {
+    name = argv[optind];
+  }
+
+  if(!reader.open(name))
+  {
+    fprintf(stderr, "%s: no compatible frame ring, is the writer running?\n", name);
+    return 1;
+  }
+
+  signal(SIGINT, on_signal);
+  signal(SIGTERM, on_signal);
+
+  report_us = now_us() + 1000000ULL;
+  while(!signalled && ((limit == 0) || (count < limit)))
+  {
+    const iqs9320_shm_frame_s *frame;
+
+    if(!reader.wait(100))
+    {
+      continue;
+    }
+
+    /* Consume in place, the copy on the stack is only made for printing */
+    while(((frame = reader.peek()) != NULL) && ((limit == 0) || (count < limit)))
+    {
+      iqs9320_shm_frame_s copy = *frame;
+
+      if(reader.consume())
+      {
+        count++;
+        interval_count++;
+        if(!quiet)
+        {
+          print_frame(&copy, deltas);
+        }
+      }
+    }
+
+    if(quiet && (now_us() >= report_us))
+    {
+      fprintf(stderr, "%llu frames/s, %llu lost\n", (unsigned long long)interval_count, (unsigned long long)reader.lost());
+      interval_count = 0;
+      report_us += 1000000ULL;
+    }
+  }
+
+  fprintf(stderr, "%llu frames read, %llu lost\n", (unsigned long long)count, (unsigned long long)reader.lost());
+  return 0;
+}
@@ -0,0 +1,350 @@
+/******************************************************************************
+ *                                                                            *
+ *                                Copyright by                                *
+ *                                                                            *
+ *                              Azoteq (Pty) Ltd                              *
+ *                          Republic of South Africa                          *
+ *                                                                            *
+ *                           Tel: +27(0)21 863 0033                           *
+ *                           E-mail: info@azoteq.com                          *
+ *                                                                            *
+ * ========================================================================== *
+ * @file        iqs9320_stream.cpp                                            *
+ * @brief       PC decoder for the binary stream sent by the example sketch   *
+ *              when DEMO_IQS9320_BINARY_STREAM is enabled.                   *
+ *                                                                            *
+ *              Usage: iqs9320-stream [options] <serial port | file | ->      *
+ *                -b <baud>     Serial baud rate (default 115200)             *
+ *                -f <format>   events | table | csv | trace (default events) *
+ *                              trace writes the bus capture records of a     *
+ *                              DEMO_IQS9320_BUS_CAPTURE build to stdout as a *
+ *                              trace file for tools/iqs9320-replay           *
+ *                -l <layout>   EV-Kit key layout for the table:              *
+ *                              v1.0 (also v0.7) or v0.4 (default v1.0)       *
+ *                -w <file>     Also record the status and delta packets,     *
+ *                              with the time they arrived, in a frame        *
+ *                              recording (see IQS9320_record.h)              *
+ *                                                                            *
+ *              Build (Linux/macOS):                                          *
+ *                g++ -O2 -I../../src/IQS9320 iqs9320_stream.cpp              *
+ *                    ../../src/IQS9320/IQS9320_stream.cpp                    *
+ *                    ../../src/IQS9320/IQS9320_record.cpp -o iqs9320-stream  *
+ * @author      Azoteq PTY Ltd                                                *
+ * @version     v1.5.3                                                        *
+ * @date        2024                                                          *
+ *****************************************************************************/
+
+/* Include Files */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <termios.h>
+#include <time.h>
+
+#include "IQS9320_record.h"
+#include "IQS9320_stream.h"
+
+/* Output formats */
+typedef enum {
+        FORMAT_EVENTS = 0,
+        FORMAT_TABLE,
+        FORMAT_CSV,
+        FORMAT_TRACE,
+} format_e;
+
+/* Channel layout for the keys on EV-Kit, same as the example sketch */
+static const uint8_t ch_seq_v1_0[IQS9320_MAX_CHANNELS] = {8,  18, 7,  17,
+                                                          19, 9,  6,  16,
+                                                          2,  11, 14, 5,
+                                                          10, 0,  4,  15,
+                                                          1,  12, 13, 3};
+
+static const uint8_t ch_seq_v0_4[IQS9320_MAX_CHANNELS] = {1,  11, 2,  12,
+                                                          10, 0,  3,  13,
+                                                          7,  18, 15, 4,
+                                                          19, 9,  5,  14,
+                                                          8,  17, 16, 6};
+
+static const char *power_mode_names[4] = {"Normal Power", "Low Power", "Ultra Low Power", "Unknown"};
+
+/* Configure a serial port for raw 8N1 reception */
+static bool configure_serial(int fd, long baud)
+{
+  struct termios tty;
+  speed_t speed;
+
+  switch(baud)
+  {
+    case 9600:    speed = B9600;    break;
+    case 57600:   speed = B57600;   break;
+    case 115200:  speed = B115200;  break;
+    case 230400:  speed = B230400;  break;
+    default:
+      fprintf(stderr, "Unsupported baud rate %ld\n", baud);
+      return false;
+  }
+
+  if(tcgetattr(fd, &tty) != 0)
+  {
+    return false;
+  }
+
+  cfmakeraw(&tty);
+  cfsetispeed(&tty, speed);
+  cfsetospeed(&tty, speed);
+  tty.c_cflag |= (CLOCAL | CREAD);
+  tty.c_cc[VMIN] = 1;
+  tty.c_cc[VTIME] = 0;
+
+  return tcsetattr(fd, TCSANOW, &tty) == 0;
+}
+
+/* Same table as serial_ui_print() in the example sketch */
+static void print_table(const iqs9320_stream_packet_s *p, const uint8_t ch_seq[])
+{
+  printf("\n    IQS9320 20-KEY EV-KIT    \n");
+  printf("=============================\n|");
+
+  for(uint8_t i = 0; i < IQS9320_MAX_CHANNELS; i++)
+  {
+    if(i % 4 == 0 && i != 0)
+    {
+      printf(" \n|---------------------------|\n|");
+    }
+
+    if((p->activation >> ch_seq[i]) & 0x01)
+    {
+      printf("██████|");
+    }
+    else
+    {
+      printf(" CH%-3u|", ch_seq[i]);
+    }
+  }
+
+  printf(" \n|---------------------------|\n");
+  const char *pm = power_mode_names[p->system_status & 0x03];
+  int pad = 27 - (int)strlen(pm);
+  printf("|%*s%s%*s|\n", pad - pad/2, "", pm, pad/2, "");
+  printf("=============================\n\n");
+}
+
+static void print_csv_header(void)
+{
+  printf("seq,slot,system_status,activation,filter_halt");
+  for(uint8_t i = 0; i < IQS9320_MAX_CHANNELS; i++)
+  {
+    printf(",delta%u", i);
+  }
+  printf("\n");
+}
+
+static void print_csv(const iqs9320_stream_packet_s *p)
+{
+  printf("%u,%u,0x%04X,0x%06X,0x%06X", p->seq, p->slot, p->system_status,
+         (unsigned)p->activation, (unsigned)p->filter_halt);
+  for(uint8_t i = 0; i < IQS9320_MAX_CHANNELS; i++)
+  {
+    if(i < p->nDeltas)
+    {
+      printf(",%d", p->delta[i]);
+    }
+    else
+    {
+      printf(",");
+    }
+  }
+  printf("\n");
+}
+
+static void print_event(const iqs9320_stream_packet_s *p)
+{
+  printf("#%-3u dev %u  %-15s  act 0x%05X  halt 0x%05X",
+         p->seq, p->slot, power_mode_names[p->system_status & 0x03],
+         (unsigned)p->activation, (unsigned)p->filter_halt);
+  for(uint8_t i = 0; i < p->nDeltas; i++)
+  {
+    printf(" %d", p->delta[i]);
+  }
+  printf("\n");
+}
+
+/* SIGINT ends the read loop so that the recording is closed */
+static void on_signal(int sig)
+{
+  (void)sig;
+}
+
+static void record(IQS9320RecordWriter *writer, const iqs9320_stream_packet_s *p)
+{
+  iqs9320_record_frame_s frame;
+  struct timespec ts;
+
+  clock_gettime(CLOCK_REALTIME, &ts);
+  memset(&frame, 0, sizeof(frame));
+  frame.timestamp_us = (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+  frame.slot = p->slot;
+  frame.nChannels = p->nDeltas ? p->nDeltas : IQS9320_MAX_CHANNELS;
+  frame.fields = p->nDeltas ? IQS9320_RECORD_DELTA : 0;
+  frame.system_status = p->system_status;
+  frame.activation = p->activation;
+  frame.filter_halt = p->filter_halt;
+  memcpy(frame.delta, p->delta, sizeof(frame.delta));
+  writer->write(&frame);
+}
+
+static void usage(void)
+{
+  fprintf(stderr, "Usage: iqs9320-stream [-b baud] [-f events|table|csv|trace] [-l v1.0|v0.4] [-w recording] <port|file|->\n");
+}
+
+int main(int argc, char *argv[])
+{
+  long baud = 115200;
+  format_e format = FORMAT_EVENTS;
+  const uint8_t *ch_seq = ch_seq_v1_0;
+  IQS9320RecordWriter writer;
+  const char *record_path = NULL;
+  int opt;
+
+  while((opt = getopt(argc, argv, "b:f:l:w:h")) != -1)
+  {
+    switch(opt)
+    {
+      case 'b':
+        baud = strtol(optarg, NULL, 10);
+        break;
+      case 'f':
+        if(strcmp(optarg, "table") == 0)        format = FORMAT_TABLE;
+        else if(strcmp(optarg, "csv") == 0)     format = FORMAT_CSV;
+        else if(strcmp(optarg, "events") == 0)  format = FORMAT_EVENTS;
+        else if(strcmp(optarg, "trace") == 0)   format = FORMAT_TRACE;
+        else { usage(); return 1; }
+        break;
+      case 'l':
+        ch_seq = (strcmp(optarg, "v0.4") == 0) ? ch_seq_v0_4 : ch_seq_v1_0;
+        break;
+      case 'w':
+        record_path = optarg;
+        break;
+      default:
+        usage();
+        return 1;
+    }
+  }
+
+  if(optind >= argc)
+  {
+    usage();
+    return 1;
+  }
+
+  int fd = STDIN_FILENO;
+  if(strcmp(argv[optind], "-") != 0)
+  {
+    fd = open(argv[optind], O_RDONLY | O_NOCTTY);
+    if(fd < 0)
+    {
+      perror(argv[optind]);
+      return 1;
+    }
+    if(isatty(fd) && !configure_serial(fd, baud))
+    {
+      fprintf(stderr, "Could not configure %s\n", argv[optind]);
+      return 1;
+    }
+  }
+
+  if(record_path)
+  {
+    struct sigaction action;
+
+    if(!writer.open(record_path))
+    {
+      perror(record_path);
+      return 1;
+    }
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = on_signal;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+  }
+
+  if(format == FORMAT_CSV)
+  {
+    print_csv_header();
+  }
+  else if(format == FORMAT_TRACE)
+  {
+    fwrite(IQS9320_TRACE_MAGIC, 1, IQS9320_TRACE_MAGIC_SIZE, stdout);
+  }
+
+  IQS9320StreamReader reader;
+  uint8_t buffer[256];
+  uint8_t last_seq = 0;
+  bool have_seq = false;
+  uint32_t dropped = 0;
+  uint32_t records = 0;
+  ssize_t n;
+
+  while((n = read(fd, buffer, sizeof(buffer))) > 0)
+  {
+    for(ssize_t i = 0; i < n; i++)
+    {
+      if(!reader.feed(buffer[i]))
+      {
+        continue;
+      }
+
+      /* Trace records carry no sequence number, they are passed through as is */
+      if(reader.packet.type == IQS9320_STREAM_TYPE_TRACE)
+      {
+        if(format == FORMAT_TRACE)
+        {
+          fwrite(&reader.payload[1], 1, reader.payload_length - 1, stdout);
+          records++;
+        }
+        continue;
+      }
+
+      const iqs9320_stream_packet_s *p = &reader.packet;
+      if(have_seq)
+      {
+        dropped += (uint8_t)(p->seq - last_seq - 1);
+      }
+      last_seq = p->seq;
+      have_seq = true;
+
+      if(record_path)
+      {
+        record(&writer, p);
+      }
+
+      switch(format)
+      {
+        case FORMAT_TABLE:  print_table(p, ch_seq); break;
+        case FORMAT_CSV:    print_csv(p);           break;
+        case FORMAT_TRACE:                          break;
+        default:            print_event(p);         break;
+      }
+    }
+    fflush(stdout);
+  }
+
+  fprintf(stderr, "%u packets, %u rejected, %u lost (sequence gaps)\n",
+          (unsigned)reader.packets_ok, (unsigned)reader.packets_bad, (unsigned)dropped);
+  if(format == FORMAT_TRACE)
+  {
+    fprintf(stderr, "%u trace records written\n", (unsigned)records);
+  }
+  if(record_path)
+  {
+    writer.close();
+    fprintf(stderr, "%llu frames recorded in %llu bytes\n", (unsigned long long)writer.frames(), (unsigned long long)writer.bytes());
+  }
+
+  return 0;
+}
@@ -0,0 +1,842 @@
+/******************************************************************************
+ *                                                                            *
+ *                                Copyright by                                *
+ *                                                                            *
+ *                              Azoteq (Pty) Ltd                              *
+ *                          Republic of South Africa                          *
+ *                                                                            *
+ *                           Tel: +27(0)21 863 0033                           *
+ *                           E-mail: info@azoteq.com                          *
+ *                                                                            *
+ * ========================================================================== *
+ * @file        iqs9320_tune.cpp                                              *
+ * @brief       Offline threshold tuner. Replays a frame recording through    *
+ *              the software model of IQS9320_model.h for every combination   *
+ *              of the swept settings, on all cores, ranks the settings by    *
+ *              false and missed activations against labelled key presses     *
+ *              and writes the best settings as an init header or as a table  *
+ *              of register blocks.                                           *
+ *                                                                            *
+ *              Usage: iqs9320-tune [options] <recording>                     *
+ *                -l <file>     Labelled presses, one per line:               *
+ *                              <channel> <start s> <end s>, in seconds from  *
+ *                              the start of the recording. Without labels    *
+ *                              the recorded activation flags are the         *
+ *                              reference.                                    *
+ *                -p <header>   Init header with the base settings, e.g.      *
+ *                              IQS9320_v1_0_init.h, also used as template    *
+ *                              for -o                                        *
+ *                -S <slot>     Device slot in the recording (default first)  *
+ *                -T a:b:step   Activation thresholds to sweep (16:128:4)     *
+ *                -H a:b:step   Hysteresis values to sweep (0:8:2)            *
+ *                -R a:b:step   Reference halt thresholds to sweep (8:64:8)   *
+ *                -O a:b:step   Reference halt timeouts to sweep, in s        *
+ *                              (default: the base setting)                   *
+ *                -i            Refine the individual threshold of every      *
+ *                              channel after the sweep                       *
+ *                -V            Validate the model: replay the recording with *
+ *                              the settings of -p and compare the flags with *
+ *                              the recorded ones                             *
+ *                -t <ms>       Match tolerance around a label (default 50)   *
+ *                -w <n>        Weight of a missed press against a false      *
+ *                              activation (default 1)                        *
+ *                -n <n>        Settings to list (default 10)                 *
+ *                -j <n>        Worker threads (default: all cores)           *
+ *                -f <format>   header | table output format (default header) *
+ *                -o <file>     Write the best settings, - for stdout         *
+ *                                                                            *
+ *              The filter betas (BETA_*) are not swept. CH_NORM_DELTA is     *
+ *              the output of the counts filter and the long-term average of  *
+ *              the device, so a recording of it already holds the effect of  *
+ *              the betas it was made with, and replaying it cannot show a    *
+ *              different beta. Tune the betas on the device.                 *
+ *                                                                            *
+ *              Build (Linux/macOS):                                          *
+ *                g++ -O2 -pthread -I../../src/IQS9320 iqs9320_tune.cpp       *
+ *                    ../../src/IQS9320/IQS9320_model.cpp                     *
+ *                    ../../src/IQS9320/IQS9320_record.cpp -o iqs9320-tune    *
+ * @author      Azoteq PTY Ltd                                                *
+ * @version     v1.5.3                                                        *
+ * @date        2024                                                          *
+ *****************************************************************************/
+
+/* Include Files */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "IQS9320_model.h"
+#include "IQS9320_record.h"
+
+/* Register blocks of the tuned settings (v0.7 and v1.0 memory map) */
+#define TUNE_MM_INDIVIDUAL_THRESHOLDS   0x30F0
+#define TUNE_MM_THRESHOLDS              0x3136
+#define TUNE_MM_HALT_TIMEOUT            0x3144
+#define TUNE_MM_HYSTERESIS              0x3145
+
+/* Effective max delta used to normalise recordings without normalised deltas */
+#define TUNE_MAX_DELTA_DEFAULT          10000
+
+/* Frames given to IQS9320Model::processBlock() at a time */
+#define TUNE_BLOCK_FRAMES               4096
+
+/* Output formats */
+typedef enum {
+        FORMAT_HEADER = 0,
+        FORMAT_TABLE,
+} format_e;
+
+/**
+* @brief  A swept range, first to last in steps.
+*/
+typedef struct
+{
+        int first;
+        int last;
+        int step;
+} tune_range_s;
+
+/**
+* @brief  A labelled press of one channel, in ms from the first frame.
+*/
+typedef struct
+{
+        uint32_t start;
+        uint32_t end;
+} tune_press_s;
+
+/**
+* @brief  Replay data of one device: timestamps and normalised deltas.
+*/
+typedef struct
+{
+        uint8_t nChannels;
+        std::vector<uint32_t> time_ms;
+        std::vector<uint8_t> norm;                      // nChannels per frame
+        std::vector<uint32_t> activation;               // Recorded flags per frame
+        std::vector<uint32_t> filter_halt;
+        bool normalised;                                // Norm was recorded
+        std::vector<tune_press_s> presses[IQS9320_MODEL_MAX_CHANNELS];
+        double duration_h;
+} tune_data_s;
+
+/**
+* @brief  Errors of one setting, in total and per channel.
+*/
+typedef struct
+{
+        iqs9320_model_config_s config;
+        uint32_t false_activations;
+        uint32_t missed;
+        uint64_t latency_ms;                            // Sum over detected presses
+        uint32_t detected;
+        uint32_t channel_false[IQS9320_MODEL_MAX_CHANNELS];
+        uint32_t channel_missed[IQS9320_MODEL_MAX_CHANNELS];
+        double score;
+} tune_result_s;
+
+/* Options shared by the workers */
+static uint32_t tolerance_ms = 50;
+static double miss_weight = 1.0;
+
+/*****************************************************************************/
+/*                                  INPUT                                    */
+/*****************************************************************************/
+static bool parse_range(const char *text, tune_range_s *range)
+{
+  int n = sscanf(text, "%d:%d:%d", &range->first, &range->last, &range->step);
+
+  if(n == 1)
+  {
+    range->last = range->first;
+    range->step = 1;
+  }
+  return (n == 1 || n == 3) && (range->step > 0) && (range->first <= range->last)
+         && (range->first >= 0) && (range->last <= 255);
+}
+
+/* Values of '#define NAME 0xNN' lines */
+static bool header_value(const std::vector<std::string> &lines, const char *name, uint8_t *value)
+{
+  size_t length = strlen(name);
+
+  for(size_t i = 0; i < lines.size(); i++)
+  {
+    const char *p = lines[i].c_str();
+
+    if(strncmp(p, "#define", 7) != 0)
+    {
+      continue;
+    }
+    p += 7;
+    while(*p == ' ' || *p == '\t')
+    {
+      p++;
+    }
+    if((strncmp(p, name, length) == 0) && (p[length] == ' ' || p[length] == '\t'))
+    {
+      *value = (uint8_t)strtol(p + length, NULL, 0);
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool read_lines(const char *path, std::vector<std::string> *lines)
+{
+  FILE *f = fopen(path, "r");
+  char line[512];
+
+  if(!f)
+  {
+    return false;
+  }
+  while(fgets(line, sizeof(line), f))
+  {
+    lines->push_back(line);
+  }
+  fclose(f);
+  return true;
+}
+
+/* Base settings from an init header, v1.0 defaults for missing values */
+static void base_config(const std::vector<std::string> &header, iqs9320_model_config_s *config, uint16_t max_delta[])
+{
+  char name[48];
+
+  config->activation_threshold = 0x28;
+  config->hysteresis = 0x05;
+  config->halt_threshold = 0x14;
+  config->halt_timeout = 0x27;
+  header_value(header, "ACTIVATION_THRESHOLD", &config->activation_threshold);
+  header_value(header, "ACTIVATION_HYSTERESIS_0", &config->hysteresis);
+  header_value(header, "REFERENCE_HALT_THRESHOLD", &config->halt_threshold);
+  header_value(header, "REF_HALT_TIMEOUT_0", &config->halt_timeout);
+
+  for(uint8_t ch = 0; ch < IQS9320_MODEL_MAX_CHANNELS; ch++)
+  {
+    uint8_t low;
+    uint8_t high;
+
+    config->individual_threshold[ch] = 0;
+    snprintf(name, sizeof(name), "INDIVIDUAL_THRESHOLDS_%u", ch);
+    header_value(header, name, &config->individual_threshold[ch]);
+
+    max_delta[ch] = TUNE_MAX_DELTA_DEFAULT;
+    snprintf(name, sizeof(name), "MAX_DELTA_E_%u_0", ch);
+    if(header_value(header, name, &low))
+    {
+      snprintf(name, sizeof(name), "MAX_DELTA_E_%u_1", ch);
+      if(header_value(header, name, &high) && (low | high))
+      {
+        max_delta[ch] = (uint16_t)(low | (high << 8));
+      }
+    }
+  }
+}
+
+/* Frames of one slot, deltas are normalised when no normalised delta was recorded */
+static bool load_recording(const char *path, int slot, const uint16_t max_delta[], tune_data_s *data)
+{
+  IQS9320RecordReader reader;
+  iqs9320_record_frame_s frame;
+  uint64_t first_us = 0;
+  bool first = true;
+
+  if(!reader.open(path))
+  {
+    return false;
+  }
+
+  data->nChannels = 0;
+  data->normalised = true;
+  while(reader.next(&frame))
+  {
+    uint8_t norm[IQS9320_MODEL_MAX_CHANNELS];
+
+    if(slot < 0)
+    {
+      slot = frame.slot;
+    }
+    if((frame.slot != slot) || !(frame.fields & (IQS9320_RECORD_DELTA | IQS9320_RECORD_NORM)))
+    {
+      continue;
+    }
+    if(first)
+    {
+      first_us = frame.timestamp_us;
+      data->nChannels = (frame.nChannels > IQS9320_MODEL_MAX_CHANNELS) ? IQS9320_MODEL_MAX_CHANNELS : frame.nChannels;
+      first = false;
+    }
+
+    data->normalised &= ((frame.fields & IQS9320_RECORD_NORM) != 0);
+    for(uint8_t ch = 0; ch < data->nChannels; ch++)
+    {
+      if(frame.fields & IQS9320_RECORD_NORM)
+      {
+        norm[ch] = frame.norm[ch];
+      }
+      else
+      {
+        int32_t value = (frame.delta[ch] > 0) ? ((int32_t)frame.delta[ch] * 255) / max_delta[ch] : 0;
+        norm[ch] = (uint8_t)((value > 255) ? 255 : value);
+      }
+    }
+    data->time_ms.push_back((uint32_t)((frame.timestamp_us - first_us) / 1000ULL));
+    data->norm.insert(data->norm.end(), norm, norm + data->nChannels);
+    data->activation.push_back(frame.activation);
+    data->filter_halt.push_back(frame.filter_halt);
+  }
+
+  data->duration_h = data->time_ms.empty() ? 0.0 : (double)data->time_ms.back() / 3600000.0;
+  return !data->time_ms.empty();
+}
+
+static bool load_labels(const char *path, tune_data_s *data)
+{
+  std::vector<std::string> lines;
+
+  if(!read_lines(path, &lines))
+  {
+    return false;
+  }
+  for(size_t i = 0; i < lines.size(); i++)
+  {
+    unsigned ch;
+    double start;
+    double end;
+
+    if((lines[i][0] == '#') || (sscanf(lines[i].c_str(), "%u %lf %lf", &ch, &start, &end) != 3))
+    {
+      continue;
+    }
+    if((ch < data->nChannels) && (end >= start))
+    {
+      tune_press_s press = {(uint32_t)(start * 1000.0), (uint32_t)(end * 1000.0)};
+      data->presses[ch].push_back(press);
+    }
+  }
+  for(uint8_t ch = 0; ch < IQS9320_MODEL_MAX_CHANNELS; ch++)
+  {
+    std::sort(data->presses[ch].begin(), data->presses[ch].end(),
+              [](const tune_press_s &a, const tune_press_s &b) { return a.start < b.start; });
+  }
+  return true;
+}
+
+/* Without labels, the activations reported by the device are the presses */
+static void presses_from_flags(tune_data_s *data)
+{
+  const std::vector<uint32_t> &activation = data->activation;
+
+  for(uint8_t ch = 0; ch < data->nChannels; ch++)
+  {
+    bool active = false;
+    tune_press_s press = {0, 0};
+
+    for(size_t i = 0; i < activation.size(); i++)
+    {
+      bool now = (activation[i] >> ch) & 1;
+
+      if(now && !active)
+      {
+        press.start = data->time_ms[i];
+      }
+      if(!now && active)
+      {
+        press.end = data->time_ms[i];
+        data->presses[ch].push_back(press);
+      }
+      active = now;
+    }
+    if(active)
+    {
+      press.end = data->time_ms.back();
+      data->presses[ch].push_back(press);
+    }
+  }
+}
+
+/*****************************************************************************/
+/*                                EVALUATION                                 */
+/*****************************************************************************/
+/* Replay the data through the model in blocks and match its activations to the presses */
+static void evaluate(const tune_data_s *data, tune_result_s *result)
+{
+  IQS9320Model model;
+  iqs9320_model_block_s block;
+  uint32_t activation[TUNE_BLOCK_FRAMES];
+  size_t next[IQS9320_MODEL_MAX_CHANNELS];
+  bool matched[IQS9320_MODEL_MAX_CHANNELS];
+  uint32_t previous = 0;
+  size_t frames = data->time_ms.size();
+
+  model.begin(data->nChannels, &result->config);
+  result->false_activations = 0;
+  result->missed = 0;
+  result->latency_ms = 0;
+  result->detected = 0;
+  memset(result->channel_false, 0, sizeof(result->channel_false));
+  memset(result->channel_missed, 0, sizeof(result->channel_missed));
+  memset(next, 0, sizeof(next));
+  memset(matched, 0, sizeof(matched));
+
+  block.stride = data->nChannels;
+  block.activation = activation;
+  block.filter_halt = NULL;
+
+  for(size_t first = 0; first < frames; first += TUNE_BLOCK_FRAMES)
+  {
+    block.frames = (uint32_t)(((frames - first) < TUNE_BLOCK_FRAMES) ? (frames - first) : TUNE_BLOCK_FRAMES);
+    block.time_ms = &data->time_ms[first];
+    block.norm = &data->norm[first * data->nChannels];
+    model.processBlock(&block);
+
+    for(uint32_t n = 0; n < block.frames; n++)
+    {
+      uint32_t t = block.time_ms[n];
+      uint32_t onsets = activation[n] & ~previous;
+
+      previous = activation[n];
+
+      /* Only the channels that activated in this frame are matched */
+      while(onsets)
+      {
+        uint8_t ch = (uint8_t)__builtin_ctz(onsets);
+        const std::vector<tune_press_s> &presses = data->presses[ch];
+
+        onsets &= onsets - 1;
+
+        /* Presses that ended before this frame are done */
+        while((next[ch] < presses.size()) && (presses[next[ch]].end + tolerance_ms < t))
+        {
+          if(!matched[ch])
+          {
+            result->channel_missed[ch]++;
+          }
+          next[ch]++;
+          matched[ch] = false;
+        }
+
+        /* The first onset in a press detects it, any other onset is false */
+        if((next[ch] < presses.size()) && (t + tolerance_ms >= presses[next[ch]].start) && !matched[ch])
+        {
+          matched[ch] = true;
+          result->detected++;
+          result->latency_ms += (t > presses[next[ch]].start) ? (t - presses[next[ch]].start) : 0;
+        }
+        else
+        {
+          result->channel_false[ch]++;
+        }
+      }
+    }
+  }
+
+  /* Presses after the last activation of a channel */
+  for(uint8_t ch = 0; ch < data->nChannels; ch++)
+  {
+    for(size_t p = next[ch]; p < data->presses[ch].size(); p++)
+    {
+      if(!(matched[ch] && (p == next[ch])))
+      {
+        result->channel_missed[ch]++;
+      }
+    }
+    result->false_activations += result->channel_false[ch];
+    result->missed += result->channel_missed[ch];
+  }
+  result->score = (double)result->false_activations + miss_weight * (double)result->missed;
+}
+
+/* Agreement of the model with the flags in the recording */
+static int validate(const tune_data_s *data, const iqs9320_model_config_s *config)
+{
+  IQS9320Model model;
+  iqs9320_model_block_s block;
+  iqs9320_model_validation_s result;
+
+  block.frames = (uint32_t)data->time_ms.size();
+  block.stride = data->nChannels;
+  block.time_ms = data->time_ms.data();
+  block.norm = data->norm.data();
+  block.activation = NULL;
+  block.filter_halt = NULL;
+
+  model.begin(data->nChannels, config);
+  model.validate(&block, data->activation.data(), data->filter_halt.data(), &result);
+
+  printf("frames            %u%s\n", (unsigned)result.frames, data->normalised ? "" : " (normalised from the deltas)");
+  printf("activation flags  %.4f%% of the frames identical\n", 100.0 * result.activation_frames / result.frames);
+  printf("filter halt flags %.4f%% of the frames identical\n", 100.0 * result.halt_frames / result.frames);
+  if(result.first_mismatch >= 0)
+  {
+    printf("first difference  frame %d at %.3f s\n", (int)result.first_mismatch,
+           (double)data->time_ms[result.first_mismatch] / 1000.0);
+    printf("channel  activation  halt\n");
+    for(uint8_t ch = 0; ch < data->nChannels; ch++)
+    {
+      printf("CH%-2u     %10u  %4u\n", ch, (unsigned)result.activation_errors[ch], (unsigned)result.halt_errors[ch]);
+    }
+  }
+  return ((result.activation_frames == result.frames) && (result.halt_frames == result.frames)) ? 0 : 2;
+}
+
+static bool better(const tune_result_s &a, const tune_result_s &b)
+{
+  double la = a.detected ? (double)a.latency_ms / a.detected : 1e9;
+  double lb = b.detected ? (double)b.latency_ms / b.detected : 1e9;
+
+  if(a.score != b.score)
+  {
+    return a.score < b.score;
+  }
+  return la < lb;
+}
+
+/* Evaluate all results on the worker threads */
+static void run_parallel(const tune_data_s *data, std::vector<tune_result_s> *results, unsigned threads)
+{
+  std::atomic<size_t> index(0);
+  std::vector<std::thread> workers;
+
+  for(unsigned w = 0; w < threads; w++)
+  {
+    workers.push_back(std::thread([&]() {
+      size_t i;
+      while((i = index.fetch_add(1)) < results->size())
+      {
+        evaluate(data, &(*results)[i]);
+      }
+    }));
+  }
+  for(size_t w = 0; w < workers.size(); w++)
+  {
+    workers[w].join();
+  }
+}
+
+/*****************************************************************************/
+/*                                  OUTPUT                                   */
+/*****************************************************************************/
+static void print_result(const tune_result_s *r, const tune_data_s *data, unsigned presses)
+{
+  printf("%5u %4u %5u %5u  %6u %6u  %8.2f %6.2f%%  %7.1f\n",
+         r->config.activation_threshold, r->config.hysteresis, r->config.halt_threshold,
+         r->config.halt_timeout, r->false_activations, r->missed,
+         (data->duration_h > 0) ? (double)r->false_activations / data->duration_h : 0.0,
+         presses ? 100.0 * (double)r->missed / presses : 0.0,
+         r->detected ? (double)r->latency_ms / r->detected : 0.0);
+}
+
+/* Replace the value of a '#define NAME value' line, keeping its layout */
+static void set_define(std::vector<std::string> *lines, const char *name, uint8_t value)
+{
+  char text[96];
+  size_t length = strlen(name);
+
+  for(size_t i = 0; i < lines->size(); i++)
+  {
+    std::string &line = (*lines)[i];
+    size_t at = line.find(name);
+
+    if((line.compare(0, 7, "#define") == 0) && (at != std::string::npos)
+       && (at + length < line.size()) && (line[at + length] == ' ' || line[at + length] == '\t'))
+    {
+      size_t value_at = line.find_first_not_of(" \t", at + length);
+      size_t value_end = line.find_first_of(" \t\r\n", value_at);
+
+      snprintf(text, sizeof(text), "0x%02X", value);
+      line.replace(value_at, value_end - value_at, text);
+      return;
+    }
+  }
+
+  snprintf(text, sizeof(text), "#define %-41s0x%02X\n", name, value);
+  lines->push_back(text);
+}
+
+static void write_header(FILE *out, std::vector<std::string> lines, const iqs9320_model_config_s *config)
+{
+  char name[48];
+
+  if(lines.empty())
+  {
+    lines.push_back("/* Settings chosen by iqs9320-tune, copy into the IQS9320_init.h in use */\n");
+  }
+  set_define(&lines, "ACTIVATION_THRESHOLD", config->activation_threshold);
+  set_define(&lines, "REFERENCE_HALT_THRESHOLD", config->halt_threshold);
+  set_define(&lines, "REF_HALT_TIMEOUT_0", config->halt_timeout);
+  set_define(&lines, "ACTIVATION_HYSTERESIS_0", config->hysteresis);
+  for(uint8_t ch = 0; ch < IQS9320_MODEL_MAX_CHANNELS; ch++)
+  {
+    snprintf(name, sizeof(name), "INDIVIDUAL_THRESHOLDS_%u", ch);
+    set_define(&lines, name, config->individual_threshold[ch]);
+  }
+  for(size_t i = 0; i < lines.size(); i++)
+  {
+    fputs(lines[i].c_str(), out);
+  }
+}
+
+static void write_block(FILE *out, uint16_t address, const char *name, const uint8_t data[], uint8_t length)
+{
+  fprintf(out, "  {0x%04X, %2u, \"%s\", {", address, length, name);
+  for(uint8_t i = 0; i < length; i++)
+  {
+    fprintf(out, "%s0x%02X", i ? ", " : "", data[i]);
+  }
+  fprintf(out, "}},\n");
+}
+
+/* Register blocks in the layout of iqs9320_settings_block_s */
+static void write_table(FILE *out, const std::vector<std::string> &header, const iqs9320_model_config_s *config)
+{
+  uint8_t d[IQS9320_MODEL_MAX_CHANNELS];
+  uint8_t value;
+
+  fprintf(out, "/* Settings chosen by iqs9320-tune, written with IQS9320::writeRandomBytes16() */\n");
+  fprintf(out, "static const iqs9320_settings_block_s tuned_settings[] = {\n");
+
+  write_block(out, TUNE_MM_INDIVIDUAL_THRESHOLDS, "Individual Thresholds", config->individual_threshold, IQS9320_MODEL_MAX_CHANNELS);
+
+  d[0] = config->activation_threshold;
+  d[1] = config->halt_threshold;
+  d[2] = header_value(header, "FAST_REF_THRESHOLD", &value) ? value : 0x0A;
+  d[3] = header_value(header, "MOVEMENT_THRESHOLD", &value) ? value : 0x08;
+  write_block(out, TUNE_MM_THRESHOLDS, "Thresholds", d, 4);
+
+  write_block(out, TUNE_MM_HALT_TIMEOUT, "Reference Halt Timeout", &config->halt_timeout, 1);
+  write_block(out, TUNE_MM_HYSTERESIS, "Activation Hysteresis", &config->hysteresis, 1);
+  fprintf(out, "};\n");
+}
+
+/*****************************************************************************/
+/*                                   MAIN                                    */
+/*****************************************************************************/
+static void usage(void)
+{
+  fprintf(stderr, "Usage: iqs9320-tune [-l labels] [-p init.h] [-S slot] [-T a:b:s] [-H a:b:s] [-R a:b:s] [-O a:b:s]\n"
+                  "                    [-i] [-V] [-t ms] [-w weight] [-n list] [-j threads] [-f header|table] [-o file] <recording>\n");
+}
+
+int main(int argc, char *argv[])
+{
+  tune_range_s thresholds = {16, 128, 4};
+  tune_range_s hystereses = {0, 8, 2};
+  tune_range_s halts = {8, 64, 8};
+  tune_range_s timeouts = {-1, -1, 1};
+  const char *labels_path = NULL;
+  const char *header_path = NULL;
+  const char *output_path = NULL;
+  format_e format = FORMAT_HEADER;
+  unsigned threads = std::thread::hardware_concurrency();
+  unsigned list = 10;
+  bool refine = false;
+  bool check = false;
+  int slot = -1;
+  int opt;
+
+  while((opt = getopt(argc, argv, "l:p:S:T:H:R:O:iVt:w:n:j:f:o:h")) != -1)
+  {
+    bool ok = true;
+
+    switch(opt)
+    {
+      case 'l':  labels_path = optarg;                          break;
+      case 'p':  header_path = optarg;                          break;
+      case 'S':  slot = (int)strtol(optarg, NULL, 0);           break;
+      case 'T':  ok = parse_range(optarg, &thresholds);         break;
+      case 'H':  ok = parse_range(optarg, &hystereses);         break;
+      case 'R':  ok = parse_range(optarg, &halts);              break;
+      case 'O':  ok = parse_range(optarg, &timeouts);           break;
+      case 'i':  refine = true;                                 break;
+      case 'V':  check = true;                                  break;
+      case 't':  tolerance_ms = (uint32_t)strtoul(optarg, NULL, 10); break;
+      case 'w':  miss_weight = strtod(optarg, NULL);            break;
+      case 'n':  list = (unsigned)strtoul(optarg, NULL, 10);    break;
+      case 'j':  threads = (unsigned)strtoul(optarg, NULL, 10); break;
+      case 'f':
+        if(strcmp(optarg, "header") == 0)       format = FORMAT_HEADER;
+        else if(strcmp(optarg, "table") == 0)   format = FORMAT_TABLE;
+        else ok = false;
+        break;
+      case 'o':  output_path = optarg;                          break;
+      default:   ok = false;                                    break;
+    }
+    if(!ok)
+    {
+      usage();
+      return 1;
+    }
+  }
+  if(optind >= argc)
+  {
+    usage();
+    return 1;
+  }
+  threads = threads ? threads : 1;
+
+  /* Base settings and data */
+  std::vector<std::string> header;
+  iqs9320_model_config_s base;
+  uint16_t max_delta[IQS9320_MODEL_MAX_CHANNELS];
+  tune_data_s data;
+
+  if(header_path && !read_lines(header_path, &header))
+  {
+    perror(header_path);
+    return 1;
+  }
+  base_config(header, &base, max_delta);
+  if(timeouts.first < 0)
+  {
+    timeouts.first = timeouts.last = base.halt_timeout;
+  }
+
+  if(!load_recording(argv[optind], slot, max_delta, &data))
+  {
+    fprintf(stderr, "%s: no delta frames%s\n", argv[optind], (slot >= 0) ? " of this slot" : "");
+    return 1;
+  }
+  if(check)
+  {
+    return validate(&data, &base);
+  }
+  if(labels_path)
+  {
+    if(!load_labels(labels_path, &data))
+    {
+      perror(labels_path);
+      return 1;
+    }
+  }
+  else
+  {
+    presses_from_flags(&data);
+  }
+
+  unsigned presses = 0;
+  for(uint8_t ch = 0; ch < data.nChannels; ch++)
+  {
+    presses += (unsigned)data.presses[ch].size();
+  }
+  fprintf(stderr, "%zu frames of %u channels, %.2f h, %u %s presses\n", data.time_ms.size(), data.nChannels,
+          data.duration_h, presses, labels_path ? "labelled" : "recorded");
+
+  /* Every combination of the swept settings, the threshold applies to all channels */
+  std::vector<tune_result_s> results;
+  tune_result_s candidate;
+
+  memset(&candidate, 0, sizeof(candidate));
+  for(int t = thresholds.first; t <= thresholds.last; t += thresholds.step)
+  for(int h = hystereses.first; h <= hystereses.last; h += hystereses.step)
+  for(int r = halts.first; r <= halts.last; r += halts.step)
+  for(int o = timeouts.first; o <= timeouts.last; o += timeouts.step)
+  {
+    candidate.config = base;
+    candidate.config.activation_threshold = (uint8_t)t;
+    memset(candidate.config.individual_threshold, 0, sizeof(candidate.config.individual_threshold));
+    candidate.config.hysteresis = (uint8_t)h;
+    candidate.config.halt_threshold = (uint8_t)r;
+    candidate.config.halt_timeout = (uint8_t)o;
+    results.push_back(candidate);
+  }
+
+  struct timespec t0;
+  struct timespec t1;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  run_parallel(&data, &results, threads);
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  double elapsed = (double)(t1.tv_sec - t0.tv_sec) + (double)(t1.tv_nsec - t0.tv_nsec) * 1e-9;
+  fprintf(stderr, "%zu settings evaluated in %.2f s on %u threads (%.1f Mframes/s)\n", results.size(), elapsed, threads,
+          (double)results.size() * (double)data.time_ms.size() / elapsed / 1e6);
+
+  std::sort(results.begin(), results.end(), better);
+
+  printf("thres hyst  halt tmout   false missed  false/h   missed  latency\n");
+  for(size_t i = 0; (i < list) && (i < results.size()); i++)
+  {
+    print_result(&results[i], &data, presses);
+  }
+
+  tune_result_s best = results[0];
+
+  /* Channels are independent: one run per threshold gives the errors of
+  every channel at that threshold, each channel keeps its best one */
+  if(refine)
+  {
+    std::vector<tune_result_s> sweep;
+    double channel_best[IQS9320_MODEL_MAX_CHANNELS];
+
+    for(int t = thresholds.first; t <= thresholds.last; t += thresholds.step)
+    {
+      candidate = best;
+      memset(candidate.config.individual_threshold, (uint8_t)t, sizeof(candidate.config.individual_threshold));
+      sweep.push_back(candidate);
+    }
+    run_parallel(&data, &sweep, threads);
+
+    for(uint8_t ch = 0; ch < data.nChannels; ch++)
+    {
+      channel_best[ch] = (double)best.channel_false[ch] + miss_weight * (double)best.channel_missed[ch];
+      best.config.individual_threshold[ch] = best.config.activation_threshold;
+      for(size_t i = 0; i < sweep.size(); i++)
+      {
+        double score = (double)sweep[i].channel_false[ch] + miss_weight * (double)sweep[i].channel_missed[ch];
+        if(score < channel_best[ch])
+        {
+          channel_best[ch] = score;
+          best.config.individual_threshold[ch] = sweep[i].config.individual_threshold[ch];
+        }
+      }
+    }
+    evaluate(&data, &best);
+    printf("individual thresholds:");
+    for(uint8_t ch = 0; ch < data.nChannels; ch++)
+    {
+      printf(" %u", best.config.individual_threshold[ch]);
+    }
+    printf("\n");
+    print_result(&best, &data, presses);
+  }
+  else
+  {
+    for(uint8_t ch = 0; ch < IQS9320_MODEL_MAX_CHANNELS; ch++)
+    {
+      best.config.individual_threshold[ch] = best.config.activation_threshold;
+    }
+  }
+
+  if(output_path)
+  {
+    FILE *out = (strcmp(output_path, "-") == 0) ? stdout : fopen(output_path, "w");
+
+    if(!out)
+    {
+      perror(output_path);
+      return 1;
+    }
+    if(format == FORMAT_TABLE)
+    {
+      write_table(out, header, &best.config);
+    }
+    else
+    {
+      write_header(out, header, &best.config);
+    }
+    if(out != stdout)
+    {
+      fclose(out);
+    }
+  }
+
+  return 0;
+}